@@ -11,6 +11,7 @@
 #pragma link C++ namespace rb::data;
 #pragma link C++ namespace rb::hist;
 #pragma link C++ namespace rb::canvas;
+#pragma link C++ namespace rb::stats;
 #pragma link C++ class rb::Rint+;
 #pragma link C++ class rb::Signals+;
 #pragma link C++ class rb::HistSignals+;
@@ -26,6 +27,7 @@
 #pragma link C++ class rb::hist::Summary+;
 #pragma link C++ class rb::hist::Gamma+;
 #pragma link C++ class rb::hist::Bit+;
+#pragma link C++ class rb::hist::Variable+;
 #pragma link C++ class AxisIndices;
 
 #pragma link C++ defined_in "user/User.hxx";
@@ -0,0 +1,185 @@
+//! \file Affinity.cxx
+//! \brief Implements utils/Affinity.hxx
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <sched.h>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include "utils/Affinity.hxx"
+#include "utils/Error.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Helper Functions                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace
+{
+const char* gRoleNames[rb::Affinity::kNroles] = { "attach", "fill", "canvas" };
+// Settings of each role, guarded by gLock
+pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+std::string gSpecs[rb::Affinity::kNroles];
+cpu_set_t gMasks[rb::Affinity::kNroles];
+volatile UInt_t gGeneration = 0;
+// CPUs the process was started with, used for unpinned threads
+cpu_set_t gDefault;
+pthread_once_t gOnce = PTHREAD_ONCE_INIT;
+void init() {
+	if(sched_getaffinity(0, sizeof(gDefault), &gDefault)) {
+		CPU_ZERO(&gDefault);
+		for(Int_t i=0; i< CPU_SETSIZE; ++i) CPU_SET(i, &gDefault);
+	}
+}
+// Read the default mask while the only thread is still unpinned
+struct InitAtLoad { InitAtLoad() { pthread_once(&gOnce, init); } } init_at_load;
+
+// Parse "0-3,8" into \c mask
+Bool_t parse(const char* cpus, cpu_set_t& mask) {
+	CPU_ZERO(&mask);
+	const char* p = cpus;
+	while(*p) {
+		char* end;
+		const long first = strtol(p, &end, 10);
+		if(end == p || first < 0 || first >= CPU_SETSIZE) return false;
+		long last = first;
+		p = end;
+		if(*p == '-') {
+			const char* start = ++p;
+			last = strtol(start, &end, 10);
+			if(end == start || last < first || last >= CPU_SETSIZE) return false;
+			p = end;
+		}
+		for(long i = first; i<= last; ++i) CPU_SET(i, &mask);
+		if(*p == ',') ++p;
+		else if(*p) return false;
+	}
+	return CPU_COUNT(&mask) > 0;
+}
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::Affinity                                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::Affinity::Set() [static]                   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::Affinity::Set(Int_t role, const char* cpus) {
+	pthread_once(&gOnce, init);
+	if(role < 0 || role >= kNroles) {
+		err::Error("rb::Affinity::Set") << "Invalid role: " << role;
+		return false;
+	}
+	if(!cpus) cpus = "";
+	cpu_set_t mask = gDefault;
+	if(*cpus) {
+		if(!parse(cpus, mask)) {
+			err::Error("rb::Affinity::Set") << "Invalid CPU list \"" << cpus
+																			<< "\" (expected e.g. \"0-3,8\").";
+			return false;
+		}
+		cpu_set_t usable;
+		CPU_AND(&usable, &mask, &gDefault);
+		if(!CPU_EQUAL(&usable, &mask)) {
+			if(!CPU_COUNT(&usable)) {
+				err::Error("rb::Affinity::Set") << "None of the CPUs \"" << cpus << "\" are available.";
+				return false;
+			}
+			err::Warning("rb::Affinity::Set") << "Some of the CPUs \"" << cpus
+																				<< "\" aren't available and will be ignored.";
+			mask = usable;
+		}
+	}
+	pthread_mutex_lock(&gLock);
+	gSpecs[role] = cpus;
+	gMasks[role] = mask;
+	__sync_add_and_fetch(&gGeneration, 1);
+	pthread_mutex_unlock(&gLock);
+	return true;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::Affinity::Set() [static, by name]          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::Affinity::Set(const char* role, const char* cpus) {
+	for(Int_t i=0; i< kNroles; ++i) {
+		if(role && !strcmp(role, gRoleNames[i])) return Set(i, cpus);
+	}
+	err::Error("rb::Affinity::Set") << "Unknown role \"" << (role ? role : "")
+																	<< "\" (expected attach, fill or canvas).";
+	return false;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// std::string rb::Affinity::Get() [static]             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+std::string rb::Affinity::Get(Int_t role) {
+	if(role < 0 || role >= kNroles) return "";
+	pthread_mutex_lock(&gLock);
+	std::string out = gSpecs[role];
+	pthread_mutex_unlock(&gLock);
+	return out;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::Affinity::IsPinned() [static]              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::Affinity::IsPinned(Int_t role) {
+	return !Get(role).empty();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::Affinity::Apply() [static]                   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::Affinity::Apply(Int_t role) {
+	pthread_once(&gOnce, init);
+	cpu_set_t mask = gDefault;
+	if(role >= 0 && role < kNroles) {
+		pthread_mutex_lock(&gLock);
+		if(!gSpecs[role].empty()) mask = gMasks[role];
+		pthread_mutex_unlock(&gLock);
+	}
+	const Int_t error = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+	if(error) {
+		err::Warning("rb::Affinity::Apply") << "Couldn't pin a " << GetRoleName(role)
+																				<< " thread: " << strerror(error);
+	}
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// UInt_t rb::Affinity::GetGeneration() [static]        //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+UInt_t rb::Affinity::GetGeneration() {
+	return gGeneration;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// const char* rb::Affinity::GetRoleName() [static]      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+const char* rb::Affinity::GetRoleName(Int_t role) {
+	return role >= 0 && role < kNroles ? gRoleNames[role] : "other";
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::Affinity::ParseArgs() [static]               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::Affinity::ParseArgs(Int_t argc, char** argv) {
+	static const char prefix[] = "-pin-";
+	for(Int_t i=1; i< argc; ++i) {
+		const std::string arg = argv[i] ? argv[i] : "";
+		if(arg.compare(0, sizeof(prefix) - 1, prefix)) continue;
+		const std::string::size_type eq = arg.find('=');
+		if(eq == std::string::npos) {
+			err::Error("rb::Affinity") << "Expected -pin-ROLE=CPUS, got \"" << arg << "\".";
+			continue;
+		}
+		const std::string role = arg.substr(sizeof(prefix) - 1, eq - sizeof(prefix) + 1);
+		Set(role.c_str(), arg.substr(eq + 1).c_str());
+	}
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::Affinity::Print() [static]                   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::Affinity::Print(std::ostream& strm) {
+	for(Int_t i=0; i< kNroles; ++i) {
+		const std::string cpus = Get(i);
+		strm << "  " << gRoleNames[i] << ":\t" << (cpus.empty() ? "(unpinned)" : cpus) << "\n";
+	}
+	strm.flush();
+}
@@ -9,6 +9,7 @@
 #include <TDatime.h>
 #include "Rint.hxx"
 #include "Buffer.hxx"
+#include "Stats.hxx"
 
 extern void attach_sync();
 
@@ -24,6 +25,15 @@ namespace { void start_save(const std::string& save_fname) {
 		rb::gApp()->GetEvent(it->first)->
 			 StartSave(file, tname.str().c_str(), ttitle.str().c_str(), rb::gApp()->GetSaveHists());
 	}
+}
+// Move the histogram bins to the memory node of a pinned attach thread
+void place_histograms() {
+	if(!rb::Affinity::IsPinned(rb::Affinity::kAttach)) return;
+	rb::EventVector_t events = rb::gApp()->GetEventVector();
+	for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it) {
+		rb::Event* event = rb::gApp()->GetEvent(it->first);
+		if(event) event->GetHistManager()->Relocate();
+	}
 } }
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -35,7 +45,7 @@ namespace { void start_save(const std::string& save_fname) {
 // Constructor                                           //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 rb::attach::File::File(const char* filename, Bool_t stopAtEnd) :
-  rb::Thread(FILE_THREAD_NAME),
+  rb::Thread(FILE_THREAD_NAME, rb::Affinity::kAttach),
   kFileName(gSystem->ExpandPathName(filename)),
   kStopAtEnd(stopAtEnd)
 {
@@ -82,6 +92,7 @@ rb::attach::File::~File() {
 // void rb::attach::File::DoInThread()                   //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 void rb::attach::File::DoInThread() {
+	if(!ListAttached()) place_histograms(); // a list places them once for all of its files
 
   Bool_t open = fBuffer->OpenFile(kFileName);
   if(!open) {
@@ -89,11 +100,15 @@ void rb::attach::File::DoInThread() {
     return;
   }
 
+	rb::stats::ThreadScope stats_scope(FILE_THREAD_NAME);
 	Int_t nbuffers = 0;
-  while(FileAttached() || ListAttached()) { // loop over buffers in the file
+  while(!IsCancelled()) { // loop over buffers in the file
+		rb::stats::Timer timer;
     bool read_success = fBuffer->ReadBufferOffline();
+		timer.Lap(rb::stats::kRead);
     if (read_success) {
 			fBuffer->UnpackBuffer();
+			timer.Lap(rb::stats::kUnpack);
 			if(gApp()->GetSignals()) gApp()->GetSignals()->UpdateBufferCounter(nbuffers++);
 		}
     else if (kStopAtEnd) break; // we're done
@@ -124,7 +139,7 @@ void rb::attach::File::DoInThread() {
 // Constructor                                           //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 rb::attach::List::List(const char* filename) :
-  rb::Thread(LIST_THREAD_NAME),
+  rb::Thread(LIST_THREAD_NAME, rb::Affinity::kAttach),
   kListFileName(gSystem->ExpandPathName(filename)) {
 
   fBuffer = BufferSource::New();
@@ -150,7 +165,9 @@ void rb::attach::List::DoInThread() {
     Error("AttachList", "List file: %s not found.", kListFileName);
     return;
   }
-  while(ListAttached()) {
+	rb::stats::ThreadScope stats_scope(LIST_THREAD_NAME); // files in the list are counted here
+	place_histograms();
+  while(!IsCancelled()) {
     TString line;
     line.ReadLine(ifs);
     if(!ifs.good()) break;
@@ -161,6 +178,7 @@ void rb::attach::List::DoInThread() {
 
     // Attach to the listed file //
     std::auto_ptr<File> f (File::New(line.Data(), true));
+    f->ShareCancelToken(*this); // stop with the list
     f->DoInThread();
   }
   if(ListAttached())
@@ -188,7 +206,7 @@ namespace { TString get_ts_string() {
 	return time;
 }}
 rb::attach::Online::Online(const char* source, const char* other, char** others, int nothers) :
-  rb::Thread(ONLINE_THREAD_NAME),
+  rb::Thread(ONLINE_THREAD_NAME, rb::Affinity::kAttach),
   fSourceArg(source),
   fOtherArg(other),
   fOtherArgs(others),
@@ -224,15 +242,20 @@ rb::attach::Online::~Online() {
 // void rb::attach::Online::DoInThread()                 //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 void rb::attach::Online::DoInThread() {
+	place_histograms();
   Bool_t connected = fBuffer->ConnectOnline(fSourceArg, fOtherArg, fOtherArgs, fNumOthers);
   if (!connected) return;
 	if(gApp()->GetSignals())
 		 gApp()->GetSignals()->AttachedOnline(fSourceArg);
+	rb::stats::ThreadScope stats_scope(ONLINE_THREAD_NAME);
 	Int_t nbuffers = 0;
-  while (OnlineAttached()) {
+  while (!IsCancelled()) {
+		rb::stats::Timer timer;
     Bool_t readSuccess = fBuffer->ReadBufferOnline();
     if(!readSuccess) break;
+		timer.Lap(rb::stats::kRead);
     fBuffer->UnpackBuffer();
+		timer.Lap(rb::stats::kUnpack);
 		gApp()->GetSignals()->UpdateBufferCounter(nbuffers++);
   }
   fBuffer->DisconnectOnline();
@@ -5,6 +5,8 @@
 #include <TCanvas.h>
 #include "Rint.hxx"
 #include "Rootbeer.hxx"
+#include "Event.hxx"
+#include "CutGate.hxx"
 #include "hist/Hist.hxx"
 #include "utils/Timer.hxx"
 #include "utils/Thread.hxx"
@@ -34,7 +36,7 @@ class CanvasUpdate : public rb::Thread
 private:
 	 Int_t fRate; // update rate (seconds)
 	 CanvasUpdate(const char* name, Int_t rate) :
-		 rb::Thread(name), fRate(rate) {}
+		 rb::Thread(name, rb::Affinity::kCanvas), fRate(rate) {}
 public:
 	 ~CanvasUpdate() {}
 	 static void CreateAndRun(const char* name, Int_t rate) {
@@ -43,12 +45,23 @@ public:
 	 }
 	 void DoInThread() {
 		 rb::Timer t(fRate);
-		 while(rb::Thread::IsRunning(fName)) {
+		 while(!IsCancelled()) {
 			 if(t.Check()) rb::canvas::UpdateAll();
 		 }
 	 }
 };
 
+/// Apply any buffered fills, so that what gets drawn is current.
+/// \note Must be called without holding the TThread global mutex, since
+/// the managers lock their own mutex before it.
+void FlushFillBuffers() {
+	rb::EventVector_t events = rb::gApp()->GetEventVector();
+	for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it) {
+		rb::Event* event = rb::gApp()->GetEvent(it->first);
+		if(event) event->GetHistManager()->FlushAll();
+	}
+}
+
 inline void SendUpdate(TVirtualPad* pad) {
 	pad->Update();
 }
@@ -103,6 +116,8 @@ void ClearPad(TVirtualPad* pad) {
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 
 void rb::canvas::UpdateCurrent() {
+  rb::CutGate::Touch(); // cuts drawn on it may have been edited
+  FlushFillBuffers();
   CANVAS_LOCKGUARD;
   if(gPad) {
     gPad->Modified();
@@ -111,6 +126,8 @@ void rb::canvas::UpdateCurrent() {
 }
 
 void rb::canvas::UpdateAll() {
+  rb::CutGate::Touch(); // cuts drawn on them may have been edited
+  FlushFillBuffers();
   TPad* pInitial = dynamic_cast<TPad*>(gPad);
   TPad* pad;
   for(Int_t i=0; i< gROOT->GetListOfCanvases()->GetEntries(); ++i) {
@@ -0,0 +1,186 @@
+//! \file CutGate.cxx
+//! \brief Implements CutGate.hxx
+#include <cmath>
+#include <algorithm>
+#include <TROOT.h>
+#include <TMath.h>
+#include <TCutG.h>
+#include <TString.h>
+#include "CutGate.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Helper Functions                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace
+{
+// Remove all whitespace
+inline std::string strip(const char* str) {
+	return TString(str).ReplaceAll(" ", "").ReplaceAll("\t", "").Data();
+}
+// Remove any number of enclosing parentheses
+std::string strip_parens(std::string str) {
+	while(str.size() > 1 && str[0] == '(' && str[str.size()-1] == ')')
+		 str = str.substr(1, str.size()-2);
+	return str;
+}
+// Check for a plain C identifier
+Bool_t is_identifier(const std::string& str) {
+	if(str.empty() || !(isalpha(str[0]) || str[0] == '_')) return false;
+	for(std::string::size_type i=1; i< str.size(); ++i)
+		 if(!(isalnum(str[i]) || str[i] == '_')) return false;
+	return true;
+}
+// Number of cells along an axis of length \c length divided into cells of width \c width
+Int_t ncells(Double_t length, Double_t width) {
+	if(!(length > 0)) return 1;
+	Double_t n = width > 0 ? std::ceil(length / width) : rb::CutRaster::kDefaultCells;
+	if(n < rb::CutRaster::kMinCells) n = rb::CutRaster::kMinCells;
+	if(n > rb::CutRaster::kMaxCells) n = rb::CutRaster::kMaxCells;
+	return Int_t(n);
+}
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::CutRaster                                         //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor                                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::CutRaster::CutRaster(const TCutG* cut, Double_t dx, Double_t dy):
+	fX(cut->GetX(), cut->GetX() + cut->GetN()), fY(cut->GetY(), cut->GetY() + cut->GetN()),
+	fXlow(0), fXhigh(-1), fYlow(0), fYhigh(-1), fNx(1), fNy(1), fScaleX(0), fScaleY(0),
+	fCells(1, kOutside)
+{
+	const Int_t npoints = fX.size();
+	if(npoints == 0) return; // empty bounding box, everything is outside
+
+	fXlow = *std::min_element(fX.begin(), fX.end());
+	fXhigh = *std::max_element(fX.begin(), fX.end());
+	fYlow = *std::min_element(fY.begin(), fY.end());
+	fYhigh = *std::max_element(fY.begin(), fY.end());
+
+	fNx = ncells(fXhigh - fXlow, dx);
+	fNy = ncells(fYhigh - fYlow, dy);
+	fScaleX = fXhigh > fXlow ? fNx / (fXhigh - fXlow) : 0;
+	fScaleY = fYhigh > fYlow ? fNy / (fYhigh - fYlow) : 0;
+
+	// Classify every cell by its center, then flag the ones the boundary passes through
+	fCells.assign(fNx*fNy, kOutside);
+	for(Int_t iy=0; iy< fNy; ++iy) {
+		const Double_t y = fScaleY ? fYlow + (iy + 0.5) / fScaleY : fYlow;
+		for(Int_t ix=0; ix< fNx; ++ix) {
+			const Double_t x = fScaleX ? fXlow + (ix + 0.5) / fScaleX : fXlow;
+			fCells[iy*fNx + ix] = IsInsideExact(x, y) ? kInside : kOutside;
+		}
+	}
+	for(Int_t i=0; i< npoints; ++i) {
+		const Int_t j = i == 0 ? npoints - 1 : i - 1; // closing segment included, as in TMath::IsInside()
+		MarkSegment(fX[j], fY[j], fX[i], fY[i]);
+	}
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::CutRaster::MarkSegment()                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::CutRaster::MarkSegment(Double_t x0, Double_t y0, Double_t x1, Double_t y1) {
+	// Work in cell units
+	Double_t u0 = (x0 - fXlow) * fScaleX, u1 = (x1 - fXlow) * fScaleX;
+	Double_t v0 = (y0 - fYlow) * fScaleY, v1 = (y1 - fYlow) * fScaleY;
+	if(u0 > u1) { std::swap(u0, u1); std::swap(v0, v1); }
+
+	// Walk the columns spanned by the segment, marking the rows it covers in each one.
+	// One extra cell on every side takes care of segments lying on cell boundaries and
+	// of rounding in the conversion to cell units.
+	const Int_t cfirst = std::max(Int_t(std::floor(u0)) - 1, 0);
+	const Int_t clast  = std::min(Int_t(std::floor(u1)) + 1, fNx - 1);
+	for(Int_t c = cfirst; c <= clast; ++c) {
+		Double_t va = v0, vb = v1;
+		if(u1 > u0) {
+			const Double_t ua = std::max(Double_t(c), u0), ub = std::min(Double_t(c+1), u1);
+			if(ua > ub) va = vb = (c < u0 ? v0 : v1); // padding column
+			else {
+				va = v0 + (v1 - v0) * (ua - u0) / (u1 - u0);
+				vb = v0 + (v1 - v0) * (ub - u0) / (u1 - u0);
+			}
+		}
+		if(va > vb) std::swap(va, vb);
+		const Int_t rfirst = std::max(Int_t(std::floor(va)) - 1, 0);
+		const Int_t rlast  = std::min(Int_t(std::floor(vb)) + 1, fNy - 1);
+		for(Int_t r = rfirst; r <= rlast; ++r) fCells[r*fNx + c] = kEdge;
+	}
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::CutRaster::IsInsideExact()                 //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::CutRaster::IsInsideExact(Double_t x, Double_t y) const {
+	if(fX.empty()) return false;
+	return TMath::IsInside(x, y, Int_t(fX.size()), const_cast<Double_t*>(&fX[0]), const_cast<Double_t*>(&fY[0]));
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::CutRaster::Matches()                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::CutRaster::Matches(const TCutG* cut) const {
+	if(cut->GetN() != Int_t(fX.size())) return false;
+	return std::equal(fX.begin(), fX.end(), cut->GetX()) && std::equal(fY.begin(), fY.end(), cut->GetY());
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::CutGate                                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+volatile UInt_t rb::CutGate::fgEpoch = 0;
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor                                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::CutGate::CutGate(const TCutG* cut, Bool_t negate, TTreeFormula* formx, TTreeFormula* formy):
+	fName(cut->GetName()), fVarX(strip(cut->GetVarX())), fVarY(strip(cut->GetVarY())), fNegate(negate),
+	fFormulaX(formx), fFormulaY(formy), fRaster(new CutRaster(cut)), fDx(0), fDy(0), fNeval(0), fEpoch(fgEpoch),
+	fValid(formx && formy && formx->GetNdim() && formy->GetNdim())
+{ }
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Destructor                                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::CutGate::~CutGate() { }
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// TCutG* rb::CutGate::Parse() [static]                  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+TCutG* rb::CutGate::Parse(const std::string& formula, Bool_t& negate) {
+	std::string name = strip_parens(strip(formula.c_str()));
+	negate = false;
+	if(!name.empty() && name[0] == '!') {
+		negate = true;
+		name = strip_parens(name.substr(1));
+	}
+	if(!is_identifier(name)) return 0;
+	TCutG* cut = dynamic_cast<TCutG*>(gROOT->GetListOfSpecials()->FindObject(name.c_str()));
+	return (cut && cut->GetN() >= 3) ? cut : 0;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::CutGate::SetResolution()                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::CutGate::SetResolution(const std::string& varx, Double_t dx, const std::string& vary, Double_t dy) {
+	if(strip(varx.c_str()) != fVarX || strip(vary.c_str()) != fVarY) return;
+	fDx = dx; fDy = dy;
+	TCutG* cut = dynamic_cast<TCutG*>(gROOT->GetListOfSpecials()->FindObject(fName.c_str()));
+	if(cut && cut->GetN() >= 3) fRaster.reset(new CutRaster(cut, fDx, fDy));
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::CutGate::Refresh()                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::CutGate::Refresh() {
+	fNeval = 0;
+	fEpoch = fgEpoch;
+	if(!fFormulaX->GetNdim() || !fFormulaY->GetNdim()) { fValid = false; return; }
+	TCutG* cut = dynamic_cast<TCutG*>(gROOT->GetListOfSpecials()->FindObject(fName.c_str()));
+	if(!cut || cut->GetN() < 3 || strip(cut->GetVarX()) != fVarX || strip(cut->GetVarY()) != fVarY) {
+		fValid = false;
+		return;
+	}
+	if(!fRaster->Matches(cut)) fRaster.reset(new CutRaster(cut, fDx, fDy));
+	fValid = true;
+}
@@ -0,0 +1,147 @@
+//! \file CutGate.hxx
+//! \brief Defines classes for fast evaluation of gates on TCutG objects.
+#ifndef CUT_GATE_HXX
+#define CUT_GATE_HXX
+#include <string>
+#include <vector>
+#include <TTreeFormula.h>
+#include "utils/boost_scoped_ptr.h"
+
+// =========== Forward Declarations =========== //
+class TCutG;
+
+
+namespace rb
+{
+/// \brief Rasterized copy of a TCutG polygon.
+//! \details The polygon's bounding box is divided into a grid of cells, and each cell is
+//! classified once as being fully inside, fully outside, or crossed by an edge of the polygon.
+//! A point lookup is then a bounding box check and a table lookup; only points landing in an
+//! edge cell need the exact (crossing number) test, which uses the same algorithm as
+//! TCutG::IsInside() so that the answer is identical.
+class CutRaster
+{
+public:
+	 /// Cell classification codes
+	 enum { kOutside, kInside, kEdge };
+	 /// Number of cells per axis if no resolution is given
+	 static const Int_t kDefaultCells = 256;
+	 /// Limits on the number of cells per axis
+	 static const Int_t kMinCells = 8, kMaxCells = 1024;
+private:
+	 /// Vertex coordinates
+	 std::vector<Double_t> fX, fY;
+	 /// Bounding box
+	 Double_t fXlow, fXhigh, fYlow, fYhigh;
+	 /// Number of cells along each axis
+	 Int_t fNx, fNy;
+	 /// Cells per unit x and y
+	 Double_t fScaleX, fScaleY;
+	 /// Classification of each cell (x index runs fastest)
+	 std::vector<UChar_t> fCells;
+public:
+	 /// Copy the vertices of \c cut and build the raster
+	 //! \param dx, dy Cell widths; if zero, the bounding box is divided into kDefaultCells
+	 CutRaster(const TCutG* cut, Double_t dx = 0, Double_t dy = 0);
+	 /// Is (x, y) inside the polygon?
+	 Bool_t IsInside(Double_t x, Double_t y) const;
+	 /// Check that \c cut still has the vertices this raster was built from
+	 Bool_t Matches(const TCutG* cut) const;
+	 /// Return the number of cells along x
+	 Int_t GetNx() const { return fNx; }
+	 /// Return the number of cells along y
+	 Int_t GetNy() const { return fNy; }
+private:
+	 /// Exact point-in-polygon test
+	 Bool_t IsInsideExact(Double_t x, Double_t y) const;
+	 /// Mark every cell touched by the segment (x0, y0) - (x1, y1) as an edge cell
+	 void MarkSegment(Double_t x0, Double_t y0, Double_t x1, Double_t y1);
+};
+
+/// \brief Gate formula consisting of a single TCutG reference.
+//! \details Built by rb::TreeFormulae for formulae of the form \c "cut" or \c "!cut", which are
+//! the usual way of gating on PID polygons. The cut's x and y expressions are evaluated
+//! separately and looked up in a CutRaster instead of going through TTreeFormula's own
+//! TCutG::IsInside() call.
+//!
+//! The cut is looked up again by name, and the raster rebuilt if its points have been moved, at
+//! the first evaluation after Touch(), which is called whenever a cut is created, a TCutG on a
+//! canvas is released after being edited with the mouse, or the canvases are updated; that check
+//! costs Eval() a single comparison. Changes made any other way (e.g. TCutG::SetPoint() from CINT)
+//! are picked up by the same check every kCheckPeriod evaluations. If the cut has been deleted or
+//! its variables changed, Eval() returns false and the caller should fall back on the ordinary
+//! TTreeFormula.
+//! \note No locking is done here; rb::TreeFormulae calls this with gDataMutex held.
+class CutGate
+{
+public:
+	 /// Number of evaluations between checks for a modified cut
+	 static const UInt_t kCheckPeriod = 4096;
+private:
+	 /// Incremented by Touch()
+	 static volatile UInt_t fgEpoch;
+	 /// Name of the cut
+	 std::string fName;
+	 /// Cut x and y expressions
+	 std::string fVarX, fVarY;
+	 /// Is the gate the negation of the cut?
+	 Bool_t fNegate;
+	 /// Formulae for the cut's x and y expressions
+	 boost::scoped_ptr<TTreeFormula> fFormulaX, fFormulaY;
+	 /// Rasterized cut
+	 boost::scoped_ptr<CutRaster> fRaster;
+	 /// Requested cell widths (zero for default)
+	 Double_t fDx, fDy;
+	 /// Evaluations since the last check
+	 UInt_t fNeval;
+	 /// fgEpoch at the last check
+	 UInt_t fEpoch;
+	 /// Is the raster usable?
+	 Bool_t fValid;
+public:
+	 /// Set up the gate, taking ownership of the x and y formulae
+	 CutGate(const TCutG* cut, Bool_t negate, TTreeFormula* formx, TTreeFormula* formy);
+	 /// Destructor
+	 ~CutGate();
+	 /// Evaluate the gate
+	 //! \param [out] result 1 if the gate passes, 0 otherwise
+	 //! \returns false if the raster can't be used and the caller should evaluate the formula itself
+	 Bool_t Eval(Double_t& result);
+	 /// Rebuild the raster with cells matching a histogram's bins
+	 //! \details Only applied if \c varx and \c vary are the cut's variables
+	 void SetResolution(const std::string& varx, Double_t dx, const std::string& vary, Double_t dy);
+	 /// Have every gate check its cut at its next evaluation, e.g. after a cut may have been edited
+	 static void Touch() { __sync_fetch_and_add(&fgEpoch, 1); }
+	 /// Parse a gate formula of the form "cut" or "!cut"
+	 //! \returns The named TCutG, or 0 if the formula is anything else
+	 static TCutG* Parse(const std::string& formula, Bool_t& negate);
+private:
+	 /// Look the cut up by name and rebuild the raster if it has changed
+	 void Refresh();
+	 CutGate(const CutGate&);
+	 CutGate& operator= (const CutGate&);
+};
+}
+
+
+// ========= Inlined Functions ========= //
+inline Bool_t rb::CutRaster::IsInside(Double_t x, Double_t y) const {
+	if(x < fXlow || x > fXhigh || y < fYlow || y > fYhigh) return false;
+	const Int_t ix = Int_t((x - fXlow) * fScaleX), iy = Int_t((y - fYlow) * fScaleY);
+	if(ix >= fNx || iy >= fNy) return IsInsideExact(x, y);
+	switch(fCells[iy*fNx + ix]) {
+	case kInside:  return true;
+	case kOutside: return false;
+	default:       return IsInsideExact(x, y);
+	}
+}
+
+inline Bool_t rb::CutGate::Eval(Double_t& result) {
+	if(fEpoch != fgEpoch || ++fNeval >= kCheckPeriod) Refresh();
+	if(!fValid) return false;
+	const Bool_t inside = fRaster->IsInside(fFormulaX->EvalInstance(0), fFormulaY->EvalInstance(0));
+	result = (inside != fNegate);
+	return true;
+}
+
+#endif
@@ -1,11 +1,128 @@
 //! \file Data.cxx
 //! \brief Implements Data.hxx
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <fstream>
 #include <algorithm>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <TBaseClass.h>
 #include "Rint.hxx"
 #include "Data.hxx"
 #include "Utils/ANSort.hxx"
 
 
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Variable Index (Helper Functions)         //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace {
+// A mapped basic data member; arrays are a single leaf
+struct Leaf {
+	const rb::data::Layout::Leaf* fLayout;
+	Long_t fAddress; // of the first element
+};
+// Trie over the dot-separated parts of variable names, e.g. "det.adc.ch" -> det, adc, ch
+struct Node {
+	std::map<std::string, Node*> fChildren;
+	Leaf* fLeaf;
+	Node(): fLeaf(0) { }
+};
+// The index is written when classes are mapped and read by MBasic::Find(), GetAll() & GetAllValues(),
+// all guarded by gIndexLock (which also guards MBasic::fgAll()).
+pthread_mutex_t gIndexLock = PTHREAD_MUTEX_INITIALIZER;
+Node& index_root() { static Node* n = new Node(); return *n; }
+std::vector<std::pair<std::string, Leaf*> >& index_leaves() {
+	static std::vector<std::pair<std::string, Leaf*> >* v = new std::vector<std::pair<std::string, Leaf*> >();
+	return *v;
+}
+
+// Add a leaf under \c name; the first mapping of a name wins
+void index_add(const std::string& name, Leaf* leaf) {
+	Node* node = &index_root();
+	std::string::size_type begin = 0, end;
+	do {
+		end = name.find('.', begin);
+		Node*& child = node->fChildren[name.substr(begin, end - begin)];
+		if(!child) child = new Node();
+		node = child;
+		begin = end + 1;
+	} while(end != std::string::npos);
+	if(node->fLeaf) { delete leaf; return; }
+	node->fLeaf = leaf;
+	index_leaves().push_back(std::make_pair(name, leaf));
+}
+
+// Look up e.g. "det.adc.ch[3][1]", returning the leaf and the (row-major) element index
+Leaf* index_find(const std::string& name, Int_t& element) {
+	std::string::size_type bracket = name.find('[');
+	const std::string path = name.substr(0, bracket);
+	Node* node = &index_root();
+	std::string::size_type begin = 0, end;
+	do {
+		end = path.find('.', begin);
+		std::map<std::string, Node*>::const_iterator it = node->fChildren.find(path.substr(begin, end - begin));
+		if(it == node->fChildren.end()) return 0;
+		node = it->second;
+		begin = end + 1;
+	} while(end != std::string::npos);
+	Leaf* leaf = node->fLeaf;
+	if(!leaf) return 0;
+
+	element = 0;
+	Int_t dim = 0;
+	const char* p = name.c_str() + path.size();
+	while(*p) {
+		if(*p != '[' || dim == leaf->fLayout->fNdim) return 0;
+		// Only canonical indices ("ch[3]", not "ch[03]" or "ch[ 3]"), so each element has one name
+		if(!isdigit(static_cast<unsigned char>(p[1]))) return 0;
+		char* close;
+		const long i = strtol(p + 1, &close, 10);
+		if(*close != ']' || (p[1] == '0' && close != p + 2) || i >= leaf->fLayout->fDims[dim]) return 0;
+		element = element * leaf->fLayout->fDims[dim++] + i;
+		p = close + 1;
+	}
+	return dim == leaf->fLayout->fNdim ? leaf : 0;
+}
+
+// Append the name of each element of an array, in memory order, e.g. "ch[0][0]", "ch[0][1]", ...
+void append_names(const std::string& name, const Int_t* dims, Int_t ndim, std::vector<std::string>& out) {
+	for(Int_t i=0; i< ndim; ++i) if(dims[i] <= 0) return;
+	std::vector<Int_t> index(ndim, 0);
+	std::stringstream sstr;
+	Int_t j;
+	do {
+		sstr.str("");
+		sstr << name;
+		for(Int_t i=0; i< ndim; ++i) sstr << "[" << index[i] << "]";
+		out.push_back(sstr.str());
+		for(j = ndim - 1; j >= 0 && ++index[j] == dims[j]; --j) index[j] = 0;
+	} while(j >= 0);
+}
+
+// Read the value of type \c type at \c addr as Basic<type>::GetValue() does (without locking)
+Bool_t read_value(const std::string& type, Long_t addr, Double_t& value) {
+#define READ_TYPE(T)																										\
+	if(type == #T) { value = Double_t(*reinterpret_cast<volatile T*>(addr)); return true; }
+	READ_TYPE(double)
+	READ_TYPE(float)
+	READ_TYPE(long long)
+	READ_TYPE(long)
+	READ_TYPE(int)
+	READ_TYPE(short)
+	READ_TYPE(char)
+	READ_TYPE(bool)
+	READ_TYPE(unsigned long long)
+	READ_TYPE(unsigned long)
+	READ_TYPE(unsigned int)
+	READ_TYPE(unsigned short)
+	READ_TYPE(unsigned char)
+#undef READ_TYPE
+	return false;
+}
+}
+
+
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // Class                                 //
 // rb::data::MBasic Implementation       //
@@ -14,10 +131,11 @@
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // MBasic* rb::data::MBasic::New() [static]    //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-void rb::data::MBasic::New(const char* name, volatile void* addr, TDataMember* d) {
+rb::data::MBasic* rb::data::MBasic::New(const char* name, volatile void* addr, const char* type) {
+  rb::data::MBasic* m = 0;
 #define CHECK_TYPE(type)																								\
-  else if (!strcmp(d->GetTrueTypeName(), #type)) {											\
-    rb::data::MBasic* m = new rb::data::Basic<type> (name, addr, d);		\
+  else if (!strcmp(type, #type)) {																		\
+    m = new rb::data::Basic<type> (name, addr, type);										\
     if(!m) err::Error("data::MBasic::New") << "Constructor returned a NULL pointer"; }
   if(0);
   CHECK_TYPE(double)
@@ -35,23 +153,73 @@ void rb::data::MBasic::New(const char* name, volatile void* addr, TDataMember* d
 		 CHECK_TYPE(unsigned char)
   else;
 #undef CHECK_TYPE
+  return m;
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // rb::data::MBasic::GetAll() [static]         //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 std::vector<std::string> rb::data::MBasic::GetAll() {
 	std::vector<std::string> out;
-	for(Map_t::iterator it = fgAll().begin(); it != fgAll().end(); ++it) {
-		out.push_back(it->first);
+	pthread_mutex_lock(&gIndexLock);
+	for(UInt_t i=0; i< index_leaves().size(); ++i) {
+		const Layout::Leaf* leaf = index_leaves()[i].second->fLayout;
+		append_names(index_leaves()[i].first, leaf->fDims, leaf->fNdim, out);
 	}
+	pthread_mutex_unlock(&gIndexLock);
+	std::sort(out.begin(), out.end());
 	return out;
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::data::MBasic::GetAllValues() [static]   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+std::vector<rb::data::MBasic::Value> rb::data::MBasic::GetAllValues() {
+	// Names and addresses from the index; leaves and layouts are never deleted
+	std::vector<Value> out;
+	std::vector<Long_t> addresses;
+	std::vector<std::string> names;
+	pthread_mutex_lock(&gIndexLock);
+	for(UInt_t i=0; i< index_leaves().size(); ++i) {
+		const Leaf* leaf = index_leaves()[i].second;
+		names.clear();
+		append_names(index_leaves()[i].first, leaf->fLayout->fDims, leaf->fLayout->fNdim, names);
+		for(UInt_t k=0; k< names.size(); ++k) { // in memory order
+			out.push_back(Value());
+			out.back().fName.swap(names[k]);
+			out.back().fType = leaf->fLayout->fType;
+			addresses.push_back(leaf->fAddress + k * leaf->fLayout->fSize);
+		}
+	}
+	pthread_mutex_unlock(&gIndexLock);
+
+	// Values, all under one lock
+	std::vector<Value> known;
+	known.reserve(out.size());
+	{
+		rb::ScopedLock<rb::Mutex> lock(gDataMutex);
+		for(UInt_t i=0; i< out.size(); ++i) {
+			if(!read_value(out[i].fType, addresses[i], out[i].fValue)) continue; // no Basic<T> either
+			known.push_back(Value());
+			std::swap(known.back(), out[i]);
+		}
+	}
+	std::sort(known.begin(), known.end());
+	return known;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // MBasic* rb::data::MBasic::Find() [static]   //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 rb::data::MBasic* rb::data::MBasic::Find(const char* name) {
+	pthread_mutex_lock(&gIndexLock);
   rb::data::MBasic::Map_t::iterator it = fgAll().find(std::string(name));
-  return it != fgAll().end() ? it->second : 0;
+	MBasic* out = it != fgAll().end() ? it->second : 0;
+	Int_t element;
+	Leaf* leaf = out ? 0 : index_find(name, element);
+	if(leaf) { // first access: create the instance now
+		const Long_t addr = leaf->fAddress + element * leaf->fLayout->fSize;
+		out = New(name, reinterpret_cast<void*>(addr), leaf->fLayout->fType.c_str());
+	}
+	pthread_mutex_unlock(&gIndexLock);
+	return out;
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // Sub Class                             //
@@ -61,18 +229,23 @@ rb::data::MBasic* rb::data::MBasic::Find(const char* name) {
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::data::MBasic::Printer::SavePrimitive()   //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-namespace { ANSort ansort; }
+namespace { // Helper functions for the printers
+// Values of every variable, keyed by name, and their names in alpha-numeric order
+void get_sorted_values(std::map<std::string, rb::data::MBasic::Value>& values, std::vector<std::string>& names) {
+	std::vector<rb::data::MBasic::Value> all = rb::data::MBasic::GetAllValues();
+	names.clear();
+	for(UInt_t i=0; i< all.size(); ++i) {
+		names.push_back(all[i].fName);
+		values[all[i].fName] = all[i];
+	}
+	ANSort::Sort(names);
+} }
 void rb::data::MBasic::Printer::SavePrimitive(std::ostream& strm) {
-  if(fgAll().empty()) return;
-  rb::data::MBasic::Map_t::iterator it;
+	std::map<std::string, Value> values;
 	std::vector<std::string> names;
-  for(it = fgAll().begin(); it != fgAll().end(); ++it) {
-		names.push_back(it->first);
-	}
-	std::sort(names.begin(), names.end(), ansort);
+	get_sorted_values(values, names);
 	for(UInt_t i=0; i< names.size(); ++i) {
-		it = fgAll().find(names[i]);
-    strm << "  rb::Rb::Data::SetValue(\"" << it->first << "\", " << it->second->GetValue() << ");\n";
+    strm << "  rb::Rb::Data::SetValue(\"" << names[i] << "\", " << values[names[i]].fValue << ");\n";
   }
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -88,19 +261,15 @@ inline std::string double2str(Double_t d) {
 	return sstr.str();
 } }
 void rb::data::MBasic::Printer::PrintAll() {
-  if(fgAll().empty()) return;
+	std::map<std::string, Value> all;
   std::vector<std::string> names, values, classes;
-
-  rb::data::MBasic::Map_t::iterator it = fgAll().begin();
-  while(it != fgAll().end()) {
-    names.push_back(it->first); ++it;
-	}
-	std::sort(names.begin(), names.end(), ansort);
+	get_sorted_values(all, names);
+  if(names.empty()) return;
 
 	for(UInt_t i=0; i< names.size(); ++i) {
-		it = fgAll().find(names[i]);
-    values.push_back(double2str(it->second->GetValue()));
-    classes.push_back(it->second->fDataMember->GetTrueTypeName());
+		const Value& value = all[names[i]];
+    values.push_back(double2str(value.fValue));
+    classes.push_back(value.fType);
   }
   Int_t maxName  = max_element(names.begin(), names.end(), string_len_compare)->size();
   maxName = maxName > 4 ? maxName : 4;
@@ -118,122 +287,359 @@ void rb::data::MBasic::Printer::PrintAll() {
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // Class                                 //
-// rb::data::Mapper Implementation       //
+// rb::data::Staged Implementation       //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-namespace { // Helper Functions & Class //
-inline Bool_t ShouldBeMapped(TDataMember* d, bool exclude_hash = true) {
-	std::string title = d->GetTitle();
-	if(title.size() == 0) return true;
-	if(exclude_hash) return !(title[0] == '#');
-	else             return !(title[0] == '!');
-}
-class ArrayConverter // Class to reconstruct the original indices				       
-{		       // of a multi-dimensional array that has been flattened by TStreamerElements.
-public:	       // Gives us strings with the original indices in brackets.
-	 ArrayConverter(TDataMember* d);
-	 // Return the original indices.
-	 std::string GetFullName(const char* baseName, UInt_t index);
-	 Int_t GetArrayLength() { return fArrayLength; }
-private:
-	 TDataMember* fElement;
-	 std::vector<std::string> fIndices;
-	 Int_t fArrayLength;
-}; // class ArrayConverter
+namespace {
+typedef std::vector<std::pair<rb::data::MBasic*, Double_t> > Batch_t;
+// Changes waiting to be applied, guarded by gStagedLock
+pthread_mutex_t gStagedLock = PTHREAD_MUTEX_INITIALIZER;
+Batch_t& staging() { static Batch_t* b = new Batch_t(); return *b; }
+// Changes being applied, only touched with gDataMutex held
+Batch_t& applying() { static Batch_t* b = new Batch_t(); return *b; }
 }
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-// void rb::data::Mapper::HandleBasic()   //
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-void rb::data::Mapper::HandleBasic(TDataMember* d, const char* name) {
-  Long_t addr = kBase + d->GetOffset();
-  Int_t nDim = d->GetArrayDim();
-  if(nDim == 0) { // not an array
-    rb::data::MBasic::New(name, reinterpret_cast<void*>(addr), d);
-  }
-  else if(d->GetArrayDim() > 4) // too big
-		 Warning("MapData",
-						 "No support for arrays > 4 dimensions. The array %s is %d and will not be mapped!",
-						 name, d->GetArrayDim());
-  else {
-    ArrayConverter ac(d);
-    Int_t arrayLen = ac.GetArrayLength();
-    Int_t size = d->GetUnitSize();
-    for(Int_t i=0; i< arrayLen; ++i) {
-      addr += size*(i>0);
-      rb::data::MBasic::New(ac.GetFullName(name, i).c_str(), reinterpret_cast<void*>(addr), d);
-    }
-  }  
+volatile Int_t rb::data::Staged::fgPending = 0;
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::data::Staged::Add() [static]     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::data::Staged::Add(const std::map<std::string, Double_t>& values) {
+	Batch_t batch;
+	batch.reserve(values.size());
+	std::vector<std::string> missing;
+	for(std::map<std::string, Double_t>::const_iterator it = values.begin(); it != values.end(); ++it) {
+		MBasic* basic = MBasic::Find(it->first.c_str());
+		if(basic) batch.push_back(std::make_pair(basic, it->second));
+		else missing.push_back(it->first);
+	}
+	if(!missing.empty()) {
+		err::Error error("rb::data::Staged::Add");
+		error << "Unknown variable(s), no values were changed:";
+		for(UInt_t i=0; i< missing.size(); ++i) error << " " << missing[i];
+		return false;
+	}
+	pthread_mutex_lock(&gStagedLock);
+	staging().insert(staging().end(), batch.begin(), batch.end());
+	__sync_fetch_and_or(&fgPending, 1);
+	pthread_mutex_unlock(&gStagedLock);
+	return true;
 }
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-// void rb::data::Mapper::InsertBasic()   //
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-void rb::data::Mapper::InsertBasic(TDataMember* d, std::vector<std::string>& v_names, const char* name) {
-  Long_t addr = kBase + d->GetOffset();
-  Int_t nDim = d->GetArrayDim();
-  if(nDim == 0) { // not an array
-		v_names.push_back(name);
-  }
-  else if(d->GetArrayDim() > 4) // too big
-		 Warning("MapData",
-						 "No support for arrays > 4 dimensions. The array %s is %d and will not be mapped!",
-						 name, d->GetArrayDim());
-  else {
-    ArrayConverter ac(d);
-    Int_t arrayLen = ac.GetArrayLength();
-    Int_t size = d->GetUnitSize();
-    for(Int_t i=0; i< arrayLen; ++i) {
-      addr += size*(i>0);
-			v_names.push_back(ac.GetFullName(name, i).c_str());
-    }
-  }  
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::data::Staged::ApplyUnlocked() [static]      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::data::Staged::ApplyUnlocked() {
+	Batch_t& batch = applying();
+	batch.clear();
+	pthread_mutex_lock(&gStagedLock);
+	batch.swap(staging());
+	__sync_fetch_and_and(&fgPending, 0);
+	pthread_mutex_unlock(&gStagedLock);
+	// In staging order, so the latest of several changes to one variable wins
+	for(Batch_t::const_iterator it = batch.begin(); it != batch.end(); ++it) {
+		it->first->SetValueUnlocked(it->second);
+	}
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::data::Staged::Flush() [static]     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::data::Staged::Flush() {
+	if(!IsPending()) return;
+	rb::ScopedLock<rb::Mutex> lock(gDataMutex);
+	ApplyUnlocked();
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                 //
+// rb::data::Layout Implementation       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace { // Helper Functions //
+typedef std::map<std::string, rb::data::Layout*> LayoutMap_t;
+// Layouts in use, and ones read from the cache file but not yet checked against their
+// class, all guarded by gLayoutLock
+pthread_mutex_t gLayoutLock = PTHREAD_MUTEX_INITIALIZER;
+LayoutMap_t& layouts() { static LayoutMap_t* m = new LayoutMap_t(); return *m; }
+LayoutMap_t& cached_layouts() { static LayoutMap_t* m = new LayoutMap_t(); return *m; }
+Bool_t gCacheRead = false;
+// Off unless turned on by $RB_LAYOUT_CACHE, -layout-cache=FILE or Layout::SetCacheFile(); always
+// off on Darwin, where cache_header() can't identify the build (no /proc)
+std::string& cache_file() {
+#ifdef OS_DARWIN
+	static std::string* f = new std::string();
+#else
+	static std::string* f = new std::string(getenv("RB_LAYOUT_CACHE") ? getenv("RB_LAYOUT_CACHE") : "");
+#endif
+	return *f;
 }
+
+// Path of the file (executable or shared library) this code was loaded from
+std::string this_library() {
+	const unsigned long here = reinterpret_cast<unsigned long>(&this_library);
+	std::ifstream maps("/proc/self/maps");
+	std::string line;
+	while(std::getline(maps, line)) {
+		unsigned long begin, end;
+		if(sscanf(line.c_str(), "%lx-%lx", &begin, &end) != 2 || here < begin || here >= end) continue;
+		const std::string::size_type slash = line.find('/');
+		return slash < line.size() ? line.substr(slash) : "";
+	}
+	return "";
+}
+
+// Identifies the builds of the executable and of the library holding the user classes (which
+// are linked into it), whose dictionaries the cached layouts came from
+std::string cache_header() {
+	std::stringstream sstr;
+	struct stat st;
+	sstr << "# rootbeer class layouts 2, executable";
+	if(!stat("/proc/self/exe", &st)) sstr << " " << st.st_size << " " << st.st_mtime;
+	sstr << ", library";
+	if(!stat(this_library().c_str(), &st)) sstr << " " << st.st_size << " " << st.st_mtime;
+	return sstr.str();
+}
+
+void record_members(TClass* cl, rb::data::Layout& layout);
+
+// Record class \c cl and its base classes in \c layout (once each), with their checksums
+void record(TClass* cl, rb::data::Layout& layout) {
+	for(UInt_t i=0; i< layout.fClasses.size(); ++i)
+		 if(layout.fClasses[i].first == cl->GetName()) return;
+	layout.fClasses.push_back(std::make_pair(std::string(cl->GetName()), cl->GetCheckSum()));
+	TList* bases = cl->GetListOfBases();
+	for(Int_t i=0; bases && i< bases->GetEntries(); ++i) {
+		TClass* base = static_cast<TBaseClass*>(bases->At(i))->GetClassPointer();
+		if(!base) continue;
+		record(base, layout);
+		record_members(base, layout);
+	}
+}
+
+// Record the classes of the members of \c cl, at any depth, for members build() skips: their size
+// still moves the members that follow them
+void record_members(TClass* cl, rb::data::Layout& layout) {
+	TList* members = cl->GetListOfDataMembers();
+	for(Int_t i=0; members && i< members->GetEntries(); ++i) {
+		TDataMember* d = static_cast<TDataMember*>(members->At(i));
+		TClass* sub = d->IsBasic() ? 0 : TClass::GetClass(d->GetTrueTypeName());
+		if(!sub) continue;
+		const UInt_t n = layout.fClasses.size();
+		record(sub, layout);
+		if(layout.fClasses.size() != n) record_members(sub, layout);
+	}
+}
+
+// Are the classes \c layout was built from unchanged? One checksum per class, no walk of the
+// dictionary
+Bool_t is_current(const rb::data::Layout& layout) {
+	if(layout.fClasses.empty()) return false; // corrupt
+	for(UInt_t i=0; i< layout.fClasses.size(); ++i) {
+		TClass* cl = TClass::GetClass(layout.fClasses[i].first.c_str());
+		if(!cl || cl->GetCheckSum() != layout.fClasses[i].second) return false;
+	}
+	return true;
+}
+
+// Read the cache file into cached_layouts(), ignoring it if it's from another build
+void read_cache() {
+	gCacheRead = true;
+	std::ifstream file(cache_file().c_str());
+	std::string line;
+	if(!std::getline(file, line) || line != cache_header()) return;
+	rb::data::Layout* layout = 0;
+	while(std::getline(file, line)) {
+		std::istringstream iss(line);
+		std::string key;
+		iss >> key;
+		if(key == "class") {
+			std::string name;
+			layout = new rb::data::Layout();
+			std::getline(iss >> std::ws, name);
+			delete cached_layouts()[name];
+			cached_layouts()[name] = layout;
+		}
+		else if(key == "uses" && layout) {
+			std::pair<std::string, UInt_t> used;
+			iss >> used.second >> std::ws;
+			std::getline(iss, used.first);
+			if(iss.fail() || used.first.empty()) { // corrupt: rebuild this class
+				layout->fClasses.clear();
+				layout = 0;
+			}
+			else layout->fClasses.push_back(used);
+		}
+		else if(key == "leaf" && layout) {
+			rb::data::Layout::Leaf leaf;
+			iss >> leaf.fOffset >> leaf.fSize >> leaf.fVisible >> leaf.fInTree >> leaf.fNdim;
+			for(Int_t i=0; i< 4; ++i) iss >> leaf.fDims[i];
+			iss >> leaf.fName >> std::ws;
+			std::getline(iss, leaf.fType);
+			if(iss.fail() || leaf.fType.empty()) { // corrupt: rebuild this class
+				layout->fClasses.clear();
+				layout = 0;
+			}
+			else layout->fLeaves.push_back(leaf);
+		}
+	}
+}
+
+// Write every known layout to the cache file
+void write_cache() {
+	const std::string tmp = cache_file() + ".tmp";
+	std::ofstream file(tmp.c_str());
+	file << cache_header() << "\n";
+	for(Int_t pass = 0; pass< 2; ++pass) {
+		const LayoutMap_t& m = pass ? cached_layouts() : layouts();
+		for(LayoutMap_t::const_iterator it = m.begin(); it != m.end(); ++it) {
+			if(pass && layouts().count(it->first)) continue;
+			file << "class " << it->first << "\n";
+			for(UInt_t i=0; i< it->second->fClasses.size(); ++i)
+				 file << "uses " << it->second->fClasses[i].second << " " << it->second->fClasses[i].first << "\n";
+			for(UInt_t i=0; i< it->second->fLeaves.size(); ++i) {
+				const rb::data::Layout::Leaf& leaf = it->second->fLeaves[i];
+				file << "leaf " << leaf.fOffset << " " << leaf.fSize << " " << leaf.fVisible << " "
+						 << leaf.fInTree << " " << leaf.fNdim;
+				for(Int_t j=0; j< 4; ++j) file << " " << leaf.fDims[j];
+				file << " " << leaf.fName << " " << leaf.fType << "\n";
+			}
+		}
+	}
+	file.close();
+	if(file.fail() || rename(tmp.c_str(), cache_file().c_str())) {
+		err::Warning("rb::data::Layout") << "Couldn't write the layout cache file " << cache_file();
+		remove(tmp.c_str());
+	}
+}
+
+inline Bool_t excluded(TDataMember* d, char c) {
+	const char* title = d->GetTitle();
+	return title && title[0] == c;
+}
+
+// Append the basic data members of class \c cl, recursively, to \c layout
+void build(TClass* cl, const std::string& prefix, Long_t offset, Bool_t visible, Bool_t in_tree,
+					 rb::data::Layout& layout) {
+	TList* dataMembers = cl->GetListOfDataMembers();
+	for(Int_t i=0; i< dataMembers->GetEntries(); ++i) {
+		TDataMember* d = reinterpret_cast<TDataMember*>(dataMembers->At(i));
+		const Bool_t v = visible && !excluded(d, '#');
+		const Bool_t t = in_tree && !excluded(d, '!');
+		TClass* sub = d->IsBasic() ? 0 : TClass::GetClass(d->GetTrueTypeName());
+		if(!v && !t) {
+			if(sub) {
+				record(sub, layout);
+				record_members(sub, layout);
+			}
+			continue;
+		}
+
+		const std::string name = prefix + d->GetName();
+		if(!d->IsBasic()) {
+			if(sub) {
+				record(sub, layout);
+				build(sub, name + ".", offset + d->GetOffset(), v, t, layout);
+			}
+			continue;
+		}
+		if(d->GetArrayDim() > 4) { // too big
+			Warning("MapData",
+							"No support for arrays > 4 dimensions. The array %s is %d and will not be mapped!",
+							name.c_str(), d->GetArrayDim());
+			continue;
+		}
+		rb::data::Layout::Leaf leaf;
+		leaf.fName = name;
+		leaf.fType = d->GetTrueTypeName();
+		leaf.fOffset = offset + d->GetOffset();
+		leaf.fSize = d->GetUnitSize();
+		leaf.fNdim = d->GetArrayDim();
+		for(Int_t j=0; j< 4; ++j) leaf.fDims[j] = j < leaf.fNdim ? d->GetMaxIndex(j) : 0;
+		leaf.fVisible = v;
+		leaf.fInTree = t;
+		layout.fLeaves.push_back(leaf);
+	}
+}
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// const Layout* rb::data::Layout::Get() [static]       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+const rb::data::Layout* rb::data::Layout::Get(const char* classname) {
+	TClass* cl = TClass::GetClass(classname);
+	if(!cl) return 0;
+	const std::string name = cl->GetName();
+	pthread_mutex_lock(&gLayoutLock);
+	LayoutMap_t::iterator it = layouts().find(name);
+	if(it == layouts().end()) {
+		if(!gCacheRead && !cache_file().empty()) read_cache();
+		Layout* layout = 0;
+		LayoutMap_t::iterator cached = cached_layouts().find(name);
+		if(cached != cached_layouts().end()) {
+			if(is_current(*cached->second)) layout = cached->second;
+			else delete cached->second;
+			cached_layouts().erase(cached);
+		}
+		const Bool_t build_layout = !layout;
+		if(build_layout) {
+			layout = new Layout();
+			record(cl, *layout);
+			build(cl, "", 0, true, true, *layout);
+		}
+		it = layouts().insert(std::make_pair(name, layout)).first;
+		if(build_layout && !cache_file().empty()) write_cache();
+	}
+	pthread_mutex_unlock(&gLayoutLock);
+	return it->second;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::data::Layout::SetCacheFile() [static]             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::data::Layout::SetCacheFile(const char* path) {
+#ifdef OS_DARWIN
+	if(path && *path) {
+		err::Warning("rb::data::Layout::SetCacheFile") << "The layout cache isn't supported on Darwin.";
+		return;
+	}
+#endif
+	pthread_mutex_lock(&gLayoutLock);
+	cache_file() = path ? path : "";
+	for(LayoutMap_t::iterator it = cached_layouts().begin(); it != cached_layouts().end(); ++it)
+		 delete it->second;
+	cached_layouts().clear();
+	gCacheRead = false;
+	pthread_mutex_unlock(&gLayoutLock);
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                 //
+// rb::data::Mapper Implementation       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::data::Mapper::MapClass()      //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-namespace {
-inline std::string append_name(const std::string& base, const char* toAppend) {
-  std::stringstream out;
-  out << base << "." << toAppend;
-  return out.str();
-}
-}
 void rb::data::Mapper::MapClass() {
-  TClass* cl = TClass::GetClass(kClassName.c_str());
-  if(!cl) return;
-  TList* dataMembers = cl->GetListOfDataMembers();
-  for(Int_t i=0; i< dataMembers->GetEntries(); ++i) {
-    TDataMember* d = reinterpret_cast<TDataMember*>(dataMembers->At(i));
-    if(!ShouldBeMapped(d)) continue;
-
-    std::string newName = append_name(kBranchName, d->GetName());
-    if(d->IsBasic())
-			 HandleBasic(d, newName.c_str());
-    else {
-      Long_t addr = kBase + d->GetOffset();
-      Mapper sub_mapper(newName.c_str(), d->GetTrueTypeName(), addr, false);
-      sub_mapper.MapClass();
-    }
-  }
+	const Layout* layout = Layout::Get(kClassName.c_str());
+	if(!layout) return;
+	pthread_mutex_lock(&gIndexLock);
+	for(UInt_t i=0; i< layout->fLeaves.size(); ++i) {
+		const Layout::Leaf& leaf = layout->fLeaves[i];
+		if(!leaf.fVisible) continue;
+		Leaf* indexed = new Leaf();
+		indexed->fLayout = &leaf;
+		indexed->fAddress = kBase + leaf.fOffset;
+		index_add(kBranchName + "." + leaf.fName, indexed);
+	}
+	pthread_mutex_unlock(&gIndexLock);
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::data::Mapper::ReadBranches()  //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 void rb::data::Mapper::ReadBranches(std::vector<std::string>& branches) {
-  TClass* cl = TClass::GetClass(kClassName.c_str());
-  if(!cl) return;
-  TList* dataMembers = cl->GetListOfDataMembers();
-  for(Int_t i=0; i< dataMembers->GetEntries(); ++i) {
-    TDataMember* d = reinterpret_cast<TDataMember*>(dataMembers->At(i));
-    if(!ShouldBeMapped(d, false)) continue;
-
-    std::string newName = append_name(kBranchName, d->GetName());
-    if(d->IsBasic())
-			 InsertBasic(d, branches, newName.c_str());
-    else {
-      Long_t addr = kBase + d->GetOffset();
-      Mapper sub_mapper(newName.c_str(), d->GetTrueTypeName(), addr, false);
-      sub_mapper.ReadBranches(branches);
-    }
-  }
+	const Layout* layout = Layout::Get(kClassName.c_str());
+	if(!layout) return;
+	for(UInt_t i=0; i< layout->fLeaves.size(); ++i) {
+		const Layout::Leaf& leaf = layout->fLeaves[i];
+		if(leaf.fInTree) append_names(kBranchName + "." + leaf.fName, leaf.fDims, leaf.fNdim, branches);
+	}
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::data::Mapper::Message()       //
@@ -250,45 +656,3 @@ void rb::data::Mapper::Message() {
   sstr << "      " << kBranchName << "\t\t\t" << kClassName << "\n";
   rb::gApp()->AddMessage(sstr.str());
 }
-
-
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-// Class ArrayConverter                   //
-// Implementation                         //
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-ArrayConverter::ArrayConverter(TDataMember* d) : fElement(d), fArrayLength(0) {
-  for(Int_t j=0; j< d->GetArrayDim(); ++j)
-		 fArrayLength += d->GetMaxIndex(j);
-
-  std::stringstream sstr;
-  Int_t ndim = fElement->GetArrayDim();
-  std::vector<Int_t> index(4, 0);
-
-  // Lazy way of "flattening" the array, just use nested for loops.  TStreamerElement
-  // only supports up to 4-dimensional arrays anyway so there's no loss. Though really this
-  // should be done recursively withouth the for loops (or some other clever way).
-  for(index[0] = 0; index[0] < fElement->GetMaxIndex(0); ++index[0]) {
-    for(index[1] = 0; index[1] < (ndim > 1 ? fElement->GetMaxIndex(1) : 1) ; ++index[1]) {
-      for(index[2] = 0; index[2] < (ndim > 2 ? fElement->GetMaxIndex(2) : 1) ; ++index[2]) {
-				for(index[3] = 0; index[3] < (ndim > 3 ? fElement->GetMaxIndex(3) : 1) ; ++index[3]) {
-					sstr.str("");
-					for(Int_t i=0; i< ndim; ++i) {
-						sstr << "[" << index[i] << "]";
-					}
-					fIndices.push_back(sstr.str());
-				}
-      }
-    }
-  }
-}
-std::string ArrayConverter::GetFullName(const char* baseName, UInt_t index)  {
-  if(index < fIndices.size()) {
-    std::string out = baseName;
-    out += fIndices[index];
-    return out;
-  }
-  else {
-    fprintf(stderr, "Invalid index %d\n", index);
-    return "";
-  }
-}
@@ -7,6 +7,7 @@
 #define DATA_HXX
 #include <iostream>
 #include <sstream>
+#include <map>
 #include <vector>
 #include <TROOT.h>
 #include <TTree.h>
@@ -17,7 +18,10 @@
 #include "utils/Error.hxx"
 #include "utils/LockingPointer.hxx"
 #ifndef __MAKECINT__
+#include <cstring>
 #include "boost/scoped_ptr.hpp"
+#include "boost/type_traits/has_trivial_copy.hpp"
+#include "boost/type_traits/has_trivial_destructor.hpp"
 #else
 namspace boost { template <class T> class scoped_ptr; }
 #endif
@@ -38,25 +42,40 @@ protected:
 	 //! data::MBasic instance
 	 static MBasic::Map_t& fgAll();
 	 //! The type of basic data (int, double, etc.)
-	 const TDataMember* fDataMember;
+	 const std::string fTypeName;
 public:
-	 //! Sets fDataMember
-	 MBasic(const TDataMember* d);
+	 //! Sets fTypeName
+	 MBasic(const char* type);
 	 //! Nothing to do
 	 virtual ~MBasic() {}
 	 //! Pure virtual, see rb::data::Basic
 	 virtual Double_t GetValue() = 0;
 	 //! Pure virtual, see rb::data::Basic
 	 virtual void SetValue(Double_t newval) = 0;
+	 //! Pure virtual, see rb::data::Basic
+	 virtual void SetValueUnlocked(Double_t newval) = 0;
    //! Returns a vector containing the names of all variables.
 	 static std::vector<std::string> GetAll();
-	 //! Search for an instance of Basic*
+	 //! Name, type and value of one variable (see GetAllValues())
+	 struct Value {
+			std::string fName;
+			std::string fType;
+			Double_t fValue;
+			Value(): fValue(0) { }
+			bool operator< (const Value& other) const { return fName < other.fName; }
+	 };
+	 //! Returns the name, type and current value of every variable, sorted by name.
+	 //! \details Reads the values straight from the index, without creating a Basic<T> for each element,
+	 //! and all under a single lock of gDataMutex.
+	 static std::vector<Value> GetAllValues();
+	 //! Search for an instance of Basic*, creating it on first access
 	 //! \param [in] leafName The name (how it would be referred to in TTree::Draw) of the class instance being searched for.
+	 //! \returns 0 if there is no such variable
 	 static MBasic* Find(const char* leafName);
 	 //! Allocate a \c new instance of data::MBasic.
 	 //! \returns A heap allocated instance of a data::MBasic-derived class (i.e. some data::Basic template class). It is
 	 //! automatically caseted to the correct type based on the <i>basic_type_name</i> input parameter.
-	 static void New(const char* name, volatile void* addr, TDataMember* element);
+	 static MBasic* New(const char* name, volatile void* addr, const char* type);
 
 	 //! Prints or writes to a stream information on each entry in fgAll.
 	 class Printer
@@ -68,8 +87,8 @@ public:
 			void PrintAll();
 	 };
 };
-inline rb::data::MBasic::MBasic(const TDataMember* d) :
-	fDataMember(d) {}
+inline rb::data::MBasic::MBasic(const char* type) :
+	fTypeName(type) {}
 inline MBasic::Map_t& MBasic::fgAll() {
 	static MBasic::Map_t* m = new MBasic::Map_t();
 	return *m;
@@ -93,14 +112,15 @@ inline MBasic::Map_t& MBasic::fgAll() {
 //!    -# It encapsulates the memory address of the each basic data member.
 //!    -# A pointer to each instance of data::Basic<T> is stored in the global std::map
 //!       data::MBasic::fgAll, keyed by the "name" (leaf name) of its corresponding basic
-//!       data member.
+//!       data member. Instances are created the first time a variable is accessed (see
+//!       MBasic::Find()), so that large arrays cost nothing until their elements are used.
 //!    -# The class allows (read and write) access to the values of its encapsulated basic data
 //!       through SetValue() and GetValue() member functions. Note that each of these functions
 //!       locks a mutex, ensuring thread safety.
 //!
-//! Instances of this class are created from the constructor of rb::data::Wrapper <T>, whenever the user
+//! The constructor of rb::data::Wrapper <T> indexes the class's members whenever the user
 //! requests that his/her class be mapped by specifying the <i>makeVisible</i> argument of rb::data::Wrapper::Wrapper
-//! to true. Individual fields of a class can be excluded from the mapping by including a special comment directly
+//! to true; instances of this class are then created from the index as variables are accessed. Individual fields of a class can be excluded from the mapping by including a special comment directly
 //! after the field declaration (following the spirit of using comments to direct TStreamer construction in ROOT).
 //! There are two options for exclusion comments: the first is <tt>//!</tt>, which will both exclude the field
 //! from being mapped by this class, and also exclude it from having a TStreamer created in ROOT (or in other words,
@@ -159,13 +179,13 @@ private:
 	 volatile T * fAddress;
 public:
 	 /// \brief Sets fAddress and inserts \c this into data::MBasic::fgAll.
-	 //! \details Also, in the case of an array, it iterates through the whole array and
-	 //! creates a new instance of data::Basic for each element.
-	 Basic(const char* name, volatile void* addr, const TDataMember* d);
+	 Basic(const char* name, volatile void* addr, const char* type);
 	 //! Return the value of the data stored at fAddress
 	 Double_t GetValue();
 	 //! Change the value of the data stored at fAddress
 	 void SetValue(Double_t newval);
+	 //! Same as SetValue(), for callers already holding gDataMutex
+	 void SetValueUnlocked(Double_t newval);
 	 //! Nothing to do
 	 virtual ~Basic();
 };
@@ -183,19 +203,93 @@ private:
 public:
 	 //! Set constants, call Message() is callMessage is false
 	 Mapper(const char* branchname, const char* classname, Long_t base_address, Bool_t call_message);
-	 //! Recurses through a class structure, and for each basic data member, creates a new
-	 //! instance of rb::data::Basic.
+	 //! Adds each basic data member of the class (see Layout) to the index searched by MBasic::Find().
 	 void MapClass();
 	 //! Similar to MapClass(), except if isn't concerned with addresses and it fills an external vector.
 	 void ReadBranches(std::vector<std::string>& branches);
 private:
-	 //! Handle a basic element, create a new instance of MBasic data for each array element.
-	 void HandleBasic(TDataMember* d, const char* name);
-	 //! Insert basic element names into a vector of strings, handles arrays similar to HandleBasic
-	 void InsertBasic(TDataMember* d, std::vector<std::string>& v_names, const char* name);
 	 //! Adds a message to rb::Rint::fMessage indicating that a class's basic data has been mapped out.
 	 void Message();
 };
+#ifndef __MAKECINT__
+/// \brief Flattened layout of a user class: every basic data member, at any depth.
+//! \details Working the layout out walks the class's dictionary recursively, which is slow for
+//! large classes. Layouts can therefore be saved to a cache file and read back on later starts, as
+//! long as the rootbeer executable and library are unchanged and so are the checksums
+//! (TClass::GetCheckSum()) of the classes recorded while building the layout: the class, its base
+//! classes and the classes of its members. Checking a cached layout costs one checksum per recorded
+//! class, without walking the dictionary. Caching is off unless a file is given, by the
+//! RB_LAYOUT_CACHE environment variable or the -layout-cache=FILE command line option (both read
+//! before the user classes are mapped) or by SetCacheFile(), and always off on Darwin, where the
+//! build can't be identified. Used by Mapper, for both CINT variables and the GUI parameter lists.
+class Layout
+{
+public:
+	 //! One basic data member; an array is a single leaf
+	 struct Leaf {
+			//! Name relative to the class, e.g. "adc.ch"
+			std::string fName;
+			//! Type name, e.g. "unsigned short"
+			std::string fType;
+			//! Offset from the start of the class
+			Long_t fOffset;
+			//! Size of one element
+			Int_t fSize;
+			//! Number of array dimensions (0 if not an array)
+			Int_t fNdim;
+			//! Array dimensions
+			Int_t fDims[4];
+			//! Accessible in CINT (not excluded by a "//#" comment)
+			Bool_t fVisible;
+			//! Shown in TTrees (not excluded by a "//!" comment)
+			Bool_t fInTree;
+	 };
+	 //! Basic data members, in declaration order
+	 std::vector<Leaf> fLeaves;
+	 //! Classes the layout was made from (the class first, then its bases and its members' classes),
+	 //! with their checksums
+	 std::vector<std::pair<std::string, UInt_t> > fClasses;
+public:
+	 //! Return the layout of class \c classname, from memory, the cache file or its dictionary
+	 //! \returns 0 if the class has no dictionary
+	 static const Layout* Get(const char* classname);
+	 //! Set the cache file, "" to disable caching (default: $RB_LAYOUT_CACHE, or off)
+	 static void SetCacheFile(const char* path);
+};
+
+/// \brief Batches of variable changes, applied all at once between events.
+//! \details Setting many variables one by one (e.g. loading a calibration) locks gDataMutex
+//! once per variable, and events processed in between see a mix of old and new values.
+//! Instead, Add() stages a whole batch, which is applied under a single lock of gDataMutex
+//! between two events: by the analysis thread at the start of its next event
+//! (rb::Event::Process()), while it already holds gDataMutex, or by Flush(), which waits at most
+//! for the event being processed and works just as well while the attach thread is idle. Checking
+//! for a batch costs the analysis thread a single read of a flag.
+//!
+//! Staging and applying use two buffers: Add() appends to one under a short lock of its own,
+//! and ApplyUnlocked() swaps it with the other one before writing the values, so staging never
+//! waits on gDataMutex.
+class Staged
+{
+private:
+	 //! Is a batch waiting to be applied?
+	 static volatile Int_t fgPending;
+public:
+	 //! Stage a batch of changes, keyed by variable name
+	 //! \returns false (staging nothing) if any of the names isn't a known variable
+	 static Bool_t Add(const std::map<std::string, Double_t>& values);
+	 //! Is a batch waiting to be applied?
+	 static Bool_t IsPending() { return fgPending != 0; }
+	 //! Apply staged changes; the caller must hold gDataMutex
+	 static void ApplyUnlocked();
+	 //! Lock gDataMutex and apply any staged changes; rb::data::SetValue() and rb::data::GetValue()
+	 //! call this first, so they are ordered after the batches staged before them
+	 static void Flush();
+private:
+	 Staged();
+};
+#endif
+
 inline Mapper::Mapper(const char* branchname, const char* classname, Long_t base_address, Bool_t call_message) :
 	kBranchName(branchname), kClassName(classname), kBase(base_address) {
 	if(call_message) Message();
@@ -235,10 +329,18 @@ private:
 	 //! of the Branch. This is why we include this here as a class member rather than just assigning
 	 //! a temporary when creating branches.
 	 void * fDataVoidPtr;
+	 /// Copy of the data taken by CaptureImage(), restored by Reset()
+	 std::vector<char> fImage;
+	 /// One bit per cache line of the data, set by MarkDirty()
+	 std::vector<UInt_t> fDirty;
+	 /// Does Reset() restore only the lines marked by MarkDirty()?
+	 Bool_t fTrackDirty;
 
 	 /// Does most of the work for the constructor.
 	 void Init(Event* event, Bool_t makeVisible, const char* args, Int_t bufsize);
 public:
+	 /// Size of the blocks tracked by MarkDirty()
+	 static const UInt_t kLineSize = 64;
 	 /// \details Allocates memory to the user data class and sets internal variables.
 	 //!
 	 //! \param [in] name Name of the user data class. This is how you will refer to it in the
@@ -293,6 +395,34 @@ public:
 	 /// Dereference operator
 	 //! \returns reference to fData.
 	 T& operator* ();
+
+	 /// \brief Take a copy of the data as it is now, to be restored by Reset().
+	 //! \details Called by the constructor for classes that can be copied byte by byte (no
+	 //! user-defined copy constructor or destructor). Other classes can call it explicitly,
+	 //! e.g. right after construction, as long as they don't own heap memory: the copy is
+	 //! restored as raw bytes, pointers included.
+	 void CaptureImage();
+
+	 /// \brief Restore the data to the copy taken by CaptureImage().
+	 //! \details Use this instead of resetting each field at the start of every event: it is a
+	 //! single memcpy, or with SetDirtyTracking() only the lines written during the event.
+	 //! \returns false if no copy has been taken
+	 Bool_t Reset();
+
+	 /// \brief Make Reset() restore only the lines marked by MarkDirty().
+	 //! \details Worthwhile for large classes of which only a few fields are written per event
+	 //! (e.g. many channels, low multiplicity). Every write to the data must then be marked, or
+	 //! Reset() will leave it in place.
+	 void SetDirtyTracking(Bool_t on);
+
+	 /// Mark <tt>[addr, addr + size)</tt>, within the data, as written this event
+	 void MarkDirty(const volatile void* addr, UInt_t size);
+
+	 /// Mark a member of the data as written this event, returning it for writing:
+	 //! \code
+	 //! fData.Dirty(fData->adc[ch]) = value;
+	 //! \endcode
+	 template <class M> M& Dirty(M& member) { MarkDirty(&member, sizeof(M)); return member; }
 };
 } // namespace data
 } // namespace rb
@@ -308,8 +438,8 @@ public:
 // Constructor                //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 template <class T>
-rb::data::Basic<T>::Basic(const char* name, volatile void* addr, const TDataMember* d) :
-  MBasic(d), fAddress(reinterpret_cast<volatile T*>(addr)) {
+rb::data::Basic<T>::Basic(const char* name, volatile void* addr, const char* type) :
+  MBasic(type), fAddress(reinterpret_cast<volatile T*>(addr)) {
   fgAll().insert(std::make_pair<std::string, MBasic*>(name, this));
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -334,6 +464,14 @@ inline void rb::data::Basic<T>::SetValue(Double_t newval) {
   LockingPointer<T> p(fAddress, gDataMutex);
   *p = T(newval);
 }
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::data::Basic<T>::SetValueUnlocked()       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+template <class T>
+inline void rb::data::Basic<T>::SetValueUnlocked(Double_t newval) {
+  LockFreePointer<T> p(fAddress);
+  *p = T(newval);
+}
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // Template Class                        //
@@ -373,8 +511,11 @@ inline rb::data::Wrapper<T>::Wrapper(const char* name, Event* event, Bool_t make
 #else
   fData(Construct<T>(args)),  fDataVoidPtr(fData.get())
 #endif
+  , fTrackDirty(false)
 {
   Init(event, makeVisible, args, bufsize);
+  if(boost::has_trivial_copy<T>::value && boost::has_trivial_destructor<T>::value)
+		 CaptureImage();
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // Destructor                 //
@@ -419,6 +560,56 @@ inline T& rb::data::Wrapper<T>::operator* () {
 #endif
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::data::Wrapper<T>::CaptureImage()                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+template <class T>
+void rb::data::Wrapper<T>::CaptureImage() {
+  if(!Get()) return;
+  fImage.resize(sizeof(T));
+  memcpy(&fImage[0], Get(), sizeof(T));
+  fDirty.assign((sizeof(T) + kLineSize*32 - 1) / (kLineSize*32), 0);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::data::Wrapper<T>::Reset()                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+template <class T>
+Bool_t rb::data::Wrapper<T>::Reset() {
+  if(fImage.empty()) return false;
+  char* data = reinterpret_cast<char*>(Get());
+  if(!fTrackDirty) {
+    memcpy(data, &fImage[0], sizeof(T));
+    return true;
+  }
+  for(UInt_t word = 0; word < fDirty.size(); ++word) {
+    for(UInt_t bits = fDirty[word]; bits; bits &= bits - 1) {
+      const UInt_t begin = (word*32 + __builtin_ctz(bits)) * kLineSize;
+      const UInt_t end = begin + kLineSize < sizeof(T) ? begin + kLineSize : sizeof(T);
+      memcpy(data + begin, &fImage[begin], end - begin);
+    }
+    fDirty[word] = 0;
+  }
+  return true;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::data::Wrapper<T>::SetDirtyTracking()                   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+template <class T>
+void rb::data::Wrapper<T>::SetDirtyTracking(Bool_t on) {
+  fTrackDirty = on;
+  fDirty.assign(fDirty.size(), 0);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::data::Wrapper<T>::MarkDirty()                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+template <class T>
+inline void rb::data::Wrapper<T>::MarkDirty(const volatile void* addr, UInt_t size) {
+  if(!fTrackDirty || fDirty.empty() || !size) return;
+  const Long_t offset = reinterpret_cast<const volatile char*>(addr) - reinterpret_cast<const char*>(Get());
+  if(offset < 0 || static_cast<ULong_t>(offset) + size > sizeof(T)) return; // not part of the data
+  for(UInt_t line = offset / kLineSize; line <= (offset + size - 1) / kLineSize; ++line)
+     fDirty[line / 32] |= 1u << (line % 32);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::data::Wrapper<T>::Init()                               //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 template <class T>
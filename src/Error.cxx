@@ -0,0 +1,149 @@
+//! \file Error.cxx
+//! \brief Implements the error counters in utils/Error.hxx
+#include <vector>
+#include <iomanip>
+#include <algorithm>
+#include <pthread.h>
+#include "utils/Error.hxx"
+#include "utils/Cycles.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Helper Functions                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace
+{
+// Every counter, guarded by gCountersLock
+pthread_mutex_t gCountersLock = PTHREAD_MUTEX_INITIALIZER;
+std::vector<err::Counter*>& counters() {
+	static std::vector<err::Counter*>* out = new std::vector<err::Counter*>();
+	return *out;
+}
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// err::Counter                                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+volatile Long64_t err::Counter::fgFirst = 10;
+volatile Double_t err::Counter::fgPeriod = 10;
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor                                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+err::Counter::Counter(const char* where, const char* kind):
+	fWhere(where), fKind(kind), fCount(0), fSummaryCount(0), fSummaryTime(rb::Cycles::Now()) {
+	pthread_mutex_lock(&gCountersLock);
+	counters().push_back(this);
+	pthread_mutex_unlock(&gCountersLock);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Destructor                                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+err::Counter::~Counter() {
+	pthread_mutex_lock(&gCountersLock);
+	std::vector<err::Counter*>& all = counters();
+	all.erase(std::remove(all.begin(), all.end(), this), all.end());
+	pthread_mutex_unlock(&gCountersLock);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t err::Counter::Count()                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t err::Counter::Count(Bool_t* last_printed) {
+	const ULong64_t count = __sync_add_and_fetch(&fCount, 1);
+	const Long64_t first = fgFirst;
+	if(first < 0 || count <= ULong64_t(first)) {
+		if(last_printed) *last_printed = (count == ULong64_t(first));
+		return true;
+	}
+
+	// Suppressed; print a summary if the last one is old enough (one thread wins the exchange)
+	const ULong64_t last = fSummaryTime, now = rb::Cycles::Now();
+	if(now - last < fgPeriod * rb::Cycles::PerSecond()) return false;
+	if(!__sync_bool_compare_and_swap(&fSummaryTime, last, now)) return false;
+	const ULong64_t since = fSummaryCount > ULong64_t(first) ? fSummaryCount : ULong64_t(first);
+	fSummaryCount = count;
+	err::Warning(fWhere.c_str()) << count - since << " \"" << fKind << "\" errors suppressed in the last "
+															 << (now - last) / rb::Cycles::PerSecond() << " seconds (" << count
+															 << " in total).";
+	return false;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// err::Counter& err::Counter::Get() [static]            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+err::Counter& err::Counter::Get(const char* where, const char* kind) {
+	err::Counter* out = 0;
+	pthread_mutex_lock(&gCountersLock);
+	std::vector<err::Counter*>& all = counters();
+	for(UInt_t i=0; i< all.size() && !out; ++i) {
+		if(all[i]->fWhere == where && all[i]->fKind == kind) out = all[i];
+	}
+	pthread_mutex_unlock(&gCountersLock);
+	if(!out) out = new err::Counter(where, kind); // kept for the rest of the program
+	return *out;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void err::Counter::SetPolicy() [static]               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void err::Counter::SetPolicy(Long64_t first, Double_t period) {
+	fgFirst = first;
+	fgPeriod = period;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void err::Counter::PrintAll() [static]                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void err::Counter::PrintAll(std::ostream& strm) {
+	pthread_mutex_lock(&gCountersLock);
+	std::vector<err::Counter*>& all = counters();
+	strm << std::setw(24) << std::left << "Location" << " " << std::setw(24) << "Kind"
+			 << " " << std::right << std::setw(14) << "Count" << "\n";
+	for(UInt_t i=0; i< all.size(); ++i) {
+		if(!all[i]->fCount) continue;
+		strm << std::setw(24) << std::left << all[i]->fWhere << " " << std::setw(24) << all[i]->fKind
+				 << " " << std::right << std::setw(14) << all[i]->fCount << "\n";
+	}
+	pthread_mutex_unlock(&gCountersLock);
+	strm.flush();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void err::Counter::ResetAll() [static]                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void err::Counter::ResetAll() {
+	pthread_mutex_lock(&gCountersLock);
+	std::vector<err::Counter*>& all = counters();
+	for(UInt_t i=0; i< all.size(); ++i) {
+		all[i]->fCount = 0;
+		all[i]->fSummaryCount = 0;
+		all[i]->fSummaryTime = rb::Cycles::Now();
+	}
+	pthread_mutex_unlock(&gCountersLock);
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// err::Limited                                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructors                                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+err::Limited::Limited(err::Counter& counter, const char* what):
+	fCounter(counter), fLast(false), fPrint(fCounter.Count(&fLast)) {
+	if(fPrint) std::cerr << what << " in <" << fCounter.GetWhere() << ">: ";
+}
+
+err::Limited::Limited(const char* where, const char* kind, const char* what):
+	fCounter(err::Counter::Get(where, kind)), fLast(false), fPrint(fCounter.Count(&fLast)) {
+	if(fPrint) std::cerr << what << " in <" << where << ">: ";
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Destructor                                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+err::Limited::~Limited() {
+	if(!fPrint) return;
+	if(fLast) std::cerr << " [further \"" << fCounter.GetKind() << "\" errors will only be counted]";
+	std::endl(std::cerr);
+}
@@ -1,7 +1,9 @@
 //! \file Event.cxx
 //! \brief Implements Event.hxx
 #include "Event.hxx"
+#include "Data.hxx"
 #include "hist/Hist.hxx"
+#include "Stats.hxx"
 #include "utils/Logger.hxx"
 
 namespace rb { rb::Mutex gDataMutex("gDataMutex"); }
@@ -25,19 +27,29 @@ rb::Event::Event(): fTree(new TTree("tree", "Rootbeer event tree")),
 // void rb::Event::Process()                             //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 void rb::Event::Process(void* event_address, Int_t nchar) {
+  rb::stats::Timer timer(this);
   Bool_t success = false;
   {
     rb::ScopedLock<TVirtualMutex> cint_lock (gCINTMutex);
     LockingPointer<TTree> pTree(fTree, gDataMutex);
 		LockFreePointer<rb::Event::Save> pSave(fSave);
+		timer.Lap(rb::stats::kLockWait);
+		if(rb::data::Staged::IsPending()) // between events: apply staged variable changes
+			 rb::data::Staged::ApplyUnlocked();
     success = DoProcess(event_address, nchar);
+		timer.Lap(rb::stats::kProcess);
     if(success) {
       pTree->Fill();
       pTree->LoadTree(0);
+			timer.Lap(rb::stats::kTreeFill);
 			pSave->Fill();
+			timer.Lap(rb::stats::kSave);
     }
   } // Locks go out of scope & unlock
-  if(success) fHistManager.FillAll();
+  if(success) {
+		fHistManager.FillAll();
+		timer.Lap(rb::stats::kFillAll);
+	}
   else HandleBadEvent();
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -97,6 +97,8 @@ private:
 	 //! \brief Defines what should be done upon failure to successfully process an event.
 	 //! \details Users may want/need to handle bad events differently, e.g. by throwing an exception,
 	 //!  printing/logging an error message, aborting the program, etc. Since this is pure virtual, they get to choose.
+	 //!  Since bad events tend to come in bursts, messages should be printed with err::Limited, which
+	 //!  prints the first few and then only counts them (see utils/Error.hxx).
 	 virtual void HandleBadEvent() = 0;
 
 public:
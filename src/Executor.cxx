@@ -0,0 +1,302 @@
+//! \file Executor.cxx
+//! \brief Implements utils/Executor.hxx
+#include <deque>
+#include <vector>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+#include <pthread.h>
+#include <TThread.h>
+#include "utils/Executor.hxx"
+#include "utils/Affinity.hxx"
+#include "utils/Error.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Struct                                                //
+// rb::Future::State                                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+struct rb::Future::State
+{
+	 /// Task to run, deleted once it has
+	 Task* fTask;
+	 /// Cancellation flag given to the task
+	 CancelToken fToken;
+	 /// Does the task run on the compute workers?
+	 const Bool_t fCompute;
+	 /// Has the task finished? (only accessed with __sync builtins, which order the task's writes)
+	 volatile Int_t fDone;
+	 /// Signal completion
+	 pthread_mutex_t fLock;
+	 pthread_cond_t fCond;
+
+	 State(Task* task, const CancelToken& token, Bool_t compute):
+		 fTask(task), fToken(token), fCompute(compute), fDone(0) {
+		 pthread_mutex_init(&fLock, 0);
+		 pthread_cond_init(&fCond, 0);
+	 }
+	 Bool_t IsDone() { return __sync_fetch_and_add(&fDone, 0); }
+	 ~State() {
+		 delete fTask; // only if it never ran
+		 pthread_cond_destroy(&fCond);
+		 pthread_mutex_destroy(&fLock);
+	 }
+};
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Helper Functions                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace
+{
+typedef boost::shared_ptr<rb::Future::State> StatePtr_t;
+
+// Run a task and mark it done
+void run(const StatePtr_t& state) {
+	try {
+		state->fTask->Execute();
+	} catch (std::exception& e) {
+		err::Error("rb::Executor") << "Task threw an exception: " << e.what();
+	} catch (...) {
+		err::Error("rb::Executor") << "Task threw an unknown exception.";
+	}
+	delete state->fTask;
+	state->fTask = 0;
+	pthread_mutex_lock(&state->fLock);
+	__sync_fetch_and_or(&state->fDone, 1);
+	pthread_cond_broadcast(&state->fCond);
+	pthread_mutex_unlock(&state->fLock);
+}
+
+// Start a TThread that never exits
+void spawn(const char* kind, Int_t index, void* (*loop)(void*), void* arg) {
+	std::stringstream name;
+	name << "rb::Executor " << kind << " " << index;
+	TThread* thread = new TThread(name.str().c_str(), loop, arg);
+	thread->Run();
+}
+
+//
+// Service threads
+//
+pthread_mutex_t gServiceLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t gServiceWake = PTHREAD_COND_INITIALIZER;
+// Tasks waiting for a service thread
+std::deque<StatePtr_t>& service_queue() {
+	static std::deque<StatePtr_t>* out = new std::deque<StatePtr_t>();
+	return *out;
+}
+// Number of service threads, and of those waiting for a task
+Int_t gNservice = 0, gNserviceIdle = 0;
+
+void* service_loop(void*) {
+	pthread_mutex_lock(&gServiceLock);
+	while(true) {
+		while(service_queue().empty()) {
+			++gNserviceIdle;
+			pthread_cond_wait(&gServiceWake, &gServiceLock);
+			--gNserviceIdle;
+		}
+		StatePtr_t state = service_queue().front();
+		service_queue().pop_front();
+		pthread_mutex_unlock(&gServiceLock);
+		run(state);
+		state.reset();
+		pthread_mutex_lock(&gServiceLock);
+	}
+	return 0;
+}
+
+//
+// Compute workers
+//
+// One worker's queue: the owner works from the back, thieves take from the front
+struct Queue {
+	pthread_mutex_t fLock;
+	std::deque<StatePtr_t> fTasks;
+	Queue() { pthread_mutex_init(&fLock, 0); }
+};
+std::vector<Queue*>& queues() {
+	static std::vector<Queue*>* out = new std::vector<Queue*>();
+	return *out;
+}
+// Number of workers (0 until started), and the number requested with SetNworkers()
+volatile Int_t gNworkers = 0;
+Int_t gNrequested = 0;
+pthread_once_t gComputeOnce = PTHREAD_ONCE_INIT;
+// Index of the calling thread's worker, -1 if it isn't one
+__thread Int_t tWorker = -1;
+// Queue for the next task submitted from outside the pool
+volatile UInt_t gNext = 0;
+// Tasks in all queues, and workers sleeping because there were none
+volatile Int_t gQueued = 0, gSleeping = 0;
+pthread_mutex_t gSleepLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t gWake = PTHREAD_COND_INITIALIZER;
+
+// Take a task from queue \c i (the back if it is our own, the front if stealing)
+Bool_t pop(Int_t i, Bool_t own, StatePtr_t& out) {
+	Queue* queue = queues()[i];
+	pthread_mutex_lock(&queue->fLock);
+	if(queue->fTasks.empty()) {
+		pthread_mutex_unlock(&queue->fLock);
+		return false;
+	}
+	if(own) {
+		out = queue->fTasks.back();
+		queue->fTasks.pop_back();
+	}
+	else {
+		out = queue->fTasks.front();
+		queue->fTasks.pop_front();
+	}
+	pthread_mutex_unlock(&queue->fLock);
+	__sync_sub_and_fetch(&gQueued, 1);
+	return true;
+}
+
+void* compute_loop(void* index) {
+	tWorker = static_cast<Int_t>(reinterpret_cast<Long_t>(index));
+	UInt_t generation = rb::Affinity::GetGeneration();
+	rb::Affinity::Apply(rb::Affinity::kFill);
+	while(true) {
+		if(generation != rb::Affinity::GetGeneration()) {
+			generation = rb::Affinity::GetGeneration();
+			rb::Affinity::Apply(rb::Affinity::kFill);
+		}
+		if(rb::Executor::RunOne()) continue;
+		pthread_mutex_lock(&gSleepLock);
+		__sync_add_and_fetch(&gSleeping, 1);
+		// Submit() increments gQueued before reading gSleeping, so the wakeup can't be missed
+		while(!__sync_add_and_fetch(&gQueued, 0)) pthread_cond_wait(&gWake, &gSleepLock);
+		__sync_sub_and_fetch(&gSleeping, 1);
+		pthread_mutex_unlock(&gSleepLock);
+	}
+	return 0;
+}
+
+void start_compute() {
+	Int_t n = gNrequested;
+	if(n <= 0) n = sysconf(_SC_NPROCESSORS_ONLN);
+	if(n <= 0) n = 1;
+	for(Int_t i=0; i< n; ++i) queues().push_back(new Queue());
+	__sync_synchronize();
+	gNworkers = n;
+	for(Int_t i=0; i< n; ++i) spawn("compute", i, compute_loop, reinterpret_cast<void*>(Long_t(i)));
+}
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::Future                                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::Future::IsDone()                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::Future::IsDone() const {
+	return !fState.get() || fState->IsDone();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::Future::Wait()                               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::Future::Wait() const {
+	if(!fState.get()) return;
+	State& state = *fState;
+	while(!state.IsDone()) {
+		// Help out; if nothing is queued, our task is already running
+		if(state.fCompute && rb::Executor::RunOne()) continue;
+		pthread_mutex_lock(&state.fLock);
+		if(!state.IsDone()) pthread_cond_wait(&state.fCond, &state.fLock);
+		pthread_mutex_unlock(&state.fLock);
+	}
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::Future::Cancel()                             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::Future::Cancel() const {
+	if(fState.get()) fState->fToken.Cancel();
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::Executor                                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::Future rb::Executor::Service() [static]           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::Future rb::Executor::Service(rb::Task* task, const rb::CancelToken& token) {
+	task->fToken = token;
+	StatePtr_t state(new rb::Future::State(task, token, false));
+	pthread_mutex_lock(&gServiceLock);
+	service_queue().push_back(state);
+	if(Int_t(service_queue().size()) > gNserviceIdle) // every thread is busy
+		 spawn("service", gNservice++, service_loop, 0);
+	else
+		 pthread_cond_signal(&gServiceWake);
+	pthread_mutex_unlock(&gServiceLock);
+	return rb::Future(state);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::Future rb::Executor::Submit() [static]            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::Future rb::Executor::Submit(rb::Task* task, const rb::CancelToken& token) {
+	pthread_once(&gComputeOnce, start_compute);
+	task->fToken = token;
+	StatePtr_t state(new rb::Future::State(task, token, true));
+	const Int_t i = tWorker >= 0 ? tWorker : Int_t(__sync_fetch_and_add(&gNext, 1) % gNworkers);
+	Queue* queue = queues()[i];
+	pthread_mutex_lock(&queue->fLock);
+	queue->fTasks.push_back(state);
+	pthread_mutex_unlock(&queue->fLock);
+	__sync_add_and_fetch(&gQueued, 1);
+	if(__sync_add_and_fetch(&gSleeping, 0)) {
+		pthread_mutex_lock(&gSleepLock);
+		pthread_cond_signal(&gWake);
+		pthread_mutex_unlock(&gSleepLock);
+	}
+	return rb::Future(state);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::Executor::RunOne() [static]                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::Executor::RunOne() {
+	const Int_t n = gNworkers;
+	if(!n || !__sync_fetch_and_add(&gQueued, 0)) return false;
+	const Int_t self = tWorker;
+	StatePtr_t state;
+	Bool_t found = self >= 0 && pop(self, true, state);
+	for(Int_t k = 1; k <= n && !found; ++k) {
+		const Int_t i = (self + k + n) % n; // start with the next worker's queue
+		if(i != self) found = pop(i, false, state);
+	}
+	if(!found) return false;
+	run(state);
+	return true;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Int_t rb::Executor::GetNworkers() [static]            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::Executor::GetNworkers() {
+	pthread_once(&gComputeOnce, start_compute);
+	return gNworkers;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::Executor::SetNworkers() [static]             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::Executor::SetNworkers(Int_t n) {
+	if(gNworkers) {
+		err::Warning("rb::Executor::SetNworkers")
+			 << "The compute workers are already running (" << gNworkers << " of them).";
+		return;
+	}
+	gNrequested = n;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::Executor::InWorker() [static]              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::Executor::InWorker() {
+	return tWorker >= 0;
+}
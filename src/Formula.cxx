@@ -1,16 +1,20 @@
 //! \file Formula.cxx
 //! \brief Implements Formula.hxx
 #include <cassert>
+#include <algorithm>
 #include <vector>
 #include <sstream>
 #include <stdexcept>
 #include <TTree.h>
 #include <TString.h>
 #include <TTreeFormula.h>
+#include <TCutG.h>
 #include "Formula.hxx"
+#include "CutGate.hxx"
 #include "Rint.hxx"
 #include "utils/Mutex.hxx"
 #include "utils/Error.hxx"
+#include "utils/Cycles.hxx"
 
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -45,8 +49,35 @@ rb::TreeFormulae::TreeFormulae(std::vector<std::string>& params, Int_t event_cod
       rb::Event::InitFormula::Operate(rb::gApp()->GetEvent(kEventCode), it->c_str());
 
     if(!formula->GetNdim()) ThrowBad(it->c_str(), it-params.begin());
-    else fTreeFormulae->push_back(formula);
+    else {
+      fTreeFormulae->push_back(formula);
+      fCutGates.push_back(MakeCutGate(*it));
+      fProfiles.push_back(rb::FormulaProfile());
+    }
+  }
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::TreeFormulae::MakeCutGate()                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+boost::shared_ptr<rb::CutGate> rb::TreeFormulae::MakeCutGate(const std::string& formula) {
+  boost::shared_ptr<rb::CutGate> gate;
+  Bool_t negate;
+  TCutG* cut = rb::CutGate::Parse(formula, negate);
+  if(cut) {
+    rb::Event* event = rb::gApp()->GetEvent(kEventCode);
+    gate.reset(new rb::CutGate(cut, negate,
+                               rb::Event::InitFormula::Operate(event, cut->GetVarX()),
+                               rb::Event::InitFormula::Operate(event, cut->GetVarY())));
   }
+  return gate;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::TreeFormulae::SetCutResolution()             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::TreeFormulae::SetCutResolution(const std::string& varx, Double_t dx, const std::string& vary, Double_t dy) {
+  RB_LOCKGUARD(gDataMutex);
+  for(UInt_t i=0; i< fCutGates.size(); ++i)
+    if(fCutGates[i]) fCutGates[i]->SetResolution(varx, dx, vary, dy);
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void ThrowBad()                                       //
@@ -76,6 +107,8 @@ Bool_t rb::TreeFormulae::Change(Int_t index, std::string new_formula) {
       RB_LOCKGUARD(gDataMutex);
       fTreeFormulae->replace(index, rb::Event::InitFormula::Operate(rb::gApp()->GetEvent(kEventCode), new_formula.c_str()));
       fFormulaArgs.at(index) = new_formula;
+      fCutGates.at(index) = MakeCutGate(new_formula);
+      fProfiles.at(index) = rb::FormulaProfile();
     } catch(std::exception& e) {
       err::Error("rb::TreeFormulae::Change()") << "Invalid index " << index;
     }
@@ -104,7 +137,10 @@ Double_t rb::TreeFormulae::Eval(Int_t index) {
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 Double_t rb::TreeFormulae::EvalUnlocked(Int_t index) {
   Double_t ret = -1;
-  try { ret = fTreeFormulae->at(index).EvalInstance(0); }
+  try {
+    rb::CutGate* gate = fCutGates.at(index).get();
+    if(!gate || !gate->Eval(ret)) ret = fTreeFormulae->at(index).EvalInstance(0);
+  }
   catch (std::exception& e) {
     err::Error("rb::TreeFormulae::Eval") << "Invalid index " << index;
     ret = -1;
@@ -124,6 +160,39 @@ void rb::TreeFormulae::EvalAll(std::vector<Double_t>& out) {
 void rb::TreeFormulae::EvalAllUnlocked(std::vector<Double_t>& out) {
   boost::ptr_vector<TTreeFormula>::iterator it;
   out.clear();
-  for(it = fTreeFormulae->begin(); it != fTreeFormulae->end(); ++it)
-    out.push_back(it->EvalInstance(0));
+  for(it = fTreeFormulae->begin(); it != fTreeFormulae->end(); ++it) {
+    Double_t value;
+    rb::CutGate* gate = fCutGates[it - fTreeFormulae->begin()].get();
+    if(!gate || !gate->Eval(value)) value = it->EvalInstance(0);
+    out.push_back(value);
+  }
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Double_t rb::TreeFormulae::EvalProfiled()             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Double_t rb::TreeFormulae::EvalProfiled(Int_t index, Bool_t timed) {
+  if(index < 0 || index >= Int_t(fProfiles.size())) return EvalUnlocked(index);
+  rb::FormulaProfile& profile = fProfiles[index];
+  ++profile.fNevals;
+  if(!timed) return EvalUnlocked(index);
+  const ULong64_t start = rb::Cycles::Now();
+  Double_t ret = EvalUnlocked(index);
+  profile.fCycles += rb::Cycles::Now() - start;
+  ++profile.fNtimed;
+  return ret;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::TreeFormulae::EvalAllProfiled()              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::TreeFormulae::EvalAllProfiled(std::vector<Double_t>& out, Bool_t timed) {
+  out.clear();
+  for(Int_t i=0; i< Int_t(fProfiles.size()); ++i)
+    out.push_back(EvalProfiled(i, timed));
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::TreeFormulae::ResetProfiles()                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::TreeFormulae::ResetProfiles() {
+  RB_LOCKGUARD(gDataMutex);
+  std::fill(fProfiles.begin(), fProfiles.end(), rb::FormulaProfile());
 }
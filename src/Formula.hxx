@@ -4,11 +4,13 @@
 #define FORMULA_HXX
 #include <string>
 #include "utils/boost_ptr_vector.h"
+#include "utils/boost_shared_ptr.h"
 #include "utils/Critical.hxx"
 
 // =========== Forward Declarations =========== //
 class TTree;
 class TTreeFormula;
+namespace rb { class CutGate; }
 
 // =========== Enums =========== //
 enum AxisIndices { X, Y, Z, GATE };
@@ -18,6 +20,20 @@ namespace rb
 {
   // =========== Class Definitions ============ //
 
+  /// \brief Evaluation counters for one formula, used by the fill profiler.
+  struct FormulaProfile
+  {
+    /// Number of evaluations
+    ULong64_t fNevals;
+    /// Number of timed evaluations
+    ULong64_t fNtimed;
+    /// Total cycles spent in the timed evaluations
+    ULong64_t fCycles;
+    FormulaProfile(): fNevals(0), fNtimed(0), fCycles(0) {}
+    /// Estimated total cycles for all evaluations
+    Double_t GetCost() const { return fNtimed ? Double_t(fCycles) * fNevals / fNtimed : 0.; }
+  };
+
   /// \brief Wrapper for histogram TTreeFormulae
   class TreeFormulae
   {
@@ -25,6 +41,10 @@ namespace rb
     const Int_t kEventCode;
     rb::Critical<boost::ptr_vector<TTreeFormula> > fTreeFormulae;
     std::vector<std::string> fFormulaArgs;
+    /// Rasterized TCutG gates, one per formula (null unless the formula is a single cut)
+    std::vector<boost::shared_ptr<rb::CutGate> > fCutGates;
+    /// Profiling counters, one per formula
+    std::vector<rb::FormulaProfile> fProfiles;
   public:
     TreeFormulae(): kEventCode(-1001), fTreeFormulae(0, gDataMutex) {}
     TreeFormulae(std::vector<std::string>& params, Int_t event_code);
@@ -34,9 +54,23 @@ namespace rb
     Double_t EvalUnlocked(Int_t index);
     void EvalAll(std::vector<Double_t>& out);
     void EvalAllUnlocked(std::vector<Double_t>& out);
+    /// Unlocked evaluation that also updates the profiling counters
+    //! \param timed Also measure the time taken by the evaluation
+    Double_t EvalProfiled(Int_t index, Bool_t timed);
+    /// Unlocked evaluation of all formulae that also updates the profiling counters
+    void EvalAllProfiled(std::vector<Double_t>& out, Bool_t timed);
+    /// Return the profiling counters of a formula
+    const rb::FormulaProfile& GetProfile(Int_t index) { return fProfiles.at(index); }
+    /// Zero the profiling counters
+    void ResetProfiles();
     Bool_t Change(Int_t index, std::string new_formula);
+    /// Is formula \c index evaluated through a rasterized TCutG?
+    Bool_t IsCutGate(Int_t index) const { return fCutGates.at(index).get() != 0; }
+    /// Match the raster of any TCutG gates on (varx, vary) to a histogram's bin widths
+    void SetCutResolution(const std::string& varx, Double_t dx, const std::string& vary, Double_t dy);
   private:
     void ThrowBad(const char* formula, Int_t index);
+    boost::shared_ptr<rb::CutGate> MakeCutGate(const std::string& formula);
     TreeFormulae(const TreeFormulae& other): kEventCode(-1001), fTreeFormulae(0, gDataMutex) {}
     TreeFormulae& operator= (const TreeFormulae& other) { return *this; }
   };
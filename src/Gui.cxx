@@ -446,6 +446,24 @@ fUnattach->SetFont(ufont->GetFontStruct());
    fGroupData->AddFrame(fNbuffers, new TGLayoutHints(kLHintsLeft | kLHintsTop,2,2,2,2));
    fNbuffers->MoveResize(210,166,100,18);
 
+   ufont = gClient->GetFont("-*-helvetica-medium-r-*-*-10-*-*-*-*-*-iso8859-1");
+
+   // graphics context changes
+   GCValues_t vall1886;
+   vall1886.fMask = kGCForeground | kGCBackground | kGCFillStyle | kGCFont | kGCGraphicsExposures;
+   gClient->GetColorByName("#000000",vall1886.fForeground);
+   gClient->GetColorByName("#e0e0e0",vall1886.fBackground);
+   vall1886.fFillStyle = kFillSolid;
+   vall1886.fFont = ufont->GetFontHandle();
+   vall1886.fGraphicsExposures = kFALSE;
+   uGC = gClient->GetGC(&vall1886, kTRUE);
+
+   /* TGLabel* */ fStatsSummary = new TGLabel(fGroupData," ",uGC->GetGC(),ufont->GetFontStruct(),kChildFrame,ucolor);   fStatsSummary->SetTextJustify(33);
+   fStatsSummary->SetMargins(0,0,0,0);
+   fStatsSummary->SetWrapLength(-1);
+   fGroupData->AddFrame(fStatsSummary, new TGLayoutHints(kLHintsLeft | kLHintsTop,2,2,2,2));
+   fStatsSummary->MoveResize(8,201,320,14);
+
    fGroupData->SetLayoutManager(new TGVerticalLayout(fGroupData));
    fGroupData->Resize(336,216);
    fMainFrame6310->AddFrame(fGroupData, new TGLayoutHints(kLHintsLeft | kLHintsTop,2,2,2,2));
@@ -160,6 +160,7 @@ class TGRbeerFrame : public TGMainFrame
 	 TGLabel *fNbuffersLabelDivider; // " | "
 	 TGLabel *fNbuffersLabel; // "Buffers Analyzed:"
 	 TGLabel *fNbuffers; // "0"
+	 TGLabel *fStatsSummary; // pipeline rates (rb::stats)
 
 public:
 	 TGRbeerFrame(const TGWindow* p = 0, UInt_t w = 1, UInt_t h = 1, UInt_t options = kVerticalFrame) :
@@ -683,6 +683,17 @@ fMkdirButton->SetFont(ufont->GetFontStruct());
    fCompositeFrame717->AddFrame(fMkdirButton, new TGLayoutHints(kLHintsLeft | kLHintsTop,2,2,2,2));
    fMkdirButton->MoveResize(230,361,96,22);
 
+   /* TGTextButton* */ fProfileButton = new TGTextButton(fCompositeFrame717,"Profile");
+fProfileButton->SetFont(ufont->GetFontStruct());
+   fProfileButton->SetTextJustify(36);
+   fProfileButton->SetMargins(0,0,0,0);
+   fProfileButton->SetWrapLength(-1);
+   fProfileButton->Resize(96,22);
+
+   fProfileButton->ChangeBackground(ucolor);
+   fCompositeFrame717->AddFrame(fProfileButton, new TGLayoutHints(kLHintsLeft | kLHintsTop,2,2,2,2));
+   fProfileButton->MoveResize(332,361,96,22);
+
 
    // graphics context changes
    GCValues_t vall855;
@@ -1014,6 +1025,7 @@ void TGHistVarFrame::MakeHistConnections() {
 	fBinsY->SetNumber(100);	fHighY->SetNumber(100);
 	fBinsZ->SetNumber(100);	fHighZ->SetNumber(100);
 	fEventEntry->Connect("Selected(Int_t)", "rb::HistSignals", RB_HIST_SIGNALS, "PopulateParameters(Int_t)");
+	fParamX->GetTextEntry()->Connect("TextChanged(const char*)", "rb::HistSignals", RB_HIST_SIGNALS, "FilterParameters(=0)");
 	RB_HIST_SIGNALS->PopulateEvents();
 	fTypeEntry->Connect("Selected(Int_t)", "rb::HistSignals", RB_HIST_SIGNALS, "EnableHistFields(Int_t)");
 	fTypeEntry->Selected(0);
@@ -1028,11 +1040,10 @@ void TGHistVarFrame::MakeHistConnections() {
 	fCommandOk->Connect("Pressed()", "rb::HistSignals", RB_HIST_SIGNALS, "HistMemberFn()");
 	fCommandEntry->Connect("ReturnPressed()", "rb::HistSignals", RB_HIST_SIGNALS, "HistMemberFn()");
 	fMkdirButton->Connect("Pressed()",  "rb::HistSignals", RB_HIST_SIGNALS, "Mkdir()");
+	fProfileButton->Connect("Pressed()",  "rb::HistSignals", RB_HIST_SIGNALS, "Profile()");
 	fHistRegateButton->Connect("Pressed()", "rb::HistSignals", RB_HIST_SIGNALS, "RegateHist()");
 
 
-	RB_HIST_SIGNALS->Connect("NewOrDeleteHist()", "rb::HistSignals", RB_HIST_SIGNALS, "SyncHistTree()");
-
 	RB_HIST_SIGNALS->SyncHistTree();
 
 	fQuit->Connect("Pressed()", "rb::HistSignals", RB_HIST_SIGNALS, "Quit()");
@@ -190,6 +190,7 @@ private:
 	 TGTextButton *fHistLoadButton; // "Load"
 	 TGTextEntry *fDrawOptionEntry;
 	 TGTextButton *fMkdirButton; // "New Directory"
+	 TGTextButton *fProfileButton; // "Profile"
 	 TGLabel *fDrawOptionLabel; // "Draw option:"
 	 TGGroupFrame *fVariablesFrame; // "Variables"
 	 TGCanvas *fVariablesCanvas;
@@ -0,0 +1,359 @@
+//! \file LockProfile.cxx
+//! \brief Implements utils/LockProfile.hxx
+#include <map>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <cxxabi.h>
+#include <TThread.h>
+#include "utils/LockProfile.hxx"
+#include "utils/Mutex.hxx"
+#include "utils/Cycles.hxx"
+#include "utils/Error.hxx"
+
+
+#if defined(RB_LOCK_PROFILE)
+__thread const void* rb::gLockSite = 0;
+#endif
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::LockProfile                                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace rb
+{
+/// Counters for one rb::Mutex instance
+//! \details Updated by the thread holding the mutex, and protected by fLock so that they can be
+//! read by the printing thread.
+class LockProfile
+{
+public:
+	 /// Number of hold time bins; bin \c i counts holds of [2^i, 2^(i+1)) cycles
+	 static const Int_t kNbins = 48;
+	 /// Counters for one acquisition site
+	 struct Site {
+			ULong64_t fCount, fContended, fWait, fMaxWait, fReleased, fHold, fMaxHold;
+			ULong64_t fHoldBins[kNbins];
+			Site() { Reset(); }
+			void Reset() {
+				fCount = fContended = fWait = fMaxWait = fReleased = fHold = fMaxHold = 0;
+				std::fill(fHoldBins, fHoldBins + kNbins, 0);
+			}
+			/// Approximate hold time quantile, in cycles
+			Double_t HoldQuantile(Double_t q) const;
+	 };
+	 /// Number of contended acquisitions and wait time for a pair of threads
+	 typedef std::pair<ULong64_t, ULong64_t> Pair;
+	 /// Site map
+	 typedef std::map<const void*, Site> SiteMap_t;
+	 /// (waiter, holder) thread id pair map
+	 typedef std::map<std::pair<Long_t, Long_t>, Pair> PairMap_t;
+public:
+	 /// Mutex name
+	 std::string fName;
+	 /// Protects the maps
+	 pthread_mutex_t fLock;
+	 /// Counters for each site
+	 SiteMap_t fSites;
+	 /// Counters for each thread pair
+	 PairMap_t fPairs;
+public:
+	 /// Set the name
+	 LockProfile(const std::string& name): fName(name) { pthread_mutex_init(&fLock, 0); }
+};
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Double_t rb::LockProfile::Site::HoldQuantile()        //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Double_t rb::LockProfile::Site::HoldQuantile(Double_t q) const {
+	if(!fReleased) return 0;
+	const Double_t target = q * fReleased;
+	ULong64_t sum = 0;
+	for(Int_t i=0; i< kNbins; ++i) {
+		if(!fHoldBins[i]) continue;
+		if(sum + fHoldBins[i] >= target) return std::ldexp(std::pow(2., (target - sum) / fHoldBins[i]), i);
+		sum += fHoldBins[i];
+	}
+	return fMaxHold;
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Helper Functions                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace
+{
+// Every profile ever created, never deleted
+pthread_mutex_t gRegistryLock = PTHREAD_MUTEX_INITIALIZER;
+std::vector<rb::LockProfile*>& registry() {
+	static std::vector<rb::LockProfile*>* out = new std::vector<rb::LockProfile*>();
+	return *out;
+}
+// Time profiling was last started or reset
+ULong64_t gStart = 0;
+// Copy of a profile's counters
+struct Snapshot {
+	std::string fName;
+	rb::LockProfile::SiteMap_t fSites;
+	rb::LockProfile::PairMap_t fPairs;
+	ULong64_t fCount, fContended, fWait, fHold;
+	Snapshot(): fCount(0), fContended(0), fWait(0), fHold(0) { }
+};
+struct WaitGreater {
+	bool operator() (const Snapshot& lhs, const Snapshot& rhs) const {
+		return lhs.fWait != rhs.fWait ? lhs.fWait > rhs.fWait : lhs.fHold > rhs.fHold;
+	}
+};
+struct SiteGreater {
+	bool operator() (const std::pair<const void*, rb::LockProfile::Site>& lhs,
+									 const std::pair<const void*, rb::LockProfile::Site>& rhs) const {
+		return lhs.second.fWait + lhs.second.fHold > rhs.second.fWait + rhs.second.fHold;
+	}
+};
+struct PairGreater {
+	bool operator() (const std::pair<std::pair<Long_t, Long_t>, rb::LockProfile::Pair>& lhs,
+									 const std::pair<std::pair<Long_t, Long_t>, rb::LockProfile::Pair>& rhs) const {
+		return lhs.second.second > rhs.second.second;
+	}
+};
+// Convert cycles to microseconds
+inline Double_t to_us(Double_t cycles) {
+	return 1e6 * cycles / rb::Cycles::PerSecond();
+}
+// Run a command and return the first line of its output
+std::string read_command(const std::string& command) {
+	FILE* pipe = popen(command.c_str(), "r");
+	if(!pipe) return "";
+	char line[1024] = "";
+	if(!fgets(line, sizeof(line), pipe)) line[0] = '\0';
+	pclose(pipe);
+	std::string out(line);
+	if(!out.empty() && out[out.size()-1] == '\n') out.erase(out.size()-1);
+	return out;
+}
+// Describe a return address as "function+offset (file:line)"
+std::string describe_site(const void* site) {
+	std::stringstream out;
+	Dl_info info;
+	if(!site || !dladdr(site, &info) || !info.dli_fname) {
+		out << site;
+		return out.str();
+	}
+	if(info.dli_sname) {
+		int status = 0;
+		char* demangled = abi::__cxa_demangle(info.dli_sname, 0, 0, &status);
+		out << (status == 0 && demangled ? demangled : info.dli_sname);
+		free(demangled);
+		out << "+0x" << std::hex << ((const char*)site - (const char*)info.dli_saddr) << std::dec;
+	}
+	else out << info.dli_fname << "+0x" << std::hex << ((const char*)site - (const char*)info.dli_fbase) << std::dec;
+
+	// The return address is just after the call, back up one byte to get the call's line
+	// Offsets are relative to the object's base for shared libraries, absolute otherwise
+	const char* call = (const char*)site - 1;
+	for(Int_t relative = 1; relative >= 0; --relative) {
+		std::stringstream cmd;
+		cmd << "addr2line -e '" << info.dli_fname << "' 0x" << std::hex
+				<< (relative ? call - (const char*)info.dli_fbase : call - (const char*)0) << " 2>/dev/null";
+		std::string line = read_command(cmd.str());
+		if(!line.empty() && line[0] != '?') {
+			if(line.find_last_of("/") < line.size()) line = line.substr(line.find_last_of("/") + 1);
+			out << " (" << line << ")";
+			break;
+		}
+	}
+	return out.str();
+}
+// Thread name from its id
+std::string thread_name(Long_t id) {
+	std::stringstream out;
+	if(id == 0 || id == rb::Mutex::kIsUnlocked) return "[unknown]";
+	TThread* thread = TThread::GetThread(id);
+	if(thread) out << thread->GetName();
+	else out << "[" << id << "]";
+	return out.str();
+}
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::LockProfiler                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+Bool_t rb::LockProfiler::fgEnabled = false;
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::LockProfiler::IsAvailable() [static]       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::LockProfiler::IsAvailable() {
+#ifdef RB_LOCK_PROFILE
+	return true;
+#else
+	return false;
+#endif
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::LockProfiler::Enable() [static]              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::LockProfiler::Enable() {
+	if(!IsAvailable()) {
+		err::Error("rb::stats::StartLockProfile") << "Lock profiling isn't compiled in, rebuild with -DRB_LOCK_PROFILE.";
+		return;
+	}
+	rb::Cycles::PerSecond(); // calibrate now rather than while locked
+	if(!gStart) gStart = rb::Cycles::Now();
+	fgEnabled = true;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::LockProfiler::Reset() [static]               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::LockProfiler::Reset() {
+	pthread_mutex_lock(&gRegistryLock);
+	std::vector<LockProfile*> profiles = registry();
+	pthread_mutex_unlock(&gRegistryLock);
+	for(UInt_t i=0; i< profiles.size(); ++i) {
+		pthread_mutex_lock(&profiles[i]->fLock);
+		profiles[i]->fSites.clear();
+		profiles[i]->fPairs.clear();
+		pthread_mutex_unlock(&profiles[i]->fLock);
+	}
+	gStart = rb::Cycles::Now();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// LockProfile* rb::LockProfiler::Register() [static]    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::LockProfile* rb::LockProfiler::Register(const char* name) {
+	pthread_mutex_lock(&gRegistryLock);
+	std::vector<LockProfile*>& profiles = registry();
+	// Several mutexes can share a name (e.g. each histogram manager's SetMutex)
+	Int_t nsame = 0;
+	for(UInt_t i=0; i< profiles.size(); ++i) {
+		if(profiles[i]->fName.substr(0, profiles[i]->fName.find('#')) == name) ++nsame;
+	}
+	std::stringstream fullname;
+	fullname << (strlen(name) ? name : "[unnamed]");
+	if(nsame) fullname << "#" << nsame + 1;
+	profiles.push_back(new LockProfile(fullname.str()));
+	LockProfile* out = profiles.back();
+	pthread_mutex_unlock(&gRegistryLock);
+	return out;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::LockProfiler::Acquired() [static]            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::LockProfiler::Acquired(LockProfile* profile, const void* site, Bool_t contended, ULong64_t wait,
+																Long_t waiter, Long_t holder) {
+	pthread_mutex_lock(&profile->fLock);
+	LockProfile::Site& counters = profile->fSites[site];
+	++counters.fCount;
+	if(contended) {
+		++counters.fContended;
+		counters.fWait += wait;
+		if(wait > counters.fMaxWait) counters.fMaxWait = wait;
+		LockProfile::Pair& pair = profile->fPairs[std::make_pair(waiter, holder)];
+		++pair.first;
+		pair.second += wait;
+	}
+	pthread_mutex_unlock(&profile->fLock);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::LockProfiler::Released() [static]            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::LockProfiler::Released(LockProfile* profile, const void* site, ULong64_t hold) {
+	if(!profile) return;
+	pthread_mutex_lock(&profile->fLock);
+	LockProfile::Site& counters = profile->fSites[site];
+	++counters.fReleased;
+	counters.fHold += hold;
+	if(hold > counters.fMaxHold) counters.fMaxHold = hold;
+	const Int_t bin = hold ? 63 - __builtin_clzll(hold) : 0;
+	++counters.fHoldBins[bin < LockProfile::kNbins ? bin : LockProfile::kNbins - 1];
+	pthread_mutex_unlock(&profile->fLock);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::LockProfiler::Print() [static]               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::LockProfiler::Print(Int_t nsites, std::ostream& strm) {
+	if(!IsAvailable()) {
+		err::Error("rb::stats::PrintLockProfile") << "Lock profiling isn't compiled in, rebuild with -DRB_LOCK_PROFILE.";
+		return;
+	}
+	if(!fgEnabled)
+		 err::Info("rb::stats::PrintLockProfile") << "Lock profiling is off (start it with rb::stats::StartLockProfile()), "
+																							<< "showing counts from the last profiling run.";
+
+	// Copy everything first, so that nothing is locked while resolving sites
+	pthread_mutex_lock(&gRegistryLock);
+	std::vector<LockProfile*> profiles = registry();
+	pthread_mutex_unlock(&gRegistryLock);
+	std::vector<Snapshot> snapshots(profiles.size());
+	for(UInt_t i=0; i< profiles.size(); ++i) {
+		pthread_mutex_lock(&profiles[i]->fLock);
+		snapshots[i].fName = profiles[i]->fName;
+		snapshots[i].fSites = profiles[i]->fSites;
+		snapshots[i].fPairs = profiles[i]->fPairs;
+		pthread_mutex_unlock(&profiles[i]->fLock);
+		for(LockProfile::SiteMap_t::iterator it = snapshots[i].fSites.begin(); it != snapshots[i].fSites.end(); ++it) {
+			snapshots[i].fCount += it->second.fCount;
+			snapshots[i].fContended += it->second.fContended;
+			snapshots[i].fWait += it->second.fWait;
+			snapshots[i].fHold += it->second.fHold;
+		}
+	}
+	std::sort(snapshots.begin(), snapshots.end(), WaitGreater());
+
+	const Double_t rate = rb::Cycles::PerSecond();
+	std::ios_base::fmtflags flags = strm.flags();
+	std::streamsize precision = strm.precision();
+	strm << std::fixed << std::setprecision(3);
+	strm << "\nLock profile, " << (gStart ? (rb::Cycles::Now() - gStart) / rate : 0.) << " s:\n";
+	for(UInt_t i=0; i< snapshots.size(); ++i) {
+		const Snapshot& snap = snapshots[i];
+		if(!snap.fCount) continue;
+		strm << "\n" << snap.fName << ": " << snap.fCount << " acquisitions, "
+				 << (100. * snap.fContended / snap.fCount) << "% contended, "
+				 << snap.fWait / rate << " s waiting, " << snap.fHold / rate << " s held\n";
+
+		typedef std::pair<const void*, LockProfile::Site> SiteEntry_t;
+		std::vector<SiteEntry_t> sites(snap.fSites.begin(), snap.fSites.end());
+		std::sort(sites.begin(), sites.end(), SiteGreater());
+		strm << std::right << std::setw(14) << "Count" << std::setw(8) << "Cont%"
+				 << std::setw(11) << "Wait us" << std::setw(11) << "MaxWait"
+				 << std::setw(11) << "Hold us" << std::setw(10) << "p50" << std::setw(10) << "p99"
+				 << std::setw(11) << "MaxHold" << "  Site\n";
+		for(Int_t j=0; j< Int_t(sites.size()) && j< nsites; ++j) {
+			const LockProfile::Site& site = sites[j].second;
+			strm << std::setw(14) << site.fCount
+					 << std::setw(8) << (site.fCount ? 100. * site.fContended / site.fCount : 0.)
+					 << std::setw(11) << (site.fContended ? to_us(Double_t(site.fWait) / site.fContended) : 0.)
+					 << std::setw(11) << to_us(site.fMaxWait)
+					 << std::setw(11) << (site.fReleased ? to_us(Double_t(site.fHold) / site.fReleased) : 0.)
+					 << std::setw(10) << to_us(site.HoldQuantile(0.5))
+					 << std::setw(10) << to_us(site.HoldQuantile(0.99))
+					 << std::setw(11) << to_us(site.fMaxHold)
+					 << "  " << describe_site(sites[j].first) << "\n";
+		}
+
+		typedef std::pair<std::pair<Long_t, Long_t>, LockProfile::Pair> PairEntry_t;
+		std::vector<PairEntry_t> pairs(snap.fPairs.begin(), snap.fPairs.end());
+		std::sort(pairs.begin(), pairs.end(), PairGreater());
+		if(!pairs.empty()) strm << "  Contending threads (waiter <- holder):\n";
+		for(Int_t j=0; j< Int_t(pairs.size()) && j< nsites; ++j) {
+			strm << "    " << thread_name(pairs[j].first.first) << " <- " << thread_name(pairs[j].first.second)
+					 << ": " << pairs[j].second.first << " times, " << pairs[j].second.second / rate << " s\n";
+		}
+	}
+	strm << std::endl;
+	strm.flags(flags);
+	strm.precision(precision);
+}
@@ -0,0 +1,256 @@
+//! \file Logger.cxx
+//! \brief Implements utils/Logger.hxx
+#include <new>
+#include <ctime>
+#include <cstdlib>
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <pthread.h>
+#include <sys/time.h>
+#include "utils/Logger.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Struct                                                //
+// Logger::Ring                                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+struct Logger::Ring
+{
+	 /// Records, indexed by position modulo kRingSize
+	 Record fRecords[kRingSize];
+	 /// Position of the next record to write (only changed by the owning thread)
+	 volatile ULong64_t fHead;
+	 /// Position of the next record to read (only changed by the background thread)
+	 volatile ULong64_t fTail;
+	 /// Messages dropped because the ring was full (only changed by the owning thread)
+	 volatile ULong64_t fDropped;
+	 /// Is a record being written?
+	 Bool_t fBusy;
+	 /// Has the owning thread exited?
+	 volatile Bool_t fOrphan;
+	 /// Number shown in the log for the owning thread
+	 Int_t fThread;
+	 Ring(): fHead(0), fTail(0), fDropped(0), fBusy(false), fOrphan(false), fThread(0) { }
+};
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Helper Functions                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace
+{
+// Ring of the calling thread
+__thread Logger::Ring* tRing = 0;
+// Every ring, never deleted; rings of exited threads are reused
+pthread_mutex_t gRingsLock = PTHREAD_MUTEX_INITIALIZER;
+std::vector<Logger::Ring*>& rings() {
+	static std::vector<Logger::Ring*>* out = new std::vector<Logger::Ring*>();
+	return *out;
+}
+// Serializes draining (background thread and Flush())
+pthread_mutex_t gDrainLock = PTHREAD_MUTEX_INITIALIZER;
+// Number of threads that have logged
+Int_t gNthreads = 0;
+// Background thread, and the flag telling it to stop
+pthread_t gDrainThread;
+volatile Bool_t gStop = false;
+// Marks a thread's ring as reusable when it exits
+pthread_key_t gRingKey;
+pthread_once_t gOnce = PTHREAD_ONCE_INIT;
+void release_ring(void* ring) {
+	static_cast<Logger::Ring*>(ring)->fOrphan = true;
+}
+// Conversion from cycles to wall time
+ULong64_t gBaseCycles = 0;
+timeval gBaseTime;
+Double_t gCyclesPerSecond = 1;
+// Output
+std::ofstream& output() {
+	static std::ofstream* out = new std::ofstream("rbeer.log");
+	return *out;
+}
+const char* level_name(Int_t level) {
+	switch(level) {
+	case Logger::kError:   return "ERROR  ";
+	case Logger::kWarning: return "WARNING";
+	case Logger::kInfo:    return "INFO   ";
+	default:               return "DEBUG  ";
+	}
+}
+// A copied record and the number of its thread
+struct Entry {
+	Logger::Record fRecord;
+	Int_t fThread;
+	bool operator< (const Entry& other) const { return fRecord.fTime < other.fRecord.fTime; }
+};
+// Format one record
+void write_entry(std::ostream& strm, const Entry& entry) {
+	const Logger::Record& rec = entry.fRecord;
+	// Time stamp
+	const Double_t elapsed = Long64_t(rec.fTime - gBaseCycles) / gCyclesPerSecond;
+	Long64_t usec = Long64_t(gBaseTime.tv_usec) + Long64_t(elapsed * 1e6);
+	time_t sec = gBaseTime.tv_sec + usec / 1000000;
+	usec %= 1000000;
+	if(usec < 0) { usec += 1000000; --sec; }
+	char stamp[32];
+	tm local;
+	strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", localtime_r(&sec, &local));
+
+	std::string file = rec.fFile ? rec.fFile : "";
+	if(file.find_last_of("/") < file.size()) file = file.substr(file.find_last_of("/") + 1);
+	strm << stamp << "." << std::setw(6) << std::setfill('0') << usec << std::setfill(' ')
+			 << " " << level_name(rec.fLevel) << " [thread " << entry.fThread << "] <"
+			 << (rec.fFunc ? rec.fFunc : "") << "> (" << file << ", line " << rec.fLine << "): ";
+
+	// Arguments
+	const UInt_t size = rec.fSize & 0x7fff;
+	for(UInt_t pos = 0; pos < size; ) {
+		const char tag = rec.fPayload[pos++];
+		switch(tag) {
+		case Logger::kTagSigned:   { Long64_t v; std::copy(rec.fPayload + pos, rec.fPayload + pos + sizeof(v), (char*)&v); strm << v; pos += sizeof(v); break; }
+		case Logger::kTagUnsigned: { ULong64_t v; std::copy(rec.fPayload + pos, rec.fPayload + pos + sizeof(v), (char*)&v); strm << v; pos += sizeof(v); break; }
+		case Logger::kTagDouble:   { Double_t v; std::copy(rec.fPayload + pos, rec.fPayload + pos + sizeof(v), (char*)&v); strm << v; pos += sizeof(v); break; }
+		case Logger::kTagChar:     { strm << rec.fPayload[pos++]; break; }
+		case Logger::kTagBool:     { strm << (rec.fPayload[pos++] ? "true" : "false"); break; }
+		case Logger::kTagString:   {
+			const UInt_t len = static_cast<unsigned char>(rec.fPayload[pos++]);
+			strm.write(rec.fPayload + pos, len);
+			pos += len;
+			break;
+		}
+		default: pos = size; break; // corrupt, shouldn't happen
+		}
+	}
+	if(rec.fSize & 0x8000) strm << "[...]";
+	strm << "\n";
+}
+// Copy out and write everything published so far
+void drain() {
+	pthread_mutex_lock(&gDrainLock);
+	pthread_mutex_lock(&gRingsLock);
+	std::vector<Logger::Ring*> all = rings();
+	pthread_mutex_unlock(&gRingsLock);
+
+	static std::vector<Entry> entries;
+	static std::vector<ULong64_t> dropped;
+	entries.clear();
+	dropped.resize(all.size(), 0);
+	for(UInt_t i=0; i< all.size(); ++i) {
+		Logger::Ring* ring = all[i];
+		const ULong64_t head = ring->fHead;
+		__sync_synchronize(); // read the records after their publication
+		for(ULong64_t pos = ring->fTail; pos != head; ++pos) {
+			entries.push_back(Entry());
+			entries.back().fRecord = ring->fRecords[pos & (Logger::kRingSize - 1)];
+			entries.back().fThread = ring->fThread;
+		}
+		__sync_synchronize(); // finish reading before releasing the slots
+		ring->fTail = head;
+	}
+
+	std::stable_sort(entries.begin(), entries.end());
+	std::ostream& strm = output();
+	for(UInt_t i=0; i< entries.size(); ++i) write_entry(strm, entries[i]);
+	for(UInt_t i=0; i< all.size(); ++i) {
+		const ULong64_t ndropped = all[i]->fDropped;
+		if(ndropped != dropped[i]) {
+			strm << "[thread " << all[i]->fThread << "]: " << ndropped - dropped[i]
+					 << " messages dropped (log ring full)\n";
+			dropped[i] = ndropped;
+		}
+	}
+	if(!entries.empty()) strm.flush();
+	pthread_mutex_unlock(&gDrainLock);
+}
+// Background thread
+void* drain_loop(void*) {
+	timespec wait = { 0, 20000000 }; // 20 ms
+	while(!gStop) {
+		nanosleep(&wait, 0);
+		drain();
+	}
+	return 0;
+}
+// Stop the background thread, write what is left and close the file
+void flush_at_exit() {
+	gStop = true;
+	pthread_join(gDrainThread, 0);
+	drain();
+	output().close();
+}
+// One-time setup
+void init() {
+	pthread_key_create(&gRingKey, release_ring);
+	gCyclesPerSecond = rb::Cycles::PerSecond();
+	gettimeofday(&gBaseTime, 0);
+	gBaseCycles = rb::Cycles::Now();
+	if(pthread_create(&gDrainThread, 0, drain_loop, 0) == 0) atexit(flush_at_exit);
+}
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// Logger                                                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+#ifdef RB_LOGGING
+volatile Int_t Logger::fgLevel = Logger::kWarning;
+#else
+volatile Int_t Logger::fgLevel = Logger::kOff;
+#endif
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Ring* Logger::GetRing() [static]                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Logger::Ring* Logger::GetRing() {
+	if(tRing) return tRing;
+	pthread_once(&gOnce, init);
+	pthread_mutex_lock(&gRingsLock);
+	std::vector<Ring*>& all = rings();
+	// Reuse the ring of an exited thread once it has been emptied
+	for(UInt_t i=0; i< all.size() && !tRing; ++i) {
+		if(all[i]->fOrphan && all[i]->fTail == all[i]->fHead) tRing = all[i];
+	}
+	if(!tRing) {
+		tRing = new(std::nothrow) Ring();
+		if(tRing) all.push_back(tRing);
+	}
+	if(tRing) {
+		tRing->fOrphan = false;
+		tRing->fBusy = false;
+		tRing->fThread = ++gNthreads;
+		pthread_setspecific(gRingKey, tRing);
+	}
+	pthread_mutex_unlock(&gRingsLock);
+	return tRing;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Record* Logger::Reserve() [static]                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Logger::Record* Logger::Reserve(Ring* ring) {
+	if(ring->fBusy) return 0; // logging from inside a message's arguments
+	if(ring->fHead - ring->fTail >= kRingSize) {
+		ring->fDropped = ring->fDropped + 1;
+		return 0;
+	}
+	ring->fBusy = true;
+	return ring->fRecords + (ring->fHead & (kRingSize - 1));
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void Logger::Publish() [static]                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void Logger::Publish(Ring* ring) {
+	__sync_synchronize(); // the record must be complete before it is seen
+	ring->fHead = ring->fHead + 1;
+	ring->fBusy = false;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void Logger::Flush() [static]                         //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void Logger::Flush() {
+	pthread_once(&gOnce, init);
+	drain();
+}
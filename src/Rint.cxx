@@ -1,11 +1,15 @@
 //! \file Rint.cxx
 //! \brief Implements Rint.hxx
 #include <set>
+#include <cstring>
 #include "Rint.hxx"
+#include "Data.hxx"
 #include "Rootbeer.hxx"
 #include "Gui.hxx"
 #include "HistGui.hxx"
 #include "hist/Hist.hxx"
+#include "hist/BackingStore.hxx"
+#include "utils/Affinity.hxx"
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // Class rb::Rint Implementation                         //
@@ -19,12 +23,18 @@ rb::Rint::Rint(const char* appClassName, int* argc, char** argv,
   TRint(appClassName, argc, argv, options, numOptions, kTRUE),
 	fSignals(0), fHistSignals(0),
 	fSaveData(false), fSaveHists(false) {
+	static const char cache_flag[] = "-layout-cache=";
+	for(Int_t i=1; i< *argc; ++i) { // before the events map their classes
+		if(argv[i] && !strncmp(argv[i], cache_flag, sizeof(cache_flag) - 1))
+			 rb::data::Layout::SetCacheFile(argv[i] + sizeof(cache_flag) - 1);
+	}
   RegisterEvents();
   SetPrompt("rootbeer [%d] ");
   PrintLogo(liteLogo);
   std::cout << fMessage.str() << std::endl;
 
 	std::set<std::string> flags(argv, argv + *argc);
+	rb::Affinity::ParseArgs(*argc, argv);
 	if(!(flags.count("-ng") || !gClient)) InitGui();
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -33,6 +43,11 @@ rb::Rint::Rint(const char* appClassName, int* argc, char** argv,
 void rb::Rint::Terminate(Int_t status) {
   rb::canvas::StopUpdate();
   rb::Unattach();
+  rb::hist::StopServer();
+  rb::hist::StopExport();
+  rb::hist::StopAutosave(); // last save, before the histograms go
+  rb::hist::StopRunOutput(); // finishes writing stopped runs
+  rb::hist::BackingStore::Close(); // keeps the counts in the file, before the histograms go
   EventMap_t::iterator it;
   for(it = fEvents.begin(); it != fEvents.end(); ++it) {
     rb::Event* event = it->second.first;
@@ -1,5 +1,11 @@
 //! \file Rootbeer.cxx 
 //! \brief Implements the user interface functions.
+#include <cmath>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <TCutG.h>
 #include <TVirtualPad.h>
@@ -7,9 +13,20 @@
 #include "Rint.hxx"
 #include "Buffer.hxx"
 #include "Data.hxx"
+#include "CutGate.hxx"
 #include "Signals.hxx"
 #include "hist/Hist.hxx"
+#include "hist/Profile.hxx"
+#include "hist/Server.hxx"
+#include "hist/Export.hxx"
+#include "hist/BackingStore.hxx"
+#include "hist/Autosave.hxx"
+#include "hist/RunOutput.hxx"
+#include "Stats.hxx"
+#include "utils/LockProfile.hxx"
+#include "utils/Logger.hxx"
 #include "utils/Error.hxx"
+#include "utils/Affinity.hxx"
 
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -138,8 +155,10 @@ TDirectory* rb::Mkdir(const char* name, const char* title) {
 		}
 	}
 	TDirectory* new_dir = gDirectory->mkdir(name, title);
-	if(new_dir) new_dir->cd();
-	if(gApp()->GetHistSignals()) gApp()->GetHistSignals()->SyncHistTree();
+	if(new_dir) {
+		new_dir->cd();
+		if(gApp()->GetHistSignals()) gApp()->GetHistSignals()->DirectoryAdded(new_dir);
+	}
 	return new_dir;
 }
 
@@ -153,6 +172,57 @@ Bool_t rb::SetTCutGOverwrite(Bool_t on) {
 	return ret;
 }
 
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::SetLogLevel                                  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::SetLogLevel(Int_t level) {
+	if(level < Logger::kOff || level > Logger::kDebug) {
+		err::Error("rb::SetLogLevel") << "Invalid level " << level << ", must be between "
+																	<< Logger::kOff << " and " << Logger::kDebug << ".";
+		return;
+	}
+	Logger::SetLevel(level);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::FlushLog                                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::FlushLog() {
+	Logger::Flush();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::SetErrorLimit                                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::SetErrorLimit(Long64_t first, Double_t period) {
+	if(period <= 0) {
+		err::Error("rb::SetErrorLimit") << "Invalid period " << period << ", must be positive.";
+		return;
+	}
+	err::Counter::SetPolicy(first, period);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::PrintErrors                                  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::PrintErrors() {
+	err::Counter::PrintAll();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::SetAffinity                                  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::SetAffinity(const char* role, const char* cpus) {
+	rb::Affinity::Set(role, cpus);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::PrintAffinity                                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::PrintAffinity() {
+	rb::Affinity::Print(std::cout);
+}
+
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::CreateTCutG                                  //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -182,10 +252,10 @@ TCutG* rb::CreateTCutG(const char* name, Int_t n, const Double_t* x, const Doubl
 		cutg->SetLineWidth(lineWidth);
 		cutg->SetLineColor(lineColor);
 	}
+	CutGate::Touch(); // gates on a cut it replaces look it up again
 	return cutg;
 }
 
-
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // Double_t rb::data::GetValue                           //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -196,6 +266,7 @@ Double_t rb::data::GetValue(const char* name) {
     Error("GetValue", "%s not found.", name);
     return -1.;
   }
+  data::Staged::Flush(); // so a batch set before is seen
   return (Double_t)basicData->GetValue();
 }
 
@@ -209,9 +280,48 @@ void rb::data::SetValue(const char* name, Double_t newvalue) {
     Error("SetData", "Data object: %s not found.", name);
     return;
   }
+  data::Staged::Flush(); // so a batch set before doesn't overwrite this later
   basicData->SetValue(newvalue);
 }
 
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::data::SetValues                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::data::SetValues(const std::map<std::string, Double_t>& values) {
+	if(!data::Staged::Add(values)) return false;
+	data::Staged::Flush(); // unless the attach thread got there first, at the start of its event
+	return true;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Int_t rb::data::LoadCalibration                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::data::LoadCalibration(const char* filename) {
+	std::ifstream file(filename);
+	if(!file.good()) {
+		err::Error("rb::data::LoadCalibration") << "Couldn't open the file \"" << filename << "\".";
+		return -1;
+	}
+	std::map<std::string, Double_t> values;
+	std::string line;
+	for(Int_t lineno = 1; std::getline(file, line); ++lineno) {
+		line = line.substr(0, line.find('#'));
+		std::replace(line.begin(), line.end(), '=', ' ');
+		std::istringstream iss(line);
+		std::string name, extra;
+		Double_t value;
+		if(!(iss >> name)) continue; // blank or comment
+		if(!(iss >> value) || (iss >> extra)) {
+			err::Error("rb::data::LoadCalibration") << filename << ", line " << lineno
+																							<< ": expected \"name value\", nothing was loaded.";
+			return -1;
+		}
+		values[name] = value;
+	}
+	if(!SetValues(values)) return -1;
+	return values.size();
+}
+
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::data::PrintAll                               //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -227,6 +337,18 @@ namespace { rb::hist::Manager* const find_manager(Int_t code) {
   rb::Event* event = rb::gApp()->GetEvent(code);
   if(event == 0) err::Throw() << "Invalid event code: " << code;
   return event->GetHistManager();
+}
+inline void set_sampling(rb::hist::Base* hist, Int_t prescale, Double_t max_rate) {
+  hist->SetPrescale(prescale);
+  hist->SetMaxRate(max_rate);
+}
+void check_edges(Int_t nbins, const Double_t* edges) {
+  if(nbins < 1 || edges == 0) err::Throw() << "Need at least one bin and a valid edge array";
+  for(Int_t i=0; i< nbins; ++i) {
+    if(!(edges[i] < edges[i+1]))
+       err::Throw() << "Bin edges must be increasing (edge " << i+1 << " = " << edges[i+1]
+                    << ", edge " << i << " = " << edges[i] << ")";
+  }
 }}
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -234,12 +356,14 @@ namespace { rb::hist::Manager* const find_manager(Int_t code) {
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 rb::hist::Base* rb::hist::New(const char* name, const char* title,
 															Int_t bx, Double_t xl, Double_t xh,
-															const char* param, const char* gate, Int_t event_code) {
+															const char* param, const char* gate, Int_t event_code,
+															Int_t prescale, Double_t max_rate) {
 	Bool_t from_gui =
 		 gApp()->GetHistSignals() ? gApp()->GetHistSignals()->IsHistFromGui() : 0;
   rb::hist::Base* hist = 0;
   try {
     hist = find_manager(event_code)->Create<D1>(name, title, param, gate, event_code, bx, xl, xh);
+    set_sampling(hist, prescale, max_rate);
   }
   catch (std::exception& e) {
 		if(!from_gui) err::Error("rb::hist::New") << e.what();
@@ -254,12 +378,14 @@ rb::hist::Base* rb::hist::New(const char* name, const char* title,
 rb::hist::Base* rb::hist::New(const char* name, const char* title,
 															Int_t bx, Double_t xl, Double_t xh,
 															Int_t by, Double_t yl, Double_t yh,
-															const char* param, const char* gate, Int_t event_code) {
+															const char* param, const char* gate, Int_t event_code,
+															Int_t prescale, Double_t max_rate) {
   Bool_t from_gui =
 		 gApp()->GetHistSignals() ? gApp()->GetHistSignals()->IsHistFromGui() : 0;
   rb::hist::Base* hist = 0;
   try {
     hist = find_manager(event_code)->Create<D2>(name, title, param, gate, event_code, bx, xl, xh, by, yl, yh);
+    set_sampling(hist, prescale, max_rate);
   }
   catch (std::exception& e) {
 		if(!from_gui) err::Error("rb::hist::New") << e.what();
@@ -275,13 +401,90 @@ rb::hist::Base* rb::hist::New(const char* name, const char* title,
 															Int_t bx, Double_t xl, Double_t xh,
 															Int_t by, Double_t yl, Double_t yh,
 															Int_t bz, Double_t zl, Double_t zh,
-															const char* param, const char* gate, Int_t event_code) {
+															const char* param, const char* gate, Int_t event_code,
+															Int_t prescale, Double_t max_rate) {
 	Bool_t from_gui =
 		 gApp()->GetHistSignals() ? gApp()->GetHistSignals()->IsHistFromGui() : 0;
 
   rb::hist::Base* hist = 0;
   try {
 		hist = find_manager(event_code)->Create<D3>(name, title, param, gate, event_code, bx, xl, xh, by, yl, yh, bz, zl, zh);
+    set_sampling(hist, prescale, max_rate);
+  }
+  catch (std::exception& e) {
+		if(!from_gui) err::Error("rb::hist::New") << e.what();
+		else throw;
+  }
+  return hist;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::NewVariable (One-dimensional)              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Base* rb::hist::NewVariable(const char* name, const char* title,
+																			Int_t nbinsx, const Double_t* xedges,
+																			const char* param, const char* gate, Int_t event_code,
+																			Int_t prescale, Double_t max_rate) {
+	Bool_t from_gui =
+		 gApp()->GetHistSignals() ? gApp()->GetHistSignals()->IsHistFromGui() : 0;
+  rb::hist::Base* hist = 0;
+  try {
+    check_edges(nbinsx, xedges);
+    hist = find_manager(event_code)->Create<Variable>(name, title, param, gate, event_code, nbinsx, xedges);
+    set_sampling(hist, prescale, max_rate);
+  }
+  catch (std::exception& e) {
+		if(!from_gui) err::Error("rb::hist::New") << e.what();
+		else throw;
+  }
+  return hist;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::NewVariable (Two-dimensional)              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Base* rb::hist::NewVariable(const char* name, const char* title,
+																			Int_t nbinsx, const Double_t* xedges,
+																			Int_t nbinsy, const Double_t* yedges,
+																			const char* param, const char* gate, Int_t event_code,
+																			Int_t prescale, Double_t max_rate) {
+	Bool_t from_gui =
+		 gApp()->GetHistSignals() ? gApp()->GetHistSignals()->IsHistFromGui() : 0;
+  rb::hist::Base* hist = 0;
+  try {
+    check_edges(nbinsx, xedges);
+    check_edges(nbinsy, yedges);
+    hist = find_manager(event_code)->Create<Variable>(name, title, param, gate, event_code,
+																											nbinsx, xedges, nbinsy, yedges);
+    set_sampling(hist, prescale, max_rate);
+  }
+  catch (std::exception& e) {
+		if(!from_gui) err::Error("rb::hist::New") << e.what();
+		else throw;
+  }
+  return hist;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::NewLog                                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Base* rb::hist::NewLog(const char* name, const char* title,
+																 Int_t nbinsx, Double_t xlow, Double_t xhigh,
+																 const char* param, const char* gate, Int_t event_code,
+																 Int_t prescale, Double_t max_rate) {
+	Bool_t from_gui =
+		 gApp()->GetHistSignals() ? gApp()->GetHistSignals()->IsHistFromGui() : 0;
+  rb::hist::Base* hist = 0;
+  try {
+    if(!(xlow > 0 && xhigh > xlow))
+       err::Throw() << "Log binning needs 0 < xlow < xhigh (xlow = " << xlow << ", xhigh = " << xhigh << ")";
+    if(nbinsx < 1) err::Throw() << "Need at least one bin";
+    std::vector<Double_t> edges(nbinsx + 1);
+    for(Int_t i=0; i<= nbinsx; ++i)
+       edges[i] = xlow * std::pow(xhigh / xlow, Double_t(i) / nbinsx);
+    edges[nbinsx] = xhigh;
+    hist = find_manager(event_code)->Create<Variable>(name, title, param, gate, event_code, nbinsx, &edges[0]);
+    set_sampling(hist, prescale, max_rate);
   }
   catch (std::exception& e) {
 		if(!from_gui) err::Error("rb::hist::New") << e.what();
@@ -296,7 +499,7 @@ rb::hist::Base* rb::hist::New(const char* name, const char* title,
 rb::hist::Base* rb::hist::NewSummary(const char* name, const char* title,
 																		 Int_t nbins, Double_t low, Double_t high,
 																		 const char* paramList,  const char* gate, Int_t event_code,
-																		 const char* orient) {
+																		 const char* orient, Int_t prescale, Double_t max_rate) {
 	Bool_t from_gui =
 		 gApp()->GetHistSignals() ? gApp()->GetHistSignals()->IsHistFromGui() : 0;
 
@@ -304,6 +507,7 @@ rb::hist::Base* rb::hist::NewSummary(const char* name, const char* title,
   try {
     hist = find_manager(event_code)->Create<Summary>(name, title, paramList, gate, event_code,
 																										 nbins, low, high, orient);
+    set_sampling(hist, prescale, max_rate);
   }
   catch (std::exception& e) {
 		if(!from_gui) err::Error("rb::hist::New") << e.what();
@@ -317,13 +521,15 @@ rb::hist::Base* rb::hist::NewSummary(const char* name, const char* title,
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 rb::hist::Base* rb::hist::NewGamma(const char* name, const char* title,
 																	 Int_t nbinsx, Double_t xlow, Double_t xhigh,
-																	 const char* param, const char* gate, Int_t event_code) {
+																	 const char* param, const char* gate, Int_t event_code,
+																	 Int_t prescale, Double_t max_rate) {
 	Bool_t from_gui =
 		 gApp()->GetHistSignals() ? gApp()->GetHistSignals()->IsHistFromGui() : 0;
 
   rb::hist::Base* hist = 0;
   try {
     hist = find_manager(event_code)->Create<Gamma>(name, title, param, gate, event_code, nbinsx, xlow, xhigh);
+    set_sampling(hist, prescale, max_rate);
   }
   catch (std::exception& e) {
 		if(!from_gui) err::Error("rb::hist::New") << e.what();
@@ -338,7 +544,8 @@ rb::hist::Base* rb::hist::NewGamma(const char* name, const char* title,
 rb::hist::Base* rb::hist::NewGamma(const char* name, const char* title,
 																	 Int_t nbinsx, Double_t xlow, Double_t xhigh,
 																	 Int_t nbinsy, Double_t ylow, Double_t yhigh,
-																	 const char* param, const char* gate, Int_t event_code) {
+																	 const char* param, const char* gate, Int_t event_code,
+																	 Int_t prescale, Double_t max_rate) {
 	Bool_t from_gui =
 		 gApp()->GetHistSignals() ? gApp()->GetHistSignals()->IsHistFromGui() : 0;
 
@@ -346,6 +553,7 @@ rb::hist::Base* rb::hist::NewGamma(const char* name, const char* title,
   try {
     hist = find_manager(event_code)->Create<Gamma>(name, title, param, gate, event_code,
 																									 nbinsx, xlow, xhigh, nbinsy, ylow, yhigh);
+    set_sampling(hist, prescale, max_rate);
   }
   catch (std::exception& e) {
 		if(!from_gui) err::Error("rb::hist::New") << e.what();
@@ -361,7 +569,8 @@ rb::hist::Base* rb::hist::NewGamma(const char* name, const char* title,
 																	 Int_t nbinsx, Double_t xlow, Double_t xhigh,
 																	 Int_t nbinsy, Double_t ylow, Double_t yhigh,
 																	 Int_t nbinsz, Double_t zlow, Double_t zhigh,
-																	 const char* params,  const char* gate, Int_t event_code) {
+																	 const char* params,  const char* gate, Int_t event_code,
+																	 Int_t prescale, Double_t max_rate) {
 	Bool_t from_gui =
 		 gApp()->GetHistSignals() ? gApp()->GetHistSignals()->IsHistFromGui() : 0;
 
@@ -369,6 +578,7 @@ rb::hist::Base* rb::hist::NewGamma(const char* name, const char* title,
   try {
     hist = find_manager(event_code)->Create<Gamma>(name, title, params, gate, event_code,
 																									 nbinsx, xlow, xhigh, nbinsy, ylow, yhigh, nbinsz, zlow, zhigh);
+    set_sampling(hist, prescale, max_rate);
   }
   catch (std::exception& e) {
 		if(!from_gui) err::Error("rb::hist::New") << e.what();
@@ -381,12 +591,14 @@ rb::hist::Base* rb::hist::NewGamma(const char* name, const char* title,
 //  rb::hist::NewBit                                     //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 rb::hist::Base* rb::hist::NewBit(const char* name, const char* title, Int_t nbits, const char* param, const char* gate,
-																 Int_t event_code) {
+																 Int_t event_code,
+																 Int_t prescale, Double_t max_rate) {
 	Bool_t from_gui =
 		 gApp()->GetHistSignals() ? gApp()->GetHistSignals()->IsHistFromGui() : 0;
   rb::hist::Base* hist = 0;
   try {
     hist = find_manager(event_code)->Create<Bit>(name, title, param, gate, event_code, nbits, 0., 1.);
+    set_sampling(hist, prescale, max_rate);
   }
   catch (std::exception& e) {
 		if(!from_gui) err::Error("rb::hist::New") << e.what();
@@ -394,3 +606,154 @@ rb::hist::Base* rb::hist::NewBit(const char* name, const char* title, Int_t nbit
   }
   return hist;
 }
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::StartProfile                               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::StartProfile(Int_t period) {
+  rb::hist::Profiler::Reset();
+  rb::hist::Profiler::Enable(period > 0 ? period : 1);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::StopProfile                                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::StopProfile() {
+  rb::hist::Profiler::Disable();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::PrintProfile                               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::PrintProfile(Int_t nmax) {
+  rb::hist::Profiler::Print(nmax);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::SetParallelFill                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::SetParallelFill(Int_t nthreads) {
+  rb::EventVector_t events = rb::gApp()->GetEventVector();
+  for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it) {
+    rb::Event* event = rb::gApp()->GetEvent(it->first);
+    if(event) event->GetHistManager()->SetParallel(nthreads);
+  }
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::StartServer                                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::StartServer(Int_t port, Double_t period, Bool_t lan) {
+  return rb::hist::Server::Start(port, period, lan);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::StopServer                                 //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::StopServer() {
+  rb::hist::Server::Stop();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::StartExport                                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::StartExport(const char* name, Double_t period) {
+  return rb::hist::Export::Start(name, period);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::StopExport                                 //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::StopExport() {
+  rb::hist::Export::Stop();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::StartAutosave                              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::StartAutosave(const char* filename, Double_t period, Bool_t changed_only, Int_t nfiles) {
+  return rb::hist::Autosave::Start(filename, period, changed_only, nfiles);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::StopAutosave                               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::StopAutosave() {
+  rb::hist::Autosave::Stop();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::StartRunOutput                             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::StartRunOutput(const char* pattern) {
+  return rb::hist::RunOutput::Enable(pattern);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::StopRunOutput                              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::StopRunOutput() {
+  rb::hist::RunOutput::Disable();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::OpenBackingStore                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::OpenBackingStore(const char* filename, Double_t sync_period) {
+  return rb::hist::BackingStore::Open(filename, sync_period);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::CloseBackingStore                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::CloseBackingStore() {
+  rb::hist::BackingStore::Close();
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::stats::Print                                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::stats::Print() {
+  rb::stats::Registry::Print(std::cout);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::stats::Dump                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::stats::Dump(const char* filename) {
+  if(!filename || !strcmp(filename, "")) {
+    rb::stats::Registry::Dump(std::cout);
+    return;
+  }
+  std::ofstream ofs(filename);
+  if(!ofs.good()) {
+    err::Error("rb::stats::Dump") << "Couldn't open the file " << filename << " for writing.";
+    return;
+  }
+  rb::stats::Registry::Dump(ofs);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::stats::Reset                                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::stats::Reset() {
+  rb::stats::Registry::Reset();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::stats::StartLockProfile                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::stats::StartLockProfile() {
+  rb::LockProfiler::Reset();
+  rb::LockProfiler::Enable();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::stats::StopLockProfile                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::stats::StopLockProfile() {
+  rb::LockProfiler::Disable();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::stats::PrintLockProfile                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::stats::PrintLockProfile(Int_t nsites) {
+  rb::LockProfiler::Print(nsites);
+}
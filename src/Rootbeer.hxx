@@ -6,6 +6,8 @@
 //! of the available user functions and their descriptions can be found in this Doxygen file.
 #ifndef ROOTBEER_HXX
 #define ROOTBEER_HXX
+#include <map>
+#include <string>
 #include <Rtypes.h>
 
 class TCutG;
@@ -38,6 +40,9 @@ extern void Unattach();
 /// \brief Write configuration file
 //! \details The configureation file is CINT code that reproduces things you've defined in ROOTBEER
 //! so far: histogram definitions, directories, and variable values.
+//! If \c filename ends in <tt>.rbc</tt>, a structured, line-per-object file is written instead,
+//! which ReadConfig() parses directly rather than running through CINT, so that large setups load
+//! quickly (see WriteConfig.cxx for the format).
 //! \param filename Path of the configuration file you're writing.
 //! \param prompt Boolean: true = ask to overwrite existing files, false = overwrite automatically.
 extern Int_t WriteConfig(const char* filename, Bool_t prompt = kTRUE);
@@ -60,6 +65,10 @@ extern Int_t WriteVariables(const char* filename, Bool_t prompt = kTRUE);
 //!     new histogram with \c _1, \c _2, etc. appended to the name.
 //!
 //!  Note that the option string is not case sensitive.
+//!
+//! Files ending in <tt>.rbc</tt> (see WriteConfig()) are parsed natively: the GUI is synced once at
+//! the end rather than for every histogram, and variables are set as a single batch. Errors are
+//! reported with their line number, and the rest of the file is still read.
 extern void ReadConfig(const char* filename, Option_t* option = "o");
 
 /// \brief Write canvas configuration file.
@@ -92,6 +101,34 @@ extern TCutG* CreateTCutG(const char* name, Int_t n, const Double_t* x, const Do
 //! \returns true if the condition was changed by calling the function, false otherwise
 extern Bool_t SetTCutGOverwrite(Bool_t on);
 
+/// Set how much is written to rbeer.log.
+//! \param level 0 (nothing), 1 (errors), 2 (warnings), 3 (info) or 4 (debug, e.g. lock logging)
+extern void SetLogLevel(Int_t level);
+
+/// Write out pending log messages now instead of waiting for the background writer.
+extern void FlushLog();
+
+/// Set how often repeated errors (e.g. bad events) are printed.
+//! \param first Number of occurrences of each error printed before the rest are only counted
+//!  (negative to print all of them)
+//! \param period Seconds between the summaries of suppressed errors
+extern void SetErrorLimit(Long64_t first, Double_t period = 10);
+
+/// Print how many times each counted error has happened.
+extern void PrintErrors();
+
+/// Pin a kind of thread to a set of CPUs.
+//! \details Also available on the command line as <tt>-pin-ROLE=CPUS</tt>. Applies to threads
+//! started afterwards; the compute workers re-pin themselves straight away. A pinned attach
+//! thread also moves the histogram bins to its own memory node when it starts.
+//! \param role "attach" (reading, unpacking, processing and saving data), "fill" (parallel
+//!  histogram filling, see hist::SetParallelFill()) or "canvas" (canvas updates)
+//! \param cpus List of CPUs and ranges, e.g. "0-3,8"; empty to unpin
+extern void SetAffinity(const char* role, const char* cpus);
+
+/// Print which CPUs each kind of thread is pinned to.
+extern void PrintAffinity();
+
 /// Contains user functions relevant to updating canvases and other graphics.
 namespace canvas
 {
@@ -150,6 +187,27 @@ extern Double_t GetValue(const char* name);
 //! \param [in] newvalue What you want to set the data keyed by <i>name</i> to.
 extern void SetValue(const char* name, Double_t newvalue);
 
+/// Set the values of many data members at once.
+//! \details The changes are staged and applied together between two events, so every event
+//! sees either all of the old values or all of the new ones. They have been applied when this
+//! returns, so later calls of SetValue() and GetValue() come after them, whether or not anything
+//! is attached. Faster than calling SetValue() for each variable.
+//! \param [in] values New values keyed by full name (see data::GetValue())
+//! \returns false (changing nothing) if any of the names is unknown.
+extern Bool_t SetValues(const std::map<std::string, Double_t>& values);
+
+/// Load values of data members from a text file, applying them as one set (see SetValues()).
+//! \details Each line holds a name and a value, separated by spaces or '='. Blank lines and
+//! anything following a '#' are ignored:
+//! \code
+//! # Silicon strip gains
+//! si.gain[0]  1.0032
+//! si.gain[1] = 0.9987
+//! \endcode
+//! \returns The number of values set, or -1 (changing nothing) if the file can't be read or
+//! contains an error.
+extern Int_t LoadCalibration(const char* filename);
+
 
 /// Print the fill name and current value of every data member in every listed class.
 extern void PrintAll();
@@ -157,6 +215,12 @@ extern void PrintAll();
 } // namespace data
 
 /// Creation functions for histograms
+//! \details All of the creation functions take two optional trailing arguments to
+//! sample the histogram rather than filling it on every event: \c prescale fills only
+//! every n-th event passing the gate, and \c max_rate caps the number of fills per second
+//! (0 means no limit). Use rb::hist::Base::GetScaleFactor() to correct integrals; saved
+//! copies of sampled histograms have it next to them, as a TParameter<Double_t> named
+//! "<name>_scale".
 namespace hist
 {
 class Base;
@@ -164,50 +228,193 @@ class Base;
 /// One-dimensional creation function
 extern rb::hist::Base* New(const char* name, const char* title,
 													 Int_t nbinsx, Double_t xlow, Double_t xhigh,
-													 const char* param, const char* gate = "", Int_t event_code = 1);
+													 const char* param, const char* gate = "", Int_t event_code = 1,
+													 Int_t prescale = 1, Double_t max_rate = 0);
 
 /// Two-dimensional creation function
 extern rb::hist::Base* New(const char* name, const char* title,
 													 Int_t nbinsx, Double_t xlow, Double_t xhigh,
 													 Int_t nbinsy, Double_t ylow, Double_t yhigh,
-													 const char* param, const char* gate = "", Int_t event_code = 1);
+													 const char* param, const char* gate = "", Int_t event_code = 1,
+													 Int_t prescale = 1, Double_t max_rate = 0);
 
 /// Three-dimensional creation function
 extern rb::hist::Base* New(const char* name, const char* title,
 													 Int_t nbinsx, Double_t xlow, Double_t xhigh,
 													 Int_t nbinsy, Double_t ylow, Double_t yhigh,
 													 Int_t nbinsz, Double_t zlow, Double_t zhigh,
-													 const char* param, const char* gate = "", Int_t event_code = 1);
+													 const char* param, const char* gate = "", Int_t event_code = 1,
+													 Int_t prescale = 1, Double_t max_rate = 0);
+
+/// One-dimensional creation function with variable bin widths
+//! \param xedges Array of <tt>nbinsx + 1</tt> bin edges, in increasing order
+extern rb::hist::Base* NewVariable(const char* name, const char* title,
+																	 Int_t nbinsx, const Double_t* xedges,
+																	 const char* param, const char* gate = "", Int_t event_code = 1,
+																	 Int_t prescale = 1, Double_t max_rate = 0);
+
+/// Two-dimensional creation function with variable bin widths
+//! \param xedges Array of <tt>nbinsx + 1</tt> bin edges, in increasing order
+//! \param yedges Array of <tt>nbinsy + 1</tt> bin edges, in increasing order
+extern rb::hist::Base* NewVariable(const char* name, const char* title,
+																	 Int_t nbinsx, const Double_t* xedges,
+																	 Int_t nbinsy, const Double_t* yedges,
+																	 const char* param, const char* gate = "", Int_t event_code = 1,
+																	 Int_t prescale = 1, Double_t max_rate = 0);
+
+/// One-dimensional creation function with logarithmic bins
+//! \details Bins are equally spaced in log(x) between \c xlow and \c xhigh, which must both be positive.
+extern rb::hist::Base* NewLog(const char* name, const char* title,
+															Int_t nbinsx, Double_t xlow, Double_t xhigh,
+															const char* param, const char* gate = "", Int_t event_code = 1,
+															Int_t prescale = 1, Double_t max_rate = 0);
 
 /// Summary histogram creation
 extern rb::hist::Base* NewSummary(const char* name, const char* title,
 																	Int_t nbins, Double_t low, Double_t high,
 																	const char* paramList,  const char* gate = "", Int_t event_code = 1,
-																	const char* orientation = "v");
+																	const char* orientation = "v", Int_t prescale = 1, Double_t max_rate = 0);
 
 /// Gamma hist creation (1d)
 extern rb::hist::Base* NewGamma(const char* name, const char* title,
 																Int_t nbinsx, Double_t xlow, Double_t xhigh,
-																const char* params,  const char* gate = "", Int_t event_code = 1);
+																const char* params,  const char* gate = "", Int_t event_code = 1,
+																Int_t prescale = 1, Double_t max_rate = 0);
 
 /// Gamma hist creation (2d)
 extern rb::hist::Base* NewGamma(const char* name, const char* title,
 																Int_t nbinsx, Double_t xlow, Double_t xhigh,
 																Int_t nbinsy, Double_t ylow, Double_t yhigh,
-																const char* params,  const char* gate = "", Int_t event_code = 1);
+																const char* params,  const char* gate = "", Int_t event_code = 1,
+																Int_t prescale = 1, Double_t max_rate = 0);
 
 /// Gamma hist creation (3d)
 extern rb::hist::Base* NewGamma(const char* name, const char* title,
 																Int_t nbinsx, Double_t xlow, Double_t xhigh,
 																Int_t nbinsy, Double_t ylow, Double_t yhigh,
 																Int_t nbinsz, Double_t zlow, Double_t zhigh,
-																const char* params,  const char* gate = "", Int_t event_code = 1);
+																const char* params,  const char* gate = "", Int_t event_code = 1,
+																Int_t prescale = 1, Double_t max_rate = 0);
 
 /// Bit hist creation
 rb::hist::Base* NewBit (const char* name, const char* title, Int_t nbits, const char* param,
-												const char* gate = "", Int_t event_code = 1);
+												const char* gate = "", Int_t event_code = 1,
+												Int_t prescale = 1, Double_t max_rate = 0);
+
+/// Start profiling histogram fills.
+//! Counts fills, gate passes and formula evaluations for every histogram, and times one
+//! in every \c period fills (rounded up to a power of two). Also zeros any previous counts.
+extern void StartProfile(Int_t period = 64);
+
+/// Stop profiling histogram fills; the counts are kept until the next StartProfile().
+extern void StopProfile();
+
+/// Print the histograms and formulae that take the most time to fill/evaluate.
+//! \param nmax Maximum number of histograms (and of formulae) to print
+extern void PrintProfile(Int_t nmax = 30);
+
+/// Fill each event type's histograms with several threads.
+//! \details Gates and parameters are still evaluated by the attach thread; the filling is
+//! split between \c nthreads threads, balanced by the measured time each histogram takes to
+//! fill. Worthwhile for large numbers of histograms (or expensive ones, e.g. 3d or gamma).
+//! \param nthreads Number of threads per event type; 0 or 1 fills serially (the default)
+extern void SetParallelFill(Int_t nthreads);
+
+/// Serve the histograms to remote viewers over TCP (see rb::hist::Server for the protocol).
+//! \details Viewers get the catalogue of histograms, and then only the bins that changed
+//! since they last asked, compressed. Snapshots are taken by the server's own thread, at
+//! most once every \c period seconds however many viewers there are.
+//! \param port TCP port to listen on
+//! \param period Minimum time between snapshots, in seconds
+//! \param lan If true, accept viewers on other hosts, otherwise only on this one
+//! \returns false if the server couldn't be started
+extern Bool_t StartServer(Int_t port = 9091, Double_t period = 1, Bool_t lan = false);
+
+/// Stop serving histograms.
+extern void StopServer();
+
+/// Publish the histograms in POSIX shared memory (see rb::hist::Export for the layout).
+//! \details Every \c period seconds, a snapshot of every histogram is copied into the
+//! segment, where viewer processes on the same host can read it without copying it and
+//! without touching the analyzer's locks (see rb::hist::ExportReader).
+//! \param name Name of the shared memory segment
+//! \param period Time between publications, in seconds
+//! \returns false if the segment couldn't be created
+extern Bool_t StartExport(const char* name = "/rootbeer", Double_t period = 1);
+
+/// Stop publishing histograms in shared memory, and remove the segment.
+extern void StopExport();
+
+/// Periodically save the histograms to a rotating set of ROOT files (see rb::hist::Autosave).
+//! \details Runs in the background from snapshots, so it is safe to leave on during runs. The
+//! files are numbered, e.g. "autosave.0.root", "autosave.1.root", and written in turn, so a crash
+//! while writing one of them never loses the others.
+//! \param filename Name of the files; the file number is inserted before the extension
+//! \param period Time between autosaves, in seconds
+//! \param changed_only If true, only rewrite the histograms that changed since the file was last written
+//! \param nfiles Number of files to rotate through
+//! \returns false if autosaving couldn't be started
+extern Bool_t StartAutosave(const char* filename = "autosave.root", Double_t period = 300, Bool_t changed_only = true, Int_t nfiles = 2);
+
+/// Save the histograms one last time, and stop autosaving.
+extern void StopAutosave();
+
+/// Save the histograms of every run to a file of their own (see rb::hist::RunOutput).
+//! \details When the end-of-run event of a run is unpacked, every histogram is swapped for a zeroed copy without pausing the
+//! analysis, and the old contents are written in the background, e.g. for run 42 and the pattern
+//! "run%05d_hists.root", to run00042_hists.root, with the same directories. The histograms then always hold the current run only.
+//! \param pattern Name of the files, with a printf-style integer conversion for the run number
+//! \returns false if it couldn't be enabled
+extern Bool_t StartRunOutput(const char* pattern = "run%05d_hists.root");
+
+/// Stop saving the histograms at run stops (runs already stopped are still written).
+extern void StopRunOutput();
+
+/// Keep the bins of every histogram in a memory-mapped file (see rb::hist::BackingStore).
+//! \details The counts survive a crash of the analyzer, and (up to the last sync) of the host.
+//! Opening the same file again after a crash or restart makes every histogram with the same
+//! path and binning resume from the counts in the file, without reprocessing any data.
+//! \param filename File to keep the bins in; created if it doesn't exist
+//! \param sync_period Time between writes of the file to disk, in seconds
+//! \returns false if the file couldn't be opened
+extern Bool_t OpenBackingStore(const char* filename, Double_t sync_period = 10);
+
+/// Move the bins of every histogram back into memory and close the backing store file.
+//! \details The counts stay in the file, for a later OpenBackingStore().
+extern void CloseBackingStore();
+
+} // namespace hist
+
+/// Statistics on each stage of the analysis pipeline
+//! \details Every attach thread counts calls, rates (averaged over the last few seconds) and
+//! latency distributions for reading and unpacking buffers, and, for each event type, for waiting
+//! on the data locks, DoProcess(), filling the event tree, saving data, and filling histograms.
+//! Decompression of .gz files is counted separately, but is also part of the read time.
+namespace stats
+{
+/// Print a table of the statistics for every thread and event type.
+extern void Print();
 
-}
+/// Write the statistics in JSON format.
+//! \param filename Output file; if empty, write to stdout
+extern void Dump(const char* filename = "");
+
+/// Zero all statistics.
+extern void Reset();
+
+/// Start profiling lock contention.
+//! Counts acquisitions, waits and hold times for every rb::Mutex, by locking site.
+//! Only available when compiled with -DRB_LOCK_PROFILE.
+extern void StartLockProfile();
+
+/// Stop profiling lock contention; the counts are kept until the next StartLockProfile().
+extern void StopLockProfile();
+
+/// Print the mutexes that threads spend the most time waiting for.
+//! \param nsites Maximum number of locking sites (and of contending thread pairs) printed per mutex
+extern void PrintLockProfile(Int_t nsites = 10);
+
+} // namespace stats
 }
 
 #endif
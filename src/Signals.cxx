@@ -1,11 +1,18 @@
 //! \file Signals.cxx
 //! \brief Implements rb::Signals
 #include <algorithm>
+#include <iterator>
+#include <set>
+#include <vector>
 #include <TROOT.h>
 #include <TString.h>
 #include <TGMsgBox.h>
 #include <TGFileDialog.h>
 #include <TGInputDialog.h>
+#include <TThread.h>
+#include <TTimer.h>
+#include <TCutG.h>
+#include <Buttons.h>
 #include "TGSelectDialog.h"
 #include "TGDivideSelect.h"
 #include "Signals.hxx"
@@ -16,18 +23,30 @@
 #include "Gui.hxx"
 #include "HistGui.hxx"
 #include "hist/Hist.hxx"
+#include "CutGate.hxx"
+#include "Stats.hxx"
 #include "utils/Error.hxx"
+#include "utils/Mutex.hxx"
 #include "utils/ANSort.hxx"
 
 
-rb::Signals::Signals() { }
+namespace {
+// How often the pipeline summary is redrawn (ms)
+const Long_t kStatsPeriod = 1000;
+}
 
-rb::Signals::~Signals() { }
+rb::Signals::Signals(): fStatsTimer(new TTimer(kStatsPeriod)) {
+	fStatsTimer->Connect("Timeout()", "rb::Signals", this, "UpdateStats()");
+	fStatsTimer->TurnOn();
+}
+
+rb::Signals::~Signals() {
+	delete fStatsTimer;
+}
 
 namespace { void error_box(const char* message, const char* title = "Error") {
 	new TGMsgBox(gClient->GetRoot(), 0, title, message);
 }
-ANSort ansort;
 }
 
 void rb::Signals::UpdateBufferCounter(Int_t n, Bool_t force) {
@@ -38,6 +57,12 @@ void rb::Signals::UpdateBufferCounter(Int_t n, Bool_t force) {
 	rb::gApp()->fRbeerFrame->fNbuffers->ChangeText(sstr.str().c_str());
 }
 
+void rb::Signals::UpdateStats() {
+	// On the GUI thread, so it keeps going when the attach thread is stalled
+	if(!rb::gApp()->fRbeerFrame || !rb::gApp()->fRbeerFrame->fStatsSummary) return;
+	rb::gApp()->fRbeerFrame->fStatsSummary->ChangeText(rb::stats::Registry::Summary().c_str());
+}
+
 void rb::Signals::SaveData() {
 	EnableSaveHists();
 	if(rb::gApp()->fRbeerFrame->fSaveData->IsOn()) {
@@ -236,9 +261,24 @@ void rb::Signals::DivideCurrent() {
 
 // =========== HIST ============ //
 rb::HistSignals::HistSignals():
-	fHistFromGui (false) { }
+	fHistFromGui (false), fGuiThread(TThread::SelfId()), fPendingTimer(new TTimer(kPendingPeriod)) {
+	fPendingTimer->Connect("Timeout()", "rb::HistSignals", this, "ProcessPending()");
+	fPendingTimer->TurnOn();
+	TQObject::Connect("TCanvas", "ProcessedEvent(Int_t,Int_t,Int_t,TObject*)",
+										"rb::HistSignals", this, "CanvasEvent(Int_t,Int_t,Int_t,TObject*)");
+}
+
+rb::HistSignals::~HistSignals() {
+	TQObject::Disconnect("TCanvas", "ProcessedEvent(Int_t,Int_t,Int_t,TObject*)",
+											 this, "CanvasEvent(Int_t,Int_t,Int_t,TObject*)");
+	delete fPendingTimer;
+}
 
-rb::HistSignals::~HistSignals() { }
+void rb::HistSignals::CanvasEvent(Int_t event, Int_t, Int_t, TObject* selected) {
+	// A cut dragged with the mouse: its gates rebuild their rasters before the next event
+	if(event == kButton1Up && selected && selected->InheritsFrom(TCutG::Class()))
+		 rb::CutGate::Touch();
+}
 
 void rb::HistSignals::Quit() {
 	std::cout << "\n";
@@ -298,7 +338,13 @@ void rb::HistSignals::hist_field_enable(bool onoff, int which) {
 		else { // enabling
 			param->SetEnabled(true);
 			param->EnableTextInput(true);
-			if(param->GetTextEntry()) param->GetTextEntry()->SetText("");
+			if(param->GetTextEntry()) {
+				param->GetTextEntry()->SetText("");
+				std::stringstream slot;
+				slot << "FilterParameters(=" << which << ")";
+				param->GetTextEntry()->Disconnect("TextChanged(const char*)", this);
+				param->GetTextEntry()->Connect("TextChanged(const char*)", "rb::HistSignals", this, slot.str().c_str());
+			}
 		}
 	}
 	for(int i=1; i< 4; ++i)
@@ -311,6 +357,16 @@ void rb::HistSignals::hist_error(const char* message) {
 }
 
 
+namespace {
+// Parameter names of each event, built once per event code until the events or variables change
+std::map<Int_t, ANIndex> parameter_index;
+// Most names shown in a parameter combo box; typing a prefix narrows the list
+const std::size_t kMaxParameterEntries = 500;
+TGComboBox* param_combo(Int_t axis) {
+	TGComboBox* combos[3] = { rb::gApp()->fHistFrame->fParamX, rb::gApp()->fHistFrame->fParamY, rb::gApp()->fHistFrame->fParamZ };
+	return axis >= 0 && axis < 3 ? combos[axis] : 0;
+} }
+
 void rb::HistSignals::PopulateParameters(Int_t event_code) {
 	rb::Event* event = gApp()->GetEvent(event_code);
 	if(!event) {
@@ -321,8 +377,7 @@ void rb::HistSignals::PopulateParameters(Int_t event_code) {
 		rb::gApp()->fHistFrame->fParamZ->RemoveAll();
 		return;
 	}
-	static std::map<Int_t, std::vector<std::string> > branches;
-	if(!branches.count(event_code)) {
+	if(!parameter_index.count(event_code)) {
 		std::vector<std::pair<std::string, std::string> > top_branches = event->GetBranchList();
 		std::vector<std::string> event_branches;
 		std::vector<std::pair<std::string, std::string> >::iterator it;
@@ -330,15 +385,35 @@ void rb::HistSignals::PopulateParameters(Int_t event_code) {
 			data::Mapper mapper(it->first.c_str(), it->second.c_str(), 0, false);
 			mapper.ReadBranches(event_branches);
 		}
-		std::sort(event_branches.begin(), event_branches.end(), ansort);
-		branches.insert(std::make_pair(event_code, event_branches));
+		ANIndex& index = parameter_index[event_code];
+		for(std::vector<std::string>::iterator itb = event_branches.begin(); itb != event_branches.end(); ++itb)
+			 index.Insert(*itb);
+	}
+	for(Int_t axis = 0; axis < 3; ++axis) {
+		std::vector<std::string> entries;
+		parameter_index[event_code].Find("", entries, kMaxParameterEntries);
+		populate_combo(param_combo(axis), entries, 400);
 	}
-	populate_combo(rb::gApp()->fHistFrame->fParamX, branches[event_code], 400);
-	populate_combo(rb::gApp()->fHistFrame->fParamY, branches[event_code], 400);
-	populate_combo(rb::gApp()->fHistFrame->fParamZ, branches[event_code], 400);
+}
+
+void rb::HistSignals::FilterParameters(Int_t axis) {
+	TGComboBox* combo = param_combo(axis);
+	if(!combo || !combo->GetTextEntry()) return;
+	std::map<Int_t, ANIndex>::iterator index = parameter_index.find(rb::gApp()->fHistFrame->fEventEntry->GetSelected());
+	if(index == parameter_index.end()) return;
+	const std::string prefix = combo->GetTextEntry()->GetText();
+	if(index->second.Contains(prefix)) return; // picked from the list, or typed out in full
+	std::vector<std::string> entries;
+	index->second.Find(prefix, entries, kMaxParameterEntries);
+	// Repopulating resets the text, so put back what was typed
+	const Int_t cursor = combo->GetTextEntry()->GetCursorPosition();
+	populate_combo(combo, entries, 400);
+	combo->GetTextEntry()->SetText(prefix.c_str(), kFALSE);
+	combo->GetTextEntry()->SetCursorPosition(cursor);
 }
 
 void rb::HistSignals::PopulateEvents() {
+	parameter_index.clear();
 	rb::gApp()->fHistFrame->fEventEntry->RemoveAll();
 	rb::EventVector_t events = rb::gApp()->GetEventVector();
 	if(!events.size()) return;
@@ -472,6 +547,29 @@ void rb::HistSignals::ClickedLoadButton(Int_t which) {
 namespace {
 std::map<TGListTreeItem*, rb::hist::Base*> hist_map;
 std::map<TGListTreeItem*, TDirectory*> directory_map;
+// Reverse lookups, so single histograms and directories can be added or removed without a rebuild
+std::map<rb::hist::Base*, TGListTreeItem*> hist_items;
+std::map<TDirectory*, TGListTreeItem*> directory_items;
+// The tree is only touched by the GUI thread: histograms created by other threads are queued here,
+// for HistSignals::ProcessPending() to show. Ones deleted by other threads leave hist_map and
+// hist_items at once, so the GUI never looks up a freed histogram, and their items wait in
+// stale_items to be taken out of the tree. All of these, and hist_map and hist_items, are guarded
+// by pending_mutex() (recursive), which is taken after the TThread global mutex, never before.
+struct PendingHist { rb::hist::Base* fHist; Bool_t fAdded; };
+std::vector<PendingHist> pending_hists;
+std::set<TGListTreeItem*> stale_items;
+rb::Mutex& pending_mutex() {
+	static rb::Mutex* out = new rb::Mutex("HistSignals::pending", true);
+	return *out;
+}
+// Histogram shown by \c item, or null
+rb::hist::Base* find_hist(TGListTreeItem* item) {
+	rb::ScopedLock<rb::Mutex> lock(pending_mutex());
+	std::map<TGListTreeItem*, rb::hist::Base*>::iterator it = hist_map.find(item);
+	return it != hist_map.end() ? it->second : 0;
+}
+// How often the queue is checked (ms)
+const Long_t kPendingPeriod = 100;
 }
 
 void rb::HistSignals::recurse_directory(TDirectory* dir, TGListTreeItem* item) {
@@ -483,14 +581,15 @@ void rb::HistSignals::recurse_directory(TDirectory* dir, TGListTreeItem* item) {
     if(hist) {
 			TGListTreeItem* hist_item = rb::gApp()->fHistFrame->fHistTree->AddItem(item, hist->GetName(), p_hist, p_hist);
 			hist_map.insert(std::make_pair(hist_item, hist));
+			hist_items.insert(std::make_pair(hist, hist_item));
 		}
 	}
   for(Int_t i=0; i< dir->GetList()->GetEntries(); ++i) {
 		TDirectory* directory = dynamic_cast<TDirectory*>(dir->GetList()->At(i));
 		if(directory) {
-			if(!rb::gApp()->fHistFrame->fHistTree->FindChildByName(item, dir->GetName()));
 			TGListTreeItem* this_ = rb::gApp()->fHistFrame->fHistTree->AddItem(item, directory->GetName(), p_ofolder, p_folder);
 			directory_map.insert(std::make_pair(this_, directory));
+			directory_items.insert(std::make_pair(directory, this_));
 			this_->SetOpen(true);
       recurse_directory(directory, this_);
     }
@@ -498,15 +597,147 @@ void rb::HistSignals::recurse_directory(TDirectory* dir, TGListTreeItem* item) {
 }
 
 void rb::HistSignals::SyncHistTree() {
+	rb::ScopedLock<rb::Mutex> lock(pending_mutex());
+	stale_items.clear(); // deleted with the rest
 	TGListTreeItem* fRootbeer = rb::gApp()->fHistFrame->fHistTree->FindItemByPathname(gROOT->GetName());
 	rb::gApp()->fHistFrame->fHistTree->DeleteChildren(fRootbeer);
 	hist_map.clear();
 	directory_map.clear();
+	hist_items.clear();
+	directory_items.clear();
 	directory_map.insert(std::make_pair(fRootbeer, gROOT));
+	directory_items.insert(std::make_pair(static_cast<TDirectory*>(gROOT), fRootbeer));
 	recurse_directory(gROOT, fRootbeer);
 	rb::gApp()->fHistFrame->fHistTree->ClearViewPort();
 }
 
+TGListTreeItem* rb::HistSignals::directory_item(TDirectory* directory) {
+	if(!directory) return 0;
+	std::map<TDirectory*, TGListTreeItem*>::iterator it = directory_items.find(directory);
+	if(it != directory_items.end()) {
+		if(directory == gROOT || !strcmp(it->second->GetText(), directory->GetName())) return it->second;
+		DirectoryRemoved(directory); // deleted outside the gui, and the address since reused
+	}
+	if(directory == gROOT) {
+		TGListTreeItem* fRootbeer = rb::gApp()->fHistFrame->fHistTree->FindItemByPathname(gROOT->GetName());
+		directory_map.insert(std::make_pair(fRootbeer, directory));
+		directory_items.insert(std::make_pair(directory, fRootbeer));
+		return fRootbeer;
+	}
+	TDirectory* mother = directory->GetMotherDir();
+	TGListTreeItem* parent = directory_item(mother ? mother : gROOT);
+	if(!parent) return 0;
+	TGListTreeItem* item = rb::gApp()->fHistFrame->fHistTree->AddItem(parent, directory->GetName(),
+																																		 gClient->GetPicture("ofolder_t.xpm"),
+																																		 gClient->GetPicture("folder_t.xpm"));
+	item->SetOpen(true);
+	directory_map.insert(std::make_pair(item, directory));
+	directory_items.insert(std::make_pair(directory, item));
+	return item;
+}
+
+void rb::HistSignals::forget_items(TGListTreeItem* item) {
+	rb::ScopedLock<rb::Mutex> lock(pending_mutex());
+	stale_items.erase(item);
+	for(TGListTreeItem* child = item->GetFirstChild(); child; child = child->GetNextSibling())
+		 forget_items(child);
+	std::map<TGListTreeItem*, rb::hist::Base*>::iterator ith = hist_map.find(item);
+	if(ith != hist_map.end()) {
+		hist_items.erase(ith->second);
+		hist_map.erase(ith);
+	}
+	std::map<TGListTreeItem*, TDirectory*>::iterator itd = directory_map.find(item);
+	if(itd != directory_map.end()) {
+		directory_items.erase(itd->second);
+		directory_map.erase(itd);
+	}
+}
+
+void rb::HistSignals::QueueHist(rb::hist::Base* hist, Bool_t added) {
+	rb::ScopedLock<rb::Mutex> lock(pending_mutex());
+	if(!added) {
+		for(std::vector<PendingHist>::iterator it = pending_hists.begin(); it != pending_hists.end(); ++it) {
+			if(it->fHist != hist || !it->fAdded) continue;
+			pending_hists.erase(it); // gone before it was shown: drop it
+			return;
+		}
+		std::map<rb::hist::Base*, TGListTreeItem*>::iterator it = hist_items.find(hist);
+		if(it != hist_items.end()) {
+			hist_map.erase(it->second);
+			stale_items.insert(it->second);
+			hist_items.erase(it);
+		}
+	}
+	PendingHist change = { hist, added };
+	pending_hists.push_back(change);
+}
+
+void rb::HistSignals::ProcessPending() {
+	// Held throughout, so that a histogram being deleted waits in ~Base() until it is shown
+	rb::ScopedLock<rb::Mutex> lock(pending_mutex());
+	if(pending_hists.empty()) return;
+	std::vector<PendingHist> changes;
+	changes.swap(pending_hists);
+	for(std::vector<PendingHist>::iterator it = changes.begin(); it != changes.end(); ++it) {
+		if(it->fAdded) HistAdded(it->fHist);
+		else HistRemoved(it->fHist); // only the pointer: it has been deleted
+	}
+	for(std::set<TGListTreeItem*>::iterator it = stale_items.begin(); it != stale_items.end(); ++it)
+		 rb::gApp()->fHistFrame->fHistTree->DeleteItem(*it);
+	if(!stale_items.empty()) rb::gApp()->fHistFrame->fHistTree->ClearViewPort();
+	stale_items.clear();
+}
+
+void rb::HistSignals::HistAdded(rb::hist::Base* hist) {
+	if(TThread::SelfId() != fGuiThread) {
+		QueueHist(hist, true);
+		return;
+	}
+	rb::ScopedLock<rb::Mutex> lock(pending_mutex());
+	if(!hist_items.count(hist)) {
+		TGListTreeItem* parent = directory_item(hist->GetDirectory());
+		if(parent) {
+			const TGPicture *p_hist = gClient->GetPicture("h1_t.xpm");
+			TGListTreeItem* item = rb::gApp()->fHistFrame->fHistTree->AddItem(parent, hist->GetName(), p_hist, p_hist);
+			hist_map.insert(std::make_pair(item, hist));
+			hist_items.insert(std::make_pair(hist, item));
+			rb::gApp()->fHistFrame->fHistTree->ClearViewPort();
+		}
+	}
+	NewOrDeleteHist();
+}
+
+void rb::HistSignals::HistRemoved(rb::hist::Base* hist) {
+	if(TThread::SelfId() != fGuiThread) {
+		QueueHist(hist, false);
+		return;
+	}
+	rb::ScopedLock<rb::Mutex> lock(pending_mutex());
+	std::map<rb::hist::Base*, TGListTreeItem*>::iterator it = hist_items.find(hist);
+	if(it != hist_items.end()) {
+		TGListTreeItem* item = it->second;
+		hist_map.erase(item);
+		hist_items.erase(it);
+		rb::gApp()->fHistFrame->fHistTree->DeleteItem(item);
+		rb::gApp()->fHistFrame->fHistTree->ClearViewPort();
+	}
+	NewOrDeleteHist();
+}
+
+void rb::HistSignals::DirectoryAdded(TDirectory* directory) {
+	if(directory_item(directory)) rb::gApp()->fHistFrame->fHistTree->ClearViewPort();
+}
+
+void rb::HistSignals::DirectoryRemoved(TDirectory* directory) {
+	if(!directory || directory == gROOT) return;
+	std::map<TDirectory*, TGListTreeItem*>::iterator it = directory_items.find(directory);
+	if(it == directory_items.end()) return;
+	TGListTreeItem* item = it->second;
+	forget_items(item);
+	rb::gApp()->fHistFrame->fHistTree->DeleteItem(item);
+	rb::gApp()->fHistFrame->fHistTree->ClearViewPort();
+}
+
 void rb::HistSignals::Cd() {
 	TGListTreeItem* item = rb::gApp()->fHistFrame->fHistTree->GetSelected();
 	return Cd(item, 1);
@@ -530,10 +761,11 @@ void rb::HistSignals::Mkdir() {
 	TGListTreeItem* current = rb::gApp()->fHistFrame->fHistTree->GetSelected();
 	mkdir:
 	if(directory_map.count(current)) {
-		directory_map.find(current)->second->mkdir(name);
+		TDirectory* made = directory_map.find(current)->second->mkdir(name);
 		directory_map.find(current)->second->cd(name);
+		if(made) DirectoryAdded(made);
 	}
-	else if(hist_map.count(current)) {
+	else if(find_hist(current)) {
 		current = current->GetParent();
 		goto mkdir;
 	}
@@ -541,7 +773,18 @@ void rb::HistSignals::Mkdir() {
 		current = rb::gApp()->fHistFrame->fHistTree->FindItemByPathname(gROOT->GetName());
 		goto mkdir;
 	}
-	SyncHistTree();
+}
+
+void rb::HistSignals::Profile() {
+	rb::gApp()->fHistFrame->fProfileButton->SetDown(false);
+	if(!rb::hist::Profiler::IsEnabled()) {
+		rb::hist::StartProfile();
+		err::Info("Profile") << "Started profiling histogram fills, press \"Profile\" again to stop and print the results.";
+	}
+	else {
+		rb::hist::StopProfile();
+		rb::hist::PrintProfile();
+	}
 }
 
 void rb::HistSignals::DrawHist() {
@@ -554,8 +797,9 @@ void rb::HistSignals::DrawHist(TGListTreeItem* item, Int_t btn) {
 	if(!gPad) {
 		if(gApp()->GetSignals()) gApp()->GetSignals()->CreateNew();
 	}
-	if(hist_map.count(item)) {
-		hist_map.find(item)->second->Draw(rb::gApp()->fHistFrame->fDrawOptionEntry->GetText());
+	rb::hist::Base* hist = find_hist(item);
+	if(hist) {
+		hist->Draw(rb::gApp()->fHistFrame->fDrawOptionEntry->GetText());
 		gPad->Modified();
 		gPad->Update();
 	}
@@ -636,7 +880,7 @@ void rb::HistSignals::HistTreeKeyPressed(TGListTreeItem* item, UInt_t keycode, U
 
 void rb::HistSignals::HistTreeItemClicked(TGListTreeItem* item, Int_t btn) {
 	if(0 && btn);
-	else if (hist_map.count(item)) {
+	else if (find_hist(item)) {
 		SyncHistMenu(GetSelectedHist());
 		HistTreeItemClicked(item->GetParent(), btn);
 	}
@@ -645,7 +889,7 @@ void rb::HistSignals::HistTreeItemClicked(TGListTreeItem* item, Int_t btn) {
 }
 void rb::HistSignals::HistTreeItemSelect(TGListTreeItem* item, Int_t btn) {
 	if(0 && btn);
-	else if (hist_map.count(item)) DrawHist(item, btn);
+	else if (find_hist(item)) DrawHist(item, btn);
 	else if (directory_map.count(item)) Cd(item, btn);
 	else;
 }
@@ -656,15 +900,16 @@ void rb::HistSignals::DeleteHist() {
 	}
 	else if(directory_map.count(rb::gApp()->fHistFrame->fHistTree->GetSelected())) {
 		TDirectory* directory = directory_map.find(rb::gApp()->fHistFrame->fHistTree->GetSelected())->second;
-		if(directory != gROOT) delete directory;
-		SyncHistTree();
+		if(directory != gROOT) {
+			DirectoryRemoved(directory);
+			delete directory;
+		}
 	}
 	rb::canvas::UpdateAll();
 }
 
 rb::hist::Base* rb::HistSignals::GetSelectedHist() {
-	TGListTreeItem* item = rb::gApp()->fHistFrame->fHistTree->GetSelected();
-	return hist_map.count(item) ? hist_map.find(item)->second : 0;
+	return find_hist(rb::gApp()->fHistFrame->fHistTree->GetSelected());
 }
 
 void rb::HistSignals::HistMemberFn() {
@@ -689,13 +934,18 @@ void rb::HistSignals::HistMemberFn() {
 
 
 // =========== VARIABLES / CONFIG ============ //
+namespace {
+// Every item in the variables tree by its dotted path, and the paths that are variables (leaves)
+std::map<std::string, TGListTreeItem*> variable_items;
+std::set<std::string> variable_leaves;
+}
 std::string rb::HistSignals::get_variable(TGListTreeItem* item) {
-	static std::vector<std::string> variables = rb::data::MBasic::GetAll();
+	if(!item) return "";
 	char path[1000];
 	rb::gApp()->fHistFrame->fVariablesTree->GetPathnameFromItem(item, path);
 	TString sPath(&path[1]);
 	sPath.ReplaceAll("/", ".");
-	if(std::find(variables.begin(), variables.end(), sPath.Data()) == variables.end())
+	if(!variable_leaves.count(sPath.Data()))
 		 return "";
 	return sPath.Data();
 }
@@ -722,30 +972,52 @@ void rb::HistSignals::SyncVariables() {
 	const TGPicture* pbr_o = gClient->GetPicture("branch_t.xpm");
 	const TGPicture* pbr_c = gClient->GetPicture("branch-cl_t.xpm");
 	const TGPicture* pvar = gClient->GetPicture("leaf_t.xpm");
-	static std::vector<std::string> variables = rb::data::MBasic::GetAll();
-	std::sort(variables.begin(), variables.end(), ansort);
+	TGListTree* tree = rb::gApp()->fHistFrame->fVariablesTree;
+	std::vector<std::string> all = rb::data::MBasic::GetAll();
+	std::set<std::string> current(all.begin(), all.end());
+
+	// Remove variables that have gone, then any branches left empty
+	std::vector<std::string> gone;
+	std::set_difference(variable_leaves.begin(), variable_leaves.end(), current.begin(), current.end(), std::back_inserter(gone));
+	for(std::vector<std::string>::iterator it = gone.begin(); it != gone.end(); ++it) {
+		std::string name = *it;
+		variable_leaves.erase(name);
+		while(1) {
+			std::map<std::string, TGListTreeItem*>::iterator item = variable_items.find(name);
+			if(item == variable_items.end() || item->second->GetFirstChild()) break;
+			tree->DeleteItem(item->second);
+			variable_items.erase(item);
+			if(name.rfind(".") > name.size()) break;
+			name = name.substr(0, name.rfind("."));
+		}
+	}
+
+	// Add the new ones, in alpha-numeric order
+	std::vector<std::string> variables;
+	std::set_difference(current.begin(), current.end(), variable_leaves.begin(), variable_leaves.end(), std::back_inserter(variables));
+	ANSort::Sort(variables);
 	for(UInt_t i=0; i< variables.size(); ++i) {
-		std::string name = variables[i];
 		TGListTreeItem* item = 0;
-		while(name.find(".") < name.size()) {
-			std::string name0 = name.substr(0, name.find("."));
-			if(name == variables[i]) {
-				if(!rb::gApp()->fHistFrame->fVariablesTree->FindItemByPathname(name0.c_str())) {
-					rb::gApp()->fHistFrame->fVariablesTree->AddRoot(name0.c_str());
-					rb::gApp()->fHistFrame->fVariablesTree->FindItemByPathname(name0.c_str())->SetPictures(pbr_o, pbr_c);
-				}
-				item = rb::gApp()->fHistFrame->fVariablesTree->FindItemByPathname(name0.c_str());
-				item->SetOpen(true);
-			}
+		std::string::size_type begin = 0, dot;
+		while((dot = variables[i].find(".", begin)) < variables[i].size()) {
+			const std::string path = variables[i].substr(0, dot);
+			std::map<std::string, TGListTreeItem*>::iterator it = variable_items.find(path);
+			if(it != variable_items.end()) item = it->second;
 			else {
-				item = rb::gApp()->fHistFrame->fVariablesTree->FindChildByName(item, name0.c_str()) ?
-					 rb::gApp()->fHistFrame->fVariablesTree->FindChildByName(item, name0.c_str()) :
-					 rb::gApp()->fHistFrame->fVariablesTree->AddItem(item, name0.c_str(), pbr_o, pbr_c);
+				const std::string name0 = variables[i].substr(begin, dot - begin);
+				item = tree->AddItem(item, name0.c_str(), pbr_o, pbr_c);
 				item->SetOpen(true);
+				variable_items.insert(std::make_pair(path, item));
 			}
-			name = name.substr(name.find(".") + 1);
+			begin = dot + 1;
 		}
-		rb::gApp()->fHistFrame->fVariablesTree->AddItem(item, name.c_str(), pvar, pvar);
+		TGListTreeItem* leaf = tree->AddItem(item, variables[i].substr(begin).c_str(), pvar, pvar);
+		variable_items.insert(std::make_pair(variables[i], leaf));
+		variable_leaves.insert(variables[i]);
+	}
+	if(!gone.empty() || !variables.empty()) {
+		parameter_index.clear(); // rebuilt from the new branches when next shown
+		tree->ClearViewPort();
 	}
 }
 
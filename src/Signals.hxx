@@ -7,6 +7,8 @@
 
 class TGListTreeItem;
 class TGTextButton;
+class TDirectory;
+class TTimer;
 namespace rb
 {
 namespace hist { class Base; }
@@ -15,6 +17,9 @@ class Signals: public TQObject
 public:
 	 Signals();
 	 ~Signals();
+private:
+	 //! Runs UpdateStats() on the GUI thread
+	 TTimer* fStatsTimer;
 public:
 	 void Unattaching(); //*SIGNAL*
 	 void Attaching(); //*SIGNAL*
@@ -26,6 +31,7 @@ public:
 	 void AttachedFile(const char*); //*SIGNAL*
 	 void ChangedCanvases(); //*SIGNAL*
 	 void UpdateBufferCounter(Int_t n, Bool_t force = false);
+	 void UpdateStats();
 	 void SaveData();
 	 void SaveHists();
 	 void EnableSaveHists();
@@ -56,19 +62,34 @@ public:
 	 ~HistSignals();
 private:
 	 Bool_t fHistFromGui;
+	 //! Thread that created the GUI; the only one to touch the histogram tree
+	 Long_t fGuiThread;
+	 //! Runs ProcessPending() on the GUI thread
+	 TTimer* fPendingTimer;
+	 //! Queue a histogram created or deleted outside the GUI thread
+	 void QueueHist(rb::hist::Base* hist, Bool_t added);
 	 void hist_field_enable(bool, int);
 	 void hist_error(const char*);
 	 void recurse_directory(TDirectory*, TGListTreeItem*);
+	 TGListTreeItem* directory_item(TDirectory*);
+	 void forget_items(TGListTreeItem*);
 	 std::string get_variable(TGListTreeItem*);
 public:
 	 void NewOrDeleteHist(); //*SIGNAL*
 	 void EnableHistFields(Int_t);
 	 void PopulateEvents();
 	 void PopulateParameters(Int_t);
+	 void FilterParameters(Int_t axis);
 	 void SetHistFromGui();
 	 Bool_t IsHistFromGui();
 	 void CreateHistogram();
 	 void SyncHistTree();
+	 void HistAdded(rb::hist::Base* hist);
+	 void HistRemoved(rb::hist::Base* hist);
+	 void ProcessPending();
+	 void CanvasEvent(Int_t event, Int_t x, Int_t y, TObject* selected);
+	 void DirectoryAdded(TDirectory* directory);
+	 void DirectoryRemoved(TDirectory* directory);
 	 rb::hist::Base* GetSelectedHist();
 	 void HistTreeKeyPressed(TGListTreeItem*, UInt_t, UInt_t);
 	 void HistTreeItemClicked(TGListTreeItem*, Int_t);
@@ -80,6 +101,7 @@ public:
 	 void DrawHist(TGListTreeItem* item);
 	 void DrawHist();
 	 void Mkdir();
+	 void Profile();
 	 void Cd(TGListTreeItem*, Int_t);
 	 void Cd(TGListTreeItem* item);
 	 void Cd();
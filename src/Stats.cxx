@@ -0,0 +1,320 @@
+//! \file Stats.cxx
+//! \brief Implements Stats.hxx
+#include <cmath>
+#include <ctime>
+#include <sstream>
+#include <iomanip>
+#include "Stats.hxx"
+#include "Rint.hxx"
+#include "Event.hxx"
+#include "utils/Mutex.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Helper Functions                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace
+{
+// Counters of the calling thread
+__thread rb::stats::ThreadStats* tCurrent = 0;
+// Every set of counters ever created, never deleted
+std::vector<rb::stats::ThreadStats*>& registry() {
+	static std::vector<rb::stats::ThreadStats*>* out = new std::vector<rb::stats::ThreadStats*>();
+	return *out;
+}
+rb::Mutex& registry_mutex() {
+	static rb::Mutex* out = new rb::Mutex("rb::stats::Registry");
+	return *out;
+}
+// Time of the last rb::stats::Registry::Update(), or of the first registration
+ULong64_t last_update = 0;
+// Convert cycles to microseconds
+inline Double_t to_us(Double_t cycles) {
+	return 1e6 * cycles / rb::Cycles::PerSecond();
+}
+// Name of the event type counted by a block
+std::string event_name(const void* event) {
+	if(event == 0) return "-";
+	rb::EventVector_t events = rb::gApp()->GetEventVector();
+	for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it) {
+		if(rb::gApp()->GetEvent(it->first) == event) return it->second;
+	}
+	return "[unknown]";
+}
+// Escape a string for JSON
+std::string quote(const std::string& str) {
+	std::string out = "\"";
+	for(std::string::size_type i=0; i< str.size(); ++i) {
+		if(str[i] == '"' || str[i] == '\\') out += '\\';
+		out += str[i];
+	}
+	return out + "\"";
+}
+// Print a rate as e.g. "12.3 k"
+std::string si(Double_t value) {
+	std::stringstream sstr;
+	sstr << std::fixed << std::setprecision(1);
+	if(value >= 1e6) sstr << value / 1e6 << " M";
+	else if(value >= 1e3) sstr << value / 1e3 << " k";
+	else sstr << value << " ";
+	return sstr.str();
+}
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// const char* rb::stats::StageName()                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+const char* rb::stats::StageName(Int_t stage) {
+	static const char* names[kNstages] =
+		 { "Read", "Decompress", "Unpack", "LockWait", "Process", "TreeFill", "Save", "FillAll" };
+	return (stage >= 0 && stage < kNstages) ? names[stage] : "";
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::stats::Counter                                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::stats::Counter::Reset()                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::stats::Counter::Reset() {
+	fCount = fCycles = fMax = 0;
+	for(Int_t i=0; i< kNbins; ++i) fBins[i] = 0;
+	fLastCount = fLastCycles = 0;
+	fRate = fMean = 0;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::stats::Counter::Update()                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::stats::Counter::Update(Double_t dt) {
+	const ULong64_t count = fCount, cycles = fCycles;
+	if(count < fLastCount) fLastCount = fLastCycles = 0; // reset since the last update
+	const ULong64_t dcount = count - fLastCount, dcycles = cycles - fLastCycles;
+	// Exponential moving average, so that irregular update intervals are weighted correctly
+	const Double_t alpha = 1. - std::exp(-dt / Registry::kRollingTime);
+	fRate += alpha * (dcount / dt - fRate);
+	if(dcount) fMean += (fMean ? alpha : 1.) * (Double_t(dcycles) / dcount - fMean);
+	fLastCount = count;
+	fLastCycles = cycles;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Double_t rb::stats::Counter::Quantile()               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Double_t rb::stats::Counter::Quantile(Double_t q) const {
+	ULong64_t total = 0;
+	for(Int_t i=0; i< kNbins; ++i) total += fBins[i];
+	if(!total) return 0;
+	// Interpolate geometrically within the bin holding the quantile
+	const Double_t target = q * total;
+	ULong64_t sum = 0;
+	for(Int_t i=0; i< kNbins; ++i) {
+		if(!fBins[i]) continue;
+		if(sum + fBins[i] >= target) {
+			const Double_t frac = (target - sum) / fBins[i];
+			return std::ldexp(std::pow(2., frac), i);
+		}
+		sum += fBins[i];
+	}
+	return fMax;
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::stats::ThreadStats                                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::stats::ThreadStats::Reset()                  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::stats::ThreadStats::Reset() {
+	for(Int_t i=0; i< GetN(); ++i) {
+		for(Int_t s=0; s< kNstages; ++s) Get(i).fStages[s].Reset();
+	}
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::stats::ThreadScope                                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor                                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::stats::ThreadScope::ThreadScope(const char* name): fActive(tCurrent == 0) {
+	if(fActive) tCurrent = Registry::Get(name);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Destructor                                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::stats::ThreadScope::~ThreadScope() {
+	if(fActive) tCurrent = 0;
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::stats::Registry                                   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+const Double_t rb::stats::Registry::kRollingTime = 5.;
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// ThreadStats* rb::stats::Registry::Current() [static]  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::stats::ThreadStats* rb::stats::Registry::Current() {
+	if(tCurrent) return tCurrent;
+	// Not in an attach thread; cache the default counters for this thread
+	static __thread ThreadStats* unattached = 0;
+	if(!unattached) unattached = Get("Main");
+	return unattached;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// ThreadStats* rb::stats::Registry::Get() [static]      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::stats::ThreadStats* rb::stats::Registry::Get(const char* name) {
+	rb::Cycles::PerSecond(); // calibrate now rather than while printing
+	rb::ScopedLock<rb::Mutex> LOCK (registry_mutex());
+	std::vector<ThreadStats*>& threads = registry();
+	for(UInt_t i=0; i< threads.size(); ++i) {
+		if(threads[i]->GetName() == name) return threads[i];
+	}
+	if(threads.empty()) last_update = rb::Cycles::Now();
+	threads.push_back(new ThreadStats(name));
+	return threads.back();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::stats::Registry::Reset() [static]            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::stats::Registry::Reset() {
+	rb::ScopedLock<rb::Mutex> LOCK (registry_mutex());
+	std::vector<ThreadStats*>& threads = registry();
+	for(UInt_t i=0; i< threads.size(); ++i) threads[i]->Reset();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::stats::Registry::Update() [static]           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::stats::Registry::Update() {
+	// Called with registry_mutex() held
+	const ULong64_t now = rb::Cycles::Now();
+	const Double_t dt = (now - last_update) / rb::Cycles::PerSecond();
+	if(dt < 0.1) return; // too soon to say anything
+	last_update = now;
+	std::vector<ThreadStats*>& threads = registry();
+	for(UInt_t i=0; i< threads.size(); ++i) {
+		for(Int_t b=0; b< threads[i]->GetN(); ++b) {
+			for(Int_t s=0; s< kNstages; ++s) threads[i]->Get(b).fStages[s].Update(dt);
+		}
+	}
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::stats::Registry::Print() [static]            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::stats::Registry::Print(std::ostream& strm) {
+	rb::ScopedLock<rb::Mutex> LOCK (registry_mutex());
+	Update();
+	std::ios_base::fmtflags flags = strm.flags();
+	std::streamsize precision = strm.precision();
+	strm << std::fixed << std::setprecision(2);
+	strm << "\nPipeline statistics (rates and recent means averaged over ~" << kRollingTime << " s):\n";
+	std::vector<ThreadStats*>& threads = registry();
+	for(UInt_t i=0; i< threads.size(); ++i) {
+		strm << "Thread " << threads[i]->GetName() << ":\n";
+		strm << std::left << std::setw(14) << "  Stage" << std::setw(16) << "Event" << std::right
+				 << std::setw(12) << "Count" << std::setw(11) << "Rate/s"
+				 << std::setw(10) << "Mean us" << std::setw(10) << "Recent" << std::setw(10) << "p50 us"
+				 << std::setw(10) << "p99 us" << std::setw(11) << "Max us" << std::setw(10) << "Total s" << "\n";
+		for(Int_t b=0; b< threads[i]->GetN(); ++b) {
+			const Block& block = threads[i]->Get(b);
+			const std::string name = event_name(block.fEvent);
+			for(Int_t s=0; s< kNstages; ++s) {
+				const Counter& c = block.fStages[s];
+				if(!c.fCount) continue;
+				strm << "  " << std::left << std::setw(12) << StageName(s) << std::setw(16) << name << std::right
+						 << std::setw(12) << c.fCount
+						 << std::setw(11) << c.fRate
+						 << std::setw(10) << to_us(Double_t(c.fCycles) / c.fCount)
+						 << std::setw(10) << to_us(c.fMean)
+						 << std::setw(10) << to_us(c.Quantile(0.5))
+						 << std::setw(10) << to_us(c.Quantile(0.99))
+						 << std::setw(11) << to_us(c.fMax)
+						 << std::setw(10) << c.fCycles / rb::Cycles::PerSecond() << "\n";
+			}
+		}
+	}
+	strm << std::endl;
+	strm.flags(flags);
+	strm.precision(precision);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::stats::Registry::Dump() [static]             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::stats::Registry::Dump(std::ostream& strm) {
+	rb::ScopedLock<rb::Mutex> LOCK (registry_mutex());
+	Update();
+	const Double_t ns_per_cycle = 1e9 / rb::Cycles::PerSecond();
+	std::ios_base::fmtflags flags = strm.flags();
+	std::streamsize precision = strm.precision();
+	strm << std::setprecision(10);
+	strm << "{\"time\": " << std::time(0) << ", \"ns_per_cycle\": " << ns_per_cycle << ", \"threads\": [";
+	std::vector<ThreadStats*>& threads = registry();
+	for(UInt_t i=0; i< threads.size(); ++i) {
+		strm << (i ? ",\n" : "\n") << " {\"name\": " << quote(threads[i]->GetName()) << ", \"stages\": [";
+		Bool_t first = true;
+		for(Int_t b=0; b< threads[i]->GetN(); ++b) {
+			const Block& block = threads[i]->Get(b);
+			for(Int_t s=0; s< kNstages; ++s) {
+				const Counter& c = block.fStages[s];
+				if(!c.fCount) continue;
+				strm << (first ? "\n" : ",\n") << "  {\"stage\": " << quote(StageName(s))
+						 << ", \"event\": " << (block.fEvent ? quote(event_name(block.fEvent)) : "null")
+						 << ", \"count\": " << c.fCount << ", \"cycles\": " << c.fCycles << ", \"max_cycles\": " << c.fMax
+						 << ", \"rate_hz\": " << c.fRate << ", \"recent_mean_cycles\": " << c.fMean
+						 << ", \"log2_cycles_hist\": [";
+				// Trailing empty bins are left out
+				Int_t last = Counter::kNbins - 1;
+				while(last > 0 && !c.fBins[last]) --last;
+				for(Int_t bin=0; bin<= last; ++bin) strm << (bin ? ", " : "") << c.fBins[bin];
+				strm << "]}";
+				first = false;
+			}
+		}
+		strm << "]}";
+	}
+	strm << "]}" << std::endl;
+	strm.flags(flags);
+	strm.precision(precision);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// std::string rb::stats::Registry::Summary() [static]   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+std::string rb::stats::Registry::Summary() {
+	rb::ScopedLock<rb::Mutex> LOCK (registry_mutex());
+	Update();
+	// Sum the recent rates and times over threads and events
+	Double_t rate[kNstages], cycles[kNstages];
+	for(Int_t s=0; s< kNstages; ++s) rate[s] = cycles[s] = 0;
+	std::vector<ThreadStats*>& threads = registry();
+	for(UInt_t i=0; i< threads.size(); ++i) {
+		for(Int_t b=0; b< threads[i]->GetN(); ++b) {
+			for(Int_t s=0; s< kNstages; ++s) {
+				const Counter& c = threads[i]->Get(b).fStages[s];
+				rate[s] += c.fRate;
+				cycles[s] += c.fRate * c.fMean;
+			}
+		}
+	}
+	const Double_t event_cycles = cycles[kLockWait] + cycles[kProcess] + cycles[kTreeFill] + cycles[kSave] + cycles[kFillAll];
+	std::stringstream sstr;
+	sstr << std::fixed << std::setprecision(1)
+			 << si(rate[kUnpack]) << "buf/s | " << si(rate[kProcess]) << "evt/s | "
+			 << "proc " << (rate[kProcess] ? to_us(cycles[kProcess] / rate[kProcess]) : 0.) << " us, "
+			 << "fill " << (rate[kFillAll] ? to_us(cycles[kFillAll] / rate[kFillAll]) : 0.) << " us | "
+			 << "wait " << std::setprecision(0) << (event_cycles ? 100. * cycles[kLockWait] / event_cycles : 0.) << "%";
+	return sstr.str();
+}
+
@@ -0,0 +1,207 @@
+//! \file Stats.hxx
+//! \brief Defines classes for collecting statistics on each stage of the analysis pipeline.
+//! \details The user interface (rb::stats::Print(), etc.) is declared in Rootbeer.hxx.
+#ifndef STATS_HXX
+#define STATS_HXX
+#include <string>
+#include <vector>
+#include <iostream>
+#include <Rtypes.h>
+#include "utils/Cycles.hxx"
+
+
+namespace rb
+{
+namespace stats
+{
+/// Pipeline stages that are timed
+enum Stage_t {
+	kRead,       ///< BufferSource::ReadBufferOffline() / ReadBufferOnline(), includes decompression
+	kDecompress, ///< Reading from a compressed file (gzread), a subset of kRead
+	kUnpack,     ///< BufferSource::UnpackBuffer(), includes everything below
+	kLockWait,   ///< Waiting for gCINTMutex and gDataMutex in Event::Process()
+	kProcess,    ///< Event::DoProcess()
+	kTreeFill,   ///< Filling the event's TTree
+	kSave,       ///< Filling the output tree when saving data
+	kFillAll,    ///< Filling the event's histograms
+	kNstages
+};
+
+/// Return the name of a stage
+const char* StageName(Int_t stage);
+
+/// \brief Counters and latency histogram for one stage.
+//! \details Each counter is written by a single thread, without locking; readers may see
+//! slightly stale values. The rolling rate and mean are maintained by the readers (see Update()).
+class Counter
+{
+public:
+	 /// Number of latency bins; bin \c i counts calls taking [2^i, 2^(i+1)) cycles
+	 static const Int_t kNbins = 48;
+	 /// Number of calls
+	 ULong64_t fCount;
+	 /// Total cycles
+	 ULong64_t fCycles;
+	 /// Longest call, in cycles
+	 ULong64_t fMax;
+	 /// Latency histogram
+	 ULong64_t fBins[kNbins];
+	 /// Count and cycles at the last Update()
+	 ULong64_t fLastCount, fLastCycles;
+	 /// Rolling calls per second
+	 Double_t fRate;
+	 /// Rolling mean cycles per call
+	 Double_t fMean;
+public:
+	 /// Zero everything
+	 Counter() { Reset(); }
+	 /// Zero everything
+	 void Reset();
+	 /// Count one call taking \c cycles
+	 void Add(ULong64_t cycles);
+	 /// Update the rolling rate and mean, \c dt seconds after the previous update
+	 void Update(Double_t dt);
+	 /// Return the (approximate) latency quantile \c q, in cycles
+	 Double_t Quantile(Double_t q) const;
+};
+
+/// \brief Counters for every stage, for one thread and event type.
+struct Block
+{
+	 /// The event (rb::Event*) counted, or 0 for stages that are not specific to an event
+	 const void* fEvent;
+	 /// Counters for each stage
+	 Counter fStages[kNstages];
+	 Block(): fEvent(0) { }
+};
+
+/// \brief All of the counters belonging to one thread.
+class ThreadStats
+{
+public:
+	 /// Number of event types counted separately
+	 static const Int_t kMaxEvents = 16;
+private:
+	 /// Thread name
+	 std::string fName;
+	 /// Stages not specific to an event
+	 Block fThread;
+	 /// Stages for each event type
+	 Block fEvents[kMaxEvents];
+	 /// Number of fEvents in use
+	 volatile Int_t fNevents;
+public:
+	 /// Set the name
+	 ThreadStats(const char* name): fName(name), fNevents(0) { }
+	 /// Return the name
+	 const std::string& GetName() const { return fName; }
+	 /// Return the block for \c event (0 for stages that are not specific to an event)
+	 //! \note Only to be called by the owning thread
+	 Block* GetBlock(const void* event);
+	 /// Return the number of blocks
+	 Int_t GetN() const { return fNevents + 1; }
+	 /// Return block \c i; block 0 is not specific to an event
+	 Block& Get(Int_t i) { return i == 0 ? fThread : fEvents[i-1]; }
+	 /// Zero the counters
+	 void Reset();
+private:
+	 ThreadStats(const ThreadStats&);
+	 ThreadStats& operator= (const ThreadStats&);
+};
+
+/// \brief Marks the current thread as an attach thread for the lifetime of the object.
+//! \details Stages timed while no scope is active are counted under "Main". Nested scopes
+//! (e.g. the files read by an attached list) are counted under the outer scope's name.
+//! Counters persist after the scope closes, and are shared by later scopes of the same name.
+class ThreadScope
+{
+private:
+	 /// Did this scope set the thread's counters?
+	 Bool_t fActive;
+public:
+	 /// Install the counters named \c name for the calling thread
+	 ThreadScope(const char* name);
+	 /// Restore the default counters
+	 ~ThreadScope();
+};
+
+/// \brief Times consecutive stages.
+//! Example:
+//! \code
+//! rb::stats::Timer timer(this);
+//! DoSomething();
+//! timer.Lap(rb::stats::kProcess); // time since construction
+//! DoSomethingElse();
+//! timer.Lap(rb::stats::kSave);    // time since the previous Lap()
+//! \endcode
+class Timer
+{
+private:
+	 /// Counters of the calling thread
+	 Block* fBlock;
+	 /// Start of the current lap
+	 ULong64_t fStart;
+public:
+	 /// Start timing, counting under \c event (0 for stages that are not specific to an event)
+	 Timer(const void* event = 0);
+	 /// Count the time since the previous lap (or construction) under \c stage
+	 void Lap(Int_t stage);
+};
+
+/// \brief Access to the counters of every thread.
+class Registry
+{
+public:
+	 /// Time constant of the rolling rates and means, in seconds
+	 static const Double_t kRollingTime;
+public:
+	 /// Return the counters of the calling thread
+	 static ThreadStats* Current();
+	 /// Return the counters named \c name, creating them if needed
+	 static ThreadStats* Get(const char* name);
+	 /// Zero every counter
+	 static void Reset();
+	 /// Print a table of every non-empty counter
+	 static void Print(std::ostream& strm = std::cout);
+	 /// Write every non-empty counter in JSON format
+	 static void Dump(std::ostream& strm);
+	 /// Return a one line summary of the recent rates, for the GUI
+	 static std::string Summary();
+private:
+	 /// Update rolling rates and means
+	 static void Update();
+};
+}
+}
+
+
+// ========= Inlined Functions ========= //
+inline void rb::stats::Counter::Add(ULong64_t cycles) {
+	++fCount;
+	fCycles += cycles;
+	if(cycles > fMax) fMax = cycles;
+	const Int_t bin = cycles ? 63 - __builtin_clzll(cycles) : 0;
+	++fBins[bin < kNbins ? bin : kNbins - 1];
+}
+
+inline rb::stats::Block* rb::stats::ThreadStats::GetBlock(const void* event) {
+	if(event == 0) return &fThread;
+	for(Int_t i=0; i< fNevents; ++i) {
+		if(fEvents[i].fEvent == event) return fEvents + i;
+	}
+	if(fNevents == kMaxEvents) return fEvents + kMaxEvents - 1; // shouldn't happen
+	fEvents[fNevents].fEvent = event;
+	__sync_synchronize(); // readers must not see the new block before its key
+	return fEvents + fNevents++;
+}
+
+inline rb::stats::Timer::Timer(const void* event):
+	fBlock(Registry::Current()->GetBlock(event)), fStart(rb::Cycles::Now()) { }
+
+inline void rb::stats::Timer::Lap(Int_t stage) {
+	const ULong64_t now = rb::Cycles::Now();
+	fBlock->fStages[stage].Add(now - fStart);
+	fStart = now;
+}
+
+#endif
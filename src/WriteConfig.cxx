@@ -4,6 +4,12 @@
 //!  Rootbeer.cxx
 #include <iostream>
 #include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <cctype>
+#include <cstdlib>
 #include <TCanvas.h>
 #include <TFrame.h>
 #include <TTimeStamp.h>
@@ -13,6 +19,7 @@
 #include "Data.hxx"
 #include "Signals.hxx"
 #include "hist/Hist.hxx"
+#include "utils/Error.hxx"
 using namespace std;
 
 
@@ -33,6 +40,15 @@ TAxis* get_axis(rb::hist::Base* hst, UInt_t n) {
   }
 }
 
+/// Return the optional sampling arguments to the creation functions
+/// (empty if the histogram fills on every event).
+std::string sampling_args(rb::hist::Base* rbhist) {
+	if(rbhist->GetPrescale() == 1 && rbhist->GetMaxRate() == 0) return "";
+	std::stringstream sstr;
+	sstr << ", " << rbhist->GetPrescale() << ", " << rbhist->GetMaxRate();
+	return sstr.str();
+}
+
 void write_std_hist(rb::hist::Base* rbhist, std::ostream& ofs) {
 	std::string title = rbhist->UseDefaultTitle() ? "" : rbhist->GetTitle();
 	for(int i=0; i< ntabs; ++i) ofs << "    ";
@@ -42,7 +58,7 @@ void write_std_hist(rb::hist::Base* rbhist, std::ostream& ofs) {
     ofs << axis->GetNbins() << ", " << axis->GetBinLowEdge(1) << ", " << axis->GetBinLowEdge(1+axis->GetNbins()) <<", ";
 	}
 	std::string param = rbhist->GetInitialParams();
-	ofs << "\"" << param << "\", \"" << rbhist->GetGate() << "\", " << rbhist->GetEventCode() << ");\n";
+	ofs << "\"" << param << "\", \"" << rbhist->GetGate() << "\", " << rbhist->GetEventCode() << sampling_args(rbhist) << ");\n";
 }
 
 void write_summary_hist(rb::hist::Summary* rbhist, std::ostream& ofs) {
@@ -55,7 +71,7 @@ void write_summary_hist(rb::hist::Summary* rbhist, std::ostream& ofs) {
 	std::string orient_arg =  vertical? "v" : "h";
 	ofs << axis->GetNbins() << ", " << axis->GetBinLowEdge(1) << ", " << axis->GetBinLowEdge(1+axis->GetNbins()) <<", ";
 	std::string param = rbhist->GetInitialParams();
-	ofs << "\"" << param << "\", \"" << rbhist->GetGate() << "\", \"" << orient_arg << "\", " << rbhist->GetEventCode() << ");\n";
+	ofs << "\"" << param << "\", \"" << rbhist->GetGate() << "\", " << rbhist->GetEventCode() << ", \"" << orient_arg << "\"" << sampling_args(rbhist) << ");\n";
 }
 
 void write_bit_hist(rb::hist::Bit* rbhist, std::ostream& ofs) {
@@ -65,7 +81,39 @@ void write_bit_hist(rb::hist::Bit* rbhist, std::ostream& ofs) {
 	TAxis* axis = rbhist->GetXaxis();
 	ofs << axis->GetNbins() << ", ";
 	std::string param = rbhist->GetInitialParams();
-	ofs << "\"" << param << "\", \"" << rbhist->GetGate() << "\", " << rbhist->GetEventCode() << ");\n";
+	ofs << "\"" << param << "\", \"" << rbhist->GetGate() << "\", " << rbhist->GetEventCode() << sampling_args(rbhist) << ");\n";
+}
+
+void write_variable_hist(rb::hist::Variable* rbhist, std::ostream& ofs) {
+	std::string title = rbhist->UseDefaultTitle() ? "" : rbhist->GetTitle();
+	std::string indent = "";
+	for(int i=0; i< ntabs; ++i) indent += "    ";
+	std::string param = rbhist->GetInitialParams();
+	std::stringstream args;
+	args << "\"" << param << "\", \"" << rbhist->GetGate() << "\", " << rbhist->GetEventCode() << sampling_args(rbhist) << ");\n";
+	ofs << std::setprecision(17);
+	if(rbhist->GetNdimensions() == 1 && rbhist->IsLog(0)) {
+		TAxis* axis = rbhist->GetXaxis();
+		ofs << indent << "  rb::hist::NewLog(\"" << rbhist->GetName() << "\", \"" << title << "\", ";
+		ofs << axis->GetNbins() << ", " << axis->GetBinLowEdge(1) << ", " << axis->GetBinLowEdge(1+axis->GetNbins()) << ", ";
+		ofs << args.str() << std::setprecision(6);
+		return;
+	}
+	const char* names[] = { "xedges", "yedges" };
+	ofs << indent << "  {\n";
+	for(UInt_t dim = 0; dim < rbhist->GetNdimensions(); ++dim) {
+		TAxis* axis = get_axis(rbhist, dim);
+		ofs << indent << "    Double_t " << names[dim] << "[] = { ";
+		for(Int_t bin = 1; bin <= axis->GetNbins() + 1; ++bin) {
+			ofs << axis->GetBinLowEdge(bin) << (bin <= axis->GetNbins() ? ", " : " };\n");
+		}
+	}
+	ofs << indent << "    rb::hist::NewVariable(\"" << rbhist->GetName() << "\", \"" << title << "\", ";
+	for(UInt_t dim = 0; dim < rbhist->GetNdimensions(); ++dim) {
+		ofs << get_axis(rbhist, dim)->GetNbins() << ", " << names[dim] << ", ";
+	}
+	ofs << args.str();
+	ofs << indent << "  }\n" << std::setprecision(6);
 }
 
 /// Write a histogram constructor format to a stream.
@@ -82,6 +130,8 @@ void write_hist(TObject* object, std::ostream& ofs) {
 		 write_summary_hist(static_cast<rb::hist::Summary*>(rbhist), ofs);
 	else if(class_name == "Bit")
 		 write_bit_hist(static_cast<rb::hist::Bit*>(rbhist), ofs);
+	else if(class_name == "Variable")
+		 write_variable_hist(static_cast<rb::hist::Variable*>(rbhist), ofs);
 	else;
 }
 
@@ -180,12 +230,317 @@ Bool_t overwrite(const char* fname) {
 }
 } // namespace
 
+// Structured (.rbc) configuration files.
+// One declaration per line, read natively rather than through CINT:
+//
+//   rbc 1
+//   cut  "name" "varx" "vary" width color npoints x0 y0 x1 y1 ...
+//   dir  "name" "title"        (create and enter a directory)
+//   end                        (leave it)
+//   hist KIND "name" "title" "params" "gate" event_code prescale max_rate AXES...
+//   var  "name" value
+//
+// KIND and AXES are one of: d or gamma (nbins low high, once per dimension), log (nbins low high),
+// summary (v|h nbins low high), bit (nbits), variable (nbins edge0 ... edge_nbins, once per dimension).
+// Strings are double-quoted, with \" and \\ escaped; '#' starts a comment.
+namespace {
+
+const Int_t kRbcVersion = 1;
+
+inline Bool_t is_rbc(const char* fname) {
+	const std::string name = fname;
+	return name.size() > 4 && name.substr(name.size() - 4) == ".rbc";
+}
+
+std::string quote(const char* str) {
+	std::string out = "\"";
+	for(const char* c = str; *c; ++c) {
+		if(*c == '"' || *c == '\\') out += '\\';
+		out += *c;
+	}
+	return out + "\"";
+}
+
+void write_rbc_axis(TAxis* axis, std::ostream& ofs) {
+	ofs << " " << axis->GetNbins() << " " << axis->GetBinLowEdge(1) << " " << axis->GetBinLowEdge(1+axis->GetNbins());
+}
+
+void write_rbc_hist(TObject* object, std::ostream& ofs) {
+	rb::hist::Base* rbhist = dynamic_cast<rb::hist::Base*>(object);
+	if(!rbhist || !rbhist->GetHist()) return;
+	std::string class_name = rbhist->ClassName();
+	class_name = class_name.substr(std::string("rb::hist::").size());
+	std::string kind;
+	if     (class_name == "D1" || class_name == "D2" || class_name == "D3") kind = "d";
+	else if(class_name == "Gamma")    kind = "gamma";
+	else if(class_name == "Summary")  kind = "summary";
+	else if(class_name == "Bit")      kind = "bit";
+	else if(class_name == "Variable") kind = rbhist->GetNdimensions() == 1 && rbhist->IsLog(0) ? "log" : "variable";
+	else return;
+
+	const std::string title = rbhist->UseDefaultTitle() ? "" : rbhist->GetTitle();
+	ofs << "hist " << kind << " " << quote(rbhist->GetName()) << " " << quote(title.c_str()) << " "
+			<< quote(rbhist->GetInitialParams().c_str()) << " " << quote(rbhist->GetGate().c_str()) << " "
+			<< rbhist->GetEventCode() << " " << rbhist->GetPrescale() << " " << rbhist->GetMaxRate();
+	if(kind == "summary") {
+		const Bool_t vertical = static_cast<rb::hist::Summary*>(rbhist)->GetOrientation() == rb::hist::Summary::VERTICAL;
+		ofs << (vertical ? " v" : " h");
+		write_rbc_axis(vertical ? rbhist->GetXaxis() : rbhist->GetYaxis(), ofs);
+	}
+	else if(kind == "bit") ofs << " " << rbhist->GetXaxis()->GetNbins();
+	else if(kind == "variable") {
+		for(UInt_t dim = 0; dim < rbhist->GetNdimensions(); ++dim) {
+			TAxis* axis = get_axis(rbhist, dim);
+			ofs << " " << axis->GetNbins();
+			for(Int_t bin = 1; bin <= axis->GetNbins() + 1; ++bin) ofs << " " << axis->GetBinLowEdge(bin);
+		}
+	}
+	else if(kind == "log") write_rbc_axis(rbhist->GetXaxis(), ofs);
+	else {
+		for(UInt_t dim = 0; dim < rbhist->GetNdimensions(); ++dim) write_rbc_axis(get_axis(rbhist, dim), ofs);
+	}
+	ofs << "\n";
+}
+
+void write_rbc_directory(TDirectory* dir, std::ostream& ofs) {
+	for(Int_t i=0; i< dir->GetList()->GetEntries(); ++i) {
+		write_rbc_hist(dir->GetList()->At(i), ofs);
+	}
+	for(Int_t i=0; i< dir->GetList()->GetEntries(); ++i) {
+		TDirectory* sub = dynamic_cast<TDirectory*>(dir->GetList()->At(i));
+		if(!sub) continue;
+		ofs << "dir " << quote(sub->GetName()) << " " << quote(sub->GetTitle()) << "\n";
+		write_rbc_directory(sub, ofs);
+		ofs << "end\n";
+	}
+}
+
+void write_rbc_cut(TObject* obj, std::ostream& ofs) {
+	TCutG* cut = dynamic_cast<TCutG*>(obj);
+	if(!cut) return;
+	ofs << "cut " << quote(cut->GetName()) << " " << quote(cut->GetVarX()) << " " << quote(cut->GetVarY()) << " "
+			<< cut->GetLineWidth() << " " << cut->GetLineColor() << " " << cut->GetN();
+	Double_t xx, yy;
+	for(Int_t i=0; i< cut->GetN(); ++i) {
+		cut->GetPoint(i, xx, yy);
+		ofs << " " << xx << " " << yy;
+	}
+	ofs << "\n";
+}
+
+enum { kRbcCuts = 1, kRbcHists = 2, kRbcVariables = 4 };
+
+Int_t write_rbc(const char* fname, const char* what, Int_t sections) {
+	TTimeStamp ts;
+	ofstream ofs(fname, ios::out);
+	ofs << "# ROOTBEER " << what << " FILE\n"
+			<< "# " << fname << "\n"
+			<< "# Generated on " << ts.AsString("l") << "\n"
+			<< "rbc " << kRbcVersion << "\n" << std::setprecision(17);
+	if(sections & kRbcCuts) {
+		ofs << "\n# CONTOUR GATES\n";
+		for(Int_t i=0; i< gROOT->GetListOfSpecials()->GetEntries(); ++i)
+			 write_rbc_cut(gROOT->GetListOfSpecials()->At(i), ofs);
+	}
+	if(sections & kRbcHists) {
+		ofs << "\n# DIRECTORIES AND HISTOGRAMS\n";
+		write_rbc_directory(gROOT, ofs);
+	}
+	if(sections & kRbcVariables) {
+		ofs << "\n# VARIABLES\n";
+		std::vector<rb::data::MBasic::Value> values = rb::data::MBasic::GetAllValues();
+		for(UInt_t i=0; i< values.size(); ++i)
+			 ofs << "var " << quote(values[i].fName.c_str()) << " " << values[i].fValue << "\n";
+	}
+	return ofs.good() ? 0 : 1;
+}
+
+/// Split a line into words and quoted strings, dropping comments
+void tokenize(const std::string& line, std::vector<std::string>& out) {
+	std::string::size_type i = 0;
+	while(i < line.size()) {
+		if(isspace(static_cast<unsigned char>(line[i]))) { ++i; continue; }
+		if(line[i] == '#') break;
+		std::string token;
+		if(line[i] == '"') {
+			for(++i; i < line.size() && line[i] != '"'; ++i) {
+				if(line[i] == '\\' && i+1 < line.size()) ++i;
+				token += line[i];
+			}
+			if(i == line.size()) err::Throw() << "Missing closing quote";
+			++i;
+		}
+		else {
+			while(i < line.size() && !isspace(static_cast<unsigned char>(line[i]))) token += line[i++];
+		}
+		out.push_back(token);
+	}
+}
+
+/// Reads numbers off a tokenized line
+class Fields
+{
+private:
+	const std::vector<std::string>& fTokens;
+	UInt_t fPos;
+public:
+	Fields(const std::vector<std::string>& tokens, UInt_t pos): fTokens(tokens), fPos(pos) { }
+	UInt_t Remaining() const { return fTokens.size() - fPos; }
+	const std::string& String() {
+		if(!Remaining()) err::Throw() << "Missing field";
+		return fTokens[fPos++];
+	}
+	Double_t Double() {
+		const std::string& str = String();
+		char* end;
+		const Double_t out = strtod(str.c_str(), &end);
+		if(end == str.c_str() || *end) err::Throw() << "Expected a number, got \"" << str << "\"";
+		return out;
+	}
+	Int_t Int() {
+		const Double_t out = Double();
+		if(out != Int_t(out)) err::Throw() << "Expected an integer, got " << out;
+		return Int_t(out);
+	}
+	void End() {
+		if(Remaining()) err::Throw() << "Unexpected \"" << fTokens[fPos] << "\"";
+	}
+};
+
+void read_rbc_hist(Fields& f) {
+	const std::string kind = f.String(), name = f.String(), title = f.String(), param = f.String(), gate = f.String();
+	const Int_t code = f.Int(), prescale = f.Int();
+	const Double_t max_rate = f.Double();
+	const char *n = name.c_str(), *t = title.c_str(), *p = param.c_str(), *g = gate.c_str();
+
+	if(kind == "d" || kind == "gamma") {
+		if(f.Remaining() % 3 || f.Remaining() < 3 || f.Remaining() > 9) err::Throw() << "Expected 1-3 axes";
+		const UInt_t ndim = f.Remaining() / 3;
+		Int_t nbins[3]; Double_t low[3], high[3];
+		for(UInt_t i=0; i< ndim; ++i) { nbins[i] = f.Int(); low[i] = f.Double(); high[i] = f.Double(); }
+		const Bool_t gamma = kind == "gamma";
+		if(ndim == 1) {
+			if(gamma) rb::hist::NewGamma(n, t, nbins[0], low[0], high[0], p, g, code, prescale, max_rate);
+			else      rb::hist::New     (n, t, nbins[0], low[0], high[0], p, g, code, prescale, max_rate);
+		}
+		else if(ndim == 2) {
+			if(gamma) rb::hist::NewGamma(n, t, nbins[0], low[0], high[0], nbins[1], low[1], high[1], p, g, code, prescale, max_rate);
+			else      rb::hist::New     (n, t, nbins[0], low[0], high[0], nbins[1], low[1], high[1], p, g, code, prescale, max_rate);
+		}
+		else {
+			if(gamma) rb::hist::NewGamma(n, t, nbins[0], low[0], high[0], nbins[1], low[1], high[1],
+																	 nbins[2], low[2], high[2], p, g, code, prescale, max_rate);
+			else      rb::hist::New     (n, t, nbins[0], low[0], high[0], nbins[1], low[1], high[1],
+																	 nbins[2], low[2], high[2], p, g, code, prescale, max_rate);
+		}
+	}
+	else if(kind == "log") {
+		const Int_t nbins = f.Int(); const Double_t low = f.Double(), high = f.Double();
+		f.End();
+		rb::hist::NewLog(n, t, nbins, low, high, p, g, code, prescale, max_rate);
+	}
+	else if(kind == "summary") {
+		const std::string orientation = f.String();
+		const Int_t nbins = f.Int(); const Double_t low = f.Double(), high = f.Double();
+		f.End();
+		rb::hist::NewSummary(n, t, nbins, low, high, p, g, code, orientation.c_str(), prescale, max_rate);
+	}
+	else if(kind == "bit") {
+		const Int_t nbits = f.Int();
+		f.End();
+		rb::hist::NewBit(n, t, nbits, p, g, code, prescale, max_rate);
+	}
+	else if(kind == "variable") {
+		std::vector<Double_t> edges[2];
+		Int_t nbins[2];
+		UInt_t ndim = 0;
+		for(; f.Remaining() && ndim < 2; ++ndim) {
+			nbins[ndim] = f.Int();
+			if(nbins[ndim] < 1) err::Throw() << "Need at least one bin";
+			for(Int_t i=0; i<= nbins[ndim]; ++i) edges[ndim].push_back(f.Double());
+		}
+		f.End();
+		if(ndim == 1) rb::hist::NewVariable(n, t, nbins[0], &edges[0][0], p, g, code, prescale, max_rate);
+		else if(ndim == 2) rb::hist::NewVariable(n, t, nbins[0], &edges[0][0], nbins[1], &edges[1][0], p, g, code, prescale, max_rate);
+		else err::Throw() << "Expected 1 or 2 axes";
+	}
+	else err::Throw() << "Unknown histogram kind \"" << kind << "\"";
+}
+
+void read_rbc_cut(Fields& f) {
+	const std::string name = f.String(), varx = f.String(), vary = f.String();
+	const Int_t width = f.Int(), color = f.Int(), np = f.Int();
+	std::vector<Double_t> x, y;
+	for(Int_t i=0; i< np; ++i) { x.push_back(f.Double()); y.push_back(f.Double()); }
+	f.End();
+	if(np < 1) err::Throw() << "Need at least one point";
+	rb::CreateTCutG(name.c_str(), np, &x[0], &y[0], varx.c_str(), vary.c_str(), width, color);
+}
+
+/// Enter (creating if needed) a sub-directory of gDirectory, without signalling the GUI
+void read_rbc_dir(Fields& f) {
+	const std::string name = f.String(), title = f.String();
+	f.End();
+	TDirectory* dir = dynamic_cast<TDirectory*>(gDirectory->FindObject(name.c_str()));
+	if(!dir) dir = gDirectory->mkdir(name.c_str(), title.c_str());
+	if(!dir) err::Throw() << "Couldn't create the directory \"" << name << "\"";
+	dir->cd();
+}
+
+/// Read a structured configuration file.
+//! \details Histograms are created through the usual functions, but without signalling the GUI
+//! for each one (the caller syncs it once), and variables are set as a single batch.
+void read_rbc(const char* filename) {
+	ifstream ifs(filename);
+	TDirectory* initial = gDirectory;
+	const Bool_t changed = rb::hist::Base::SetNotify(false);
+	std::map<std::string, Double_t> values;
+	std::string line;
+	for(Int_t lineno = 1; std::getline(ifs, line); ++lineno) {
+		try {
+			std::vector<std::string> tokens;
+			tokenize(line, tokens);
+			if(tokens.empty()) continue;
+			Fields f(tokens, 1);
+			if(tokens[0] == "hist") read_rbc_hist(f);
+			else if(tokens[0] == "var") {
+				const std::string name = f.String();
+				const Double_t value = f.Double();
+				f.End();
+				// Checked here, so one unknown name only costs its own line rather than the whole batch
+				if(!rb::data::MBasic::Find(name.c_str())) err::Throw() << "Unknown variable \"" << name << "\"";
+				values[name] = value;
+			}
+			else if(tokens[0] == "cut") read_rbc_cut(f);
+			else if(tokens[0] == "dir") read_rbc_dir(f);
+			else if(tokens[0] == "end") {
+				f.End();
+				if(gDirectory == gROOT || !gDirectory->GetMotherDir()) err::Throw() << "\"end\" without \"dir\"";
+				gDirectory->GetMotherDir()->cd();
+			}
+			else if(tokens[0] == "rbc") {
+				if(f.Int() > kRbcVersion) err::Throw() << "File is from a newer version of rootbeer";
+			}
+			else err::Throw() << "Unknown declaration \"" << tokens[0] << "\"";
+		}
+		catch (std::exception& e) {
+			err::Error("rb::ReadConfig") << filename << ", line " << lineno << ": " << e.what();
+		}
+	}
+	if(changed) rb::hist::Base::SetNotify(true);
+	if(!values.empty() && !rb::data::SetValues(values))
+		err::Error("rb::ReadConfig") << filename << ": none of its " << values.size() << " variables were set.";
+	initial->cd();
+}
+} // namespace
+
 // Write rootbeer configuration file
 Int_t rb::WriteConfig(const char* fname, Bool_t prompt) {
   if(prompt) {
     if(!overwrite(fname))
 			 return 1;
   }
+  if(is_rbc(fname)) return write_rbc(fname, "CONFIGURATION", kRbcCuts | kRbcHists | kRbcVariables);
   TTimeStamp ts; std::string ts_str = ts.AsString("l");
 
   ofstream ofs(fname, ios::out);
@@ -217,6 +572,7 @@ Int_t rb::WriteHistograms(const char* fname, Bool_t prompt) {
     if(!overwrite(fname))
 			 return 1;
   }
+  if(is_rbc(fname)) return write_rbc(fname, "HISTOGRAM CONFIGURATION", kRbcHists);
   TTimeStamp ts; std::string ts_str = ts.AsString("l");
 
   ofstream ofs(fname, ios::out);
@@ -238,6 +594,7 @@ Int_t rb::WriteVariables(const char* fname, Bool_t prompt) {
     if(!overwrite(fname))
 			 return 1;
   }
+  if(is_rbc(fname)) return write_rbc(fname, "VARIABLE CONFIGURATION", kRbcVariables);
   TTimeStamp ts; std::string ts_str = ts.AsString("l");
 
   ofstream ofs(fname, ios::out);
@@ -286,6 +643,9 @@ void rb::ReadConfig(const char* filename, Option_t* option) {
   TString opt(option);
   opt.ToLower();
   if(0);
+  else if(!opt.CompareTo("c") && is_rbc(filename)) {
+    read_rbc(filename);
+  }
   else if(!opt.CompareTo("c")) {
     std::stringstream sstr;
     sstr << ".x " << filename;
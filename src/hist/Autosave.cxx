@@ -0,0 +1,256 @@
+//! \file Autosave.cxx
+//! \brief Implements Autosave.hxx
+#include <map>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <TFile.h>
+#include <TSystem.h>
+#include <TTimeStamp.h>
+#include "hist/Autosave.hxx"
+#include "hist/Snapshot.hxx"
+#include "hist/Writer.hxx"
+#include "utils/Thread.hxx"
+#include "utils/Affinity.hxx"
+#include "utils/Mutex.hxx"
+#include "utils/Error.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Utility functions & classes                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace
+{
+/// Name of the autosave thread
+const char* kAutosaveThreadName = "HistAutosave";
+
+/// Longest the autosave thread sleeps between checks of whether it has been stopped (ms)
+const Int_t kMaxSleep = 100;
+
+/// Add \c size bytes at \c data to a 64 bit FNV-1a hash
+inline void hash_bytes(ULong64_t& hash, const void* data, size_t size) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for(size_t i=0; i< size; ++i) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+}
+
+/// Hash of everything about \c snapshot that ends up in the file
+ULong64_t hash_snapshot(const rb::hist::Snapshot& snapshot) {
+	ULong64_t hash = 14695981039346656037ULL;
+	hash_bytes(hash, snapshot.fTitle.data(), snapshot.fTitle.size());
+	hash_bytes(hash, &snapshot.fNdimensions, sizeof(snapshot.fNdimensions));
+	hash_bytes(hash, snapshot.fNbins, sizeof(snapshot.fNbins));
+	hash_bytes(hash, snapshot.fLow, sizeof(snapshot.fLow));
+	hash_bytes(hash, snapshot.fHigh, sizeof(snapshot.fHigh));
+	for(Int_t i=0; i< 3; ++i)
+		if(!snapshot.fEdges[i].empty())
+			hash_bytes(hash, &snapshot.fEdges[i][0], snapshot.fEdges[i].size() * sizeof(Double_t));
+	if(!snapshot.fBins.empty())
+		hash_bytes(hash, &snapshot.fBins[0], snapshot.fBins.size() * sizeof(Double_t));
+	if(!snapshot.fSumw2.empty())
+		hash_bytes(hash, &snapshot.fSumw2[0], snapshot.fSumw2.size() * sizeof(Double_t));
+	hash_bytes(hash, snapshot.fStats, sizeof(snapshot.fStats));
+	hash_bytes(hash, &snapshot.fEntries, sizeof(snapshot.fEntries));
+	hash_bytes(hash, &snapshot.fScaleFactor, sizeof(snapshot.fScaleFactor));
+	for(Int_t i=0; i< 3; ++i)
+		hash_bytes(hash, snapshot.fAxisTitles[i].data(), snapshot.fAxisTitles[i].size());
+	hash_bytes(hash, snapshot.fOption.data(), snapshot.fOption.size());
+	const Double_t drawing[] = { snapshot.fMinimum, snapshot.fMaximum,
+															 Double_t(snapshot.fLine.GetLineColor()), Double_t(snapshot.fLine.GetLineStyle()),
+															 Double_t(snapshot.fLine.GetLineWidth()), Double_t(snapshot.fFill.GetFillColor()),
+															 Double_t(snapshot.fFill.GetFillStyle()), Double_t(snapshot.fMarker.GetMarkerColor()),
+															 Double_t(snapshot.fMarker.GetMarkerStyle()), Double_t(snapshot.fMarker.GetMarkerSize()) };
+	hash_bytes(hash, drawing, sizeof(drawing));
+	return hash;
+}
+
+/// Insert \c number before the extension of \c filename ("a/b.root", 1 -> "a/b.1.root")
+std::string numbered_name(const std::string& filename, Int_t number) {
+	std::string::size_type dot = filename.rfind('.');
+	const std::string::size_type slash = filename.rfind('/');
+	if(dot == std::string::npos || (slash != std::string::npos && dot < slash)) dot = filename.size();
+	std::stringstream name;
+	name << filename.substr(0, dot) << "." << number << filename.substr(dot);
+	return name.str();
+}
+
+/// What a file holds of one histogram
+struct Saved
+{
+	 //! hash_snapshot() of what was written
+	 ULong64_t fHash;
+	 //! Snapshot::GetDirectory()
+	 std::string fDirectory;
+	 //! Snapshot::GetName()
+	 std::string fName;
+};
+
+/// Thread doing all of the autosaving.
+class AutosaveThread: public rb::Thread
+{
+private:
+	 //! Name of the files, before numbering
+	 std::string fFilename;
+	 //! Time between autosaves (seconds)
+	 Double_t fPeriod;
+	 //! Only rewrite changed histograms?
+	 Bool_t fChangedOnly;
+	 //! Number of the file to write next
+	 Int_t fNext;
+	 //! For each file, every histogram it holds (by path); only kept if fChangedOnly
+	 std::vector< std::map<std::string, Saved> > fContents;
+	 //! For each file, has it been written since Start() (so fContents is accurate)?
+	 std::vector<Bool_t> fWritten;
+
+	 AutosaveThread(const char* filename, Double_t period, Bool_t changed_only, Int_t nfiles):
+		 rb::Thread(kAutosaveThreadName, rb::Affinity::kCanvas),
+		 fFilename(filename), fPeriod(period), fChangedOnly(changed_only), fNext(0),
+		 fContents(nfiles), fWritten(nfiles, false) { }
+	 //! Snapshot every histogram and write them to the next file
+	 void Save();
+public:
+	 static void CreateAndRun(const char* filename, Double_t period, Bool_t changed_only, Int_t nfiles) {
+		 AutosaveThread* autosave = new AutosaveThread(filename, period, changed_only, nfiles);
+		 autosave->Run();
+	 }
+	 void DoInThread();
+};
+
+void AutosaveThread::Save() {
+	std::vector<rb::hist::Snapshot> snapshots;
+	rb::hist::SnapshotAll(snapshots);
+
+	// Everything from here on is private to this thread: gDirectory is per thread under TThread
+	const std::string filename = numbered_name(fFilename, fNext);
+	const Bool_t update = fChangedOnly && fWritten[fNext];
+	std::map<std::string, Saved>& contents = fContents[fNext];
+	fWritten[fNext] = false;
+	if(!update) contents.clear();
+
+	TFile file(filename.c_str(), update ? "UPDATE" : "RECREATE");
+	if(file.IsZombie()) {
+		err::Error("rb::hist::Autosave") << "Couldn't open " << filename << " for writing.";
+		return;
+	}
+
+	// Only what changed is written, gathered by directory
+	std::map<std::string, Saved> saved;
+	std::map<std::string, std::vector<rb::hist::Snapshot> > directories;
+	for(std::vector<rb::hist::Snapshot>::iterator it = snapshots.begin(); it != snapshots.end(); ++it) {
+		Saved entry = { fChangedOnly ? hash_snapshot(*it) : 0, it->GetDirectory(), it->GetName() };
+		std::map<std::string, Saved>::const_iterator old = contents.find(it->fPath);
+		if(old != contents.end() && old->second.fHash == entry.fHash) {
+			saved.insert(*old);
+			continue;
+		}
+		directories[entry.fDirectory].push_back(*it);
+		std::vector<Double_t>().swap(it->fBins); // only one copy of the contents at a time
+		std::vector<Double_t>().swap(it->fSumw2);
+		if(fChangedOnly) saved[it->fPath] = entry;
+	}
+	std::vector<rb::hist::Snapshot>().swap(snapshots);
+
+	for(std::map<std::string, std::vector<rb::hist::Snapshot> >::iterator it = directories.begin();
+			it != directories.end(); ++it) {
+		std::vector<rb::hist::Snapshot>& changed = it->second;
+		TDirectory* dir = rb::hist::GetSubdirectory(&file, it->first, true);
+		Int_t nwritten = 0;
+		if(dir) {
+			if(update) { // the old versions and scale factors go, whether or not the new ones have them
+				rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+				for(UInt_t i=0; i< changed.size(); ++i) {
+					dir->Delete((changed[i].GetName() + ";*").c_str());
+					dir->Delete((rb::hist::Snapshot::ScaleName(changed[i].GetName()) + ";*").c_str());
+				}
+			}
+			// Serializes under the global mutex one histogram at a time, and compresses outside of it
+			nwritten = rb::hist::WriteSnapshots(changed, dir);
+		}
+		if(nwritten != Int_t(changed.size())) {
+			err::Error("rb::hist::Autosave") << "Couldn't write every histogram of " << it->first << " to " << filename;
+			for(UInt_t i=0; i< changed.size(); ++i)
+				saved.erase(changed[i].fPath); // rewritten next time
+		}
+		std::vector<rb::hist::Snapshot>().swap(changed);
+	}
+	// Histograms deleted since the file was last written
+	for(std::map<std::string, Saved>::const_iterator it = contents.begin(); it != contents.end(); ++it) {
+		if(saved.count(it->first)) continue;
+		TDirectory* dir = rb::hist::GetSubdirectory(&file, it->second.fDirectory, false);
+		if(!dir) continue;
+		rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+		dir->Delete((it->second.fName + ";*").c_str());
+		dir->Delete((rb::hist::Snapshot::ScaleName(it->second.fName) + ";*").c_str());
+	}
+	file.Close();
+
+	if(file.TestBit(TFile::kWriteError)) {
+		err::Error("rb::hist::Autosave") << "Error writing " << filename << "; it will be rewritten from scratch.";
+		contents.clear();
+	}
+	else {
+		contents.swap(saved);
+		fWritten[fNext] = true;
+	}
+	fNext = (fNext + 1) % fContents.size();
+}
+
+void AutosaveThread::DoInThread() {
+	const Int_t sleep = std::min<Int_t>(kMaxSleep, std::max<Int_t>(1, Int_t(fPeriod * 1e3)));
+	Double_t saved = TTimeStamp().AsDouble();
+	while(!IsCancelled()) {
+		const Double_t now = TTimeStamp().AsDouble();
+		if(now - saved < fPeriod) {
+			gSystem->Sleep(sleep);
+			continue;
+		}
+		saved = now;
+		Save();
+	}
+	Save();
+}
+
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::Autosave                                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::Autosave::Start()                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Autosave::Start(const char* filename, Double_t period, Bool_t changed_only, Int_t nfiles) {
+	if(IsRunning()) {
+		err::Error("rb::hist::Autosave::Start") << "Histograms are already being autosaved.";
+		return false;
+	}
+	if(!filename || !*filename || period <= 0 || nfiles < 1) {
+		err::Error("rb::hist::Autosave::Start") << "Invalid arguments: need a file name, a positive period "
+																						<< "and at least one file.";
+		return false;
+	}
+	AutosaveThread::CreateAndRun(filename, period, changed_only, nfiles);
+	err::Info("rb::hist::Autosave") << "Saving " << (changed_only ? "changed" : "all") << " histograms every "
+																	<< period << " seconds to " << numbered_name(filename, 0)
+																	<< (nfiles > 1 ? " and following." : ".");
+	return true;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Autosave::Stop()                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Autosave::Stop() {
+	rb::Thread::Stop(kAutosaveThreadName);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::Autosave::IsRunning()                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Autosave::IsRunning() {
+	return rb::Thread::IsRunning(kAutosaveThreadName);
+}
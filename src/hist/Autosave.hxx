@@ -0,0 +1,44 @@
+//! \file Autosave.hxx
+//! \brief Defines the periodic saving of histograms to a rotating set of ROOT files.
+#ifndef HIST_AUTOSAVE_HXX
+#define HIST_AUTOSAVE_HXX
+#include <Rtypes.h>
+
+namespace rb
+{
+namespace hist
+{
+/// \brief Periodically saves every histogram to a rotating set of ROOT files, in the background.
+//! \details A thread (named "HistAutosave") snapshots every histogram once per period (see
+//! SnapshotAll()) and writes the snapshots to the next of \c nfiles files, e.g. for
+//! "autosave.root" and three files, to "autosave.0.root", "autosave.1.root", "autosave.2.root",
+//! "autosave.0.root" and so on. The fill locks are held only while the bins are copied, and each
+//! directory is written with WriteSnapshots(), which holds the global mutex only to serialize one
+//! histogram at a time and compresses in parallel outside of it, so autosaving during a run doesn't
+//! stall processing. A crash while writing one file leaves the
+//! other files intact. The histograms keep their directories, e.g. "/adc/adc0" is saved as
+//! "adc0" in directory "adc".
+//!
+//! With \c changed_only, each file is updated in place, rewriting only the histograms that changed
+//! since that file was last written (and removing deleted ones), so quiet histograms cost nothing.
+//! The first write of each file after Start() always rewrites the whole file.
+class Autosave
+{
+public:
+	 /// Start autosaving.
+	 //! \param filename Name of the files; the file number is inserted before the extension
+	 //! \param period Time between autosaves, in seconds
+	 //! \param changed_only Only rewrite histograms that changed since the file was last written
+	 //! \param nfiles Number of files to rotate through
+	 //! \returns false if autosaving is already running or the arguments are invalid
+	 static Bool_t Start(const char* filename, Double_t period, Bool_t changed_only, Int_t nfiles);
+	 /// Save once more, then stop autosaving.
+	 static void Stop();
+	 /// Is autosaving running?
+	 static Bool_t IsRunning();
+};
+
+}
+}
+
+#endif
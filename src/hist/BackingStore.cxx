@@ -0,0 +1,527 @@
+//! \file BackingStore.cxx
+//! \brief Implements BackingStore.hxx
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <TSystem.h>
+#include <TTimeStamp.h>
+#include "hist/BackingStore.hxx"
+#include "Hist.hxx"
+#include "Rint.hxx"
+#include "Event.hxx"
+#include "utils/Thread.hxx"
+#include "utils/Mutex.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Utility functions & classes                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace
+{
+/// Identifies the file
+const char kMagic[8] = "RBSTORE";
+/// Version of the file layout, changed whenever the structures below are
+const UInt_t kFormat = 2;
+/// Identifies the start of a record
+const UInt_t kRecordMagic = 0x52424852;
+/// Record states
+enum { kFree = 0, kLive = 1 };
+/// Size of the path field (including the terminating null)
+const Int_t kMaxPath = 256;
+/// Records start at multiples of this (so that free space is always big enough for a record header)
+const ULong64_t kAlign = 64;
+/// Offset of the first record
+const ULong64_t kFirstRecord = 4096;
+/// Size of a new file
+const ULong64_t kInitialSize = 1 << 20;
+/// Name of the sync thread
+const char* kSyncThreadName = "HistSync";
+/// Longest the sync thread sleeps between checks of whether it has been stopped (ms)
+const Int_t kMaxSleep = 100;
+
+/// Start of the file
+struct FileHeader
+{
+	 //! kMagic
+	 char fMagic[8];
+	 //! kFormat
+	 UInt_t fFormat;
+	 //! Set when closed, cleared while open
+	 UInt_t fClean;
+	 //! End of the last record
+	 ULong64_t fUsed;
+	 //! Time of the last sync (seconds since the epoch)
+	 Double_t fSyncTime;
+};
+
+/// One histogram: followed by the cell contents, the sums of squared weights
+/// (if fHasSumw2) and the edges of each variable bin axis
+struct Record
+{
+	 //! kRecordMagic
+	 UInt_t fMagic;
+	 //! kFree or kLive
+	 UInt_t fState;
+	 //! Bytes up to the next record (a multiple of kAlign)
+	 ULong64_t fLength;
+	 //! Directory path and name (see rb::hist::Base::GetPath())
+	 char fPath[kMaxPath];
+	 //! Number of dimensions
+	 Int_t fNdimensions;
+	 //! Number of bins on each axis
+	 Int_t fNbins[3];
+	 //! Lower edge of each axis
+	 Double_t fLow[3];
+	 //! Upper edge of each axis
+	 Double_t fHigh[3];
+	 //! Number of cells
+	 ULong64_t fNcells;
+	 //! Bit i is set if axis i has variable bins
+	 UInt_t fVariable;
+	 //! Are the sums of squared weights stored?
+	 UInt_t fHasSumw2;
+	 //! Code of the event the histogram belongs to
+	 Int_t fEventCode;
+	 //! Padding
+	 UInt_t fReserved;
+};
+
+/// A mapped part of the file
+struct Segment
+{
+	 ULong64_t fOffset;
+	 ULong64_t fLength;
+	 char* fMap;
+};
+
+/// Key of the records of the histogram at \c path of event \c event_code (paths repeat across events)
+inline std::string record_key(Int_t event_code, const std::string& path) {
+	std::ostringstream key;
+	key << event_code << ":" << path;
+	return key.str();
+}
+
+inline ULong64_t round_up(ULong64_t n, ULong64_t to) {
+	return (n + to - 1) / to * to;
+}
+
+inline const TAxis* get_axis(const TH1* hist, Int_t i) {
+	return i == 0 ? hist->GetXaxis() : i == 1 ? hist->GetYaxis() : hist->GetZaxis();
+}
+
+/// Bytes needed for a record of \c hist
+ULong64_t record_length(const TH1* hist, const TArrayD* bins, const TArrayD* sumw2) {
+	ULong64_t length = sizeof(Record) + bins->fN * sizeof(Double_t);
+	if(sumw2) length += sumw2->fN * sizeof(Double_t);
+	for(Int_t i=0; i< 3; ++i)
+		 length += get_axis(hist, i)->GetXbins()->fN * sizeof(Double_t);
+	return round_up(length, kAlign);
+}
+
+/// Is \c record (with at least \c length bytes mapped) long enough for the contents it claims?
+inline Bool_t consistent(const Record* record) {
+	ULong64_t ndoubles = record->fNcells * (record->fHasSumw2 ? 2 : 1);
+	for(Int_t i=0; i< 3; ++i) {
+		if(record->fNbins[i] < 0) return false;
+		if(record->fVariable & (1 << i)) ndoubles += record->fNbins[i] + 1;
+	}
+	return sizeof(Record) + ndoubles * sizeof(Double_t) <= record->fLength;
+}
+
+/// Move an array into mapped memory
+inline void adopt(TArrayD* array, Double_t* mapped) {
+	Double_t* old = array->fArray;
+	array->fArray = mapped;
+	delete[] old;
+}
+
+/// Move an array out of mapped memory
+inline void release(TArrayD* array) {
+	Double_t* heap = new Double_t[array->fN];
+	std::copy(array->fArray, array->fArray + array->fN, heap);
+	array->fArray = heap;
+}
+
+/// The open file
+class MappedFile
+{
+public:
+	 //! Name of the file
+	 std::string fFilename;
+	 //! File descriptor, -1 if not open
+	 int fFd;
+	 //! Mappings of the file, in order
+	 std::vector<Segment> fSegments;
+	 //! Live records not taken over by any histogram (yet), by record_key()
+	 std::map<std::string, ULong64_t> fRecords;
+	 //! Offset of the record of each histogram in the store
+	 std::map<const rb::hist::Base*, ULong64_t> fAttached;
+	 //! Number of histograms that took over the counts of a record
+	 Int_t fNresumed;
+
+	 MappedFile(): fFd(-1), fNresumed(0) { }
+	 //! Pointer to \c offset, 0 unless at least \c length bytes there are mapped
+	 char* At(ULong64_t offset, ULong64_t length = 16) {
+		 for(std::vector<Segment>::iterator it = fSegments.begin(); it != fSegments.end(); ++it)
+				if(offset >= it->fOffset && offset + length <= it->fOffset + it->fLength)
+					 return it->fMap + (offset - it->fOffset);
+		 return 0;
+	 }
+	 FileHeader* GetHeader() { return reinterpret_cast<FileHeader*>(fSegments.front().fMap); }
+	 Record* GetRecord(ULong64_t offset) { return reinterpret_cast<Record*>(At(offset)); }
+	 Double_t* GetCells(Record* record) { return reinterpret_cast<Double_t*>(record + 1); }
+	 Double_t* GetSumw2(Record* record) { return GetCells(record) + record->fNcells; }
+	 Double_t* GetEdges(Record* record, Int_t axis) {
+		 Double_t* edges = GetSumw2(record) + (record->fHasSumw2 ? record->fNcells : 0);
+		 for(Int_t i=0; i< axis; ++i)
+				if(record->fVariable & (1 << i)) edges += record->fNbins[i] + 1;
+		 return edges;
+	 }
+	 //! Map \c length bytes at \c offset
+	 Bool_t Map(ULong64_t offset, ULong64_t length) {
+		 void* map = mmap(0, length, PROT_READ | PROT_WRITE, MAP_SHARED, fFd, offset);
+		 if(map == MAP_FAILED) return false;
+		 Segment segment = { offset, length, static_cast<char*>(map) };
+		 fSegments.push_back(segment);
+		 return true;
+	 }
+	 //! Flush all mappings to disk
+	 void Sync() { SyncSegments(fSegments); }
+	 //! Flush \c segments to disk
+	 static void SyncSegments(const std::vector<Segment>& segments) {
+		 for(std::vector<Segment>::const_iterator it = segments.begin(); it != segments.end(); ++it)
+				msync(it->fMap, it->fLength, MS_SYNC);
+	 }
+	 //! Unmap and close the file
+	 void Close() {
+		 for(std::vector<Segment>::iterator it = fSegments.begin(); it != fSegments.end(); ++it)
+				munmap(it->fMap, it->fLength);
+		 fSegments.clear();
+		 if(fFd >= 0) close(fFd);
+		 fFd = -1;
+		 fRecords.clear();
+		 fAttached.clear();
+	 }
+	 //! Index the live records
+	 void Scan();
+	 //! Append a (free) record of \c length bytes, growing the file if needed
+	 //! \returns its offset, 0 on failure
+	 ULong64_t Allocate(ULong64_t length);
+	 //! Does \c record hold a histogram binned like \c hist?
+	 Bool_t Matches(Record* record, const TH1* hist, const TArrayD* bins, const TArrayD* sumw2);
+};
+
+void MappedFile::Scan() {
+	fRecords.clear();
+	FileHeader* header = GetHeader();
+	for(ULong64_t offset = kFirstRecord; offset < header->fUsed; ) {
+		Record* record = GetRecord(offset);
+		if(!record || record->fMagic != kRecordMagic || record->fLength < kAlign ||
+			 record->fLength % kAlign || offset + record->fLength > header->fUsed ||
+			 (record->fState == kLive && (!At(offset, record->fLength) || !consistent(record)))) {
+			err::Warning("rb::hist::BackingStore") << fFilename << ": damaged record at byte " << offset
+																						 << ", discarding the rest of the file.";
+			header->fUsed = offset;
+			break;
+		}
+		if(record->fState == kLive) {
+			const std::string key = record_key(record->fEventCode, std::string(record->fPath, strnlen(record->fPath, kMaxPath)));
+			std::map<std::string, ULong64_t>::iterator old = fRecords.find(key);
+			if(old != fRecords.end()) GetRecord(old->second)->fState = kFree;
+			fRecords[key] = offset;
+		}
+		offset += record->fLength;
+	}
+}
+
+ULong64_t MappedFile::Allocate(ULong64_t length) {
+	FileHeader* header = GetHeader();
+	const ULong64_t end = fSegments.back().fOffset + fSegments.back().fLength;
+	if(header->fUsed + length > end) {
+		if(header->fUsed < end) { // records don't straddle mappings, so pad to the end of this one
+			Record* filler = GetRecord(header->fUsed);
+			filler->fMagic = kRecordMagic;
+			filler->fState = kFree;
+			filler->fLength = end - header->fUsed;
+			header->fUsed = end;
+		}
+		const ULong64_t grow = std::max(round_up(length, sysconf(_SC_PAGESIZE)), end);
+		if(ftruncate(fFd, end + grow) < 0 || !Map(end, grow)) {
+			err::Error("rb::hist::BackingStore") << "Couldn't enlarge " << fFilename << " to "
+																					 << end + grow << " bytes: " << strerror(errno);
+			return 0;
+		}
+		header = GetHeader();
+	}
+	const ULong64_t offset = header->fUsed;
+	Record* record = GetRecord(offset);
+	memset(record, 0, sizeof(Record));
+	record->fMagic = kRecordMagic;
+	record->fState = kFree;
+	record->fLength = length;
+	header->fUsed += length;
+	return offset;
+}
+
+Bool_t MappedFile::Matches(Record* record, const TH1* hist, const TArrayD* bins, const TArrayD* sumw2) {
+	if(record->fNdimensions != hist->GetDimension() || record->fNcells != ULong64_t(bins->fN) ||
+		 record->fHasSumw2 != (sumw2 && sumw2->fN == bins->fN)) return false;
+	for(Int_t i=0; i< 3; ++i) {
+		const TAxis* axis = get_axis(hist, i);
+		const TArrayD* edges = axis->GetXbins();
+		if(record->fNbins[i] != axis->GetNbins() || record->fLow[i] != axis->GetXmin() ||
+			 record->fHigh[i] != axis->GetXmax() || ((record->fVariable >> i) & 1) != (edges->fN != 0))
+			 return false;
+		if(edges->fN && !std::equal(edges->fArray, edges->fArray + edges->fN, GetEdges(record, i)))
+			 return false;
+	}
+	return true;
+}
+
+rb::Mutex& store_mutex() {
+	static rb::Mutex* out = new rb::Mutex("rb::hist::BackingStore", true);
+	return *out;
+}
+
+MappedFile& the_store() {
+	static MappedFile* out = new MappedFile();
+	return *out;
+}
+
+/// Syncs the store periodically.
+class SyncThread: public rb::Thread
+{
+private:
+	 Double_t fPeriod; // seconds
+	 SyncThread(Double_t period): rb::Thread(kSyncThreadName), fPeriod(period) { }
+public:
+	 static void CreateAndRun(Double_t period) {
+		 SyncThread* thread = new SyncThread(period);
+		 thread->Run();
+	 }
+	 void DoInThread() {
+		 Double_t synced = TTimeStamp().AsDouble();
+		 while(!IsCancelled()) {
+			 gSystem->Sleep(kMaxSleep);
+			 const Double_t now = TTimeStamp().AsDouble();
+			 if(now - synced < fPeriod) continue;
+			 synced = now;
+			 rb::hist::BackingStore::Sync();
+		 }
+	 }
+};
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::BackingStore                                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::BackingStore::Open()                 //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::BackingStore::Open(const char* filename, Double_t sync_period) {
+	{
+		rb::ScopedLock<rb::Mutex> lock(store_mutex());
+		MappedFile& store = the_store();
+		if(store.fFd >= 0) {
+			err::Error("rb::hist::BackingStore::Open") << "The histogram store " << store.fFilename << " is already open.";
+			return false;
+		}
+		store.fFd = open(filename, O_RDWR | O_CREAT, 0644);
+		struct stat status;
+		if(store.fFd < 0 || fstat(store.fFd, &status) < 0) {
+			err::Error("rb::hist::BackingStore::Open") << "Couldn't open " << filename << ": " << strerror(errno);
+			store.Close();
+			return false;
+		}
+		store.fFilename = filename;
+		store.fNresumed = 0;
+		const Bool_t fresh = status.st_size == 0;
+		const ULong64_t size = fresh ? kInitialSize : status.st_size;
+		if(!fresh && (size < kFirstRecord || size % sysconf(_SC_PAGESIZE))) {
+			err::Error("rb::hist::BackingStore::Open") << filename << " is not a histogram store.";
+			store.Close();
+			return false;
+		}
+		if((fresh && ftruncate(store.fFd, size) < 0) || !store.Map(0, size)) {
+			err::Error("rb::hist::BackingStore::Open") << "Couldn't map " << filename << ": " << strerror(errno);
+			store.Close();
+			return false;
+		}
+		FileHeader* header = store.GetHeader();
+		if(fresh) {
+			memcpy(header->fMagic, kMagic, sizeof(kMagic));
+			header->fFormat = kFormat;
+			header->fUsed = kFirstRecord;
+		}
+		else if(memcmp(header->fMagic, kMagic, sizeof(kMagic)) || header->fFormat != kFormat ||
+						header->fUsed < kFirstRecord || header->fUsed > size) {
+			err::Error("rb::hist::BackingStore::Open") << filename << " is not a histogram store of format " << kFormat << ".";
+			store.Close();
+			return false;
+		}
+		else if(!header->fClean)
+			 err::Warning("rb::hist::BackingStore::Open") << filename << " was not closed cleanly; recovering the counts it holds.";
+		header->fClean = 0;
+		store.Scan();
+	}
+
+	// The managers lock their own mutex before the store's
+	rb::EventVector_t events = rb::gApp()->GetEventVector();
+	for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it) {
+		rb::Event* event = rb::gApp()->GetEvent(it->first);
+		if(event) event->GetHistManager()->MoveToBackingStore();
+	}
+	SyncThread::CreateAndRun(sync_period);
+
+	rb::ScopedLock<rb::Mutex> lock(store_mutex());
+	err::Info("rb::hist::BackingStore") << "Keeping the bins of " << the_store().fAttached.size()
+																			<< " histograms in " << filename << ", "
+																			<< the_store().fNresumed << " of them resuming from earlier counts.";
+	return true;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::BackingStore::Close()                  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::BackingStore::Close() {
+	rb::Thread::Stop(kSyncThreadName);
+	rb::ScopedLock<rb::Mutex> lock(store_mutex());
+	MappedFile& store = the_store();
+	if(store.fFd < 0) return;
+	while(!store.fAttached.empty())
+		 Detach(const_cast<Base*>(store.fAttached.begin()->first), true);
+	store.GetHeader()->fClean = 1;
+	store.GetHeader()->fSyncTime = TTimeStamp().AsDouble();
+	store.Sync();
+	store.Close();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::BackingStore::IsOpen()               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::BackingStore::IsOpen() {
+	rb::ScopedLock<rb::Mutex> lock(store_mutex());
+	return the_store().fFd >= 0;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::BackingStore::Sync()                   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::BackingStore::Sync() {
+	// msync() waits for the disk, so it runs outside the lock: Attach() and Detach() (i.e. creating and
+	// deleting histograms) never wait for it. Segments are only ever unmapped by Close().
+	std::vector<Segment> segments;
+	{
+		rb::ScopedLock<rb::Mutex> lock(store_mutex());
+		MappedFile& store = the_store();
+		if(store.fFd < 0) return;
+		store.GetHeader()->fSyncTime = TTimeStamp().AsDouble();
+		segments = store.fSegments;
+	}
+	MappedFile::SyncSegments(segments);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::BackingStore::Attach()                 //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::BackingStore::Attach(rb::hist::Base* hist) {
+	rb::ScopedLock<rb::Mutex> lock(store_mutex());
+	MappedFile& store = the_store();
+	if(store.fFd < 0 || store.fAttached.count(hist)) return;
+	const std::string path = hist->GetPath();
+	if(path.size() >= std::string::size_type(kMaxPath)) {
+		err::Warning("rb::hist::BackingStore") << path << ": path too long, not keeping it in the store.";
+		return;
+	}
+
+	rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+	TH1* th1 = visit::hist::Cast::Do(hist->fHistVariant);
+	TArrayD* bins = dynamic_cast<TArrayD*>(th1);
+	if(!bins || !bins->fN) return;
+	if(th1->TestBit(TH1::kCanRebin)) { // filling out of range would reallocate (delete[]) the mapped bins
+		err::Warning("rb::hist::BackingStore") << path << ": its axes extend automatically, not keeping it in the store.";
+		return;
+	}
+	TArrayD* sumw2 = th1->GetSumw2N() == bins->fN ? th1->GetSumw2() : 0;
+
+	ULong64_t offset = 0;
+	Bool_t resume = false;
+	std::map<std::string, ULong64_t>::iterator it = store.fRecords.find(record_key(hist->GetEventCode(), path));
+	if(it != store.fRecords.end()) {
+		offset = it->second;
+		resume = store.Matches(store.GetRecord(offset), th1, bins, sumw2);
+		if(!resume) store.GetRecord(offset)->fState = kFree; // binning changed, start over
+		store.fRecords.erase(it);
+	}
+	if(!resume) {
+		offset = store.Allocate(record_length(th1, bins, sumw2));
+		if(!offset) return;
+		Record* record = store.GetRecord(offset);
+		memcpy(record->fPath, path.c_str(), path.size() + 1);
+		record->fEventCode = hist->GetEventCode();
+		record->fNdimensions = th1->GetDimension();
+		record->fNcells = bins->fN;
+		record->fHasSumw2 = sumw2 != 0;
+		for(Int_t i=0; i< 3; ++i) {
+			const TAxis* axis = get_axis(th1, i);
+			record->fNbins[i] = axis->GetNbins();
+			record->fLow[i] = axis->GetXmin();
+			record->fHigh[i] = axis->GetXmax();
+			if(axis->GetXbins()->fN) record->fVariable |= 1 << i;
+		}
+		for(Int_t i=0; i< 3; ++i) {
+			const TArrayD* edges = get_axis(th1, i)->GetXbins();
+			std::copy(edges->fArray, edges->fArray + edges->fN, store.GetEdges(record, i));
+		}
+		std::copy(bins->fArray, bins->fArray + bins->fN, store.GetCells(record));
+		if(sumw2) std::copy(sumw2->fArray, sumw2->fArray + sumw2->fN, store.GetSumw2(record));
+		__sync_synchronize(); // a crash before this point leaves a free record
+		record->fState = kLive;
+	}
+	Record* record = store.GetRecord(offset);
+	adopt(bins, store.GetCells(record));
+	if(sumw2) adopt(sumw2, store.GetSumw2(record));
+	if(resume) {
+		th1->ResetStats();
+		++store.fNresumed;
+	}
+	store.fAttached[hist] = offset;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::BackingStore::Detach()                 //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::BackingStore::Detach(rb::hist::Base* hist, Bool_t keep) {
+	rb::ScopedLock<rb::Mutex> lock(store_mutex());
+	MappedFile& store = the_store();
+	std::map<const Base*, ULong64_t>::iterator it = store.fAttached.find(hist);
+	if(it == store.fAttached.end()) return;
+	Record* record = store.GetRecord(it->second);
+
+	rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+	TH1* th1 = visit::hist::Cast::Do(hist->fHistVariant);
+	release(dynamic_cast<TArrayD*>(th1));
+	if(record->fHasSumw2) release(th1->GetSumw2());
+	if(keep) store.fRecords[record_key(hist->GetEventCode(), hist->GetPath())] = it->second;
+	else record->fState = kFree;
+	store.fAttached.erase(it);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::BackingStore::IsAttached()           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::BackingStore::IsAttached(const rb::hist::Base* hist) {
+	rb::ScopedLock<rb::Mutex> lock(store_mutex());
+	return the_store().fAttached.count(hist);
+}
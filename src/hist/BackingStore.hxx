@@ -0,0 +1,61 @@
+//! \file BackingStore.hxx
+//! \brief Defines a memory-mapped file holding the bins of every histogram, so that they survive crashes.
+#ifndef HIST_BACKING_STORE_HXX
+#define HIST_BACKING_STORE_HXX
+#include <Rtypes.h>
+
+namespace rb
+{
+namespace hist
+{
+class Base;
+
+/// \brief Keeps the bin contents of every histogram in a memory-mapped file.
+//! \details While the store is open, the bin (and sum of squared weights) arrays of every histogram
+//! are not allocated on the heap but live in a shared mapping of the file, next to a small record
+//! of the histogram's event, path and binning. Filling writes straight into the page cache, so the counts
+//! survive the analyzer crashing (whatever was filled up to the crash is in the file), and a thread
+//! (named "HistSync") msync()s the file periodically so they also survive the host going down, up
+//! to the last sync.
+//!
+//! When the store is opened again after a crash or restart, every histogram whose event, path and binning
+//! match a record in the file takes over that record's counts, so accumulation resumes where it
+//! stopped without reprocessing anything; the statistics (means, entries etc.) are recomputed from
+//! the contents. Histograms created while the store is open are matched the same way.
+//!
+//! Histograms whose axes extend automatically (TH1::kCanRebin) are never moved into the store,
+//! since filling them out of range reallocates their bins.
+//!
+//! \warning The bins of a histogram in the store are not ROOT's to reallocate: anything that
+//! resizes them (TArrayD::Set()) would delete[] the mapping. While the store is open, don't call
+//! on a histogram in it SetBins(), Rebin() or RebinAxis() in place, SetBit(TH1::kCanRebin),
+//! LabelsDeflate(), LabelsInflate() or alphanumeric bin labels that add bins; close the store
+//! first, or delete and re-create the histogram.
+class BackingStore
+{
+public:
+	 /// Open (or create) \c filename and move the bins of every histogram into it.
+	 //! \param sync_period Time between msync() calls, in seconds
+	 //! \returns false if a store is already open or the file can't be used
+	 static Bool_t Open(const char* filename, Double_t sync_period);
+	 /// Sync the file, move the bins of every histogram back to the heap, and close the file.
+	 //! \details The records are kept, so opening the file again resumes from the current counts.
+	 static void Close();
+	 /// Is a store open?
+	 static Bool_t IsOpen();
+	 /// Write all changes to disk now.
+	 static void Sync();
+	 /// Move the bins of \c hist into the store, taking over the counts of a matching record
+	 //! \details Called by rb::hist::Manager whenever a histogram is added; does nothing if no store is open.
+	 static void Attach(Base* hist);
+	 /// Move the bins of \c hist back to the heap, deleting its record unless \c keep is true
+	 //! \details Called whenever a histogram is deleted; does nothing if \c hist isn't in the store.
+	 static void Detach(Base* hist, Bool_t keep = false);
+	 /// Are the bins of \c hist in the store?
+	 static Bool_t IsAttached(const Base* hist);
+};
+
+}
+}
+
+#endif
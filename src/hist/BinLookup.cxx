@@ -0,0 +1,87 @@
+//! \file BinLookup.cxx
+//! \brief Implements BinLookup.hxx
+#include <cmath>
+#include <algorithm>
+#include <TAxis.h>
+#include "hist/BinLookup.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::BinLookup                                   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+Double_t rb::hist::BinLookup::fgLog2Table[(1 << kLogTableBits) + 1];
+Double_t rb::hist::BinLookup::fgLog2Slope[1 << kLogTableBits];
+// Filled while the library loads, before any thread can build a lookup
+Bool_t rb::hist::BinLookup::fgLog2Init = rb::hist::BinLookup::InitLog2();
+
+namespace
+{
+// Relative tolerance for deciding that edges are logarithmically spaced
+const Double_t kLogTolerance = 1e-9;
+
+// Check for a constant ratio between successive edges
+Bool_t is_log(Int_t nbins, const Double_t* edges) {
+	if(nbins < 2 || edges[0] <= 0) return false;
+	const Double_t ratio = edges[1] / edges[0];
+	for(Int_t i=1; i< nbins; ++i) {
+		if(std::fabs(edges[i+1] / edges[i] - ratio) > kLogTolerance * ratio) return false;
+	}
+	return true;
+}
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::BinLookup::InitLog2() [static]       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::BinLookup::InitLog2() {
+	const Int_t n = 1 << kLogTableBits;
+	for(Int_t i=0; i<= n; ++i)
+		 fgLog2Table[i] = std::log(1. + Double_t(i) / n) / std::log(2.);
+	for(Int_t i=0; i< n; ++i)
+		 fgLog2Slope[i] = (fgLog2Table[i+1] - fgLog2Table[i]) * n;
+	return true;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor                                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::BinLookup::BinLookup(Int_t nbins, const Double_t* edges):
+	fEdges(edges, edges + nbins + 1), fNbins(nbins), fIsLog(is_log(nbins, edges)),
+	fScale(0), fLogLow(0)
+{
+	if(fIsLog) {
+		fLogLow = std::log(edges[0]) / std::log(2.);
+		fScale = nbins / (std::log(edges[nbins]) / std::log(2.) - fLogLow);
+		return;
+	}
+
+	// Grid no coarser than the narrowest bin, so each cell holds at most one edge
+	Double_t width = edges[nbins] - edges[0];
+	for(Int_t i=0; i< nbins; ++i) {
+		if(edges[i+1] - edges[i] < width) width = edges[i+1] - edges[i];
+	}
+	Double_t ncells = std::ceil((edges[nbins] - edges[0]) / width);
+	if(!(ncells >= 1)) ncells = 1;
+	if(ncells > kMaxCells) ncells = kMaxCells;
+	fScale = ncells / (edges[nbins] - edges[0]);
+
+	fCells.resize(Int_t(ncells));
+	Int_t bin = 1;
+	for(Int_t k=0; k< Int_t(fCells.size()); ++k) {
+		const Double_t low = edges[0] + k / fScale;
+		while(bin < nbins && low >= edges[bin]) ++bin;
+		fCells[k] = bin;
+	}
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::BinLookup::Matches()                 //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::BinLookup::Matches(const TAxis* axis) const {
+	if(axis->GetNbins() != fNbins) return false;
+	const TArrayD* edges = axis->GetXbins();
+	if(edges->GetSize() != fNbins + 1) return false; // uniform now
+	return std::equal(fEdges.begin(), fEdges.end(), edges->GetArray());
+}
@@ -0,0 +1,111 @@
+//! \file BinLookup.hxx
+//! \brief Defines a class for constant-time bin lookup on variable-width axes.
+#ifndef HIST_BIN_LOOKUP_HXX
+#define HIST_BIN_LOOKUP_HXX
+#include <vector>
+#include <cstring>
+#include <Rtypes.h>
+
+class TAxis;
+
+namespace rb
+{
+namespace hist
+{
+/// \brief Finds the bin containing a value on an axis with arbitrary bin edges.
+//! \details ROOT's TAxis::FindBin() does a binary search for variable-width axes. This class
+//! replaces that with a constant-time lookup that gives exactly the same answer:
+//!  - For logarithmic edges, the bin is estimated from log2(x), which is computed from the
+//!    exponent and mantissa bits of \c x with a small interpolation table.
+//!  - For any other edges, a table over a fine uniform grid (no coarser than the narrowest bin)
+//!    gives the bin containing each grid cell's lower edge.
+//!
+//! In both cases the estimate is then checked against the exact edges, which takes one comparison
+//! in practice. Bin numbering follows the ROOT convention: 0 is underflow, 1 - n are the regular
+//! bins and n+1 is overflow.
+class BinLookup
+{
+public:
+	 /// Maximum size of the uniform grid table
+	 static const Int_t kMaxCells = 1 << 16;
+	 /// Number of mantissa bits used to index the log2 interpolation table
+	 static const Int_t kLogTableBits = 8;
+private:
+	 /// Bin edges (n+1 entries)
+	 std::vector<Double_t> fEdges;
+	 /// Number of bins
+	 Int_t fNbins;
+	 /// Are the edges logarithmically spaced?
+	 Bool_t fIsLog;
+	 /// Grid scale: number of grid cells (or bins, for log axes) per unit x (or log2(x))
+	 Double_t fScale;
+	 /// log2 of the low edge (log axes only)
+	 Double_t fLogLow;
+	 /// Bin containing the low edge of each grid cell (non-log axes only)
+	 std::vector<Int_t> fCells;
+	 /// log2(1 + i/2^kLogTableBits)
+	 static Double_t fgLog2Table[(1 << kLogTableBits) + 1];
+	 /// Slope of log2 between successive table entries
+	 static Double_t fgLog2Slope[1 << kLogTableBits];
+	 /// Has the log2 table been filled? (set during static initialization)
+	 static Bool_t fgLog2Init;
+public:
+	 /// Build the lookup tables from \c nbins and an array of \c nbins + 1 edges
+	 BinLookup(Int_t nbins, const Double_t* edges);
+	 /// Return the bin number containing \c x
+	 Int_t Find(Double_t x) const;
+	 /// Return the number of bins
+	 Int_t GetNbins() const { return fNbins; }
+	 /// Are the bins logarithmic?
+	 Bool_t IsLog() const { return fIsLog; }
+	 /// Check that \c axis still has the binning this lookup was built for
+	 Bool_t Matches(const TAxis* axis) const;
+	 /// Fast approximation of log2(x) for positive, normal \c x
+	 static Double_t FastLog2(Double_t x);
+private:
+	 /// Move an estimated bin onto the exact bin containing \c x
+	 Int_t Correct(Double_t x, Int_t bin) const;
+	 /// Fill the log2 interpolation table, returns true
+	 static Bool_t InitLog2();
+};
+}
+}
+
+
+// ========= Inlined Functions ========= //
+inline Double_t rb::hist::BinLookup::FastLog2(Double_t x) {
+	ULong64_t bits;
+	std::memcpy(&bits, &x, sizeof(x));
+	const Int_t exponent = Int_t((bits >> 52) & 0x7ff) - 1023;
+	const UInt_t index = UInt_t(bits >> (52 - kLogTableBits)) & ((1 << kLogTableBits) - 1);
+	bits = (bits & ((ULong64_t(1) << 52) - 1)) | (ULong64_t(1023) << 52);
+	Double_t mantissa; // in [1, 2)
+	std::memcpy(&mantissa, &bits, sizeof(bits));
+	const Double_t m0 = 1. + Double_t(index) / (1 << kLogTableBits);
+	return exponent + fgLog2Table[index] + (mantissa - m0) * fgLog2Slope[index];
+}
+
+inline Int_t rb::hist::BinLookup::Correct(Double_t x, Int_t bin) const {
+	while(bin < fNbins && x >= fEdges[bin]) ++bin;
+	while(bin > 1 && x < fEdges[bin-1]) --bin;
+	return bin;
+}
+
+inline Int_t rb::hist::BinLookup::Find(Double_t x) const {
+	if(x < fEdges[0]) return 0;
+	if(!(x < fEdges[fNbins])) return fNbins + 1;
+	Int_t bin;
+	if(fIsLog) {
+		bin = 1 + Int_t((FastLog2(x) - fLogLow) * fScale);
+		if(bin < 1) bin = 1;
+		else if(bin > fNbins) bin = fNbins;
+	}
+	else {
+		Int_t cell = Int_t((x - fEdges[0]) * fScale);
+		if(cell >= Int_t(fCells.size())) cell = fCells.size() - 1;
+		bin = fCells[cell];
+	}
+	return Correct(x, bin);
+}
+
+#endif
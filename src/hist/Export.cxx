@@ -0,0 +1,436 @@
+//! \file Export.cxx
+//! \brief Implements Export.hxx
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <TSystem.h>
+#include <TTimeStamp.h>
+#include "hist/Export.hxx"
+#include "utils/Thread.hxx"
+#include "utils/Affinity.hxx"
+#include "utils/Error.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Utility functions & classes                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace
+{
+/// Name of the exporter thread
+const char* kExportThreadName = "HistExport";
+
+/// Longest the exporter thread sleeps between checks of whether it has been stopped (ms)
+const Int_t kMaxSleep = 100;
+
+/// Number of times ExportReader::Read() tries to get a consistent copy
+const Int_t kMaxTries = 100;
+
+/// Offset of the first shm::Entry
+const ULong64_t kEntries = sizeof(rb::hist::shm::Header);
+
+/// Copy a string into a fixed size, null terminated field
+inline void copy_name(char* field, const std::string& str) {
+	const std::string::size_type n = std::min<std::string::size_type>(str.size(), rb::hist::shm::kMaxName - 1);
+	memcpy(field, str.data(), n);
+	memset(field + n, 0, rb::hist::shm::kMaxName - n);
+}
+
+/// Does \c entry (at the start of \c base) describe the same histogram as \c snapshot?
+inline Bool_t same_definition(const char* base, const rb::hist::shm::Entry& entry, const rb::hist::Snapshot& snapshot) {
+	if(entry.fNdimensions != snapshot.fNdimensions || entry.fNcells != snapshot.fBins.size() ||
+		 snapshot.fPath.compare(0, rb::hist::shm::kMaxName - 1, entry.fPath) ||
+		 snapshot.fTitle.compare(0, rb::hist::shm::kMaxName - 1, entry.fTitle)) return false;
+	for(Int_t i=0; i< 3; ++i) {
+		if(entry.fNbins[i] != snapshot.fNbins[i] || entry.fLow[i] != snapshot.fLow[i] ||
+			 entry.fHigh[i] != snapshot.fHigh[i] || (entry.fEdges[i] != 0) != !snapshot.fEdges[i].empty())
+			 return false;
+		if(entry.fEdges[i] &&
+			 !std::equal(snapshot.fEdges[i].begin(), snapshot.fEdges[i].end(),
+									 reinterpret_cast<const Double_t*>(base + entry.fEdges[i])))
+			 return false;
+	}
+	return true;
+}
+
+/// Unlink \c segment if it was left behind by an exporter that has stopped.
+//! \returns false if it is still in use, or isn't an exporter's segment at all
+Bool_t remove_stale(const char* segment) {
+	const int fd = shm_open(segment, O_RDONLY, 0);
+	if(fd < 0) return errno == ENOENT; // removed meanwhile
+	Bool_t stale = false;
+	struct stat status;
+	if(fstat(fd, &status) == 0 && status.st_size >= (off_t)sizeof(rb::hist::shm::Header)) {
+		void* map = mmap(0, sizeof(rb::hist::shm::Header), PROT_READ, MAP_SHARED, fd, 0);
+		if(map != MAP_FAILED) {
+			const rb::hist::shm::Header* header = static_cast<const rb::hist::shm::Header*>(map);
+			stale = !memcmp(header->fMagic, rb::hist::shm::kMagic, sizeof(header->fMagic)) && header->fClosed;
+			munmap(map, sizeof(rb::hist::shm::Header));
+		}
+	}
+	close(fd);
+	return stale && shm_unlink(segment) == 0;
+}
+
+/// Thread doing all of the exporter's work.
+class ExportThread: public rb::Thread
+{
+private:
+	 //! Name of the segment
+	 std::string fSegment;
+	 //! Shared memory file descriptor
+	 int fFd;
+	 //! Mapping of the segment
+	 char* fMap;
+	 //! Size of the segment
+	 ULong64_t fCapacity;
+	 //! Time between publications (seconds)
+	 Double_t fPeriod;
+	 //! Last serial handed out
+	 ULong64_t fSerial;
+
+	 ExportThread(const std::string& segment, int fd, char* map, ULong64_t capacity, Double_t period):
+		 rb::Thread(kExportThreadName, rb::Affinity::kCanvas),
+		 fSegment(segment), fFd(fd), fMap(map), fCapacity(capacity), fPeriod(period), fSerial(0) { }
+	 rb::hist::shm::Header* GetHeader() { return reinterpret_cast<rb::hist::shm::Header*>(fMap); }
+	 rb::hist::shm::Entry* GetEntry(UInt_t i) { return reinterpret_cast<rb::hist::shm::Entry*>(fMap + kEntries) + i; }
+	 //! Enlarge the segment to hold at least \c size bytes
+	 Bool_t Grow(ULong64_t size);
+	 //! Copy \c snapshots into the segment
+	 void Publish(const std::vector<rb::hist::Snapshot>& snapshots, Double_t time);
+public:
+	 ~ExportThread() {
+		 rb::hist::shm::Header* header = GetHeader();
+		 ++header->fSequence;
+		 __sync_synchronize();
+		 header->fClosed = 1;
+		 __sync_synchronize();
+		 ++header->fSequence;
+		 munmap(fMap, fCapacity);
+		 close(fFd);
+		 shm_unlink(fSegment.c_str());
+	 }
+	 static Bool_t CreateAndRun(const char* segment, Double_t period);
+	 void DoInThread();
+};
+
+Bool_t ExportThread::CreateAndRun(const char* segment, Double_t period) {
+	// Exclusive, so a segment another exporter is publishing to is never truncated under its readers
+	int fd = shm_open(segment, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if(fd < 0 && errno == EEXIST) {
+		if(!remove_stale(segment)) {
+			err::Error("rb::hist::Export::Start") << "The shared memory segment " << segment << " is in use by "
+																						<< "another exporter; remove /dev/shm" << (segment[0] == '/' ? "" : "/")
+																						<< segment << " if that one is dead.";
+			return false;
+		}
+		fd = shm_open(segment, O_RDWR | O_CREAT | O_EXCL, 0644);
+	}
+	const ULong64_t capacity = 4096;
+	void* map = MAP_FAILED;
+	if(fd >= 0 && ftruncate(fd, capacity) == 0)
+		 map = mmap(0, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if(map == MAP_FAILED) {
+		err::Error("rb::hist::Export::Start") << "Couldn't create the shared memory segment " << segment
+																					<< ": " << strerror(errno);
+		if(fd >= 0) {
+			close(fd);
+			shm_unlink(segment);
+		}
+		return false;
+	}
+	rb::hist::shm::Header* header = static_cast<rb::hist::shm::Header*>(map);
+	memcpy(header->fMagic, rb::hist::shm::kMagic, sizeof(header->fMagic));
+	header->fFormat = rb::hist::shm::kFormat;
+	header->fSequence = 2; // so that ExportReader::BeginRead() can use 0 for failure
+	header->fSize = kEntries;
+
+	ExportThread* exporter = new ExportThread(segment, fd, static_cast<char*>(map), capacity, period);
+	exporter->Run();
+	return true;
+}
+
+Bool_t ExportThread::Grow(ULong64_t size) {
+	const ULong64_t capacity = std::max(size, 2 * fCapacity);
+	if(ftruncate(fFd, capacity) < 0) {
+		err::Error("rb::hist::Export") << "Couldn't enlarge the shared memory segment to " << capacity
+																	 << " bytes: " << strerror(errno);
+		return false;
+	}
+	void* map = mmap(0, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fFd, 0);
+	if(map == MAP_FAILED) {
+		err::Error("rb::hist::Export") << "Couldn't map " << capacity << " bytes: " << strerror(errno);
+		return false;
+	}
+	munmap(fMap, fCapacity);
+	fMap = static_cast<char*>(map);
+	fCapacity = capacity;
+	return true;
+}
+
+void ExportThread::Publish(const std::vector<rb::hist::Snapshot>& snapshots, Double_t time) {
+	rb::hist::shm::Header* header = GetHeader();
+	const UInt_t nhists = snapshots.size();
+	Bool_t redefine = header->fNhists != nhists;
+	for(UInt_t i=0; i< nhists && !redefine; ++i)
+		 redefine = !same_definition(fMap, *GetEntry(i), snapshots[i]);
+
+	ULong64_t size = header->fSize;
+	if(redefine) {
+		size = kEntries + nhists * sizeof(rb::hist::shm::Entry);
+		for(UInt_t i=0; i< nhists; ++i) {
+			size += snapshots[i].fBins.size() * sizeof(Double_t);
+			for(Int_t j=0; j< 3; ++j) size += snapshots[i].fEdges[j].size() * sizeof(Double_t);
+		}
+		if(size > fCapacity && !Grow(size)) return;
+		header = GetHeader();
+	}
+
+	++header->fSequence;
+	__sync_synchronize();
+	if(redefine) {
+		ULong64_t offset = kEntries + nhists * sizeof(rb::hist::shm::Entry);
+		for(UInt_t i=0; i< nhists; ++i) {
+			const rb::hist::Snapshot& snapshot = snapshots[i];
+			rb::hist::shm::Entry* entry = GetEntry(i);
+			copy_name(entry->fPath, snapshot.fPath);
+			copy_name(entry->fTitle, snapshot.fTitle);
+			entry->fNdimensions = snapshot.fNdimensions;
+			for(Int_t j=0; j< 3; ++j) {
+				entry->fNbins[j] = snapshot.fNbins[j];
+				entry->fLow[j] = snapshot.fLow[j];
+				entry->fHigh[j] = snapshot.fHigh[j];
+				entry->fEdges[j] = snapshot.fEdges[j].empty() ? 0 : offset;
+				std::copy(snapshot.fEdges[j].begin(), snapshot.fEdges[j].end(), reinterpret_cast<Double_t*>(fMap + offset));
+				offset += snapshot.fEdges[j].size() * sizeof(Double_t);
+			}
+			entry->fBins = offset;
+			entry->fNcells = snapshot.fBins.size();
+			offset += snapshot.fBins.size() * sizeof(Double_t);
+		}
+		header->fNhists = nhists;
+		header->fSize = size;
+		++header->fVersion;
+	}
+	for(UInt_t i=0; i< nhists; ++i) {
+		const rb::hist::Snapshot& snapshot = snapshots[i];
+		rb::hist::shm::Entry* entry = GetEntry(i);
+		Double_t* bins = reinterpret_cast<Double_t*>(fMap + entry->fBins);
+		if(redefine || entry->fEntries != snapshot.fEntries ||
+			 !std::equal(snapshot.fBins.begin(), snapshot.fBins.end(), bins)) {
+			std::copy(snapshot.fBins.begin(), snapshot.fBins.end(), bins);
+			entry->fSerial = ++fSerial;
+		}
+		entry->fEntries = snapshot.fEntries;
+		std::copy(snapshot.fStats, snapshot.fStats + rb::hist::Snapshot::kNstats, entry->fStats);
+	}
+	header->fTime = time;
+	__sync_synchronize();
+	++header->fSequence;
+}
+
+void ExportThread::DoInThread() {
+	const Int_t sleep = std::min<Int_t>(kMaxSleep, std::max<Int_t>(1, Int_t(fPeriod * 1e3)));
+	Double_t published = 0;
+	while(!IsCancelled()) {
+		const Double_t now = TTimeStamp().AsDouble();
+		if(now - published < fPeriod) {
+			gSystem->Sleep(sleep);
+			continue;
+		}
+		published = now;
+		std::vector<rb::hist::Snapshot> snapshots;
+		rb::hist::SnapshotAll(snapshots);
+		Publish(snapshots, now);
+	}
+}
+
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::Export                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::Export::Start()                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Export::Start(const char* name, Double_t period) {
+	if(IsRunning()) {
+		err::Error("rb::hist::Export::Start") << "Histograms are already being exported.";
+		return false;
+	}
+	if(!ExportThread::CreateAndRun(name, period)) return false;
+	err::Info("rb::hist::Export") << "Publishing histograms to shared memory segment " << name
+																<< " every " << period << " seconds.";
+	return true;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Export::Stop()                         //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Export::Stop() {
+	rb::Thread::Stop(kExportThreadName);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::Export::IsRunning()                  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Export::IsRunning() {
+	return rb::Thread::IsRunning(kExportThreadName);
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::ExportReader                                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor                                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::ExportReader::ExportReader(): fFd(-1), fMap(0), fMapped(0) { }
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Destructor                                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::ExportReader::~ExportReader() {
+	Close();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::ExportReader::Open()                 //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::ExportReader::Open(const char* name) {
+	Close();
+	fName = name;
+	fFd = shm_open(name, O_RDONLY, 0);
+	if(fFd < 0 || !Remap()) {
+		err::Error("rb::hist::ExportReader::Open") << "Couldn't map shared memory segment " << name
+																							 << ": " << strerror(errno);
+		Close();
+		return false;
+	}
+	if(memcmp(GetHeader()->fMagic, shm::kMagic, sizeof(shm::kMagic)) || GetHeader()->fFormat != shm::kFormat) {
+		err::Error("rb::hist::ExportReader::Open") << name << " is not a histogram segment of format "
+																							 << shm::kFormat << ".";
+		Close();
+		return false;
+	}
+	return true;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::ExportReader::Close()                  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::ExportReader::Close() {
+	if(fMap) munmap(fMap, fMapped);
+	if(fFd >= 0) close(fFd);
+	fMap = 0;
+	fMapped = 0;
+	fFd = -1;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::ExportReader::Remap()                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::ExportReader::Remap() {
+	if(fMap && GetHeader()->fSize <= fMapped) return true;
+	struct stat status;
+	if(fFd < 0 || fstat(fFd, &status) < 0 || ULong64_t(status.st_size) < sizeof(shm::Header)) return false;
+	void* map = mmap(0, status.st_size, PROT_READ, MAP_SHARED, fFd, 0);
+	if(map == MAP_FAILED) return false;
+	if(fMap) munmap(fMap, fMapped);
+	fMap = map;
+	fMapped = status.st_size;
+	return true;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// ULong64_t rb::hist::ExportReader::BeginRead()         //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+ULong64_t rb::hist::ExportReader::BeginRead() {
+	if(!fMap) return 0;
+	ULong64_t sequence;
+	while((sequence = GetHeader()->fSequence) & 1) {
+		if(GetHeader()->fClosed) return 0; // exporter died mid-publication
+		usleep(100);
+	}
+	__sync_synchronize();
+	return Remap() ? sequence : 0;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::ExportReader::EndRead()              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::ExportReader::EndRead(ULong64_t sequence) const {
+	__sync_synchronize();
+	return fMap && GetHeader()->fSequence == sequence;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// const shm::Entry* rb::hist::ExportReader::GetEntry()  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+const rb::hist::shm::Entry* rb::hist::ExportReader::GetEntry(UInt_t i) const {
+	const ULong64_t offset = kEntries + ULong64_t(i) * sizeof(shm::Entry);
+	if(!fMap || i >= GetHeader()->fNhists || offset + sizeof(shm::Entry) > fMapped) return 0;
+	return reinterpret_cast<const shm::Entry*>(static_cast<const char*>(fMap) + offset);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// const Double_t* rb::hist::ExportReader::GetData()     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+const Double_t* rb::hist::ExportReader::GetData(ULong64_t offset) const {
+	if(!fMap || offset < kEntries || offset >= fMapped) return 0;
+	return reinterpret_cast<const Double_t*>(static_cast<const char*>(fMap) + offset);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::ExportReader::Read()                 //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::ExportReader::Read(std::vector<Snapshot>& snapshots, ULong64_t* version) {
+	for(Int_t attempt = 0; attempt< kMaxTries; ++attempt) {
+		const ULong64_t sequence = BeginRead();
+		if(!sequence) return false;
+		const UInt_t nhists = GetHeader()->fNhists;
+		const ULong64_t catalogue = GetHeader()->fVersion;
+		snapshots.resize(nhists);
+		Bool_t good = true;
+		for(UInt_t i=0; i< nhists && good; ++i) {
+			const shm::Entry* entry = GetEntry(i);
+			const Double_t* bins = entry ? GetData(entry->fBins) : 0;
+			good = bins && entry->fBins + entry->fNcells * sizeof(Double_t) <= fMapped &&
+				 entry->fNdimensions >= 1 && entry->fNdimensions <= 3;
+			if(!good) break;
+			Snapshot& snapshot = snapshots[i];
+			snapshot.fPath.assign(entry->fPath, strnlen(entry->fPath, shm::kMaxName));
+			snapshot.fTitle.assign(entry->fTitle, strnlen(entry->fTitle, shm::kMaxName));
+			snapshot.fNdimensions = entry->fNdimensions;
+			for(Int_t j=0; j< 3 && good; ++j) {
+				snapshot.fNbins[j] = entry->fNbins[j];
+				snapshot.fLow[j] = entry->fLow[j];
+				snapshot.fHigh[j] = entry->fHigh[j];
+				snapshot.fEdges[j].clear();
+				if(!entry->fEdges[j]) continue;
+				const Double_t* edges = GetData(entry->fEdges[j]);
+				good = edges && entry->fNbins[j] >= 0 &&
+					 entry->fEdges[j] + (entry->fNbins[j] + 1) * sizeof(Double_t) <= fMapped;
+				if(good) snapshot.fEdges[j].assign(edges, edges + entry->fNbins[j] + 1);
+			}
+			snapshot.fBins.assign(bins, bins + entry->fNcells);
+			snapshot.fSumw2.clear();
+			std::copy(entry->fStats, entry->fStats + Snapshot::kNstats, snapshot.fStats);
+			snapshot.fEntries = entry->fEntries;
+		}
+		if(good && EndRead(sequence)) {
+			if(version) *version = catalogue;
+			return true;
+		}
+	}
+	err::Error("rb::hist::ExportReader::Read") << "Couldn't get a consistent copy of " << fName << ".";
+	return false;
+}
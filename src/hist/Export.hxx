@@ -0,0 +1,151 @@
+//! \file Export.hxx
+//! \brief Defines the publishing of histogram snapshots in POSIX shared memory, and a reader for them.
+#ifndef HIST_EXPORT_HXX
+#define HIST_EXPORT_HXX
+#include <string>
+#include <vector>
+#include "hist/Snapshot.hxx"
+
+namespace rb
+{
+namespace hist
+{
+/// Layout of the shared memory segment written by Export.
+//! \details The segment starts with a Header, followed by Header::fNhists Entry structures,
+//! followed by the cell contents and bin edges they point to (as offsets from the start of the
+//! segment). Everything is in the byte order of the host.
+//!
+//! The exporter bumps Header::fSequence to an odd number before changing anything and to the next
+//! even number when done, so a reader gets a consistent view by reading fSequence, reading whatever
+//! it needs, and checking that fSequence is the same even number as before (see ExportReader).
+namespace shm
+{
+/// Identifies the segment
+static const char kMagic[8] = "RBHIST";
+/// Version of the layout, changed whenever the structures below are
+static const UInt_t kFormat = 1;
+/// Size of the path and title fields (including the terminating null)
+static const Int_t kMaxName = 128;
+
+/// Start of the segment
+struct Header
+{
+	 //! kMagic
+	 char fMagic[8];
+	 //! kFormat
+	 UInt_t fFormat;
+	 //! Number of histograms
+	 UInt_t fNhists;
+	 //! Odd while the exporter is writing
+	 volatile ULong64_t fSequence;
+	 //! Changes whenever histograms are created, deleted or redefined (i.e. the Entry table changes)
+	 ULong64_t fVersion;
+	 //! Bytes in use; readers must remap if this exceeds what they have mapped
+	 ULong64_t fSize;
+	 //! Time of the last publication (seconds since the epoch)
+	 Double_t fTime;
+	 //! Non-zero once the exporter has stopped; nothing will be published anymore
+	 UInt_t fClosed;
+	 //! Padding
+	 UInt_t fReserved;
+};
+
+/// Description of one histogram
+struct Entry
+{
+	 //! Directory path and name, e.g. "/adc/adc0" (truncated to kMaxName - 1 characters)
+	 char fPath[kMaxName];
+	 //! Title (truncated to kMaxName - 1 characters)
+	 char fTitle[kMaxName];
+	 //! Number of dimensions (1-3)
+	 Int_t fNdimensions;
+	 //! Number of bins on each axis
+	 Int_t fNbins[3];
+	 //! Lower edge of each axis
+	 Double_t fLow[3];
+	 //! Upper edge of each axis
+	 Double_t fHigh[3];
+	 //! Offset of each axis' <tt>fNbins + 1</tt> bin edges, 0 for uniform axes
+	 ULong64_t fEdges[3];
+	 //! Offset of the cell contents (see Snapshot::fBins)
+	 ULong64_t fBins;
+	 //! Number of cells
+	 ULong64_t fNcells;
+	 //! Changes whenever the contents do
+	 ULong64_t fSerial;
+	 //! Number of entries
+	 Double_t fEntries;
+	 //! Statistics (see TH1::GetStats())
+	 Double_t fStats[Snapshot::kNstats];
+};
+}
+
+/// \brief Publishes snapshots of every histogram in a POSIX shared memory segment.
+//! \details A thread (named "HistExport") snapshots every histogram once per period (see
+//! SnapshotAll()) and copies them into the segment, so viewer processes on the same host can
+//! map it and draw straight from it, without any copying through sockets and without ever
+//! touching the analyzer's locks. See rb::hist::shm for the layout.
+class Export
+{
+public:
+	 /// Create the shared memory segment \c name and start publishing to it.
+	 //! \param name Name of the segment (see shm_open()), e.g. "/rootbeer"
+	 //! \param period Time between publications, in seconds
+	 //! \returns false if the exporter is already running, or the segment can't be created or is in use by
+	 //! another exporter (a segment left behind by a stopped one is replaced)
+	 static Bool_t Start(const char* name, Double_t period);
+	 /// Stop publishing, marking the segment closed and removing its name.
+	 //! \details Viewers that have it mapped can keep reading the last publication.
+	 static void Stop();
+	 /// Is the exporter running?
+	 static Bool_t IsRunning();
+};
+
+/// \brief Viewer side of Export.
+class ExportReader
+{
+private:
+	 //! Name of the segment
+	 std::string fName;
+	 //! Shared memory file descriptor, -1 if not open
+	 Int_t fFd;
+	 //! Mapping of the segment
+	 void* fMap;
+	 //! Size of fMap
+	 ULong64_t fMapped;
+	 //! Make sure the whole of the segment in use is mapped
+	 Bool_t Remap();
+public:
+	 /// Not open
+	 ExportReader();
+	 /// Closes
+	 ~ExportReader();
+	 /// Map the segment \c name (read only)
+	 Bool_t Open(const char* name);
+	 /// Unmap the segment
+	 void Close();
+	 /// Is a segment mapped?
+	 Bool_t IsOpen() const { return fMap != 0; }
+	 /// Start reading directly from the segment.
+	 //! \details Waits for the exporter to finish any publication in progress, and remaps if it grew.
+	 //! \returns the sequence number to pass to EndRead(), or 0 if the segment isn't usable
+	 ULong64_t BeginRead();
+	 /// Check that nothing was published since BeginRead() returned \c sequence.
+	 //! \returns false if whatever was read in between has to be read again
+	 Bool_t EndRead(ULong64_t sequence) const;
+	 /// The header, for use between BeginRead() and EndRead()
+	 const shm::Header* GetHeader() const { return static_cast<const shm::Header*>(fMap); }
+	 /// Entry \c i, for use between BeginRead() and EndRead()
+	 const shm::Entry* GetEntry(UInt_t i) const;
+	 /// Pointer to the data at \c offset (see shm::Entry), for use between BeginRead() and EndRead()
+	 const Double_t* GetData(ULong64_t offset) const;
+	 /// Copy a consistent publication of every histogram into \c snapshots.
+	 //! \param version If not null, set to the catalogue version (see shm::Header::fVersion)
+	 //! \returns false if the segment isn't usable
+	 Bool_t Read(std::vector<Snapshot>& snapshots, ULong64_t* version = 0);
+};
+
+}
+}
+
+#endif
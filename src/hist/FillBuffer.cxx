@@ -0,0 +1,153 @@
+//! \file FillBuffer.cxx
+//! \brief Implements FillBuffer.hxx
+#include <algorithm>
+#include <TH1.h>
+#include <TH3.h>
+#include <TAxis.h>
+#include "hist/FillBuffer.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Helper Functions                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace
+{
+// Fill one point the ordinary way
+inline void fill_point(TH1* hist, Int_t ndim, const Double_t* c) {
+	switch(ndim) {
+	case 1:  hist->Fill(c[0]); break;
+	case 2:  hist->Fill(c[0], c[1]); break;
+	default: static_cast<TH3*>(hist)->Fill(c[0], c[1], c[2]); break;
+	}
+}
+// Check whether the batch path gives the same result as TH1::Fill
+inline Bool_t can_batch(TH1* hist, TAxis** axes, Int_t ndim) {
+	// Axis extension changes the binning during the fill
+	if(hist->TestBit(TH1::kCanRebin)) return false;
+	// With a zoomed axis, GetStats() recomputes from the bins instead of
+	// returning the running sums, so we can't add to them
+	for(Int_t d=0; d< ndim; ++d)
+		 if(axes[d]->TestBit(TAxis::kAxisRange)) return false;
+	return true;
+}
+// Point the lookups that still match the binning of \c axes into \c lookup
+inline void match_lookups(const std::vector<rb::hist::BinLookup>* lookups, TAxis** axes, Int_t ndim,
+													const rb::hist::BinLookup** lookup) {
+	if(!lookups || Int_t(lookups->size()) != ndim) return;
+	for(Int_t d=0; d< ndim; ++d)
+		 if(lookups->at(d).Matches(axes[d])) lookup[d] = &lookups->at(d);
+}
+// Global bin of the point \c c, setting \c in_range if it is inside every axis
+inline Int_t find_bin(TH1* hist, TAxis** axes, const rb::hist::BinLookup** lookup, Int_t ndim,
+											const Double_t* c, Bool_t& in_range) {
+	Int_t b[3] = {0, 0, 0};
+	in_range = true;
+	for(Int_t d=0; d< ndim; ++d) {
+		b[d] = lookup[d] ? lookup[d]->Find(c[d]) : axes[d]->FindFixBin(c[d]);
+		if(b[d] == 0 || b[d] > axes[d]->GetNbins()) in_range = false;
+	}
+	return hist->GetBin(b[0], b[1], b[2]);
+}
+// Add the point \c c (unit weight) to the statistics sums
+inline void add_stats(Double_t* stats, Int_t ndim, const Double_t* c) {
+	stats[0] += 1; stats[1] += 1;
+	stats[2] += c[0]; stats[3] += c[0]*c[0];
+	if(ndim > 1) {
+		stats[4] += c[1]; stats[5] += c[1]*c[1]; stats[6] += c[0]*c[1];
+	}
+	if(ndim > 2) {
+		stats[7] += c[2]; stats[8] += c[2]*c[2];
+		stats[9] += c[0]*c[2]; stats[10] += c[1]*c[2];
+	}
+}
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::FillBuffer                                  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Int_t rb::hist::FillBuffer::Flush()                   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::hist::FillBuffer::Flush(TH1* hist, const std::vector<BinLookup>* lookups) {
+	const Int_t npoints = GetSize();
+	if(!npoints || !hist) { Discard(); return 0; }
+
+	const Int_t ndim = hist->GetDimension();
+	TAxis* axes[3] = { hist->GetXaxis(), hist->GetYaxis(), hist->GetZaxis() };
+
+	if(!can_batch(hist, axes, ndim)) {
+		for(Int_t p=0; p< npoints; ++p) fill_point(hist, ndim, &fCoords[3*p]);
+		Discard();
+		return npoints;
+	}
+
+	const BinLookup* lookup[3] = {0, 0, 0};
+	match_lookups(lookups, axes, ndim, lookup);
+
+	// Locate bins and accumulate statistics for the whole batch
+	Double_t stats[TH1::kNstat];
+	std::fill(stats, stats + TH1::kNstat, 0.);
+	hist->GetStats(stats);
+	const Bool_t stat_overflows = TH1::GetStatOverflowsBehaviour();
+
+	std::vector<Int_t> bins;
+	bins.reserve(npoints);
+	for(Int_t p=0; p< npoints; ++p) {
+		const Double_t* c = &fCoords[3*p];
+		Bool_t in_range;
+		bins.push_back(find_bin(hist, axes, lookup, ndim, c, in_range));
+		if(in_range || stat_overflows) add_stats(stats, ndim, c);
+	}
+
+	// Increment bins in memory order, one call per distinct bin
+	std::sort(bins.begin(), bins.end());
+	TArrayD* sumw2 = hist->GetSumw2N() ? hist->GetSumw2() : 0;
+	for(std::vector<Int_t>::iterator it = bins.begin(); it != bins.end(); ) {
+		std::vector<Int_t>::iterator next = std::upper_bound(it, bins.end(), *it);
+		const Double_t count = next - it;
+		hist->AddBinContent(*it, count);
+		if(sumw2) sumw2->fArray[*it] += count;
+		it = next;
+	}
+
+	hist->PutStats(stats);
+	hist->SetEntries(hist->GetEntries() + npoints);
+	Discard();
+	return npoints;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Int_t rb::hist::FillBuffer::FillOne() [static]        //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::hist::FillBuffer::FillOne(TH1* hist, const std::vector<BinLookup>& lookups,
+																		Double_t x, Double_t y, Double_t z) {
+	if(!hist) return -1;
+	const Double_t c[3] = {x, y, z};
+	const Int_t ndim = hist->GetDimension();
+	TAxis* axes[3] = { hist->GetXaxis(), hist->GetYaxis(), hist->GetZaxis() };
+	const BinLookup* lookup[3] = {0, 0, 0};
+	match_lookups(&lookups, axes, ndim, lookup);
+	if(!can_batch(hist, axes, ndim) || !lookup[0]) { // nothing to gain over TH1::Fill
+		switch(ndim) {
+		case 1:  return hist->Fill(x);
+		case 2:  return hist->Fill(x, y);
+		default: return static_cast<TH3*>(hist)->Fill(x, y, z);
+		}
+	}
+
+	Bool_t in_range;
+	const Int_t bin = find_bin(hist, axes, lookup, ndim, c, in_range);
+	hist->AddBinContent(bin);
+	if(hist->GetSumw2N()) hist->GetSumw2()->fArray[bin] += 1;
+	if(in_range || TH1::GetStatOverflowsBehaviour()) {
+		Double_t stats[TH1::kNstat];
+		std::fill(stats, stats + TH1::kNstat, 0.);
+		hist->GetStats(stats);
+		add_stats(stats, ndim, c);
+		hist->PutStats(stats);
+	}
+	hist->SetEntries(hist->GetEntries() + 1);
+	return bin;
+}
@@ -0,0 +1,69 @@
+//! \file FillBuffer.hxx
+//! \brief Defines a class for deferring histogram fills.
+#ifndef HIST_FILL_BUFFER_HXX
+#define HIST_FILL_BUFFER_HXX
+#include <vector>
+#include <Rtypes.h>
+#include "hist/BinLookup.hxx"
+
+class TH1;
+
+namespace rb
+{
+namespace hist
+{
+/// \brief Buffer of pending fill coordinates.
+//! \details Used by rb::hist::Base in buffered fill mode. Instead of locating and
+//! incrementing a bin for every fill, the coordinates are appended to a small
+//! array. When the buffer is full (or when somebody wants to look at the histogram),
+//! Flush() applies all of the pending fills in one pass: the bins are computed, sorted
+//! so that memory is walked in order, incremented, and the histogram statistics are
+//! updated once for the whole batch.
+//! \note This class does no locking of its own; rb::hist::Base takes care of that.
+class FillBuffer
+{
+private:
+	 //! Pending coordinates, stored as (x, y, z) triplets
+	 std::vector<Double_t> fCoords;
+	 //! Maximum number of points held before a flush is required
+	 const UInt_t kCapacity;
+public:
+	 //! Sets the capacity and reserves storage
+	 FillBuffer(UInt_t capacity);
+	 //! Returns the maximum number of points that can be held
+	 UInt_t GetCapacity() const { return kCapacity; }
+	 //! Returns the number of pending points
+	 UInt_t GetSize() const { return fCoords.size() / 3; }
+	 //! Append a point, returns true if the buffer is now full
+	 Bool_t Push(Double_t x, Double_t y, Double_t z);
+	 //! Apply all pending points to \c hist and empty the buffer
+	 //! \param lookups Optional constant-time bin lookups, one per axis, used instead
+	 //!  of TAxis::FindFixBin() as long as they still match the histogram's binning.
+	 //! \returns The number of points applied
+	 Int_t Flush(TH1* hist, const std::vector<BinLookup>* lookups = 0);
+	 //! Fill one point into \c hist straight away, binned as Flush() would bin it
+	 //! \details For histograms with \c lookups that fill without a buffer.
+	 //! \returns The global bin filled, as TH1::Fill()
+	 static Int_t FillOne(TH1* hist, const std::vector<BinLookup>& lookups,
+												Double_t x, Double_t y, Double_t z);
+	 //! Throw away all pending points
+	 void Discard() { fCoords.clear(); }
+};
+}
+}
+
+
+// ========= Inlined Functions ========= //
+inline rb::hist::FillBuffer::FillBuffer(UInt_t capacity):
+	kCapacity(capacity > 0 ? capacity : 1) {
+	fCoords.reserve(3*kCapacity);
+}
+
+inline Bool_t rb::hist::FillBuffer::Push(Double_t x, Double_t y, Double_t z) {
+	fCoords.push_back(x);
+	fCoords.push_back(y);
+	fCoords.push_back(z);
+	return GetSize() >= kCapacity;
+}
+
+#endif
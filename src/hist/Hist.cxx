@@ -3,11 +3,16 @@
 #include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <TSystem.h>
+#include <TParameter.h>
 #include "boost/dynamic_bitset.hpp"
 #include "Hist.hxx"
+#include "hist/Snapshot.hxx"
+#include "hist/BackingStore.hxx"
 #include "Formula.hxx"
 #include "Rint.hxx"
 #include "Signals.hxx"
+#include "utils/Cycles.hxx"
 
 typedef std::vector<std::string> StringVector_t;
 
@@ -62,6 +67,21 @@ namespace
 		   << ndimensions << " dimensional histogram.";
     return par;
   }
+  // Copy an array's contents into a new allocation (see Base::Relocate())
+  inline void relocate(TArrayD* array) {
+    if(!array || !array->GetSize()) return;
+    const Int_t n = array->GetSize();
+    Double_t* fresh = new Double_t[n];
+    std::copy(array->GetArray(), array->GetArray() + n, fresh);
+    array->Adopt(n, fresh);
+  }
+  // Match the raster of TCutG gates on the histogram's own parameters to its binning
+  inline void set_cut_resolution(rb::TreeFormulae* gate, rb::TreeFormulae* params, TH1* hist) {
+    if(hist->GetDimension() != 2 || params->GetN() != 2) return;
+    TAxis* x = hist->GetXaxis(); TAxis* y = hist->GetYaxis();
+    gate->SetCutResolution(params->Get(0), (x->GetXmax() - x->GetXmin()) / x->GetNbins(),
+			   params->Get(1), (y->GetXmax() - y->GetXmin()) / y->GetNbins());
+  }
 }
 
 
@@ -71,6 +91,7 @@ namespace
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 
 Bool_t rb::hist::Base::fgOverwrite = false;
+Bool_t rb::hist::Base::fgNotify = true;
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // Constructor (1d)                                      //
@@ -79,7 +100,9 @@ rb::hist::Base::Base(const char* name, const char* title, const char* param, con
 		     hist::Manager* manager, Int_t event_code,
 		     Int_t nbinsx, Double_t xlow, Double_t xhigh):
   kEventCode(event_code), kDimensions(1), fManager(manager), fHistogramClone(0), kInitialParams(param), fParams(0), fGate(0),
-  fHistVariant(TH1D(name, title, nbinsx, xlow, xhigh))
+  fHistVariant(TH1D(name, title, nbinsx, xlow, xhigh)),
+  fPrescale(1), fMaxRate(0), fNpassed(0), fNfilled(0), fRateCredit(0), fRateTime(0),
+  fHandle(hist::Store::kNoHandle)
 { }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // Constructor (2d)                                      //
@@ -89,7 +112,9 @@ rb::hist::Base::Base(const char* name, const char* title, const char* param, con
 		     Int_t nbinsx, Double_t xlow, Double_t xhigh,
 		     Int_t nbinsy, Double_t ylow, Double_t yhigh):
   kEventCode(event_code), kDimensions(2), fManager(manager), fHistogramClone(0), kInitialParams(param), fParams(0), fGate(0),
-  fHistVariant(TH2D(name, title, nbinsx, xlow, xhigh, nbinsy, ylow, yhigh))
+  fHistVariant(TH2D(name, title, nbinsx, xlow, xhigh, nbinsy, ylow, yhigh)),
+  fPrescale(1), fMaxRate(0), fNpassed(0), fNfilled(0), fRateCredit(0), fRateTime(0),
+  fHandle(hist::Store::kNoHandle)
 { }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // Constructor (3d)                                      //
@@ -100,7 +125,32 @@ rb::hist::Base::Base(const char* name, const char* title, const char* param, con
 		     Int_t nbinsy, Double_t ylow, Double_t yhigh,
 		     Int_t nbinsz, Double_t zlow, Double_t zhigh):
   kEventCode(event_code), kDimensions(3), fManager(manager), fHistogramClone(0), kInitialParams(param), fParams(0), fGate(0),
-  fHistVariant(TH3D(name, title, nbinsx, xlow, xhigh, nbinsy, ylow, yhigh, nbinsz, zlow, zhigh))
+  fHistVariant(TH3D(name, title, nbinsx, xlow, xhigh, nbinsy, ylow, yhigh, nbinsz, zlow, zhigh)),
+  fPrescale(1), fMaxRate(0), fNpassed(0), fNfilled(0), fRateCredit(0), fRateTime(0),
+  fHandle(hist::Store::kNoHandle)
+{ }
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor (1d, variable bins)                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Base::Base(const char* name, const char* title, const char* param, const char* gate,
+		     hist::Manager* manager, Int_t event_code,
+		     Int_t nbinsx, const Double_t* xedges):
+  kEventCode(event_code), kDimensions(1), fManager(manager), fHistogramClone(0), kInitialParams(param), fParams(0), fGate(0),
+  fHistVariant(TH1D(name, title, nbinsx, xedges)),
+  fPrescale(1), fMaxRate(0), fNpassed(0), fNfilled(0), fRateCredit(0), fRateTime(0),
+  fHandle(hist::Store::kNoHandle)
+{ }
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor (2d, variable bins)                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Base::Base(const char* name, const char* title, const char* param, const char* gate,
+		     hist::Manager* manager, Int_t event_code,
+		     Int_t nbinsx, const Double_t* xedges,
+		     Int_t nbinsy, const Double_t* yedges):
+  kEventCode(event_code), kDimensions(2), fManager(manager), fHistogramClone(0), kInitialParams(param), fParams(0), fGate(0),
+  fHistVariant(TH2D(name, title, nbinsx, xedges, nbinsy, yedges)),
+  fPrescale(1), fMaxRate(0), fNpassed(0), fNfilled(0), fRateCredit(0), fRateTime(0),
+  fHandle(hist::Store::kNoHandle)
 { }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::hist::Base::Init()                           //
@@ -121,12 +171,13 @@ void rb::hist::Base::Init(const char* name, const char* title, const char* param
   // Set gate and parameters
   InitParams(param, event_code);
   InitGate(gate, event_code);
+  set_cut_resolution(fGate.get(), fParams.get(), visit::hist::Cast::Do(fHistVariant));
 
   // Add to ROOT container
   if(gDirectory) {
     fDirectory = gDirectory;
     fDirectory->Append(this, kTRUE);
-		if(gApp()->GetHistSignals()) gApp()->GetHistSignals()->NewOrDeleteHist();
+		if(fgNotify && gApp()->GetHistSignals()) gApp()->GetHistSignals()->HistAdded(this);
   }
   else {
     err::Warning("Hist::Init") << "gDirectory == 0; not adding to any ROOT collections.";
@@ -137,9 +188,11 @@ void rb::hist::Base::Init(const char* name, const char* title, const char* param
 // Destructor                                            //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 rb::hist::Base::~Base() {
+	// First, while still whole: from other threads this waits for the GUI to finish showing it
+	if(fgNotify && gApp()->GetHistSignals()) gApp()->GetHistSignals()->HistRemoved(this);
 	fManager->Remove(this); // locks TTHREAD_GLOBAL_MUTEX while running
+	hist::BackingStore::Detach(this);
 	Destruct();
-	if(gApp()->GetHistSignals()) gApp()->GetHistSignals()->NewOrDeleteHist();
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::hist::Base::InitParams()                     //
@@ -161,6 +214,8 @@ void rb::hist::Base::InitGate(const char* gate, Int_t event_code) {
 Int_t rb::hist::Base::Regate(const char* newgate) {
   Bool_t success = fGate->Change(0, newgate);
   if(!success) return -1;
+  set_cut_resolution(fGate.get(), fParams.get(), visit::hist::Cast::Do(fHistVariant));
+  fManager->Ungroup();
 
   // Change title if appropriate
   if(kUseDefaultTitle) {
@@ -173,6 +228,7 @@ Int_t rb::hist::Base::Regate(const char* newgate) {
 // rb::hist::Base::GetHist()                             //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 TH1* rb::hist::Base::GetHist() {
+  FlushFillBuffer();
   hist::StopAddDirectory stop_add;
   visit::hist::Clone::Do(fHistVariant, fHistogramClone);
   return fHistogramClone.get();
@@ -181,35 +237,326 @@ TH1* rb::hist::Base::GetHist() {
 // rb::hist::Base::DoFill() [virtual]                    //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 Int_t rb::hist::Base::DoFill(const std::vector<Double_t>& params) {
-  std::vector<Double_t> axes(params.begin(), params.end());
-  for(Int_t i=axes.size(); i< 3; ++i) axes.push_back(0);
-  return visit::hist::Fill::Do(fHistVariant, axes[0], axes[1], axes[2]);
+  Double_t axes[3] = {0,0,0};
+  for(UInt_t i=0; i< params.size() && i< 3; ++i) axes[i] = params[i];
+  return FillAxes(axes[0], axes[1], axes[2]);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::hist::Base::FillAxes()                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::hist::Base::FillAxes(Double_t x, Double_t y, Double_t z) {
+  if(hist::Manager::InParallelFill()) return FillAxesUnlocked(x, y, z);
+  rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  return FillAxesUnlocked(x, y, z);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::hist::Base::FillAxesUnlocked()                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::hist::Base::FillAxesUnlocked(Double_t x, Double_t y, Double_t z) {
+  if(!fFillBuffer) {
+    if(!fBinLookups.empty())
+      return hist::FillBuffer::FillOne(visit::hist::Cast::Do(fHistVariant), fBinLookups, x, y, z);
+    return visit::hist::FillUnlocked::Do(fHistVariant, x, y, z);
+  }
+
+  if(fFillBuffer->Push(x, y, z))
+    fFillBuffer->Flush(visit::hist::Cast::Do(fHistVariant), &fBinLookups);
+  return 1;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::hist::Base::SetFillBuffer()                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Base::SetFillBuffer(Int_t size) {
+  rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  FlushFillBuffer();
+  if(size > 0) fFillBuffer.reset(new hist::FillBuffer(size));
+  else fFillBuffer.reset(0);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::hist::Base::GetFillBuffer()                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::hist::Base::GetFillBuffer() {
+  rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  return fFillBuffer ? fFillBuffer->GetCapacity() : 0;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::hist::Base::FlushFillBuffer()                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Base::FlushFillBuffer() const {
+  rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  if(!fFillBuffer || !fFillBuffer->GetSize()) return;
+  HistVariant& variant = const_cast<HistVariant&>(fHistVariant);
+  fFillBuffer->Flush(visit::hist::Cast::Do(variant), &fBinLookups);
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // rb::hist::Base::FillUnlocked()                        //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 Int_t rb::hist::Base::FillUnlocked() {
-  Double_t gate = fGate->EvalUnlocked(0);
-  if(!Bool_t(gate)) return 0;
+  if(hist::Profiler::IsEnabled()) return FillProfiled(false);
   std::vector<Double_t> axes;
-  fParams->EvalAllUnlocked(axes);
+  if(!EvalGateUnlocked() || !EvalPassedUnlocked(axes)) return 0;
   return DoFill(axes);
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // rb::hist::Base::Fill() [locked data]                  //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 Int_t rb::hist::Base::Fill() {
+  if(hist::Profiler::IsEnabled()) return FillProfiled(true);
+  if(!EvalGate()) return 0;
+  return FillPassed();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::hist::Base::EvalGate()                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Base::EvalGate() {
   Double_t gate = fGate->Eval(0);
-  if(!Bool_t(gate)) return 0;
+  return Bool_t(gate);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::hist::Base::EvalGateUnlocked()                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Base::EvalGateUnlocked() {
+  Double_t gate = fGate->EvalUnlocked(0);
+  return Bool_t(gate);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::hist::Base::FillPassed()                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::hist::Base::FillPassed() {
+  if(!Sample()) return 0;
   std::vector<Double_t> axes;
   fParams->EvalAll(axes);
   return DoFill(axes);
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::hist::Base::EvalPassedUnlocked()                  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Base::EvalPassedUnlocked(std::vector<Double_t>& params) {
+  if(!Sample()) return false;
+  fParams->EvalAllUnlocked(params);
+  return true;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Base::Relocate()                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Base::Relocate() {
+  if(hist::BackingStore::IsAttached(this)) return; // the bins live in the store's file
+  rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  TH1* hist = visit::hist::Cast::Do(fHistVariant);
+  relocate(dynamic_cast<TArrayD*>(hist));
+  relocate(hist->GetSumw2());
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Base::TakeSnapshot()                   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Base::TakeSnapshot(hist::Snapshot& snapshot) {
+  FlushFillBuffer();
+  const std::string path = GetPath();
+  rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  snapshot.Take(visit::hist::Cast::Do(fHistVariant), path);
+  snapshot.fScaleFactor = GetScaleFactor();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// std::string rb::hist::Base::GetPath()                 //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+std::string rb::hist::Base::GetPath() const {
+  std::string path = "/";
+  path += GetName();
+  for(TDirectory* dir = fDirectory; dir && dir != gROOT; dir = dir->GetMotherDir())
+    path = "/" + std::string(dir->GetName()) + path;
+  return path;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Base::GetArraySizes()                  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Base::GetArraySizes(Int_t& ncells, Int_t& nsumw2) const {
+  rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  HistVariant& variant = const_cast<HistVariant&>(fHistVariant);
+  const TH1* hist = visit::hist::Cast::Do(variant);
+  const TArrayD* bins = dynamic_cast<const TArrayD*>(hist);
+  ncells = bins ? bins->GetSize() : 0;
+  nsumw2 = hist->GetSumw2N();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Base::SwapOut()                        //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Base::SwapOut(hist::Retired& retired) {
+  FlushFillBuffer();
+  const std::string path = GetPath();
+  const Bool_t in_store = hist::BackingStore::IsAttached(this); // before the global mutex, see BackingStore
+  rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  TH1* hist = visit::hist::Cast::Do(fHistVariant);
+  TArrayD* bins = dynamic_cast<TArrayD*>(hist);
+  TArrayD* sumw2 = hist->GetSumw2();
+  if(in_store || !bins || !retired.fBins ||
+     bins->GetSize() != retired.fNcells || sumw2->GetSize() != retired.fNsumw2) {
+    retired.fSnapshot.Take(hist, path);
+    retired.fSnapshot.fScaleFactor = GetScaleFactor();
+    hist->Reset();
+    fNpassed = fNfilled = 0;
+    return;
+  }
+  retired.fSnapshot.TakeDefinition(hist, path);
+  retired.fSnapshot.fScaleFactor = GetScaleFactor();
+  fNpassed = fNfilled = 0;
+  std::fill(retired.fSnapshot.fStats, retired.fSnapshot.fStats + hist::Snapshot::kNstats, 0.);
+  hist->GetStats(retired.fSnapshot.fStats);
+  retired.fSnapshot.fEntries = hist->GetEntries();
+  std::swap(bins->fArray, retired.fBins);
+  if(retired.fSumw2) std::swap(sumw2->fArray, retired.fSumw2);
+  Double_t zeros[hist::Snapshot::kNstats] = { 0 };
+  hist->PutStats(zeros);
+  hist->SetEntries(0);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// std::string rb::hist::Base::GetGateKey()              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+std::string rb::hist::Base::GetGateKey() {
+  std::string key = fGate->Get(0);
+  // Rasterized cuts depend on this histogram's binning, so they aren't shared
+  if(fGate->IsCutGate(0)) {
+    std::stringstream sstr;
+    sstr << key << "\n" << this;
+    key = sstr.str();
+  }
+  return key;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::hist::Base::FillProfiled()                        //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::hist::Base::FillProfiled(Bool_t lock_data) {
+  const Bool_t timed = hist::Profiler::IsSampled(fProfile.fNcalls++);
+  if(timed) ++fProfile.fNtimed;
+  ULong64_t start = timed ? rb::Cycles::Now() : 0;
+  // EvalProfiled() doesn't throw, so explicit lock/unlock is safe here
+  if(lock_data) gDataMutex.Lock();
+  Double_t gate = fGate->EvalProfiled(0, timed);
+  if(lock_data) gDataMutex.UnLock();
+  if(timed) {
+    ULong64_t stop = rb::Cycles::Now();
+    fProfile.fGateCycles += stop - start;
+    start = stop;
+  }
+  if(!Bool_t(gate)) return 0;
+  ++fProfile.fNpassed;
+  if(!Sample()) return 0;
+
+  std::vector<Double_t> axes;
+  if(lock_data) gDataMutex.Lock();
+  fParams->EvalAllProfiled(axes, timed);
+  if(lock_data) gDataMutex.UnLock();
+  if(timed) {
+    ULong64_t stop = rb::Cycles::Now();
+    fProfile.fParamCycles += stop - start;
+    start = stop;
+  }
+  Int_t ret = DoFill(axes);
+  if(timed) fProfile.fFillCycles += rb::Cycles::Now() - start;
+  return ret;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Base::ResetProfile()                   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Base::ResetProfile() {
+  fProfile = hist::Profile();
+  fGate->ResetProfiles();
+  fParams->ResetProfiles();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::hist::Base::Sample()                              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Base::Sample() {
+  ++fNpassed;
+  if(fPrescale > 1 && fNpassed % fPrescale) return false;
+  if(fMaxRate > 0) {
+    // Token bucket, refilled at fMaxRate and holding at most one second's worth
+    Long64_t now = gSystem->Now();
+    fRateCredit += (now - fRateTime) * fMaxRate / 1000.;
+    fRateTime = now;
+    Double_t burst = fMaxRate > 1. ? fMaxRate : 1.;
+    if(fRateCredit > burst) fRateCredit = burst;
+    if(fRateCredit < 1.) return false;
+    fRateCredit -= 1.;
+  }
+  ++fNfilled;
+  return true;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::hist::Base::Clear()                               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Base::Clear() {
+  FlushFillBuffer();
+  // Sample() runs under the fill lock, so the counters are reset under it too
+  rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  visit::hist::Clear::Do(fHistVariant);
+  fNpassed = fNfilled = 0;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::hist::Base::SetMaxRate()                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Base::SetMaxRate(Double_t rate) {
+  fRateCredit = 0;
+  fRateTime = gSystem->Now();
+  fMaxRate = rate > 0 ? rate : 0;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // rb::hist::Base::Write()                               //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 Int_t rb::hist::Base::Write(const char* name, Int_t option, Int_t bufsize) {
-	return visit::hist::Write::Do(fHistVariant, name, option, bufsize);
+	FlushFillBuffer();
+	const Int_t nbytes = visit::hist::Write::Do(fHistVariant, name, option, bufsize);
+	const Double_t factor = GetScaleFactor();
+	if(factor == 1.) return nbytes;
+	// Sampled: record the factor to correct integrals by next to the histogram
+	TParameter<Double_t> scale(hist::Snapshot::ScaleName(name ? name : GetName()).c_str(), factor);
+	rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+	return nbytes + scale.Write(0, option, bufsize);
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::Variable                                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor (1d)                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Variable::Variable(const char* name, const char* title, const char* param, const char* gate,
+			     hist::Manager* manager, Int_t event_code,
+			     Int_t nbinsx, const Double_t* xedges):
+  Base(name, title, param, gate, manager, event_code, nbinsx, xedges)
+{
+  InitLookups();
+  Init(name, title, param, gate, event_code);
+  fLockOnConstruction.Unlock();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor (2d)                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Variable::Variable(const char* name, const char* title, const char* param, const char* gate,
+			     hist::Manager* manager, Int_t event_code,
+			     Int_t nbinsx, const Double_t* xedges,
+			     Int_t nbinsy, const Double_t* yedges):
+  Base(name, title, param, gate, manager, event_code, nbinsx, xedges, nbinsy, yedges)
+{
+  InitLookups();
+  Init(name, title, param, gate, event_code);
+  fLockOnConstruction.Unlock();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Variable::InitLookups()                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Variable::InitLookups() {
+  TH1* hst = visit::hist::Cast::Do(fHistVariant);
+  TAxis* axes[2] = { hst->GetXaxis(), hst->GetYaxis() };
+  for(UInt_t i=0; i< kDimensions; ++i) {
+    std::vector<Double_t> edges(axes[i]->GetNbins() + 1);
+    for(Int_t bin = 1; bin <= axes[i]->GetNbins() + 1; ++bin)
+      edges[bin-1] = axes[i]->GetBinLowEdge(bin);
+    fBinLookups.push_back(hist::BinLookup(axes[i]->GetNbins(), &edges[0]));
+  }
+  SetFillBuffer(kDefaultFillBuffer);
 }
 
 
@@ -311,9 +658,9 @@ Int_t rb::hist::Summary::DoFill(const std::vector<Double_t>& params) {
   Int_t ret = 0;
   for(UInt_t i=0; i< params.size(); ++i) {
     if(kOrientation == VERTICAL)
-      ret += visit::hist::Fill::Do(fHistVariant, i, params[i], 0);
+      ret += FillAxes(i, params[i]);
     else
-      ret += visit::hist::Fill::Do(fHistVariant, params[i], i, 0);
+      ret += FillAxes(params[i], i);
   }
   return ret;
 }
@@ -389,7 +736,7 @@ Int_t rb::hist::Gamma::DoFill(const std::vector<Double_t>& params) {
     for(UInt_t j=0; j< kDimensions; ++j) {
       axes[j] = params.at(i+fStops[0]*j);
     }
-    ret += visit::hist::Fill::Do(fHistVariant, axes[0], axes[1], axes[2]);
+    ret += FillAxes(axes[0], axes[1], axes[2]);
   }
   return ret;
 }
@@ -429,7 +776,7 @@ Int_t rb::hist::Bit::DoFill(const std::vector<Double_t>& params) {
   boost::dynamic_bitset<> bits(kNumBits, (unsigned long)params[0]);
   for(Int_t i=0; i< kNumBits; ++i) {
     if(bits[i]) {
-      visit::hist::Fill::Do(fHistVariant, i, 0, 0);
+      FillAxes(i);
       ++ret;
     }
   }
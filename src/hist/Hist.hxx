@@ -22,6 +22,8 @@
 #include "Formula.hxx"
 #include "hist/Visitor.hxx"
 #include "hist/Manager.hxx"
+#include "hist/FillBuffer.hxx"
+#include "hist/Profile.hxx"
 #include "utils/Error.hxx"
 #include "utils/LockingPointer.hxx"
 #include "utils/Critical.hxx"
@@ -31,7 +33,6 @@ namespace rb
 {
 namespace hist
 {
-typedef std::set<rb::hist::Base*> Container_t;
 struct StopAddDirectory
 {
 	 StopAddDirectory() { TH1::AddDirectory(false); }
@@ -42,7 +43,8 @@ struct LockOnConstruction
 {
 	 Bool_t kIsLocked;
 	 rb::Mutex* fMutex;
-	 LockOnConstruction(rb::Mutex* mutex = 0): kIsLocked(true), fMutex(mutex) {
+	 RB_LOCK_NOINLINE LockOnConstruction(rb::Mutex* mutex = 0): kIsLocked(true), fMutex(mutex) {
+		 RB_LOCK_SITE();
 		 if(!fMutex) rb::TThreadMutex::Instance()->Lock();
 		 else        fMutex->Lock();
 	 }
@@ -116,10 +118,48 @@ protected:
 	 //! \details Variant class covers all possible dimensions from 1-3 in one object.
 	 HistVariant fHistVariant;
 
+	 /// \brief Pending fill coordinates.
+	 //! \details Null unless buffered filling has been turned on with SetFillBuffer().
+	 //! Only accessed with the TThread global mutex held.
+	 boost::scoped_ptr<hist::FillBuffer> fFillBuffer;
+
+	 /// \brief Constant-time bin lookups, one per axis.
+	 //! \details Empty for uniformly binned histograms. Used when flushing fFillBuffer, and for
+	 //! every fill when the buffer is turned off.
+	 std::vector<hist::BinLookup> fBinLookups;
+
+	 /// Prescale factor: only every fPrescale-th event passing the gate is filled.
+	 Int_t fPrescale;
+
+	 /// Maximum fill rate in events per second, 0 means unlimited.
+	 Double_t fMaxRate;
+
+	 /// Number of events passing the gate since the last Clear().
+	 ULong64_t fNpassed;
+
+	 /// Number of events actually filled since the last Clear().
+	 ULong64_t fNfilled;
+
+	 /// Rate limiter: number of fills currently allowed.
+	 Double_t fRateCredit;
+
+	 /// Rate limiter: time of the last credit update [ms].
+	 Long64_t fRateTime;
+
+	 /// Fill profiling counters, only updated while rb::hist::Profiler is enabled.
+	 hist::Profile fProfile;
+
+	 /// Handle of this histogram in its manager's store (see rb::hist::Store)
+	 UInt_t fHandle;
+
 	 /// Construction mode for duplicates
 	 //! true means overwrite duplicate names in the same directory, false means append _1, _2, etc. until unique
 	 static Bool_t fgOverwrite;
 
+	 /// Signal the GUI when histograms are created or deleted?
+	 //! Turned off while reading a batch of histograms, after which the caller syncs the GUI once.
+	 static Bool_t fgNotify;
+
 	 /// Constructor (1d)
 	 Base(const char* name, const char* title, const char* param, const char* gate,
 				hist::Manager* manager, Int_t event_code,
@@ -138,10 +178,22 @@ protected:
 				Int_t nbinsy, Double_t ylow, Double_t yhigh,
 				Int_t nbinsz, Double_t zlow, Double_t zhigh);
 
+	 /// Constructor (1d, variable bins)
+	 Base(const char* name, const char* title, const char* param, const char* gate,
+				hist::Manager* manager, Int_t event_code,
+				Int_t nbinsx, const Double_t* xedges);
+
+	 /// Constructor (2d, variable bins)
+	 Base(const char* name, const char* title, const char* param, const char* gate,
+				hist::Manager* manager, Int_t event_code,
+				Int_t nbinsx, const Double_t* xedges,
+				Int_t nbinsy, const Double_t* yedges);
+
 public:
 	 /// Default constructor.
 	 //! Does nothing, just here to make rootcint happy.
-	 Base() : kEventCode(0), kDimensions(0), fManager(0) {}
+	 Base() : kEventCode(0), kDimensions(0), fManager(0),
+						fPrescale(1), fMaxRate(0), fNpassed(0), fNfilled(0), fRateCredit(0), fRateTime(0) {}
 
 private:
 	 /// Destruction function, acts like a normal dstructor
@@ -193,8 +245,56 @@ public:
 	 //! in memory and creates a new one.
 	 TH1* GetHist();
 
-	 /// Clear function, zeros-out all axes of the internal histogram
-	 virtual void Clear() { visit::hist::Clear::Do(fHistVariant); }
+	 /// Clear function, zeros-out all axes of the internal histogram and the sampling counters
+	 virtual void Clear();
+
+	 /// Set the prescale factor.
+	 //! Only every \c n-th event passing the gate is filled; \c n <= 1 fills every event.
+	 void SetPrescale(Int_t n) { fPrescale = n > 1 ? n : 1; }
+
+	 /// Return the prescale factor.
+	 Int_t GetPrescale() { return fPrescale; }
+
+	 /// Set the maximum fill rate.
+	 //! \param rate Maximum number of fills per second (after prescaling); <= 0 means unlimited.
+	 void SetMaxRate(Double_t rate);
+
+	 /// Return the maximum fill rate (0 if unlimited).
+	 Double_t GetMaxRate() { return fMaxRate; }
+
+	 /// Return the number of gate-passing events per actual fill since the last Clear().
+	 //! Multiply integrals by this number to correct for prescaling and rate limiting.
+	 Double_t GetScaleFactor() {
+		 return fNfilled ? Double_t(fNpassed) / Double_t(fNfilled) : 1.;
+	 }
+
+	 /// Return the number of events passing the gate since the last Clear().
+	 ULong64_t GetNpassed() { return fNpassed; }
+
+	 /// Return the number of events filled since the last Clear().
+	 ULong64_t GetNfilled() { return fNfilled; }
+
+	 /// Return the fill profiling counters.
+	 const hist::Profile& GetProfile() { return fProfile; }
+
+	 /// Zero the fill profiling counters, including those of the gate and parameter formulae.
+	 void ResetProfile();
+
+	 /// Turn buffered filling on or off.
+	 //! In buffered mode, filling only records the parameter values; the bins are
+	 //! updated in batches of up to \c size points (see rb::hist::FillBuffer). The buffer
+	 //! is flushed whenever it is full, before the histogram is read, written or cleared,
+	 //! and about once per second by the owning manager. Passing \c size <= 0 flushes
+	 //! anything pending and goes back to filling directly.
+	 void SetFillBuffer(Int_t size);
+
+	 /// Return the size of the fill buffer (0 means buffering is off).
+	 Int_t GetFillBuffer();
+
+	 /// Apply any buffered fills to the internal histogram.
+	 //! \note Declared \c const so that it can be called from the const TH1 wrappers;
+	 //! pending fills are not part of the logical state of the histogram.
+	 void FlushFillBuffer() const;
 
 	 /// Return the number of dimensions.
 	 UInt_t GetNdimensions() { return kDimensions; }
@@ -231,6 +331,14 @@ public:
 		 return ret;		 
 	 }
 
+	 /// Turn on/off signalling the GUI for each created or deleted histogram
+	 //! \returns true if the condition was changed by calling the function, false otherwise
+	 static Bool_t SetNotify(Bool_t on = true) {
+		 Bool_t ret = (on != fgNotify);
+		 fgNotify = on;
+		 return ret;
+	 }
+
 protected:
 	 /// Set name and title
 	 void Init(const char* name, const char* title, const char* param, const char* gate, Int_t event_code);
@@ -241,11 +349,66 @@ protected:
 	 /// Set gate formula
 	 virtual void InitGate(const char* gate, Int_t event_code);
 
+#ifndef __MAKECINT__
+	 /// Fill the internal histogram at a single point.
+	 //! Derived classes should use this from DoFill() instead of visiting fHistVariant
+	 //! directly, so that buffered filling is respected. Locks the TThread global mutex,
+	 //! except during a parallel Manager::FillAll(), where the calling thread already holds it.
+	 Int_t FillAxes(Double_t x, Double_t y = 0, Double_t z = 0);
+#endif
+
 private:
 	 /// Prevent assigmnent
 	 Base& operator= (const Base& other) { return *this; }
 	 /// Prevent copying
 	 Base(const Base& other) : kEventCode(other.kEventCode), kDimensions(other.kDimensions), fManager(other.fManager) {}
+	 /// Decide whether a gate-passing event should be filled, according to the prescale
+	 //! and rate limit; also updates the fNpassed and fNfilled counters.
+	 Bool_t Sample();
+	 /// Version of Fill() used while profiling is enabled.
+	 //! \param lock_data Lock gDataMutex while evaluating formulae (false if the caller already holds it)
+	 Int_t FillProfiled(Bool_t lock_data);
+#ifndef __MAKECINT__
+	 /// Evaluate the gate condition (locks gDataMutex).
+	 Bool_t EvalGate();
+	 /// Unlocked version of EvalGate().
+	 Bool_t EvalGateUnlocked();
+	 /// Second half of Fill(), for an event known to pass the gate: sample, evaluate
+	 //! the parameters (locking gDataMutex) and fill.
+	 Int_t FillPassed();
+	 /// For an event known to pass the gate, decide whether to fill it and if so evaluate
+	 //! the parameters into \c params, without filling.
+	 //! \returns true if the event should be filled from \c params.
+	 //! \note The caller must hold gDataMutex.
+	 Bool_t EvalPassedUnlocked(std::vector<Double_t>& params);
+	 /// Copy the bin contents (and errors) into newly allocated arrays.
+	 //! \details The kernel places memory on the node of the thread that first writes it, so
+	 //! calling this from a pinned thread makes the bins local to that thread's node. Two limits:
+	 //! the arrays come from <tt>new[]</tt> (ROOT frees them with <tt>delete[]</tt>), and glibc
+	 //! serves arrays below its mmap threshold (128 kB by default) from heap pages that may already
+	 //! have been touched, and so placed, elsewhere, so only large histograms reliably move. And a
+	 //! parallel Manager::FillAll() fills on the executor's workers, which may sit on other nodes
+	 //! than the attach thread this is called from.
+	 void Relocate();
+	 /// Key identifying the gate condition: histograms with equal keys always agree on
+	 //! whether an event passes, so rb::hist::Manager evaluates the gate once for all of them.
+	 std::string GetGateKey();
+	 /// FillAxes() without locking the TThread global mutex
+	 Int_t FillAxesUnlocked(Double_t x, Double_t y, Double_t z);
+	 /// Copy the definition and contents into \c snapshot, holding the TThread global mutex
+	 //! only while copying. Pending buffered fills are applied first.
+	 void TakeSnapshot(hist::Snapshot& snapshot);
+	 /// Directory path and name, e.g. "/adc/adc0"
+	 std::string GetPath() const;
+	 /// Sizes of the arrays SwapOut() needs for this histogram's bins and sum of squared weights
+	 void GetArraySizes(Int_t& ncells, Int_t& nsumw2) const;
+	 /// Replace the bins (and sum of squared weights) with the zeroed arrays in \c retired, which gets the old ones.
+	 //! \details Also copies the definition and statistics into \c retired, and zeroes the statistics. Under the
+	 //! TThread global mutex, only pointers are swapped, so filling doesn't wait for any copying or zeroing.
+	 //! If the arrays in \c retired don't fit (or the bins are in the BackingStore), the contents are copied
+	 //! into \c retired.fSnapshot and zeroed in place instead.
+	 void SwapOut(hist::Retired& retired);
+#endif
 	 /// Internal function to fill the histogram.
 	 //! Called from the public Fill() and FillAll(), does not do any mutex locking,
 	 //! instead relies on being passed already locked components.
@@ -253,6 +416,8 @@ private:
 public:
 #include "WrapTH1.hxx"
 	 friend class rb::hist::Manager;
+	 friend class rb::hist::ProfileReport;
+	 friend class rb::hist::BackingStore;
 	 ClassDef(rb::hist::Base, 0);
 };
 
@@ -302,6 +467,33 @@ public:
       }
 	 ClassDef(rb::hist::D3, 0);
 };
+/// \brief Variable-bin histogram
+//! \details One or two dimensional histogram with arbitrary (e.g. logarithmic) bin edges.
+//! Filling is buffered, and the buffered points are binned with rb::hist::BinLookup, which
+//! avoids the binary search TAxis does for each fill of a variable-width axis.
+class Variable: public Base
+{
+public:
+	 /// Default size of the fill buffer
+	 static const Int_t kDefaultFillBuffer = 256;
+	 /// Constructor (1d)
+	 Variable (const char* name, const char* title, const char* param, const char* gate,
+						 hist::Manager* manager, Int_t event_code,
+						 Int_t nbinsx, const Double_t* xedges);
+	 /// Constructor (2d)
+	 Variable (const char* name, const char* title, const char* param, const char* gate,
+						 hist::Manager* manager, Int_t event_code,
+						 Int_t nbinsx, const Double_t* xedges,
+						 Int_t nbinsy, const Double_t* yedges);
+	 /// Are the bins along \c axis logarithmic?
+	 Bool_t IsLog(Int_t axis) {
+		 return axis >= 0 && axis < Int_t(fBinLookups.size()) && fBinLookups[axis].IsLog();
+	 }
+private:
+	 /// Build fBinLookups from the axes and turn on buffered filling
+	 void InitLookups();
+	 ClassDef(rb::hist::Variable, 0);
+};
 /// \brief Summary histogram
 //! \details Histogram displaying multiple parameters at once.
 class Summary: public Base
@@ -1,7 +1,15 @@
 //! \file Manager.cxx
 //! \brief Implements manager.hxx
+#include <map>
+#include <algorithm>
+#include <functional>
 #include "Hist.hxx"
 #include "hist/Manager.hxx"
+#include "hist/Snapshot.hxx"
+#include "hist/BackingStore.hxx"
+#include "hist/Writer.hxx"
+#include "utils/Executor.hxx"
+#include "utils/Cycles.hxx"
 
 
 
@@ -12,23 +20,43 @@ namespace {
 struct HistFill { Int_t operator() (rb::hist::Base* const& hist) {
 	return hist->Fill();
 } } fill_hist;
-class HistWrite
+struct HistFlush { void operator() (rb::hist::Base* const& hist) {
+	hist->FlushFillBuffer();
+} } flush_hist;
+struct HistRelocate { void operator() (rb::hist::Base* const& hist) {
+	hist->Relocate();
+} } relocate_hist;
+struct HistAttach { void operator() (rb::hist::Base* const& hist) {
+	rb::hist::BackingStore::Attach(hist);
+} } attach_hist;
+struct HistResetProfile { void operator() (rb::hist::Base* const& hist) {
+	hist->ResetProfile();
+} } reset_profile;
+// Is this thread filling part of a parallel FillAll()?
+__thread Bool_t tParallelFill = false;
+// Sets tParallelFill for the life of the object
+struct ParallelFillScope {
+	ParallelFillScope()  { tParallelFill = true; }
+	~ParallelFillScope() { tParallelFill = false; }
+};
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::Manager::FillTask                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+class rb::hist::Manager::FillTask: public rb::Task
 {
 private:
-	 TFile* fFile;
+	 Manager* fManager;
+	 UInt_t fPart;
+	 Bool_t fTimed;
 public:
-	 HistWrite(TFile* file): fFile(file) { }
-	 void operator() (rb::hist::Base* const& hist) {
-		 TDirectory* current = hist->GetDirectory();
-		 if(!current) return;
-		 fFile->cd();
-		 hist->SetDirectory(fFile);
-		 hist->Write(hist->GetName());
-		 hist->SetDirectory(current);
-		 current->cd();
-	 }
+	 FillTask(Manager* manager, UInt_t part, Bool_t timed):
+		 fManager(manager), fPart(part), fTimed(timed) { }
+	 void Execute() { fManager->FillPart(fPart, fTimed); }
 };
-}
+
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // Class                                                 //
@@ -40,15 +68,246 @@ public:
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 void rb::hist::Manager::FillAll() {
   LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
-  std::for_each(pSet->begin(), pSet->end(), fill_hist);
+  if(!pSet->IsGrouped()) Group(*pSet);
+  if(hist::Profiler::IsEnabled()) // profiling counts gate evaluations per histogram
+    std::for_each(pSet->begin(), pSet->end(), fill_hist);
+  else if(fNthreads > 1 && pSet->size() >= kMinPerThread * fNthreads)
+    FillParallel(*pSet);
+  else
+    FillGrouped(*pSet);
+  if(fFlushTimer.Check())
+    std::for_each(pSet->begin(), pSet->end(), flush_hist);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Manager::FillGrouped()                 //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Manager::FillGrouped(const Container_t& set) {
+  for(UInt_t group=0; group< set.GetNgroups(); ++group) {
+    const UInt_t begin = set.GroupBegin(group), end = set.GroupEnd(group);
+    if(!set[begin]->EvalGate()) continue;
+    for(UInt_t i = begin; i< end; ++i)
+      set[i]->FillPassed();
+  }
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Manager::FillParallel()                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Manager::FillParallel(const Container_t& set) {
+  if(fSlotsDirty) {
+    // Keep the measured costs of histograms that are still there
+    std::map<Base*, Double_t> costs;
+    for(UInt_t i=0; i< fSlots.size(); ++i)
+      costs[fSlots[i].fHist] = fSlots[i].fCost;
+    fSlots.resize(set.size());
+    for(UInt_t i=0; i< set.size(); ++i) {
+      fSlots[i].fHist = set[i];
+      fSlots[i].fPass = false;
+      std::map<Base*, Double_t>::iterator it = costs.find(set[i]);
+      fSlots[i].fCost = it != costs.end() ? it->second : 0;
+    }
+    fSlotsDirty = false;
+    Partition();
+  }
+  else if(++fNsincePartition >= kPartitionPeriod) {
+    Partition();
+  }
+
+  // TTreeFormula isn't thread safe, so evaluation is serial
+  {
+    rb::ScopedLock<rb::Mutex> LOCK (gDataMutex);
+    for(UInt_t group=0; group< set.GetNgroups(); ++group) {
+      const UInt_t begin = set.GroupBegin(group), end = set.GroupEnd(group);
+      const Bool_t passed = fSlots[begin].fHist->EvalGateUnlocked();
+      for(UInt_t i = begin; i< end; ++i)
+	fSlots[i].fPass = passed && fSlots[i].fHist->EvalPassedUnlocked(fSlots[i].fParams);
+    }
+  }
+
+  // Each histogram is in exactly one part, so the parts can be filled at the same time.
+  // The workers rely on this thread holding the TThread global mutex for them.
+  const Bool_t timed = (fNsincePartition % kCostSamplePeriod) == 0;
+  rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  std::vector<rb::Future> futures;
+  futures.reserve(fParts.size());
+  for(UInt_t i=1; i< fParts.size(); ++i)
+    futures.push_back(rb::Executor::Submit(new FillTask(this, i, timed)));
+  try {
+    FillPart(0, timed);
+  }
+  catch(...) { // the other parts still use fSlots
+    for(UInt_t i=0; i< futures.size(); ++i) futures[i].Wait();
+    throw;
+  }
+  for(UInt_t i=0; i< futures.size(); ++i)
+    futures[i].Wait();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Manager::FillPart()                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Manager::FillPart(UInt_t part, Bool_t timed) {
+  ParallelFillScope scope;
+  const std::vector<UInt_t>& indices = fParts[part];
+  for(UInt_t i=0; i< indices.size(); ++i) {
+    Slot& slot = fSlots[indices[i]];
+    if(!timed) {
+      if(slot.fPass) slot.fHist->DoFill(slot.fParams);
+      continue;
+    }
+    ULong64_t cycles = 0;
+    if(slot.fPass) {
+      const ULong64_t start = rb::Cycles::Now();
+      slot.fHist->DoFill(slot.fParams);
+      cycles = rb::Cycles::Now() - start;
+    }
+    slot.fCost += (Double_t(cycles) - slot.fCost) / 8;
+  }
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Manager::Partition()                   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Manager::Partition() {
+  // Longest processing time first: take histograms from the most to least expensive,
+  // giving each to the part with the least total cost so far
+  std::vector<std::pair<Double_t, UInt_t> > order(fSlots.size());
+  for(UInt_t i=0; i< fSlots.size(); ++i)
+    order[i] = std::make_pair(fSlots[i].fCost, i);
+  std::sort(order.begin(), order.end(), std::greater<std::pair<Double_t, UInt_t> >());
+
+  const UInt_t nparts = fNthreads > 1 ? fNthreads : 1;
+  fParts.assign(nparts, std::vector<UInt_t>());
+  std::vector<Double_t> load(nparts, 0);
+  for(UInt_t i=0; i< order.size(); ++i) {
+    const UInt_t least = std::min_element(load.begin(), load.end()) - load.begin();
+    fParts[least].push_back(order[i].second);
+    load[least] += order[i].first + 1; // +1: spread histograms not yet measured evenly
+  }
+  // Fill in memory order within each part
+  for(UInt_t i=0; i< nparts; ++i)
+    std::sort(fParts[i].begin(), fParts[i].end());
+  fNsincePartition = 0;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Manager::SetParallel()                 //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Manager::SetParallel(Int_t nthreads) {
+  LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
+  fNthreads = nthreads > 1 ? nthreads : 0;
+  fSlotsDirty = true;
+  if(!fNthreads) {
+    fSlots.clear();
+    fParts.clear();
+  }
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::Manager::InParallelFill() [static]   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Manager::InParallelFill() {
+  return tParallelFill;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Manager::FlushAll()                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Manager::FlushAll() {
+  LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
+  std::for_each(pSet->begin(), pSet->end(), flush_hist);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Manager::Relocate()                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Manager::Relocate() {
+  LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
+  std::for_each(pSet->begin(), pSet->end(), relocate_hist);
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::hist::Manager::WriteAll()                    //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 void rb::hist::Manager::WriteAll(TFile* file) {
-	HistWrite write_hist(file);
+  std::vector<hist::Snapshot> snapshots;
+  TakeSnapshots(snapshots); // the only part that holds fSetMutex
+  hist::WriteSnapshots(snapshots, file);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Manager::MoveToBackingStore()          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Manager::MoveToBackingStore() {
+  LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
+  std::for_each(pSet->begin(), pSet->end(), attach_hist);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Manager::TakeSnapshots()               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Manager::TakeSnapshots(std::vector<hist::Snapshot>& snapshots) {
+  LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
+  const UInt_t first = snapshots.size();
+  snapshots.resize(first + pSet->size());
+  for(UInt_t i=0; i< pSet->size(); ++i)
+    (*pSet)[i]->TakeSnapshot(snapshots[first + i]);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::Manager::TakeSnapshot()              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Manager::TakeSnapshot(const std::string& path, hist::Snapshot& snapshot) {
+  LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
+  for(UInt_t i=0; i< pSet->size(); ++i) {
+    if((*pSet)[i]->GetPath() != path) continue;
+    (*pSet)[i]->TakeSnapshot(snapshot);
+    return true;
+  }
+  return false;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Manager::SwapOutAll()                  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Manager::SwapOutAll(std::vector<hist::Retired>& retired) {
+  std::vector<hist::Retired> prepared;
+  std::map<hist::Base*, UInt_t> index;
+  {
+    LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
+    prepared.resize(pSet->size());
+    for(UInt_t i=0; i< pSet->size(); ++i) {
+      index[(*pSet)[i]] = i;
+      (*pSet)[i]->GetArraySizes(prepared[i].fNcells, prepared[i].fNsumw2);
+    }
+  }
+  // Zeroing large arrays takes a while, so do it while filling goes on
+  for(UInt_t i=0; i< prepared.size(); ++i)
+    prepared[i].Allocate();
+
+  std::vector<Bool_t> swapped(prepared.size(), false);
+  {
+    LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
+    for(UInt_t i=0; i< pSet->size(); ++i) {
+      hist::Base* hist = (*pSet)[i];
+      std::map<hist::Base*, UInt_t>::iterator it = index.find(hist);
+      if(it == index.end()) { // added meanwhile: no arrays, so it is copied and zeroed in place
+        prepared.push_back(hist::Retired());
+        swapped.push_back(true);
+        hist->SwapOut(prepared.back());
+        continue;
+      }
+      hist->SwapOut(prepared[it->second]);
+      swapped[it->second] = true;
+    }
+  }
+  for(UInt_t i=0; i< prepared.size(); ++i) {
+    if(swapped[i]) retired.push_back(prepared[i]);
+    else prepared[i].Release(); // deleted meanwhile
+  }
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Manager::Report()                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Manager::Report(rb::hist::ProfileReport& report) {
   LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
-  std::for_each(pSet->begin(), pSet->end(), write_hist);
+  for(hist::Container_t::iterator it = pSet->begin(); it != pSet->end(); ++it)
+    report.Add(*it);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Manager::ResetProfiles()               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Manager::ResetProfiles() {
+  LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
+  std::for_each(pSet->begin(), pSet->end(), reset_profile);
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::hist::Manager::DeleteAll()                   //
@@ -65,15 +324,35 @@ void rb::hist::Manager::DeleteAll() {
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 void rb::hist::Manager::Add(rb::hist::Base* hist) {
   LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
-  pSet->insert(hist);
+  hist->fHandle = pSet->Insert(hist);
+  fSlotsDirty = true;
+  hist::BackingStore::Attach(hist);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Manager::Ungroup()                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Manager::Ungroup() {
+  LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
+  pSet->Ungroup();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Manager::Group()                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Manager::Group(Container_t& set) {
+  std::vector<std::string> keys(set.size());
+  for(UInt_t i=0; i< set.size(); ++i)
+    keys[i] = set[i]->GetGateKey();
+  set.Group(keys);
+  fSlotsDirty = true;
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::hist::Manager::Remove()                      //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 void rb::hist::Manager::Remove(rb::hist::Base* hist) {
   LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
-	if(pSet->count(hist)) {
-		pSet->erase(hist);
+	if(pSet->Erase(hist->fHandle)) {
+		hist->fHandle = hist::Store::kNoHandle;
+		fSlotsDirty = true;
 		TDirectory* directory = hist->fDirectory;
 		if(directory) directory->Remove(hist);
 	}
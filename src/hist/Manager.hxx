@@ -4,7 +4,10 @@
 #ifndef HIST_MANAGER_HXX
 #define HIST_MANAGER_HXX
 #include <typeinfo>
+#include <vector>
 #include "utils/Mutex.hxx"
+#include "utils/Timer.hxx"
+#include "hist/Store.hxx"
 
 
 namespace rb
@@ -13,9 +16,13 @@ namespace hist
 {
 // ========= Forward Declarations ========= //
 class Base;
+class ProfileReport;
+struct Snapshot;
+struct Retired;
+class BackingStore;
 
 // ========= Typedefs ========= //
-typedef std::set<rb::hist::Base*> Container_t;
+typedef rb::hist::Store Container_t;
 
 /// \brief Wraps a container of all histograms registered to this event type.
 //! \details Also takes care of functions for Adding and Deleting histograms.
@@ -25,15 +32,91 @@ private:
 	 //! Container of pointers to histograms registered to this event type.
 	 volatile Container_t fSet;
 
+	 //! Times the periodic flush of buffered fills
+	 rb::Timer fFlushTimer;
+
+	 //! Number of threads FillAll() fills with; 0 or 1 to fill serially
+	 Int_t fNthreads;
+
+	 //! Set when histograms are added or removed, so that fSlots is rebuilt
+	 Bool_t fSlotsDirty;
+
+	 //! Number of parallel FillAll() calls since the histograms were last partitioned
+	 UInt_t fNsincePartition;
+
+	 //! Number of parallel FillAll() calls between repartitions
+	 static const UInt_t kPartitionPeriod = 4096;
+
+	 //! Fill times are measured on one out of this many parallel FillAll() calls
+	 static const UInt_t kCostSamplePeriod = 16;
+
+	 //! Fewest histograms per thread worth filling in parallel
+	 static const UInt_t kMinPerThread = 8;
+
+	 //! One histogram's evaluated event, for parallel filling
+	 struct Slot {
+			//! The histogram
+			Base* fHist;
+			//! Parameter values for the current event
+			std::vector<Double_t> fParams;
+			//! Should the current event be filled?
+			Bool_t fPass;
+			//! Moving average of the time spent filling (in cycles, 0 for events not filled)
+			Double_t fCost;
+	 };
+
+	 //! Evaluated events, one per histogram in fSet
+	 std::vector<Slot> fSlots;
+
+	 //! Indices into fSlots filled by each thread
+	 std::vector< std::vector<UInt_t> > fParts;
+
+	 //! Fills one element of fParts (defined in Manager.cxx)
+	 class FillTask;
+
 	 //! Mutex to protect access to fSet
 public:
 	 rb::Mutex fSetMutex;
 
 public:
 	 //! Fill all histograms in fSet
+	 //! \details Histograms sharing a gate are stored next to each other, and the gate is
+	 //! evaluated once for all of them (except while profiling). Also flushes the fill buffers of any buffered histograms about once
+	 //! per second, so that their contents never lag far behind the data.
 	 void FillAll();
-	 //! Write all histograms in fSet
+	 //! Set the number of threads FillAll() uses
+	 //! \details With more than one thread, FillAll() evaluates every histogram's gate and
+	 //! parameters serially, then splits the filling across \c nthreads threads (the caller
+	 //! and nthreads - 1 rb::Executor compute workers), each histogram being filled by exactly one
+	 //! thread. Histograms are assigned so that each thread's measured fill time is about equal.
+	 //! Filling stays serial while profiling is enabled, or when there are too few histograms.
+	 void SetParallel(Int_t nthreads);
+	 //! Return the number of threads FillAll() uses (0 or 1: serial)
+	 Int_t GetParallel() const { return fNthreads; }
+	 //! Is the calling thread filling part of a parallel FillAll()?
+	 //! \details If so, the thread calling FillAll() holds the TThread global mutex on its behalf.
+	 static Bool_t InParallelFill();
+	 //! Apply pending buffered fills for all histograms in fSet
+	 void FlushAll();
+	 //! Reallocate the bins of all histograms in fSet from the calling thread
+	 //! (see Base::Relocate())
+	 void Relocate();
+	 //! Move the bins of all histograms in fSet into the open rb::hist::BackingStore
+	 void MoveToBackingStore();
+	 //! Write all histograms in fSet (serialized in parallel, see rb::hist::WriteSnapshots())
 	 void WriteAll(TFile* file);
+	 //! Copy all histograms in fSet, appending to \c snapshots (see rb::hist::Snapshot)
+	 void TakeSnapshots(std::vector<hist::Snapshot>& snapshots);
+	 //! Copy the histogram in fSet at \c path (see Base::GetPath()), if there is one
+	 Bool_t TakeSnapshot(const std::string& path, hist::Snapshot& snapshot);
+	 //! Swap the contents of all histograms in fSet out for zeroed ones, appending the old ones to \c retired
+	 //! \details The zeroed arrays are allocated before locking fSet; with fSet locked, every histogram is
+	 //! swapped (see Base::SwapOut()), so no event is split between the old and the new contents.
+	 void SwapOutAll(std::vector<hist::Retired>& retired);
+	 //! Add the profiling counters of all histograms in fSet to \c report
+	 void Report(ProfileReport& report);
+	 //! Zero the profiling counters of all histograms in fSet
+	 void ResetProfiles();
 	 //! Does nothing
 	 Manager();
 	 //! Deletes all entries in fSet
@@ -96,13 +179,42 @@ public:
 				new T(name, title, param, gate, this, event_code, nbinsx, xlow, xhigh, nbinsy, ylow, yhigh, nbinsz, zlow, zhigh, optional);
 		 Add(hist); return hist;
 	 }
+	 //! Create a new 1d histogram with variable bins and add to fSet
+	 template<typename T>
+	 rb::hist::Base* Create(const char* name, const char* title, const char* param, const char* gate, Int_t event_code,
+													Int_t nbinsx, const Double_t* xedges) {
+		 rb::hist::Base* hist =
+				new T(name, title, param, gate, this, event_code, nbinsx, xedges);
+		 Add(hist); return hist;
+	 }
+	 //! Create a new 2d histogram with variable bins and add to fSet
+	 template<typename T>
+	 rb::hist::Base* Create(const char* name, const char* title, const char* param, const char* gate, Int_t event_code,
+													Int_t nbinsx, const Double_t* xedges,
+													Int_t nbinsy, const Double_t* yedges) {
+		 rb::hist::Base* hist =
+				new T(name, title, param, gate, this, event_code, nbinsx, xedges, nbinsy, yedges);
+		 Add(hist); return hist;
+	 }
 	 //! Delete all histogram instances
 	 void DeleteAll();
 private:
 	 //! Add a histogram to fSet
 	 void Add(rb::hist::Base* hist);
+	 //! Regroup fSet by gate before the next FillAll() (called when a gate changes)
+	 void Ungroup();
+	 //! Group the histograms in \c set by gate, called with fSetMutex locked
+	 void Group(Container_t& set);
+	 //! Serial version of FillAll(), evaluating each group's gate once; called with fSetMutex locked
+	 void FillGrouped(const Container_t& set);
 	 //! Remove a histogram from fSet
 	 void Remove(rb::hist::Base* hist);
+	 //! Parallel version of FillAll(), called with fSetMutex locked
+	 void FillParallel(const Container_t& set);
+	 //! Fill the histograms in fParts[part] whose events passed; measures their cost if \c timed
+	 void FillPart(UInt_t part, Bool_t timed);
+	 //! Split fSlots into fNthreads parts of about equal fill cost
+	 void Partition();
 	 //! Allow access to the created histograms
 	 friend class rb::hist::Base;
 };
@@ -111,7 +223,8 @@ private:
 
 
 // ========= Inlined Functions ========= //
-inline rb::hist::Manager::Manager(): fSetMutex("SetMutex", true) {
+inline rb::hist::Manager::Manager(): fFlushTimer(1), fNthreads(0), fSlotsDirty(true),
+																		 fNsincePartition(0), fSetMutex("SetMutex", true) {
 }
 
 inline rb::hist::Manager::~Manager() {
@@ -0,0 +1,159 @@
+//! \file Profile.cxx
+//! \brief Implements Profile.hxx
+#include <algorithm>
+#include <iomanip>
+#include "hist/Profile.hxx"
+#include "hist/Hist.hxx"
+#include "Rint.hxx"
+#include "Event.hxx"
+#include "utils/Cycles.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Helper Functions                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace
+{
+// Sort by decreasing cost
+template <class T>
+struct CostGreater {
+	bool operator() (const T& lhs, const T& rhs) const {
+		return lhs.second.first.GetCost() > rhs.second.first.GetCost();
+	}
+};
+struct HistCostGreater {
+	bool operator() (const std::pair<std::string, rb::hist::Profile>& lhs,
+									 const std::pair<std::string, rb::hist::Profile>& rhs) const {
+		return lhs.second.GetCost() > rhs.second.GetCost();
+	}
+};
+// Convert cycles to microseconds per call
+inline Double_t us_per_call(ULong64_t cycles, ULong64_t ncalls) {
+	return ncalls ? 1e6 * cycles / ncalls / rb::Cycles::PerSecond() : 0.;
+}
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::Profiler                                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+Bool_t rb::hist::Profiler::fgEnabled = false;
+ULong64_t rb::hist::Profiler::fgMask = 63;
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Profiler::Enable() [static]            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Profiler::Enable(UInt_t period) {
+	ULong64_t p2 = 1;
+	while(p2 < period) p2 <<= 1;
+	rb::Cycles::PerSecond(); // calibrate now rather than while printing
+	fgMask = p2 - 1;
+	fgEnabled = true;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Profiler::Reset() [static]             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Profiler::Reset() {
+	rb::EventVector_t events = rb::gApp()->GetEventVector();
+	for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it) {
+		rb::Event* event = rb::gApp()->GetEvent(it->first);
+		if(event) event->GetHistManager()->ResetProfiles();
+	}
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Profiler::Print() [static]             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Profiler::Print(Int_t nmax, std::ostream& strm) {
+	if(!fgEnabled)
+		 err::Info("rb::hist::PrintProfile") << "Profiling is off (start it with rb::hist::StartProfile()), "
+																				<< "showing counts from the last profiling run.";
+	ProfileReport report;
+	rb::EventVector_t events = rb::gApp()->GetEventVector();
+	for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it) {
+		rb::Event* event = rb::gApp()->GetEvent(it->first);
+		if(event) event->GetHistManager()->Report(report);
+	}
+	report.Print(nmax, strm);
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::ProfileReport                               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::ProfileReport::Add()                   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::ProfileReport::Add(rb::hist::Base* hist) {
+	fHists.push_back(std::make_pair(std::string(hist->GetName()), hist->fProfile));
+	AddFormulae(hist->fGate.get());
+	AddFormulae(hist->fParams.get());
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::ProfileReport::AddFormulae()           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::ProfileReport::AddFormulae(rb::TreeFormulae* formulae) {
+	if(!formulae) return;
+	for(Int_t i=0; i< formulae->GetN(); ++i) {
+		const rb::FormulaProfile& profile = formulae->GetProfile(i);
+		std::pair<FormulaProfile, Int_t>& entry = fFormulae[formulae->Get(i)];
+		entry.first.fNevals += profile.fNevals;
+		entry.first.fNtimed += profile.fNtimed;
+		entry.first.fCycles += profile.fCycles;
+		++entry.second;
+	}
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::ProfileReport::Print()                 //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::ProfileReport::Print(Int_t nmax, std::ostream& strm) {
+	const Double_t rate = rb::Cycles::PerSecond();
+	Double_t total = 0;
+	for(UInt_t i=0; i< fHists.size(); ++i) total += fHists[i].second.GetCost();
+
+	std::sort(fHists.begin(), fHists.end(), HistCostGreater());
+	std::ios_base::fmtflags flags = strm.flags();
+	std::streamsize precision = strm.precision();
+	strm << std::fixed << std::setprecision(3);
+	strm << "\nHistogram fill profile (1 in " << Profiler::GetPeriod() << " fills timed), "
+			 << fHists.size() << " histograms, " << total / rate << " s total:\n";
+	strm << std::left << std::setw(32) << "  Name" << std::right
+			 << std::setw(12) << "Calls" << std::setw(8) << "Pass%"
+			 << std::setw(10) << "Gate us" << std::setw(10) << "Param us" << std::setw(10) << "Fill us"
+			 << std::setw(11) << "Total s" << std::setw(8) << "Share%" << "\n";
+	for(Int_t i=0; i< Int_t(fHists.size()) && i< nmax; ++i) {
+		const Profile& p = fHists[i].second;
+		// Parameter and fill times are per passing call, gate time is per call
+		const ULong64_t ntimed_passed = p.fNcalls ? ULong64_t(Double_t(p.fNtimed) * p.fNpassed / p.fNcalls + 0.5) : 0;
+		strm << "  " << std::left << std::setw(30) << fHists[i].first << std::right
+				 << std::setw(12) << p.fNcalls
+				 << std::setw(8) << (p.fNcalls ? 100. * p.fNpassed / p.fNcalls : 0.)
+				 << std::setw(10) << us_per_call(p.fGateCycles, p.fNtimed)
+				 << std::setw(10) << us_per_call(p.fParamCycles, ntimed_passed)
+				 << std::setw(10) << us_per_call(p.fFillCycles, ntimed_passed)
+				 << std::setw(11) << p.GetCost() / rate
+				 << std::setw(8) << (total > 0 ? 100. * p.GetCost() / total : 0.) << "\n";
+	}
+
+	typedef std::pair<std::string, FormulaMap_t::mapped_type> FormulaEntry_t;
+	std::vector<FormulaEntry_t> formulae(fFormulae.begin(), fFormulae.end());
+	std::sort(formulae.begin(), formulae.end(), CostGreater<FormulaEntry_t>());
+	strm << "\nFormula evaluation profile, " << formulae.size() << " distinct formulae:\n";
+	strm << std::left << std::setw(40) << "  Formula" << std::right
+			 << std::setw(8) << "Users" << std::setw(14) << "Evaluations"
+			 << std::setw(10) << "us/eval" << std::setw(11) << "Total s" << "\n";
+	for(Int_t i=0; i< Int_t(formulae.size()) && i< nmax; ++i) {
+		const FormulaProfile& f = formulae[i].second.first;
+		strm << "  " << std::left << std::setw(38) << formulae[i].first << std::right
+				 << std::setw(8) << formulae[i].second.second
+				 << std::setw(14) << f.fNevals
+				 << std::setw(10) << us_per_call(f.fCycles, f.fNtimed)
+				 << std::setw(11) << f.GetCost() / rate << "\n";
+	}
+	strm << std::endl;
+	strm.flags(flags);
+	strm.precision(precision);
+}
@@ -0,0 +1,99 @@
+//! \file Profile.hxx
+//! \brief Defines classes for profiling histogram filling.
+#ifndef HIST_PROFILE_HXX
+#define HIST_PROFILE_HXX
+#include <map>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <Rtypes.h>
+#include "Formula.hxx"
+
+
+namespace rb
+{
+namespace hist
+{
+// ========= Forward Declarations ========= //
+class Base;
+
+/// \brief Fill counters for one histogram.
+//! \details Timing is sampled: only one in every Profiler::GetPeriod() calls is timed, and the
+//! totals are estimated by scaling up. Parameter and fill times are only accumulated for sampled
+//! calls that passed the gate.
+struct Profile
+{
+	 /// Calls to Fill()
+	 ULong64_t fNcalls;
+	 /// Calls where the gate passed
+	 ULong64_t fNpassed;
+	 /// Calls that were timed
+	 ULong64_t fNtimed;
+	 /// Cycles spent evaluating the gate (timed calls only)
+	 ULong64_t fGateCycles;
+	 /// Cycles spent evaluating the parameters (timed calls only)
+	 ULong64_t fParamCycles;
+	 /// Cycles spent filling the internal histogram (timed calls only)
+	 ULong64_t fFillCycles;
+	 Profile(): fNcalls(0), fNpassed(0), fNtimed(0), fGateCycles(0), fParamCycles(0), fFillCycles(0) {}
+	 /// Estimated total cycles of gate, parameter and fill
+	 Double_t GetCost() const {
+		 return fNtimed ? Double_t(fGateCycles + fParamCycles + fFillCycles) * fNcalls / fNtimed : 0.;
+	 }
+};
+
+/// \brief Global switch and reporting for the fill profiler.
+//! \details When disabled (the default), the only overhead in rb::hist::Base::Fill() is a single
+//! test of a static flag.
+class Profiler
+{
+private:
+	 /// Is profiling on?
+	 static Bool_t fgEnabled;
+	 /// Sampling mask (sampling period - 1)
+	 static ULong64_t fgMask;
+public:
+	 /// Turn profiling on, timing one in every \c period fills (rounded up to a power of two)
+	 static void Enable(UInt_t period = 64);
+	 /// Turn profiling off
+	 static void Disable() { fgEnabled = false; }
+	 /// Is profiling on?
+	 static Bool_t IsEnabled() { return fgEnabled; }
+	 /// Return the sampling period
+	 static ULong64_t GetPeriod() { return fgMask + 1; }
+	 /// Should call number \c n be timed?
+	 static Bool_t IsSampled(ULong64_t n) { return (n & fgMask) == 0; }
+	 /// Zero the counters of every histogram
+	 static void Reset();
+	 /// Print histograms and formulae sorted by estimated cost, at most \c nmax of each
+	 static void Print(Int_t nmax = 30, std::ostream& strm = std::cout);
+};
+
+#ifndef __MAKECINT__
+/// \brief Collects profiling counters from histograms for printing.
+class ProfileReport
+{
+private:
+	 /// Histogram name and counters
+	 typedef std::pair<std::string, Profile> HistEntry_t;
+	 /// Counters summed over every histogram using a formula, with the number of users
+	 typedef std::map<std::string, std::pair<FormulaProfile, Int_t> > FormulaMap_t;
+	 /// Histogram entries
+	 std::vector<HistEntry_t> fHists;
+	 /// Formula entries
+	 FormulaMap_t fFormulae;
+public:
+	 /// Add the counters of \c hist and its formulae
+	 void Add(rb::hist::Base* hist);
+	 /// Sort and print
+	 void Print(Int_t nmax, std::ostream& strm);
+private:
+	 /// Add the counters of one set of formulae
+	 void AddFormulae(rb::TreeFormulae* formulae);
+};
+#endif
+}
+}
+
+
+#endif
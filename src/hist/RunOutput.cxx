@@ -0,0 +1,272 @@
+//! \file RunOutput.cxx
+//! \brief Implements RunOutput.hxx
+#include <map>
+#include <deque>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <TFile.h>
+#include <TSystem.h>
+#include "hist/RunOutput.hxx"
+#include "hist/Snapshot.hxx"
+#include "hist/Writer.hxx"
+#include "hist/Manager.hxx"
+#include "Rint.hxx"
+#include "Event.hxx"
+#include "utils/Thread.hxx"
+#include "utils/Mutex.hxx"
+#include "utils/Error.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Utility functions & classes                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace
+{
+/// Name of the writer thread
+const char* kRunWriterThreadName = "HistRunWriter";
+
+/// Longest the writer thread sleeps between checks for work (ms)
+const Int_t kMaxSleep = 100;
+
+/// Contents of one run, waiting to be written
+struct Job
+{
+	 //! Run number
+	 Int_t fRun;
+	 //! File to write
+	 std::string fFilename;
+	 //! Contents of every histogram
+	 std::vector<rb::hist::Retired> fRetired;
+};
+
+/// Everything shared between RunOutput and the writer thread, protected by run_mutex()
+struct State
+{
+	 //! File name pattern, empty when disabled
+	 std::string fPattern;
+	 //! Last run started or stopped
+	 Int_t fRun;
+	 //! Has fRun been started and not stopped?
+	 Bool_t fRunning;
+	 //! Run whose stop transition has been seen but whose events may still be buffered, -1 if none
+	 Int_t fPendingStop;
+	 //! Runs waiting to be written
+	 std::deque<Job> fQueue;
+	 State(): fRun(-1), fRunning(false), fPendingStop(-1) { }
+};
+
+rb::Mutex& run_mutex() {
+	static rb::Mutex* out = new rb::Mutex("rb::hist::RunOutput", false);
+	return *out;
+}
+
+State& the_state() {
+	static State* out = new State();
+	return *out;
+}
+
+/// Does \c pattern have exactly one integer conversion, and no other conversions?
+Bool_t valid_pattern(const char* pattern) {
+	Int_t nconversions = 0;
+	for(const char* c = strchr(pattern, '%'); c; c = strchr(c, '%')) {
+		++c;
+		if(*c == '%') {
+			++c;
+			continue;
+		}
+		c += strspn(c, "0123456789-+ #");
+		if(!*c || !strchr("diu", *c)) return false;
+		++nconversions;
+	}
+	return nconversions == 1;
+}
+
+/// Name of the file for run \c run
+std::string run_filename(const std::string& pattern, Int_t run) {
+	std::vector<char> name(pattern.size() + 32);
+	snprintf(&name[0], name.size(), pattern.c_str(), run);
+	return &name[0];
+}
+
+/// Thread writing the queued runs.
+class RunWriterThread: public rb::Thread
+{
+private:
+	 RunWriterThread(): rb::Thread(kRunWriterThreadName) { }
+	 //! Write \c job to its file, and free its arrays
+	 void Write(Job& job);
+public:
+	 static void CreateAndRun() {
+		 RunWriterThread* writer = new RunWriterThread();
+		 writer->Run();
+	 }
+	 void DoInThread();
+};
+
+void RunWriterThread::Write(Job& job) {
+	// By directory, so the file has the same layout as the histograms
+	std::map<std::string, std::vector<rb::hist::Snapshot> > directories;
+	for(UInt_t i=0; i< job.fRetired.size(); ++i) {
+		job.fRetired[i].Release();
+		directories[job.fRetired[i].fSnapshot.GetDirectory()].push_back(job.fRetired[i].fSnapshot);
+		job.fRetired[i].fSnapshot = rb::hist::Snapshot();
+	}
+	TFile file(job.fFilename.c_str(), "RECREATE");
+	if(file.IsZombie()) {
+		err::Error("rb::hist::RunOutput") << "Couldn't open " << job.fFilename << "; the histograms of run "
+																			<< job.fRun << " are lost.";
+		return;
+	}
+	Int_t nwritten = 0;
+	std::map<std::string, std::vector<rb::hist::Snapshot> >::iterator it;
+	for(it = directories.begin(); it != directories.end(); ++it) {
+		TDirectory* directory = rb::hist::GetSubdirectory(&file, it->first, true);
+		if(directory) nwritten += rb::hist::WriteSnapshots(it->second, directory);
+		else err::Error("rb::hist::RunOutput") << "Couldn't create " << it->first << " in " << job.fFilename << ".";
+		std::vector<rb::hist::Snapshot>().swap(it->second);
+	}
+	file.Close();
+	err::Info("rb::hist::RunOutput") << "Saved " << nwritten << " histograms of run " << job.fRun
+																	 << " to " << job.fFilename << ".";
+}
+
+void RunWriterThread::DoInThread() {
+	while(true) {
+		Job job;
+		Bool_t have_job = false;
+		{
+			rb::ScopedLock<rb::Mutex> lock(run_mutex());
+			if(!the_state().fQueue.empty()) {
+				job = the_state().fQueue.front();
+				the_state().fQueue.pop_front();
+				have_job = true;
+			}
+		}
+		if(have_job) Write(job);
+		else if(IsCancelled()) break; // only once the queue is empty
+		else gSystem->Sleep(kMaxSleep);
+	}
+}
+
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::RunOutput                                   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::RunOutput::Enable()                  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::RunOutput::Enable(const char* pattern) {
+	if(!pattern || !valid_pattern(pattern)) {
+		err::Error("rb::hist::RunOutput::Enable") << "The file name needs exactly one integer conversion "
+																							<< "(e.g. %05d) for the run number.";
+		return false;
+	}
+	{
+		rb::ScopedLock<rb::Mutex> lock(run_mutex());
+		if(!the_state().fPattern.empty()) {
+			err::Error("rb::hist::RunOutput::Enable") << "Histograms are already saved at run stops, to "
+																								<< the_state().fPattern << ".";
+			return false;
+		}
+		the_state().fPattern = pattern;
+	}
+	if(!rb::Thread::IsRunning(kRunWriterThreadName)) RunWriterThread::CreateAndRun();
+	err::Info("rb::hist::RunOutput") << "Saving and zeroing the histograms at every run stop, to " << pattern << ".";
+	return true;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::RunOutput::Disable()                   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::RunOutput::Disable() {
+	{
+		rb::ScopedLock<rb::Mutex> lock(run_mutex());
+		the_state().fPattern.clear();
+	}
+	rb::Thread::Stop(kRunWriterThreadName); // returns once the queue is written
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::RunOutput::IsEnabled()               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::RunOutput::IsEnabled() {
+	rb::ScopedLock<rb::Mutex> lock(run_mutex());
+	return !the_state().fPattern.empty();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::RunOutput::RunStart()                  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::RunOutput::RunStart(Int_t run) {
+	Int_t pending = -1;
+	{
+		rb::ScopedLock<rb::Mutex> lock(run_mutex());
+		pending = the_state().fPendingStop;
+	}
+	// Never drained: whatever is still buffered of the old run is lost to it, but the runs stay apart
+	if(pending >= 0 && pending != run) RunStop(pending);
+	rb::ScopedLock<rb::Mutex> lock(run_mutex());
+	the_state().fRun = run;
+	the_state().fRunning = true;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::RunOutput::RunStopping()               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::RunOutput::RunStopping(Int_t run) {
+	rb::ScopedLock<rb::Mutex> lock(run_mutex());
+	State& state = the_state();
+	if(!state.fRunning && state.fRun == run) return; // already stopped in the stream
+	state.fPendingStop = run;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::RunOutput::Drained()                   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::RunOutput::Drained() {
+	Int_t pending = -1;
+	{
+		rb::ScopedLock<rb::Mutex> lock(run_mutex());
+		pending = the_state().fPendingStop;
+	}
+	if(pending >= 0) RunStop(pending);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::RunOutput::RunStop()                   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::RunOutput::RunStop(Int_t run) {
+	Job job;
+	{
+		rb::ScopedLock<rb::Mutex> lock(run_mutex());
+		State& state = the_state();
+		if(state.fPendingStop == run) state.fPendingStop = -1;
+		if(!state.fRunning && state.fRun == run) return; // already stopped
+		state.fRun = run;
+		state.fRunning = false;
+		if(state.fPattern.empty()) return;
+		job.fRun = run;
+		job.fFilename = run_filename(state.fPattern, run);
+	}
+
+	rb::EventVector_t events = rb::gApp()->GetEventVector();
+	for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it) {
+		rb::Event* event = rb::gApp()->GetEvent(it->first);
+		if(event) event->GetHistManager()->SwapOutAll(job.fRetired);
+	}
+
+	rb::ScopedLock<rb::Mutex> lock(run_mutex());
+	if(rb::Thread::IsRunning(kRunWriterThreadName)) {
+		the_state().fQueue.push_back(job);
+		return;
+	}
+	// Disabled meanwhile: nothing will write it
+	for(UInt_t i=0; i< job.fRetired.size(); ++i)
+		job.fRetired[i].Release();
+}
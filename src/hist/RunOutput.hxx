@@ -0,0 +1,46 @@
+//! \file RunOutput.hxx
+//! \brief Defines the splitting of histograms into per-run files at run boundaries.
+#ifndef HIST_RUN_OUTPUT_HXX
+#define HIST_RUN_OUTPUT_HXX
+#include <Rtypes.h>
+
+namespace rb
+{
+namespace hist
+{
+/// \brief Saves the histograms of each run to a file of its own, and zeroes them for the next run.
+//! \details While enabled, RunStop() swaps the contents of every histogram out for zeroed arrays (see
+//! Manager::SwapOutAll()) and queues the old contents for a thread (named "HistRunWriter") that saves
+//! them to the run's file (see WriteSnapshots()). Filling only ever waits for pointers to be swapped,
+//! so the next run's first events land in the zeroed histograms and counts of consecutive runs never
+//! mix. The swap has to wait until every event of the run has been unpacked: a stop transition only
+//! calls RunStopping(), and the thread unpacking the data calls RunStop() when it unpacks the run's
+//! end-of-run event, or Drained() whenever its source has no events waiting (online, where the
+//! end-of-run event is usually not in the stream), whichever comes first (see rb::Midas). Repeated
+//! calls for the same run are ignored.
+class RunOutput
+{
+public:
+	 /// Start saving and zeroing the histograms at every run stop.
+	 //! \param pattern Name of the per-run files, with a printf-style integer conversion for the run
+	 //! number, e.g. "run%05d_hists.root"
+	 //! \returns false if it is already enabled or \c pattern is invalid
+	 static Bool_t Enable(const char* pattern);
+	 /// Stop saving at run stops, after writing any runs still queued.
+	 static void Disable();
+	 /// Is saving at run stops enabled?
+	 static Bool_t IsEnabled();
+	 /// Note the start of run \c run, first stopping a run still waiting to be drained.
+	 static void RunStart(Int_t run);
+	 /// Note the stop transition of run \c run; it is swapped out at the next Drained() or RunStop().
+	 static void RunStopping(Int_t run);
+	 /// Called by the unpacking thread when no events are waiting: swaps out a run waiting to stop.
+	 static void Drained();
+	 /// Swap the histograms out and queue them to be saved as run \c run (if enabled), each in its directory.
+	 static void RunStop(Int_t run);
+};
+
+}
+}
+
+#endif
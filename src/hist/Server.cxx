@@ -0,0 +1,683 @@
+//! \file Server.cxx
+//! \brief Implements Server.hxx
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <TTimeStamp.h>
+#include "hist/Server.hxx"
+#include "utils/Thread.hxx"
+#include "utils/Affinity.hxx"
+#include "utils/Error.hxx"
+
+#ifndef MSG_NOSIGNAL // e.g. OS X, where SO_NOSIGPIPE is set on the socket instead
+#define MSG_NOSIGNAL 0
+#endif
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Utility functions & classes                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace
+{
+/// Name of the server thread
+const char* kServerThreadName = "HistServer";
+
+/// How often (ms) the server thread checks whether it has been stopped
+const Int_t kPollTimeout = 200;
+
+/// Longest request accepted (bytes)
+const std::size_t kMaxRequest = 4096;
+
+/// Unchanged cells between two changed ones are sent rather than starting a new run
+/// if there are at most this many (a run header costs as much as one cell)
+const UInt_t kMaxGap = 1;
+
+/// Do two snapshots have the same axes and title?
+inline Bool_t same_axes(const rb::hist::Snapshot& lhs, const rb::hist::Snapshot& rhs) {
+	if(lhs.fNdimensions != rhs.fNdimensions || lhs.fTitle != rhs.fTitle) return false;
+	for(Int_t i=0; i< 3; ++i) {
+		if(lhs.fNbins[i] != rhs.fNbins[i] || lhs.fLow[i] != rhs.fLow[i] ||
+			 lhs.fHigh[i] != rhs.fHigh[i] || lhs.fEdges[i] != rhs.fEdges[i]) return false;
+	}
+	return true;
+}
+
+/// Number of cells (including under- and overflows) of a snapshot's histogram
+inline UInt_t ncells(const rb::hist::Snapshot& snapshot) {
+	UInt_t n = 1;
+	for(Int_t i=0; i< snapshot.fNdimensions && i< 3; ++i) n *= snapshot.fNbins[i] + 2;
+	return n;
+}
+
+/// Replace tabs and newlines, which would break up a protocol line
+inline std::string field(const std::string& str) {
+	std::string out(str);
+	for(std::string::size_type i=0; i< out.size(); ++i)
+		 if(out[i] == '\t' || out[i] == '\n' || out[i] == '\r') out[i] = ' ';
+	return out;
+}
+
+/// Split a protocol line into its fields
+inline std::vector<std::string> split(const std::string& line) {
+	std::vector<std::string> out;
+	std::string::size_type begin = 0, end;
+	while((end = line.find('\t', begin)) != std::string::npos) {
+		out.push_back(line.substr(begin, end - begin));
+		begin = end + 1;
+	}
+	out.push_back(line.substr(begin));
+	return out;
+}
+
+/// Append the bytes of \c value to \c out
+template <class T>
+inline void append(std::string& out, const T* value, std::size_t n = 1) {
+	out.append(reinterpret_cast<const char*>(value), n * sizeof(T));
+}
+
+/// Take \c n values from the front of [\c pos, \c end), false if there aren't enough bytes
+template <class T>
+inline Bool_t take(const char*& pos, const char* end, T* value, std::size_t n = 1) {
+	if(std::size_t(end - pos) < n * sizeof(T)) return false;
+	memcpy(value, pos, n * sizeof(T));
+	pos += n * sizeof(T);
+	return true;
+}
+
+/// Send as much of \c out as the (non-blocking) socket accepts
+//! \returns false if the connection failed
+Bool_t send_some(int fd, std::string& out) {
+	while(!out.empty()) {
+		const ssize_t nsent = send(fd, out.data(), out.size(), MSG_NOSIGNAL);
+		if(nsent < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+		out.erase(0, nsent);
+	}
+	return true;
+}
+
+/// Set options common to server and client sockets
+inline void setup_socket(int fd) {
+#ifdef SO_NOSIGPIPE
+	int yes = 1;
+	setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof(yes));
+#endif
+}
+
+/// One viewer's connection
+struct Connection
+{
+	 //! Requests received but not yet handled
+	 std::string fInput;
+	 //! Replies not yet sent
+	 std::string fOutput;
+	 //! Cells last sent for each histogram, by path
+	 std::map<std::string, std::vector<Double_t> > fSent;
+};
+
+/// Catalogue entry
+struct Entry
+{
+	 //! Latest snapshot
+	 rb::hist::Snapshot fSnapshot;
+	 //! Changes whenever the contents do
+	 ULong64_t fSerial;
+	 //! Time fSnapshot was taken
+	 Double_t fTaken;
+};
+
+/// Thread doing all of the server's work.
+class ServerThread: public rb::Thread
+{
+private:
+	 //! Listening socket
+	 int fListen;
+	 //! Minimum time between snapshots (seconds)
+	 Double_t fPeriod;
+	 //! Time of the last snapshot
+	 Double_t fRefreshed;
+	 //! Catalogue version, bumped when histograms are created, deleted or redefined
+	 ULong64_t fVersion;
+	 //! Last serial handed out
+	 ULong64_t fSerial;
+	 //! Latest snapshots, by path
+	 std::map<std::string, Entry> fCatalogue;
+	 //! Open connections, by socket
+	 std::map<int, Connection> fConnections;
+
+	 ServerThread(int listen, Double_t period):
+		 rb::Thread(kServerThreadName, rb::Affinity::kCanvas),
+		 fListen(listen), fPeriod(period), fRefreshed(0), fVersion(0), fSerial(0) { }
+public:
+	 ~ServerThread() {
+		 for(std::map<int, Connection>::iterator it = fConnections.begin(); it != fConnections.end(); ++it)
+				close(it->first);
+		 close(fListen);
+	 }
+	 static void CreateAndRun(int listen, Double_t period) {
+		 ServerThread* server = new ServerThread(listen, period);
+		 server->Run();
+	 }
+	 void DoInThread();
+private:
+	 //! Snapshot every histogram, unless the last snapshot is less than fPeriod old
+	 void Refresh();
+	 //! Snapshot the histogram at \c path only, unless its last snapshot is less than fPeriod old
+	 void Refresh(const std::string& path);
+	 //! A histogram was created, deleted or redefined: bump fVersion and forget what was sent of the gone ones
+	 void Redefined();
+	 //! Read and answer requests
+	 //! \returns false if the connection should be closed
+	 Bool_t Receive(int fd, Connection& connection);
+	 //! Answer a "list" request
+	 void List(Connection& connection);
+	 //! Answer a "get" request
+	 void Get(Connection& connection, const std::string& path, Bool_t full);
+};
+
+void ServerThread::DoInThread() {
+	std::vector<pollfd> fds;
+	while(!IsCancelled()) {
+		fds.clear();
+		pollfd listener = { fListen, POLLIN, 0 };
+		fds.push_back(listener);
+		for(std::map<int, Connection>::iterator it = fConnections.begin(); it != fConnections.end(); ++it) {
+			pollfd connection = { it->first, short(POLLIN | (it->second.fOutput.empty() ? 0 : POLLOUT)), 0 };
+			fds.push_back(connection);
+		}
+		const int nready = poll(&fds[0], fds.size(), kPollTimeout);
+		if(nready < 0 && errno != EINTR) {
+			err::Error("rb::hist::Server") << "poll() failed (" << strerror(errno) << "), stopping the server.";
+			break;
+		}
+		if(nready <= 0) continue;
+
+		for(std::vector<pollfd>::size_type i = 1; i< fds.size(); ++i) {
+			if(!fds[i].revents) continue;
+			std::map<int, Connection>::iterator it = fConnections.find(fds[i].fd);
+			Bool_t keep = !(fds[i].revents & (POLLERR | POLLNVAL));
+			if(keep && (fds[i].revents & (POLLIN | POLLHUP))) keep = Receive(it->first, it->second);
+			if(keep) keep = send_some(it->first, it->second.fOutput);
+			if(!keep) {
+				close(it->first);
+				fConnections.erase(it);
+			}
+		}
+		if(fds[0].revents & POLLIN) {
+			const int fd = accept(fListen, 0, 0);
+			if(fd < 0) continue;
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+			setup_socket(fd);
+			fConnections[fd];
+		}
+	}
+}
+
+void ServerThread::Refresh() {
+	const Double_t now = TTimeStamp().AsDouble();
+	if(fRefreshed && now - fRefreshed < fPeriod) return;
+	fRefreshed = now;
+
+	std::vector<rb::hist::Snapshot> snapshots;
+	rb::hist::SnapshotAll(snapshots);
+
+	std::map<std::string, Entry> catalogue;
+	Bool_t redefined = snapshots.size() != fCatalogue.size();
+	for(std::vector<rb::hist::Snapshot>::iterator it = snapshots.begin(); it != snapshots.end(); ++it) {
+		Entry& entry = catalogue[it->fPath];
+		std::map<std::string, Entry>::iterator old = fCatalogue.find(it->fPath);
+		if(old == fCatalogue.end() || !same_axes(old->second.fSnapshot, *it)) {
+			redefined = true;
+			entry.fSerial = ++fSerial;
+		}
+		else if(old->second.fSnapshot.fBins != it->fBins || old->second.fSnapshot.fEntries != it->fEntries)
+			 entry.fSerial = ++fSerial;
+		else
+			 entry.fSerial = old->second.fSerial;
+		entry.fSnapshot = *it;
+		entry.fTaken = now;
+	}
+	fCatalogue.swap(catalogue);
+	if(redefined) Redefined();
+}
+
+void ServerThread::Refresh(const std::string& path) {
+	const Double_t now = TTimeStamp().AsDouble();
+	std::map<std::string, Entry>::iterator old = fCatalogue.find(path);
+	if(old != fCatalogue.end() && now - old->second.fTaken < fPeriod) return;
+
+	rb::hist::Snapshot snapshot;
+	if(!rb::hist::SnapshotPath(path, snapshot)) {
+		if(old == fCatalogue.end()) return;
+		fCatalogue.erase(old);
+		Redefined();
+		return;
+	}
+	Entry& entry = fCatalogue[path];
+	if(old == fCatalogue.end() || !same_axes(entry.fSnapshot, snapshot)) {
+		entry.fSerial = ++fSerial;
+		Redefined();
+	}
+	else if(entry.fSnapshot.fBins != snapshot.fBins || entry.fSnapshot.fEntries != snapshot.fEntries)
+		 entry.fSerial = ++fSerial;
+	entry.fSnapshot = snapshot;
+	entry.fTaken = now;
+}
+
+void ServerThread::Redefined() {
+	++fVersion;
+	for(std::map<int, Connection>::iterator it = fConnections.begin(); it != fConnections.end(); ++it) {
+		std::map<std::string, std::vector<Double_t> >& sent = it->second.fSent;
+		for(std::map<std::string, std::vector<Double_t> >::iterator s = sent.begin(); s != sent.end(); ) {
+			if(fCatalogue.count(s->first)) ++s;
+			else sent.erase(s++);
+		}
+	}
+}
+
+Bool_t ServerThread::Receive(int fd, Connection& connection) {
+	char buffer[4096];
+	const ssize_t nread = recv(fd, buffer, sizeof(buffer), 0);
+	if(nread == 0) return false;
+	if(nread < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+	connection.fInput.append(buffer, nread);
+
+	std::string::size_type newline;
+	while((newline = connection.fInput.find('\n')) != std::string::npos) {
+		std::string line = connection.fInput.substr(0, newline);
+		connection.fInput.erase(0, newline + 1);
+		std::istringstream request(line);
+		std::string command, path, option;
+		request >> command >> path >> option;
+		if(command == "list") {
+			Refresh();
+			List(connection);
+		}
+		else if(command == "get" && !path.empty()) {
+			Refresh(path); // a viewer drawing one histogram costs one snapshot, not all of them
+			Get(connection, path, option == "full");
+		}
+		else if(command == "quit")
+			 return false;
+		else if(!command.empty())
+			 connection.fOutput += "error\tInvalid request: " + field(line) + "\n";
+	}
+	return connection.fInput.size() <= kMaxRequest;
+}
+
+void ServerThread::List(Connection& connection) {
+	std::ostringstream out;
+	out << std::setprecision(17);
+	out << "catalogue\t" << fVersion << "\t" << fCatalogue.size() << "\n";
+	for(std::map<std::string, Entry>::iterator it = fCatalogue.begin(); it != fCatalogue.end(); ++it) {
+		const rb::hist::Snapshot& snapshot = it->second.fSnapshot;
+		out << "hist\t" << field(snapshot.fPath) << "\t" << it->second.fSerial << "\t" << snapshot.fNdimensions;
+		for(Int_t i=0; i< 3; ++i)
+			 out << "\t" << snapshot.fNbins[i] << "\t" << snapshot.fLow[i] << "\t" << snapshot.fHigh[i];
+		out << "\t" << field(snapshot.fTitle) << "\n";
+		for(Int_t i=0; i< 3; ++i) {
+			if(snapshot.fEdges[i].empty()) continue;
+			out << "edges\t" << i << "\t" << snapshot.fEdges[i].size();
+			for(std::vector<Double_t>::size_type j=0; j< snapshot.fEdges[i].size(); ++j)
+				 out << "\t" << snapshot.fEdges[i][j];
+			out << "\n";
+		}
+	}
+	out << "end\n";
+	connection.fOutput += out.str();
+}
+
+void ServerThread::Get(Connection& connection, const std::string& path, Bool_t full) {
+	std::map<std::string, Entry>::iterator it = fCatalogue.find(path);
+	if(it == fCatalogue.end()) {
+		connection.fOutput += "error\tNo histogram " + field(path) + "\n";
+		return;
+	}
+	const rb::hist::Snapshot& snapshot = it->second.fSnapshot;
+	const std::vector<Double_t>& bins = snapshot.fBins;
+	std::vector<Double_t>& sent = connection.fSent[path];
+	if(sent.size() != bins.size()) full = true;
+
+	std::string raw;
+	append(raw, snapshot.fStats, rb::hist::Snapshot::kNstats);
+	const UInt_t n = bins.size();
+	UInt_t nruns = 0;
+	for(UInt_t first = 0; first< n; ) {
+		if(!full && bins[first] == sent[first]) { ++first; continue; }
+		UInt_t last = first;
+		for(UInt_t i = first + 1; i< n && i - last <= kMaxGap + 1; ++i)
+			 if(full || bins[i] != sent[i]) last = i;
+		const UInt_t count = last - first + 1;
+		append(raw, &first);
+		append(raw, &count);
+		append(raw, &bins[first], count);
+		++nruns;
+		first = last + 1;
+	}
+	sent = bins;
+
+	uLongf zipsize = compressBound(raw.size());
+	std::string zip(zipsize, '\0');
+	if(compress2(reinterpret_cast<Bytef*>(&zip[0]), &zipsize,
+							 reinterpret_cast<const Bytef*>(raw.data()), raw.size(), Z_BEST_SPEED) != Z_OK) {
+		sent.clear();
+		connection.fOutput += "error\tCompression failed\n";
+		return;
+	}
+	zip.resize(zipsize);
+
+	std::ostringstream header;
+	header << std::setprecision(17);
+	header << "delta\t" << field(path) << "\t" << it->second.fSerial << "\t" << n << "\t" << nruns
+				 << "\t" << raw.size() << "\t" << zip.size() << "\t" << snapshot.fEntries << "\n";
+	connection.fOutput += header.str();
+	connection.fOutput += zip;
+}
+
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::Server                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::Server::Start()                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Server::Start(Int_t port, Double_t period, Bool_t lan) {
+	if(IsRunning()) {
+		err::Error("rb::hist::Server::Start") << "The histogram server is already running.";
+		return false;
+	}
+	const int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if(fd < 0) {
+		err::Error("rb::hist::Server::Start") << "Couldn't create a socket: " << strerror(errno);
+		return false;
+	}
+	int yes = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(lan ? INADDR_ANY : INADDR_LOOPBACK);
+	if(bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(fd, 16) < 0) {
+		err::Error("rb::hist::Server::Start") << "Couldn't listen on port " << port << ": " << strerror(errno);
+		close(fd);
+		return false;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	ServerThread::CreateAndRun(fd, period);
+	err::Info("rb::hist::Server") << "Serving histograms on port " << port
+																<< (lan ? " to the local network." : " to localhost.");
+	return true;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Server::Stop()                         //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Server::Stop() {
+	rb::Thread::Stop(kServerThreadName);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::Server::IsRunning()                  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Server::IsRunning() {
+	return rb::Thread::IsRunning(kServerThreadName);
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::Client                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor                                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Client::Client(): fSocket(-1) { }
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Destructor                                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Client::~Client() {
+	Disconnect();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::Client::Connect()                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Client::Connect(const char* host, Int_t port) {
+	Disconnect();
+	std::ostringstream service;
+	service << port;
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* addresses = 0;
+	const int error = getaddrinfo(host, service.str().c_str(), &hints, &addresses);
+	if(error) {
+		err::Error("rb::hist::Client::Connect") << host << ": " << gai_strerror(error);
+		return false;
+	}
+	for(addrinfo* address = addresses; address && fSocket < 0; address = address->ai_next) {
+		fSocket = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+		if(fSocket < 0) continue;
+		if(connect(fSocket, address->ai_addr, address->ai_addrlen) < 0) {
+			close(fSocket);
+			fSocket = -1;
+		}
+	}
+	freeaddrinfo(addresses);
+	if(fSocket < 0) {
+		err::Error("rb::hist::Client::Connect") << "Couldn't connect to " << host << ":" << port
+																						<< " (" << strerror(errno) << ")";
+		return false;
+	}
+	setup_socket(fSocket);
+	return true;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Client::Disconnect()                   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Client::Disconnect() {
+	if(fSocket >= 0) {
+		send(fSocket, "quit\n", 5, MSG_NOSIGNAL);
+		close(fSocket);
+	}
+	fSocket = -1;
+	fInput.clear();
+	fSnapshots.clear();
+	fSerials.clear();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::Client::Send()                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Client::Send(const std::string& request) {
+	if(!IsConnected()) return false;
+	for(std::string::size_type nsent = 0; nsent < request.size(); ) {
+		const ssize_t n = send(fSocket, request.data() + nsent, request.size() - nsent, MSG_NOSIGNAL);
+		if(n < 0 && errno == EINTR) continue;
+		if(n < 0) {
+			err::Error("rb::hist::Client") << "Lost the connection: " << strerror(errno);
+			Disconnect();
+			return false;
+		}
+		nsent += n;
+	}
+	return true;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::Client::Receive()                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Client::Receive() {
+	char buffer[65536];
+	while(IsConnected()) {
+		const ssize_t nread = recv(fSocket, buffer, sizeof(buffer), 0);
+		if(nread < 0 && errno == EINTR) continue;
+		if(nread > 0) {
+			fInput.append(buffer, nread);
+			return true;
+		}
+		err::Error("rb::hist::Client") << "Lost the connection.";
+		Disconnect();
+	}
+	return false;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::Client::ReadBytes()                  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Client::ReadBytes(std::string& bytes, std::size_t n) {
+	while(fInput.size() < n)
+		 if(!Receive()) return false;
+	bytes.assign(fInput, 0, n);
+	fInput.erase(0, n);
+	return true;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::Client::ReadLine()                   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Client::ReadLine(std::string& line) {
+	std::string::size_type newline;
+	while((newline = fInput.find('\n')) == std::string::npos)
+		 if(!Receive()) return false;
+	line.assign(fInput, 0, newline);
+	fInput.erase(0, newline + 1);
+	return true;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::Client::List()                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Client::List(std::vector<Snapshot>& snapshots) {
+	if(!Send("list\n")) return false;
+	std::string line;
+	if(!ReadLine(line)) return false;
+	if(split(line)[0] != "catalogue") {
+		err::Error("rb::hist::Client::List") << line;
+		return false;
+	}
+	snapshots.clear();
+	while(ReadLine(line) && line != "end") {
+		std::vector<std::string> fields = split(line);
+		if(fields[0] == "hist" && fields.size() >= 14) {
+			Snapshot snapshot;
+			snapshot.fPath = fields[1];
+			snapshot.fNdimensions = atoi(fields[3].c_str());
+			for(Int_t i=0; i< 3; ++i) {
+				snapshot.fNbins[i] = atoi(fields[4+3*i].c_str());
+				snapshot.fLow[i]   = strtod(fields[5+3*i].c_str(), 0);
+				snapshot.fHigh[i]  = strtod(fields[6+3*i].c_str(), 0);
+			}
+			snapshot.fTitle = fields[13];
+			snapshots.push_back(snapshot);
+		}
+		else if(fields[0] == "edges" && fields.size() >= 3 && !snapshots.empty()) {
+			const Int_t axis = atoi(fields[1].c_str());
+			if(axis < 0 || axis > 2) continue;
+			std::vector<Double_t>& edges = snapshots.back().fEdges[axis];
+			for(std::vector<std::string>::size_type i=3; i< fields.size(); ++i)
+				 edges.push_back(strtod(fields[i].c_str(), 0));
+		}
+	}
+	if(!IsConnected()) return false;
+
+	// Keep the contents of local copies whose definition hasn't changed
+	std::map<std::string, Snapshot> copies;
+	std::map<std::string, ULong64_t> serials;
+	for(std::vector<Snapshot>::iterator it = snapshots.begin(); it != snapshots.end(); ++it) {
+		Snapshot& copy = copies[it->fPath];
+		std::map<std::string, Snapshot>::iterator old = fSnapshots.find(it->fPath);
+		if(old != fSnapshots.end() && same_axes(old->second, *it)) {
+			copy = old->second;
+			serials[it->fPath] = fSerials[it->fPath];
+		}
+		else copy = *it;
+	}
+	fSnapshots.swap(copies);
+	fSerials.swap(serials);
+	return true;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// const Snapshot* rb::hist::Client::Update()            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+const rb::hist::Snapshot* rb::hist::Client::Update(const char* path, Int_t* nchanged) {
+	if(nchanged) *nchanged = 0;
+	std::map<std::string, Snapshot>::iterator it = fSnapshots.find(path);
+	if(it == fSnapshots.end()) {
+		std::vector<Snapshot> listed;
+		if(!List(listed)) return 0;
+		it = fSnapshots.find(path);
+		if(it == fSnapshots.end()) {
+			err::Error("rb::hist::Client::Update") << "No histogram " << path;
+			return 0;
+		}
+	}
+	Snapshot& copy = it->second;
+	const Bool_t full = copy.fBins.size() != ncells(copy);
+	if(!Send(std::string("get ") + path + (full ? " full\n" : "\n"))) return 0;
+
+	std::string line;
+	if(!ReadLine(line)) return 0;
+	std::vector<std::string> fields = split(line);
+	if(fields[0] != "delta" || fields.size() < 8) {
+		err::Error("rb::hist::Client::Update") << line;
+		return 0;
+	}
+	const ULong64_t serial = strtoull(fields[2].c_str(), 0, 10);
+	const UInt_t n = strtoul(fields[3].c_str(), 0, 10);
+	const UInt_t nruns = strtoul(fields[4].c_str(), 0, 10);
+	const std::size_t rawbytes = strtoul(fields[5].c_str(), 0, 10);
+	const std::size_t zipbytes = strtoul(fields[6].c_str(), 0, 10);
+	std::string zip;
+	if(!ReadBytes(zip, zipbytes)) return 0;
+
+	if(n != ncells(copy)) { // redefined since we last listed
+		err::Error("rb::hist::Client::Update") << path << " has been redefined, call List() again.";
+		copy.fBins.clear();
+		return 0;
+	}
+	std::string raw(rawbytes, '\0');
+	uLongf rawsize = rawbytes;
+	Bool_t good = rawbytes > 0 &&
+		 uncompress(reinterpret_cast<Bytef*>(&raw[0]), &rawsize,
+								reinterpret_cast<const Bytef*>(zip.data()), zip.size()) == Z_OK && rawsize == rawbytes;
+	if(full) copy.fBins.assign(n, 0.);
+	const char* pos = raw.data();
+	const char* end = pos + raw.size();
+	good = good && take(pos, end, copy.fStats, Snapshot::kNstats);
+	Int_t nreceived = 0;
+	for(UInt_t i = 0; good && i< nruns; ++i) {
+		UInt_t first = 0, count = 0;
+		good = take(pos, end, &first) && take(pos, end, &count) && first + count <= n &&
+			 take(pos, end, &copy.fBins[0] + first, count);
+		nreceived += count;
+	}
+	if(!good) {
+		err::Error("rb::hist::Client::Update") << "Corrupt reply for " << path << ", disconnecting.";
+		Disconnect();
+		return 0;
+	}
+	copy.fEntries = strtod(fields[7].c_str(), 0);
+	fSerials[path] = serial;
+	if(nchanged) *nchanged = nreceived;
+	return &copy;
+}
@@ -0,0 +1,96 @@
+//! \file Server.hxx
+//! \brief Defines a TCP server publishing histograms to remote viewers, and a client for it.
+#ifndef HIST_SERVER_HXX
+#define HIST_SERVER_HXX
+#include <map>
+#include <string>
+#include <vector>
+#include "hist/Snapshot.hxx"
+
+namespace rb
+{
+namespace hist
+{
+/// \brief Serves the histogram catalogue and contents over TCP.
+//! \details All work is done by one thread (named "HistServer") which never fills anything:
+//! it snapshots histograms only when a viewer asks for something, and each at most once per
+//! refresh period: <tt>list</tt> takes every histogram (see SnapshotAll()), <tt>get</tt> only the
+//! one requested (see SnapshotPath()), so any number of viewers cost the fill thread at most
+//! one snapshot of each histogram per period. Each connection remembers the bins it was last sent, and gets
+//! only the cells that have changed since, zlib compressed.
+//!
+//! The protocol is line based; requests are
+//! - <tt>list</tt>: replies <tt>catalogue \<version\> \<n\></tt>, then one line
+//!   <tt>hist \<path\> \<serial\> \<ndim\> \<nx\> \<xlow\> \<xhigh\> \<ny\> ... \<zhigh\> \<title\></tt>
+//!   per histogram, each followed by an <tt>edges \<axis\> \<n\> \<edge\>...</tt> line for any
+//!   variable bin axes, and finally <tt>end</tt>.
+//! - <tt>get \<path\> [full]</tt>: replies
+//!   <tt>delta \<path\> \<serial\> \<ncells\> \<nruns\> \<rawbytes\> \<zipbytes\> \<entries\></tt>,
+//!   followed by \c zipbytes of zlib data which inflate to the histogram statistics
+//!   (Snapshot::kNstats doubles) and \c nruns runs of changed cells (UInt_t first cell,
+//!   UInt_t number of cells, then the cell contents as doubles). \c full sends every cell.
+//! - <tt>quit</tt>: closes the connection.
+//!
+//! Fields are tab separated, binary data are in the server's byte order, and failed
+//! requests are answered by <tt>error \<message\></tt>. The catalogue version changes whenever
+//! histograms are created, deleted or redefined; the serial of a histogram whenever its contents change.
+class Server
+{
+public:
+	 /// Start serving on \c port.
+	 //! \param period Minimum time between snapshots, in seconds
+	 //! \param lan If true, accept connections from other hosts, otherwise only from localhost
+	 //! \returns false if the server is already running or the port can't be bound
+	 static Bool_t Start(Int_t port, Double_t period, Bool_t lan);
+	 /// Stop serving, closing all connections.
+	 static void Stop();
+	 /// Is the server running?
+	 static Bool_t IsRunning();
+};
+
+/// \brief Client side of Server.
+//! \details Keeps a copy of every histogram it has listed, bringing it up to date with
+//! the deltas sent by the server. Blocking, and not thread safe.
+class Client
+{
+private:
+	 //! Socket, -1 if not connected
+	 Int_t fSocket;
+	 //! Bytes received but not yet used
+	 std::string fInput;
+	 //! Local copies, by path
+	 std::map<std::string, Snapshot> fSnapshots;
+	 //! Serial of each local copy
+	 std::map<std::string, ULong64_t> fSerials;
+	 //! Append whatever arrives next to fInput
+	 Bool_t Receive();
+	 //! Read one line (without the newline)
+	 Bool_t ReadLine(std::string& line);
+	 //! Read \c n bytes
+	 Bool_t ReadBytes(std::string& bytes, std::size_t n);
+	 //! Send a request line
+	 Bool_t Send(const std::string& request);
+public:
+	 /// Not connected
+	 Client();
+	 /// Disconnects
+	 ~Client();
+	 /// Connect to a server
+	 Bool_t Connect(const char* host, Int_t port);
+	 /// Close the connection, forgetting all local copies
+	 void Disconnect();
+	 /// Is the connection open?
+	 Bool_t IsConnected() const { return fSocket >= 0; }
+	 /// Request the catalogue, replacing \c snapshots by the definitions (without contents) of every histogram.
+	 //! \returns false if the connection failed
+	 Bool_t List(std::vector<Snapshot>& snapshots);
+	 /// Bring the local copy of histogram \c path up to date.
+	 //! \param nchanged If not null, set to the number of cells received
+	 //! \returns the local copy, or null on error (the connection is closed if it failed)
+	 const Snapshot* Update(const char* path, Int_t* nchanged = 0);
+};
+
+}
+}
+
+#endif
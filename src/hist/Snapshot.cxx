@@ -0,0 +1,202 @@
+//! \file Snapshot.cxx
+//! \brief Implements Snapshot.hxx
+#include <algorithm>
+#include <TH1D.h>
+#include <TH2D.h>
+#include <TH3D.h>
+#include <TParameter.h>
+#include "hist/Snapshot.hxx"
+#include "hist/Manager.hxx"
+#include "Rint.hxx"
+#include "Event.hxx"
+#include "utils/Mutex.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::Snapshot                                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+const Int_t rb::hist::Snapshot::kNstats;
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor                                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Snapshot::Snapshot(): fNdimensions(0), fMinimum(-1111), fMaximum(-1111), fEntries(0), fScaleFactor(1) {
+	for(Int_t i=0; i< 3; ++i) {
+		fNbins[i] = 1;
+		fLow[i] = 0;
+		fHigh[i] = 1;
+	}
+	std::fill(fStats, fStats + kNstats, 0.);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Snapshot::Take()                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Snapshot::Take(const TH1* hist, const std::string& path) {
+	TakeDefinition(hist, path);
+	const TArrayD* bins = dynamic_cast<const TArrayD*>(hist);
+	if(bins) fBins.assign(bins->GetArray(), bins->GetArray() + bins->GetSize());
+	else fBins.clear();
+	const TArrayD* sumw2 = hist->GetSumw2N() ? hist->GetSumw2() : 0;
+	if(sumw2) fSumw2.assign(sumw2->GetArray(), sumw2->GetArray() + sumw2->GetSize());
+	else fSumw2.clear();
+	std::fill(fStats, fStats + kNstats, 0.);
+	hist->GetStats(fStats);
+	fEntries = hist->GetEntries();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Snapshot::TakeDefinition()             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Snapshot::TakeDefinition(const TH1* hist, const std::string& path) {
+	fPath = path;
+	fTitle = hist->GetTitle();
+	fScaleFactor = 1;
+	fNdimensions = hist->GetDimension();
+	const TAxis* axes[3] = { hist->GetXaxis(), hist->GetYaxis(), hist->GetZaxis() };
+	for(Int_t i=0; i< 3; ++i) {
+		fNbins[i] = axes[i]->GetNbins();
+		fLow[i]   = axes[i]->GetXmin();
+		fHigh[i]  = axes[i]->GetXmax();
+		const TArrayD* edges = axes[i]->GetXbins();
+		if(edges->GetSize()) fEdges[i].assign(edges->GetArray(), edges->GetArray() + edges->GetSize());
+		else fEdges[i].clear();
+		fAxisTitles[i] = axes[i]->GetTitle();
+	}
+	fOption = hist->GetOption();
+	fMinimum = hist->GetMinimumStored();
+	fMaximum = hist->GetMaximumStored();
+	hist->TAttLine::Copy(fLine);
+	hist->TAttFill::Copy(fFill);
+	hist->TAttMarker::Copy(fMarker);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// TH1* rb::hist::Snapshot::Build()                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+TH1* rb::hist::Snapshot::Build(const char* name) const {
+	const std::string hname = (name && *name) ? name : GetName();
+	TH1* hist = 0;
+	{ // TH1::AddDirectory() is global, so keep other threads out while it's off
+		rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+		const Bool_t add = TH1::AddDirectoryStatus();
+		TH1::AddDirectory(false);
+		switch(fNdimensions) {
+		case 1:
+			hist = new TH1D(hname.c_str(), fTitle.c_str(), fNbins[0], fLow[0], fHigh[0]);
+			break;
+		case 2:
+			hist = new TH2D(hname.c_str(), fTitle.c_str(), fNbins[0], fLow[0], fHigh[0], fNbins[1], fLow[1], fHigh[1]);
+			break;
+		case 3:
+			hist = new TH3D(hname.c_str(), fTitle.c_str(), fNbins[0], fLow[0], fHigh[0],
+											fNbins[1], fLow[1], fHigh[1], fNbins[2], fLow[2], fHigh[2]);
+			break;
+		default:
+			break;
+		}
+		TH1::AddDirectory(add);
+	}
+	if(!hist) return 0;
+	TAxis* axes[3] = { hist->GetXaxis(), hist->GetYaxis(), hist->GetZaxis() };
+	for(Int_t i=0; i< 3; ++i) {
+		if(!fEdges[i].empty()) axes[i]->Set(fNbins[i], &fEdges[i][0]);
+		axes[i]->SetTitle(fAxisTitles[i].c_str());
+	}
+	hist->SetOption(fOption.c_str());
+	hist->SetMinimum(fMinimum);
+	hist->SetMaximum(fMaximum);
+	fLine.Copy(*hist);
+	fFill.Copy(*hist);
+	fMarker.Copy(*hist);
+
+	TArrayD* bins = dynamic_cast<TArrayD*>(hist);
+	if(bins && bins->GetSize() == (Int_t)fBins.size())
+		std::copy(fBins.begin(), fBins.end(), bins->GetArray());
+	if(!fSumw2.empty()) {
+		hist->Sumw2();
+		if(hist->GetSumw2()->GetSize() == (Int_t)fSumw2.size())
+			std::copy(fSumw2.begin(), fSumw2.end(), hist->GetSumw2()->GetArray());
+	}
+	// All zero means "unknown": ROOT then computes the statistics from the bins
+	if(std::count(fStats, fStats + kNstats, 0.) != kNstats)
+		hist->PutStats(const_cast<Double_t*>(fStats));
+	hist->SetEntries(fEntries);
+	return hist;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// std::string rb::hist::Snapshot::GetName()             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+std::string rb::hist::Snapshot::GetName() const {
+	const std::string::size_type slash = fPath.rfind('/');
+	return slash < fPath.size() ? fPath.substr(slash + 1) : fPath;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// std::string rb::hist::Snapshot::GetDirectory()        //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+std::string rb::hist::Snapshot::GetDirectory() const {
+	const std::string::size_type slash = fPath.rfind('/');
+	return slash > 0 && slash < fPath.size() ? fPath.substr(0, slash) : "/";
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// TObject* rb::hist::Snapshot::BuildScale()             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+TObject* rb::hist::Snapshot::BuildScale(const char* name) const {
+	if(fScaleFactor == 1.) return 0;
+	const std::string hname = (name && *name) ? name : GetName();
+	return new TParameter<Double_t>(ScaleName(hname).c_str(), fScaleFactor);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// std::string rb::hist::Snapshot::ScaleName()           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+std::string rb::hist::Snapshot::ScaleName(const std::string& name) {
+	return name + "_scale";
+}
+
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::Retired                                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Retired::Allocate()                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Retired::Allocate() {
+	fBins = fNcells > 0 ? new Double_t[fNcells]() : 0;
+	fSumw2 = fNsumw2 > 0 ? new Double_t[fNsumw2]() : 0;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Retired::Release()                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Retired::Release() {
+	if(fBins && fSnapshot.fBins.empty()) fSnapshot.fBins.assign(fBins, fBins + fNcells);
+	if(fSumw2 && fSnapshot.fSumw2.empty()) fSnapshot.fSumw2.assign(fSumw2, fSumw2 + fNsumw2);
+	delete[] fBins;
+	delete[] fSumw2;
+	fBins = fSumw2 = 0;
+	fNcells = fNsumw2 = 0;
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::SnapshotAll()                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::SnapshotAll(std::vector<Snapshot>& snapshots) {
+	rb::EventVector_t events = rb::gApp()->GetEventVector();
+	for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it) {
+		rb::Event* event = rb::gApp()->GetEvent(it->first);
+		if(event) event->GetHistManager()->TakeSnapshots(snapshots);
+	}
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::SnapshotPath()                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::SnapshotPath(const std::string& path, Snapshot& snapshot) {
+	rb::EventVector_t events = rb::gApp()->GetEventVector();
+	for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it) {
+		rb::Event* event = rb::gApp()->GetEvent(it->first);
+		if(event && event->GetHistManager()->TakeSnapshot(path, snapshot)) return true;
+	}
+	return false;
+}
@@ -0,0 +1,121 @@
+//! \file Snapshot.hxx
+//! \brief Defines a copy of a histogram's definition and contents, for use away from the fill locks.
+#ifndef HIST_SNAPSHOT_HXX
+#define HIST_SNAPSHOT_HXX
+#include <string>
+#include <vector>
+#include <Rtypes.h>
+#include <TAttLine.h>
+#include <TAttFill.h>
+#include <TAttMarker.h>
+
+class TH1;
+class TObject;
+
+namespace rb
+{
+namespace hist
+{
+/// \brief Copy of one histogram at one moment.
+//! \details Taking a snapshot holds the histogram's lock only for as long as it takes to copy
+//! the bins; everything done with the snapshot afterwards (comparing, compressing, sending,
+//! writing) leaves the fill thread alone.
+struct Snapshot
+{
+	 //! Number of statistics copied (TH1::GetStats() fills at most this many)
+	 static const Int_t kNstats = 13;
+	 //! Directory path and name, e.g. "/adc/adc0" for adc0 in directory adc
+	 std::string fPath;
+	 //! Histogram title
+	 std::string fTitle;
+	 //! Number of dimensions (1-3)
+	 Int_t fNdimensions;
+	 //! Number of bins on each axis (1 for axes the histogram doesn't have)
+	 Int_t fNbins[3];
+	 //! Lower edge of each axis
+	 Double_t fLow[3];
+	 //! Upper edge of each axis
+	 Double_t fHigh[3];
+	 //! Bin edges of each axis with variable bins, empty for uniform axes
+	 std::vector<Double_t> fEdges[3];
+	 //! Title of each axis
+	 std::string fAxisTitles[3];
+	 //! Draw option
+	 std::string fOption;
+	 //! Minimum and maximum set for drawing (-1111 if unset, see TH1::SetMinimum())
+	 Double_t fMinimum, fMaximum;
+	 //! Line, fill and marker attributes
+	 TAttLine fLine;
+	 TAttFill fFill;
+	 TAttMarker fMarker;
+	 //! Contents of every cell, including under- and overflows, in TH1::GetBin() order
+	 std::vector<Double_t> fBins;
+	 //! Sum of squared weights of every cell, empty unless the histogram stores them
+	 std::vector<Double_t> fSumw2;
+	 //! Statistics (see TH1::GetStats())
+	 Double_t fStats[kNstats];
+	 //! Number of entries
+	 Double_t fEntries;
+	 //! Events passing the gate per fill (see Base::GetScaleFactor()), 1 unless sampled
+	 Double_t fScaleFactor;
+
+	 //! Empty snapshot
+	 Snapshot();
+	 //! Copy \c hist's definition and contents
+	 //! \note The caller must make sure nothing fills \c hist meanwhile (see Base::TakeSnapshot())
+	 void Take(const TH1* hist, const std::string& path);
+	 //! Copy \c hist's definition (path, title, binning and drawing attributes), leaving the contents and statistics alone
+	 //! \note The caller must make sure nothing redefines \c hist meanwhile
+	 void TakeDefinition(const TH1* hist, const std::string& path);
+	 //! Create a new histogram (TH1D, TH2D or TH3D) holding the snapshot, not added to any directory
+	 //! \param name Name of the new histogram; if empty, the last part of fPath
+	 TH1* Build(const char* name = "") const;
+	 //! Return the name part of fPath
+	 std::string GetName() const;
+	 //! Return the directory part of fPath ("/" for the top directory)
+	 std::string GetDirectory() const;
+	 //! Create the TParameter<Double_t> recording fScaleFactor, to be written next to the histogram
+	 //! \returns 0 if the histogram isn't sampled (fScaleFactor is 1)
+	 TObject* BuildScale(const char* name = "") const;
+	 //! Name of the scale factor written next to histogram \c name ("<name>_scale")
+	 static std::string ScaleName(const std::string& name);
+};
+
+/// \brief Contents swapped out of a histogram (see Base::SwapOut()), on their way into a Snapshot.
+//! \details Before the swap, fBins and fSumw2 are the zeroed arrays the histogram gets (see Allocate());
+//! after it, they are the histogram's old arrays, which Release() moves into fSnapshot. Copies share
+//! the arrays, so exactly one copy has to be released.
+struct Retired
+{
+	 //! Definition and statistics; the contents are filled in by Release()
+	 Snapshot fSnapshot;
+	 //! Cell contents, 0 if none
+	 Double_t* fBins;
+	 //! Sum of squared weights, 0 if none
+	 Double_t* fSumw2;
+	 //! Size of fBins
+	 Int_t fNcells;
+	 //! Size of fSumw2
+	 Int_t fNsumw2;
+
+	 //! No arrays
+	 Retired(): fBins(0), fSumw2(0), fNcells(0), fNsumw2(0) { }
+	 //! Allocate zeroed arrays of fNcells and fNsumw2 elements
+	 void Allocate();
+	 //! Copy the arrays into fSnapshot (unless it already has contents) and delete them
+	 void Release();
+};
+
+/// Snapshot every histogram of every event type, appending to \c snapshots.
+//! \details Holds each event type's histogram set lock while copying its bins, never while
+//! doing anything else. Pending buffered fills are applied first.
+extern void SnapshotAll(std::vector<Snapshot>& snapshots);
+
+/// Snapshot the histogram at \c path (see Base::GetPath()), of whichever event type has it.
+//! \returns false if there is no such histogram
+extern Bool_t SnapshotPath(const std::string& path, Snapshot& snapshot);
+
+}
+}
+
+#endif
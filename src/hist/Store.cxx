@@ -0,0 +1,90 @@
+//! \file Store.cxx
+//! \brief Implements Store.hxx
+#include <algorithm>
+#include "hist/Store.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Helper Functions                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace
+{
+// Orders positions by their key
+class KeyLess
+{
+private:
+	 const std::vector<std::string>& fKeys;
+public:
+	 KeyLess(const std::vector<std::string>& keys): fKeys(keys) { }
+	 bool operator() (UInt_t a, UInt_t b) const { return fKeys[a] < fKeys[b]; }
+};
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::Store                                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+const UInt_t rb::hist::Store::kNoHandle;
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// UInt_t rb::hist::Store::Insert()                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+UInt_t rb::hist::Store::Insert(rb::hist::Base* hist) {
+	UInt_t handle;
+	if(fFree.empty()) {
+		handle = fPositions.size();
+		fPositions.push_back(kNoHandle);
+	}
+	else {
+		handle = fFree.back();
+		fFree.pop_back();
+	}
+	fPositions[handle] = fHists.size();
+	fHists.push_back(hist);
+	fHandles.push_back(handle);
+	fGrouped = false;
+	return handle;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::Store::Erase()                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Store::Erase(UInt_t handle) {
+	if(handle >= fPositions.size() || fPositions[handle] == kNoHandle) return false;
+	const UInt_t pos = fPositions[handle];
+	fHists.erase(fHists.begin() + pos);
+	fHandles.erase(fHandles.begin() + pos);
+	for(UInt_t i = pos; i< fHandles.size(); ++i) fPositions[fHandles[i]] = i;
+	fPositions[handle] = kNoHandle;
+	fFree.push_back(handle);
+
+	// The order is kept, so the groups only shift down (and may become empty)
+	for(UInt_t i=0; i< fGroups.size(); ++i)
+		if(fGroups[i] > pos) --fGroups[i];
+	fGroups.erase(std::unique(fGroups.begin(), fGroups.end()), fGroups.end());
+	return true;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Store::Group()                         //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Store::Group(const std::vector<std::string>& keys) {
+	std::vector<UInt_t> order(fHists.size());
+	for(UInt_t i=0; i< order.size(); ++i) order[i] = i;
+	std::stable_sort(order.begin(), order.end(), KeyLess(keys));
+
+	std::vector<Base*> hists(order.size());
+	std::vector<UInt_t> handles(order.size());
+	fGroups.assign(1, 0);
+	for(UInt_t i=0; i< order.size(); ++i) {
+		hists[i] = fHists[order[i]];
+		handles[i] = fHandles[order[i]];
+		fPositions[handles[i]] = i;
+		if(i && keys[order[i]] != keys[order[i-1]]) fGroups.push_back(i);
+	}
+	fGroups.push_back(order.size());
+	if(order.empty()) fGroups.assign(1, 0);
+	fHists.swap(hists);
+	fHandles.swap(handles);
+	fGrouped = true;
+}
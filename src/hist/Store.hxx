@@ -0,0 +1,83 @@
+//! \file Store.hxx
+//! \brief Defines the gate-grouped container of histograms used by rb::hist::Manager.
+#ifndef HIST_STORE_HXX
+#define HIST_STORE_HXX
+#include <string>
+#include <vector>
+#include <Rtypes.h>
+
+namespace rb
+{
+namespace hist
+{
+class Base;
+
+/// \brief Array of histogram pointers, grouped by gate, with stable handles.
+//! \details Pointers to the histograms are kept in one array which FillAll() walks from start
+//! to end. Histograms with the same gate sit next to each other, so that the gate can be
+//! evaluated once for the whole group; that is what this class is for. The histograms themselves
+//! stay where they were allocated, so filling still follows one pointer per histogram (into the
+//! Base object, its formulae and its TH1) much as the std::set it replaces did. Positions change
+//! when histograms are added, removed or regrouped; the handle returned by Insert() does not, and
+//! is what the histogram uses to remove itself.
+//! \note This is not an array of fill descriptors (gate, parameters, bin array, axis constants)
+//! that filling could walk without touching the histogram objects: filling goes through
+//! TTreeFormula and TH1::Fill(), which need the objects anyway.
+//! \note This class does no locking of its own; rb::hist::Manager takes care of that.
+class Store
+{
+public:
+	 typedef std::vector<Base*>::const_iterator const_iterator;
+	 typedef const_iterator iterator;
+	 //! Handle of a histogram that isn't stored
+	 static const UInt_t kNoHandle = 0xffffffff;
+private:
+	 //! Histograms, in fill order
+	 std::vector<Base*> fHists;
+	 //! Handle of the histogram at each position
+	 std::vector<UInt_t> fHandles;
+	 //! Position of each handle, kNoHandle for free handles
+	 std::vector<UInt_t> fPositions;
+	 //! Handles free for reuse
+	 std::vector<UInt_t> fFree;
+	 //! First position of each group, followed by size()
+	 std::vector<UInt_t> fGroups;
+	 //! Is fHists grouped by gate (i.e. is fGroups valid)?
+	 Bool_t fGrouped;
+public:
+	 //! Empty store
+	 Store(): fGroups(1, 0), fGrouped(true) { }
+	 //! First histogram
+	 const_iterator begin() const { return fHists.begin(); }
+	 //! Past the last histogram
+	 const_iterator end() const { return fHists.end(); }
+	 //! Number of histograms
+	 UInt_t size() const { return fHists.size(); }
+	 //! Is the store empty?
+	 Bool_t empty() const { return fHists.empty(); }
+	 //! Histogram at position \c pos
+	 Base* operator[] (UInt_t pos) const { return fHists[pos]; }
+	 //! Append a histogram (ungroups the store)
+	 //! \returns The histogram's handle
+	 UInt_t Insert(Base* hist);
+	 //! Remove the histogram with handle \c handle, keeping the others in order
+	 //! \returns false if there is no such histogram
+	 Bool_t Erase(UInt_t handle);
+	 //! Is the store grouped by gate?
+	 Bool_t IsGrouped() const { return fGrouped; }
+	 //! Mark the store as needing to be regrouped, e.g. after a gate changed
+	 void Ungroup() { fGrouped = false; }
+	 //! Sort the histograms so that equal keys are next to each other, keeping their order otherwise
+	 //! \param keys Gate key of each histogram, by position
+	 void Group(const std::vector<std::string>& keys);
+	 //! Number of groups (only valid when grouped)
+	 UInt_t GetNgroups() const { return fGroups.size() - 1; }
+	 //! First position in group \c group
+	 UInt_t GroupBegin(UInt_t group) const { return fGroups[group]; }
+	 //! Past the last position in group \c group
+	 UInt_t GroupEnd(UInt_t group) const { return fGroups[group + 1]; }
+};
+}
+}
+
+#endif
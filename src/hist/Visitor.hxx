@@ -113,6 +113,22 @@ struct Cast : public boost::static_visitor<TH1*>
 #undef  BOOST_VARIANT_VISITATION
 #undef  MAX_MEMBER_FN_ARGUMENTS
 
+/// Performs the Fill() function
+/// \warning Does not perform any mutex locking
+struct FillUnlocked : public boost::static_visitor<Int_t>
+{
+public:
+	 Int_t operator() (TH1D& hst) const { return hst.Fill(x_); }
+	 Int_t operator() (TH2D& hst) const { return hst.Fill(x_,y_); }
+	 Int_t operator() (TH3D& hst) const { return hst.Fill(x_,y_,z_); }
+	 static Int_t Do(HistVariant& hist, Double_t x, Double_t y=0, Double_t z=0) {
+		 return boost::apply_visitor(FillUnlocked(x,y,z), hist);
+	 }
+	 FillUnlocked(Double_t x, Double_t y, Double_t z): x_(x), y_(y), z_(z) {}
+private:
+	 Double_t x_, y_, z_;
+};
+
 /// Performs the Fill() function
 struct Fill : public rb::visit::Locked<Int_t>
 {
@@ -9,7 +9,10 @@
 //! produced by running the program gccxml on the root v5.32/01 version of TH1.h
 //! Subsequently, member functions that we did not want transferred to rb::hist::Base
 //! (or which would not compile) were commented out by hand.
-#define AS_TH1 visit::hist::Cast::Do(fHistVariant)
+//!
+//! Any buffered fills are applied before the wrapped histogram is touched, so the
+//! wrappers always see (and modify) an up-to-date histogram.
+#define AS_TH1 (FlushFillBuffer(), visit::hist::Cast::Do(fHistVariant))
 
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:Add">*** TH1 Member Function ***</a>
 virtual void Add(TF1* h1, Double_t c1 = 1, Option_t* option = "")
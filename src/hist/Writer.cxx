@@ -0,0 +1,213 @@
+//! \file Writer.cxx
+//! \brief Implements Writer.hxx
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <TH1.h>
+#include <TKey.h>
+#include <TFile.h>
+#include <TClass.h>
+#include <TBufferFile.h>
+#include <RZip.h>
+#include "hist/Writer.hxx"
+#include "utils/Executor.hxx"
+#include "utils/Mutex.hxx"
+#include "utils/Error.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Utility functions & classes                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace
+{
+/// Largest block R__zip() compresses at once (as in TKey)
+const Int_t kMaxBlock = 0xffffff;
+
+/// Objects up to this size aren't compressed (as in TKey)
+const Int_t kMinCompress = 256;
+
+/// One histogram, serialized and (maybe) compressed, ready to go into a key
+struct Packed
+{
+	 //! Key and object name
+	 std::string fName;
+	 //! Object title
+	 std::string fTitle;
+	 //! Object class
+	 std::string fClass;
+	 //! Length of the key header the object was serialized after
+	 Int_t fKeylen;
+	 //! Length of the serialized object, before compression
+	 Int_t fObjlen;
+	 //! The object, compressed if that made it shorter; empty if the snapshot couldn't be built
+	 std::vector<char> fData;
+	 Packed(): fKeylen(0), fObjlen(0) { }
+};
+
+/// Size of \c str in a TBuffer (see TString::Sizeof())
+inline Int_t string_size(const std::string& str) {
+	return str.size() + (str.size() > 254 ? 5 : 1);
+}
+
+/// Length of the header of a key for \c packed, if it is created while \c file is \c big (see TKey::Sizeof())
+inline Int_t key_length(const Packed& packed, Bool_t big) {
+	return 26 + (big ? 8 : 0) + string_size(packed.fClass) + string_size(packed.fName) + string_size(packed.fTitle);
+}
+
+/// Is \c file past the point where new keys use 64 bit offsets (see TKey::Build())?
+inline Bool_t is_big(TFile* file) {
+	return file->GetEND() > TFile::kStartBigFile;
+}
+
+/// Serialize a histogram built from \c snapshot into \c packed, uncompressed.
+//! \details Serializes into a buffer with room for the key header in front, as TKey does, so
+//! that the offsets ROOT records inside the object are right when the key is read back.
+//! Streamers and the streamer info bookkeeping of \c file aren't thread safe, so this holds
+//! TTHREAD_GLOBAL_MUTEX and is only ever called from the writing thread.
+void serialize(const rb::hist::Snapshot& snapshot, TFile* file, Bool_t big, Packed& packed) {
+	packed.fName = snapshot.GetName();
+	TH1* hist = snapshot.Build(packed.fName.c_str());
+	if(!hist) {
+		packed.fData.clear();
+		return;
+	}
+	packed.fTitle = hist->GetTitle();
+	packed.fClass = hist->ClassName();
+	packed.fKeylen = key_length(packed, big);
+
+	rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+	TBufferFile buffer(TBuffer::kWrite, packed.fKeylen + TBuffer::kInitialSize);
+	buffer.SetParent(file); // tags the streamer infos to write
+	buffer.SetBufferOffset(packed.fKeylen);
+	buffer.MapObject(hist);
+	hist->Streamer(buffer);
+	delete hist;
+	packed.fObjlen = buffer.Length() - packed.fKeylen;
+	packed.fData.assign(buffer.Buffer() + packed.fKeylen, buffer.Buffer() + buffer.Length());
+}
+
+/// Compress the serialized object in \c packed at \c level, if that makes it shorter.
+//! \details Touches nothing but \c packed, so it can run on any thread.
+void compress(Int_t level, Packed& packed) {
+	if(level <= 0 || packed.fObjlen <= kMinCompress || Int_t(packed.fData.size()) != packed.fObjlen) return;
+	const Int_t nblocks = 1 + (packed.fObjlen - 1) / kMaxBlock;
+	std::vector<char> compressed(packed.fObjlen + 9 * nblocks + 28);
+	Int_t length = 0;
+	for(Int_t i=0; i< nblocks; ++i) {
+		Int_t size = std::min(kMaxBlock, packed.fObjlen - i * kMaxBlock), out = 0;
+		R__zip(level, &size, &packed.fData[i * kMaxBlock], &size, &compressed[length], &out);
+		if(out <= 0) return; // incompressible, stays as it is
+		length += out;
+	}
+	if(length >= packed.fObjlen) return;
+	compressed.resize(length);
+	packed.fData.swap(compressed);
+}
+
+/// Key taking its contents from a Packed object instead of serializing one.
+class PackedKey: public TKey
+{
+public:
+	 //! Allocate the key in the file of \c directory and fill its buffer; WriteFile() writes it
+	 PackedKey(const Packed& packed, const TClass* cl, TDirectory* directory):
+		 TKey(packed.fName.c_str(), packed.fTitle.c_str(), cl, packed.fData.size(), directory) {
+		 fObjlen = packed.fObjlen;
+		 fCycle = directory->AppendKey(this);
+		 char* buffer = fBuffer;
+		 FillBuffer(buffer);
+		 memcpy(fBuffer + fKeylen, &packed.fData[0], packed.fData.size());
+	 }
+};
+
+/// Compresses every \c stride'th packed object, starting with \c first.
+class CompressTask: public rb::Task
+{
+private:
+	 std::vector<Packed>& fPacked;
+	 Int_t fLevel;
+	 UInt_t fFirst;
+	 UInt_t fStride;
+public:
+	 CompressTask(std::vector<Packed>& packed, Int_t level, UInt_t first, UInt_t stride):
+		 fPacked(packed), fLevel(level), fFirst(first), fStride(stride) { }
+	 void Execute() {
+		 for(UInt_t i = fFirst; i< fPacked.size() && !IsCancelled(); i += fStride)
+			 compress(fLevel, fPacked[i]);
+	 }
+};
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Int_t rb::hist::WriteSnapshots()                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::hist::WriteSnapshots(const std::vector<Snapshot>& snapshots, TDirectory* directory) {
+	TFile* file = directory ? directory->GetFile() : 0;
+	if(!file || !file->IsWritable()) {
+		err::Error("rb::hist::WriteSnapshots") << "Need a directory of a file open for writing.";
+		return 0;
+	}
+	std::vector<Packed> packed(snapshots.size());
+	for(UInt_t i=0; i< snapshots.size(); ++i)
+		serialize(snapshots[i], file, is_big(file), packed[i]);
+
+	const Int_t level = file->GetCompressionLevel();
+	const UInt_t ntasks = std::min<UInt_t>(snapshots.size(), rb::Executor::GetNworkers());
+	std::vector<rb::Future> futures;
+	for(UInt_t i=0; i< ntasks && level > 0; ++i)
+		futures.push_back(rb::Executor::Submit(new CompressTask(packed, level, i, ntasks)));
+	for(UInt_t i=0; i< futures.size(); ++i)
+		futures[i].Wait();
+
+	Int_t nwritten = 0;
+	for(UInt_t i=0; i< packed.size(); ++i) {
+		if(packed[i].fData.empty()) continue;
+		// Crossed into 64 bit offsets since serializing: the header is longer, so the offsets are off
+		if(key_length(packed[i], is_big(file)) != packed[i].fKeylen) {
+			serialize(snapshots[i], file, is_big(file), packed[i]);
+			compress(level, packed[i]);
+		}
+		TClass* cl = TClass::GetClass(packed[i].fClass.c_str());
+		PackedKey* key = new PackedKey(packed[i], cl, directory);
+		if(key->GetKeylen() != packed[i].fKeylen) {
+			err::Error("rb::hist::WriteSnapshots") << "Unexpected key header length for " << packed[i].fName
+																							<< ", not writing it.";
+			key->Delete();
+			delete key;
+			continue;
+		}
+		file->SumBuffer(packed[i].fObjlen);
+		if(key->WriteFile(0) < 0 || file->TestBit(TFile::kWriteError)) {
+			err::Error("rb::hist::WriteSnapshots") << "Error writing " << packed[i].fName << " to " << file->GetName();
+			break;
+		}
+		++nwritten;
+		std::vector<char>().swap(packed[i].fData);
+		TObject* scale = snapshots[i].BuildScale();
+		if(scale) {
+			rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+			directory->WriteTObject(scale);
+			delete scale;
+		}
+	}
+	return nwritten;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// TDirectory* rb::hist::GetSubdirectory()               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+TDirectory* rb::hist::GetSubdirectory(TDirectory* top, const std::string& path, Bool_t create) {
+	TDirectory* dir = top;
+	std::string::size_type begin = 0;
+	while(dir && begin < path.size()) {
+		std::string::size_type end = path.find('/', begin);
+		if(end == std::string::npos) end = path.size();
+		if(end > begin) {
+			const std::string part = path.substr(begin, end - begin);
+			TDirectory* sub = dir->GetDirectory(part.c_str());
+			dir = (sub || !create) ? sub : dir->mkdir(part.c_str());
+		}
+		begin = end + 1;
+	}
+	return dir;
+}
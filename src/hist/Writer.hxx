@@ -0,0 +1,33 @@
+//! \file Writer.hxx
+//! \brief Defines the writing of histogram snapshots to ROOT files, compressed in parallel.
+#ifndef HIST_WRITER_HXX
+#define HIST_WRITER_HXX
+#include <string>
+#include <vector>
+#include <Rtypes.h>
+#include "hist/Snapshot.hxx"
+
+class TDirectory;
+
+namespace rb
+{
+namespace hist
+{
+/// Write \c snapshots to \c directory (of a writable TFile), one key per snapshot.
+//! \details Each snapshot is written as the histogram Snapshot::Build() makes of it, under the name part
+//! of its path, just as TObject::Write() would, followed by its scale factor if it is sampled (see
+//! Snapshot::BuildScale()). Streamers aren't thread safe, so building and serializing happen on the
+//! calling thread, under TTHREAD_GLOBAL_MUTEX; only compressing (at the file's compression level),
+//! which is most of the work, runs in parallel on the compute workers (see rb::Executor). The calling
+//! thread then appends the buffers to the file one after the other. No histogram locks are held.
+//! \returns the number of snapshots written
+extern Int_t WriteSnapshots(const std::vector<Snapshot>& snapshots, TDirectory* directory);
+
+/// Return the directory \c path (e.g. "/a/b", see Snapshot::GetDirectory()) below \c top.
+//! \param create Create missing directories along the way; otherwise return 0 if one is missing
+extern TDirectory* GetSubdirectory(TDirectory* top, const std::string& path, Bool_t create);
+
+}
+}
+
+#endif
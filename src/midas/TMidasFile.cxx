@@ -16,6 +16,7 @@
 
 #include "TMidasFile.h"
 #include "TMidasEvent.h"
+#include "Stats.hxx"
 
 TMidasFile::TMidasFile()
 {
@@ -221,7 +222,11 @@ bool TMidasFile::Read(TMidasEvent *midasEvent)
 
   if (fGzFile)
 #ifdef HAVE_ZLIB
-    rd = gzread(*(gzFile*)fGzFile, (char*)midasEvent->GetEventHeader(), sizeof(EventHeader_t));
+    {
+      rb::stats::Timer timer;
+      rd = gzread(*(gzFile*)fGzFile, (char*)midasEvent->GetEventHeader(), sizeof(EventHeader_t));
+      timer.Lap(rb::stats::kDecompress);
+    }
 #else
     assert(!"Cannot get here");
 #endif
@@ -253,7 +258,11 @@ bool TMidasFile::Read(TMidasEvent *midasEvent)
 
   if (fGzFile)
 #ifdef HAVE_ZLIB
-    rd = gzread(*(gzFile*)fGzFile, midasEvent->GetData(), midasEvent->GetDataSize());
+    {
+      rb::stats::Timer timer;
+      rd = gzread(*(gzFile*)fGzFile, midasEvent->GetData(), midasEvent->GetDataSize());
+      timer.Lap(rb::stats::kDecompress);
+    }
 #else
     assert(!"Cannot get here");
 #endif
@@ -53,6 +53,7 @@ Bool_t rb::Midas::ReadBufferOnline() {
   int size = 0;
   do { // loop until we get an error or event, or quit polling, or unattach
     size = onlineMidas->receiveEvent(fRequestId, pEvent, sizeof(pEvent), kTRUE);
+    if(size == 0) rb::hist::RunOutput::Drained(); // every event of a stopped run has been unpacked
   } while (size == 0 && rb::Thread::IsRunning(rb::attach::ONLINE_THREAD_NAME) && onlineMidas->poll(1000));
 
   if(size == 0) // Unattached or stopped polling
@@ -76,8 +77,15 @@ Bool_t rb::Midas::ReadBufferOnline() {
 Bool_t rb::Midas::UnpackBuffer() {
 #ifdef MIDAS_BUFFERS
   // (DRAGON test setup)
-  Short_t eventId = fBuffer.GetEventId();
+  UShort_t eventId = fBuffer.GetEventId();
   switch(eventId) {
+  case MIDAS_BOR: // begin of run (the serial number is the run number)
+    RunStart(0, fBuffer.GetSerialNumber(), fBuffer.GetTimeStamp());
+    break;
+  case MIDAS_EOR: // end of run: every event of the run has been unpacked by now
+    RunStop(0, fBuffer.GetSerialNumber(), fBuffer.GetTimeStamp());
+    rb::hist::RunOutput::RunStop(fBuffer.GetSerialNumber()); // saves and zeroes the histograms, if enabled
+    break;
   case DRAGON_EVENT: // event
 		 {	 
 			 // Figure out timestamp matching
@@ -118,6 +126,11 @@ Bool_t CoincidenceEvent::DoProcess(void* addr, Int_t nchar) {
 	return true;
 }
 
+void CoincidenceEvent::HandleBadEvent() {
+	static err::Counter bad_events("CoincidenceEvent", "bad event");
+	err::Limited(bad_events) << "Something went wrong!!";
+}
+
 GammaEvent::GammaEvent(): fGamma("gamma", this, true, "") { }
 
 Bool_t GammaEvent::DoProcess(void* addr, Int_t nchar) {
@@ -130,6 +143,11 @@ Bool_t GammaEvent::DoProcess(void* addr, Int_t nchar) {
   else return false;
 }
 
+void GammaEvent::HandleBadEvent() {
+	static err::Counter bad_events("GammaEvent", "bad event");
+	err::Limited(bad_events) << "Something went wrong!!";
+}
+
 HeavyIonEvent::HeavyIonEvent(): fHeavyIon("hi", this, true, "") { }
 
 Bool_t HeavyIonEvent::DoProcess(void* addr, Int_t nchar) {
@@ -142,6 +160,11 @@ Bool_t HeavyIonEvent::DoProcess(void* addr, Int_t nchar) {
   else return false;
 }
 
+void HeavyIonEvent::HandleBadEvent() {
+	static err::Counter bad_events("HeavyIonEvent", "bad event");
+	err::Limited(bad_events) << "Something went wrong!!";
+}
+
 void rb::Rint::RegisterEvents() {
   // Register events here //
   RegisterEvent<CoincidenceEvent>(COINCIDENCE_EVENT, "CoincidenceEvent");
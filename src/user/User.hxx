@@ -16,6 +16,7 @@
 #ifdef MIDAS_ONLINE
 #include "midas/TMidasOnline.h"
 #endif
+#include "hist/RunOutput.hxx"
 namespace rb
 {
 class Midas : public rb::BufferSource
@@ -65,9 +66,13 @@ inline rb::Midas::~Midas() {
 }
 inline void rb::Midas::RunStart(int transition, int run_number, int trans_time) {
   Info("rb::Midas", "Starting run number %i.", run_number);
+  rb::hist::RunOutput::RunStart(run_number);
 }
 inline void rb::Midas::RunStop(int transition, int run_number, int trans_time) {
   Info("rb::Midas", "Stopping run number %i.", run_number);
+  // Events of the run may still be buffered: the histograms are swapped once they are unpacked
+  // (see ReadBufferOnline()), or at the MIDAS_EOR event (see UnpackBuffer())
+  rb::hist::RunOutput::RunStopping(run_number);
 }
 inline void rb::Midas::RunPause(int transition, int run_number, int trans_time) {
   Info("rb::Midas", "Pausing run number %i.", run_number);
@@ -80,6 +85,8 @@ inline void rb::Midas::RunResume(int transition, int run_number, int trans_time)
 #include <utility>
 #include "Dragon.hxx"
 enum {
+  MIDAS_BOR = 0x8000,
+  MIDAS_EOR = 0x8001,
   DRAGON_EVENT = 1,
   DRAGON_SCALER = 2,
 	HI_EVENT = 3,
@@ -98,7 +105,7 @@ public:
 private:
 	 TMidasEvent* Cast(void* addr) {return reinterpret_cast<TMidasEvent*>(addr);}
 	 Bool_t DoProcess(void* event_address, Int_t nchar);
-	 void HandleBadEvent() {Error("GammaEvent", "Something went wrong!!");}
+	 void HandleBadEvent();
 	 friend class CoincidenceEvent;
 };
 
@@ -112,7 +119,7 @@ public:
 private:
 	 TMidasEvent* Cast(void* addr) {return reinterpret_cast<TMidasEvent*>(addr);}
 	 Bool_t DoProcess(void* event_address, Int_t nchar);
-	 void HandleBadEvent() {Error("HeavyIonEvent", "Something went wrong!!");}
+	 void HandleBadEvent();
 	 friend class CoincidenceEvent;
 };
 
@@ -127,7 +134,7 @@ public:
 private:
 	 CoincEventPair_t* Cast(void* addr) {return reinterpret_cast<CoincEventPair_t*>(addr);}
 	 Bool_t DoProcess(void* event_address, Int_t nchar);
-	 void HandleBadEvent() {Error("CoincidenceEvent", "Something went wrong!!");}
+	 void HandleBadEvent();
 };
 
 
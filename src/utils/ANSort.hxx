@@ -1,42 +1,115 @@
 //! \file ANSort.hxx
-//! \brief Defines a functor class to do Alpha-numeric sorting of strings.
-
-namespace {
-void to_lower(std::string& str) {
-  std::string l = "abcdefghijklmnopqrstuvwxyz";
-  std::string u = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
-  for(unsigned i=0; i< str.size(); ++i) {
-    unsigned long upos = u.find(str[i]);
-    if(upos< u.size())
-       str[i] = l[upos];
-  }
-}
-std::string get_number(const std::string& str, unsigned posn) {
-  std::string num = "0123456789", out = "";
-  while(posn < str.size() && num.find(str[posn]) < num.size())
-     out += std::string(1, str[posn++]);
-  return out;
-}
-}
+//! \brief Defines a functor class to do Alpha-numeric sorting of strings, and a sorted
+//! name index built on it.
+#ifndef ANSORT_HXX
+#define ANSORT_HXX
+#include <map>
+#include <string>
+#include <vector>
+#include <algorithm>
 
 struct ANSort { // alpha-numeric sorting
-   bool operator() (const std::string& lhs, const std::string& rhs) {
-     std::string l = "_abcdefghijklmnopqrstuvwxyz";
-     std::string left(lhs), right(rhs);
-     to_lower(left); to_lower(right);
+  /// Natural sort key of a string.
+  //! Letters are lower-cased and each run of digits becomes a marker, its length and its
+  //! digits (without leading zeros), so that "adc2" < "adc10" when the keys are compared
+  //! as plain strings. Letters and '_' sort before numbers, as they always have.
+  static std::string Key(const std::string& str) {
+    std::string key;
+    key.reserve(str.size() + 8);
+    for(std::string::size_type i = 0; i< str.size(); ) {
+      if(str[i] >= '0' && str[i] <= '9') {
+        while(i+1 < str.size() && str[i] == '0' && str[i+1] >= '0' && str[i+1] <= '9') ++i;
+        std::string::size_type end = i;
+        while(end < str.size() && str[end] >= '0' && str[end] <= '9') ++end;
+        const std::string::size_type len = end - i < 0xff ? end - i : 0xff;
+        key += '\x7f';
+        key += static_cast<char>(len);
+        key.append(str, i, end - i);
+        i = end;
+      }
+      else {
+        key += (str[i] >= 'A' && str[i] <= 'Z') ? str[i] - 'A' + 'a' : str[i];
+        ++i;
+      }
+    }
+    return key;
+  }
+
+  /// Sort \c names, computing each key once rather than once per comparison.
+  static void Sort(std::vector<std::string>& names) {
+    std::vector<std::pair<std::string, std::string> > keyed;
+    keyed.reserve(names.size());
+    for(std::vector<std::string>::iterator it = names.begin(); it != names.end(); ++it)
+       keyed.push_back(std::make_pair(Key(*it), std::string()));
+    for(std::vector<std::string>::size_type i = 0; i< names.size(); ++i)
+       keyed[i].second.swap(names[i]);
+    std::sort(keyed.begin(), keyed.end());
+    for(std::vector<std::string>::size_type i = 0; i< names.size(); ++i)
+       names[i].swap(keyed[i].second);
+  }
 
-     for(unsigned int i=0; i< left.size(); ++i) {
-       if(!get_number(left, i).empty()) {
-         if(!get_number(right, i).empty()) {
-           int ileft = atoi(get_number(left, i).c_str());
-           int iright = atoi(get_number(right, i).c_str());
-           if(ileft != iright) return ileft < iright;
-           else i += get_number(left, i).size()-1;
-         }
-       }
-       else if(l.find(left[i]) != l.find(right[i]))
-          return l.find(left[i]) < l.find(right[i]);
-     }
-     return false;
-   }
+  bool operator() (const std::string& lhs, const std::string& rhs) const {
+    return Key(lhs) < Key(rhs);
+  }
+};
+
+/// Set of names kept in alpha-numeric order, with case-insensitive prefix search.
+//! Both orders are maintained as names are inserted and erased, so neither needs a re-sort.
+class ANIndex {
+private:
+  // Both keys are suffixed by '\0' and the name itself, so names differing only in case
+  // or leading zeros stay distinct.
+  std::map<std::string, std::string> fByKey;   // natural key -> name
+  std::map<std::string, std::string> fByLower; // lower-cased name -> name
+  static std::string lower(const std::string& str) {
+    std::string out(str);
+    for(std::string::size_type i = 0; i< out.size(); ++i)
+       if(out[i] >= 'A' && out[i] <= 'Z') out[i] = out[i] - 'A' + 'a';
+    return out;
+  }
+  static std::string unique(const std::string& key, const std::string& name) {
+    return key + '\0' + name;
+  }
+public:
+  bool Insert(const std::string& name) {
+    if(!fByLower.insert(std::make_pair(unique(lower(name), name), name)).second) return false;
+    fByKey.insert(std::make_pair(unique(ANSort::Key(name), name), name));
+    return true;
+  }
+  bool Erase(const std::string& name) {
+    if(!fByLower.erase(unique(lower(name), name))) return false;
+    fByKey.erase(unique(ANSort::Key(name), name));
+    return true;
+  }
+  bool Contains(const std::string& name) const {
+    return fByLower.count(unique(lower(name), name));
+  }
+  std::size_t Size() const {
+    return fByKey.size();
+  }
+  void Clear() {
+    fByKey.clear();
+    fByLower.clear();
+  }
+  /// Append up to \c max names starting with \c prefix (any case) to \c out, in alpha-numeric order.
+  //! An empty prefix matches every name. \returns the number of names that match, which may exceed \c max.
+  std::size_t Find(const std::string& prefix, std::vector<std::string>& out, std::size_t max) const {
+    if(prefix.empty()) {
+      std::map<std::string, std::string>::const_iterator it = fByKey.begin();
+      for(std::size_t n = 0; it != fByKey.end() && n < max; ++it, ++n) out.push_back(it->second);
+      return fByKey.size();
+    }
+    const std::string low = lower(prefix);
+    std::vector<std::string> found;
+    std::size_t count = 0;
+    for(std::map<std::string, std::string>::const_iterator it = fByLower.lower_bound(low);
+        it != fByLower.end() && !it->first.compare(0, low.size(), low); ++it, ++count) {
+      if(found.size() < max) found.push_back(it->second);
+    }
+    ANSort::Sort(found);
+    out.insert(out.end(), found.begin(), found.end());
+    return count;
+  }
 };
+
+#endif
@@ -0,0 +1,61 @@
+//! \file Affinity.hxx
+//! \brief Defines CPU pinning of rootbeer's threads by role.
+//! \details Each kind of thread can be restricted to a set of CPUs, e.g. to keep the threads
+//! that touch the histograms on one socket of a multi-socket machine:
+//! \code
+//! rb::Affinity::Set("attach", "0-3");  // or rootbeer -pin-attach=0-3
+//! rb::Affinity::Set("fill", "4-7");
+//! rb::Affinity::Set("canvas", "");     // unpinned (the default)
+//! \endcode
+//! Threads pick up their role's CPUs when they start; the compute workers (fill role) also
+//! re-pin themselves whenever the setting changes. Memory is placed by the kernel's first-touch
+//! policy, on the node of the CPU that first writes to it, so data allocated by a pinned thread
+//! is local to it.
+#ifndef AFFINITY_HXX
+#define AFFINITY_HXX
+#ifndef __MAKECINT__
+#include <string>
+#include <iostream>
+#include <Rtypes.h>
+
+namespace rb
+{
+  /// \brief Per-role CPU affinity settings.
+  class Affinity
+  {
+  public:
+    /// Thread roles
+    enum Role_t {
+      kNone = -1, ///< Not pinned by role (e.g. the CINT thread)
+      kAttach,    ///< Attach threads: read, unpack, process and save data (and fill serially)
+      kFill,      ///< Executor compute workers: parallel histogram filling
+      kCanvas,    ///< Canvas updating
+      kNroles
+    };
+    /// Restrict threads of role \c role to the CPUs in \c cpus
+    //! \param cpus List of CPUs and ranges, e.g. "0-3,8,10-11"; empty to unpin
+    //! \returns false (leaving the setting unchanged) if \c cpus can't be parsed
+    static Bool_t Set(Int_t role, const char* cpus);
+    /// Same as Set(Int_t, const char*), with the role given by name ("attach", "fill" or "canvas")
+    static Bool_t Set(const char* role, const char* cpus);
+    /// Return the CPU list of a role ("" if unpinned)
+    static std::string Get(Int_t role);
+    /// Is role \c role pinned?
+    static Bool_t IsPinned(Int_t role);
+    /// Pin the calling thread to the CPUs of \c role (unpin it if the role isn't pinned)
+    static void Apply(Int_t role);
+    /// Number of changes made by Set(), so that threads can tell when to re-pin
+    static UInt_t GetGeneration();
+    /// Return the name of a role
+    static const char* GetRoleName(Int_t role);
+    /// Apply any <tt>-pin-ROLE=CPUS</tt> command line arguments
+    static void ParseArgs(Int_t argc, char** argv);
+    /// Print the setting of every role
+    static void Print(std::ostream& strm = std::cout);
+  private:
+    Affinity();
+  };
+}
+
+#endif // #ifndef __MAKECINT__
+#endif // #ifndef AFFINITY_HXX
@@ -0,0 +1,64 @@
+//! \file Cycles.hxx
+//! \brief Defines a low-overhead cycle counter for profiling.
+#ifndef CYCLES_HXX
+#define CYCLES_HXX
+#include <Rtypes.h>
+#ifndef __MAKECINT__
+#include <time.h>
+#include <sys/time.h>
+#endif
+
+namespace rb
+{
+/// \brief Reads the CPU time stamp counter.
+//! \details On x86 this is a single \c rdtsc instruction, cheap enough to wrap around individual
+//! formula evaluations. Elsewhere it falls back on clock_gettime(), in nanoseconds.
+//! Example:
+//! \code
+//! ULong64_t start = rb::Cycles::Now();
+//! DoSomething();
+//! Double_t seconds = (rb::Cycles::Now() - start) / rb::Cycles::PerSecond();
+//! \endcode
+class Cycles
+{
+public:
+	 /// Return the current counter value
+	 static ULong64_t Now();
+	 /// Return the number of counts per second (measured on the first call, takes ~20 ms)
+	 static Double_t PerSecond();
+};
+}
+
+
+#ifndef __MAKECINT__
+// ========= Inlined Functions ========= //
+inline ULong64_t rb::Cycles::Now() {
+#if defined(__i386__) || defined(__x86_64__)
+	UInt_t lo, hi;
+	__asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+	return (ULong64_t(hi) << 32) | lo;
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ULong64_t(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+inline Double_t rb::Cycles::PerSecond() {
+	static Double_t rate = 0;
+	if(rate == 0) {
+		timeval start, stop;
+		gettimeofday(&start, 0);
+		const ULong64_t cstart = Now();
+		Double_t elapsed = 0;
+		do {
+			gettimeofday(&stop, 0);
+			elapsed = (stop.tv_sec - start.tv_sec) + 1e-6 * (stop.tv_usec - start.tv_usec);
+		} while(elapsed < 0.02);
+		rate = (Now() - cstart) / elapsed;
+	}
+	return rate;
+}
+#endif
+
+#endif
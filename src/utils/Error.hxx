@@ -7,6 +7,7 @@
 #include <string>
 #include <sstream>
 #include <stdexcept>
+#include <Rtypes.h>
 
 #define OP__(STRM, CLASS, ARGTYPE) CLASS& operator<< (ARGTYPE arg) {	\
     STRM << arg; return *this;						\
@@ -50,6 +51,78 @@ namespace err
   struct Error: public Strm { Error(const char* where) : Strm("Error", where) {} };
   struct Warning: public Strm { Warning(const char* where) : Strm("Warning", where) {} };
 
+  /// \brief Counts one kind of error and decides which occurrences get printed.
+  //! \details The first few occurrences (Counter::SetPolicy()) are printed; after that they are only
+  //! counted, and when the error happens again more than a summary period after the last summary,
+  //! a single line with the number suppressed is printed instead. Counting is a single atomic
+  //! increment, so counters can be used on the event processing path. Usually made static:
+  //! \code
+  //! static err::Counter counter("GammaEvent", "bad event");
+  //! err::Limited(counter) << "Something went wrong!!";
+  //! \endcode
+  class Counter
+  {
+  private:
+    /// Location and kind of error, used in the printed messages
+    const std::string fWhere, fKind;
+    /// Total occurrences
+    volatile ULong64_t fCount;
+    /// Value of fCount at the last summary
+    volatile ULong64_t fSummaryCount;
+    /// Cycle counter at the last summary
+    volatile ULong64_t fSummaryTime;
+    /// Number of occurrences printed before suppressing
+    static volatile Long64_t fgFirst;
+    /// Seconds between summaries
+    static volatile Double_t fgPeriod;
+  public:
+    /// Create and register a counter
+    Counter(const char* where, const char* kind);
+    /// Unregister
+    ~Counter();
+    /// Count an occurrence
+    //! \param [out] last Set to true if this is the last occurrence printed before suppressing
+    //! \returns true if it should be printed; prints a summary if one is due
+    Bool_t Count(Bool_t* last = 0);
+    /// Total occurrences
+    ULong64_t GetCount() const { return fCount; }
+    /// Location of the error
+    const char* GetWhere() const { return fWhere.c_str(); }
+    /// Kind of error
+    const char* GetKind() const { return fKind.c_str(); }
+    /// Return the registered counter for \c where and \c kind, creating it if needed
+    static Counter& Get(const char* where, const char* kind);
+    /// Set how many occurrences of each error are printed, and the seconds between summaries
+    static void SetPolicy(Long64_t first, Double_t period);
+    /// Print the totals of every error that happened
+    static void PrintAll(std::ostream& strm = std::cout);
+    /// Zero every counter (printing resumes)
+    static void ResetAll();
+  private:
+    Counter(const Counter&);
+    Counter& operator= (const Counter&);
+  };
+
+  /// \brief Like Error, but only prints when the error's Counter allows it.
+  struct Limited
+  {
+  protected:
+    typedef std::basic_ostream<char, std::char_traits<char> > CoutType;
+    typedef CoutType& (*StandardEndLine)(CoutType&);
+    Counter& fCounter;
+    Bool_t fLast;
+    const Bool_t fPrint;
+  public:
+    Limited(Counter& counter, const char* what = "Error");
+    Limited(const char* where, const char* kind, const char* what = "Error");
+    OPS__(if(fPrint) std::cerr, Limited)
+    Limited& operator<<(StandardEndLine manip) {
+      if(fPrint) manip(std::cerr);
+      return *this;
+    }
+    ~Limited();
+  };
+
   struct Throw
   {
   protected:
@@ -0,0 +1,110 @@
+//! \file Executor.hxx
+//! \brief Defines the thread pools that run rootbeer's threads and parallel tasks.
+//! \details There are two pools:
+//!  - Service threads, for long-lived loops (attaching to data, updating canvases, and every
+//!    other rb::Thread). Each service task gets a thread of its own; threads are kept and reused
+//!    when their task finishes.
+//!  - Compute workers, a fixed number of threads (one per CPU by default) for short tasks that
+//!    split up work on the event path. Each worker has its own queue and steals from the others
+//!    when it runs out.
+//!
+//! Tasks are asked to stop through a CancelToken and are waited for with a Future:
+//! \code
+//! class Half: public rb::Task {
+//!   void Execute() { for(Int_t i=0; i< n && !IsCancelled(); ++i) ... }
+//! };
+//! rb::Future first  = rb::Executor::Submit(new Half(...));
+//! rb::Future second = rb::Executor::Submit(new Half(...));
+//! first.Wait(); second.Wait(); // the waiting thread runs queued tasks meanwhile
+//! \endcode
+#ifndef EXECUTOR_HXX
+#define EXECUTOR_HXX
+#ifndef __MAKECINT__
+#include <Rtypes.h>
+#include "boost_shared_ptr.h"
+
+namespace rb
+{
+  /// \brief Shared flag asking a task to stop.
+  //! \details Copies refer to the same flag. Checking it is a single (volatile) load, so tasks can
+  //! check it as often as they like.
+  class CancelToken
+  {
+  private:
+    boost::shared_ptr<volatile Int_t> fFlag;
+  public:
+    /// Create a new, unset flag
+    CancelToken(): fFlag(new volatile Int_t(0)) { }
+    /// Ask the task(s) using this token to stop
+    void Cancel() { __sync_fetch_and_or(fFlag.get(), 1); }
+    /// Has Cancel() been called?
+    Bool_t IsCancelled() const { return *fFlag != 0; }
+  };
+
+  /// \brief Work run by the Executor.
+  //! \details Derived classes implement Execute(). The Executor owns submitted tasks and deletes
+  //! them when they are done.
+  class Task
+  {
+  private:
+    /// Set by the Executor when the task is submitted
+    CancelToken fToken;
+  public:
+    Task() { }
+    virtual ~Task() { }
+    /// Do the work
+    virtual void Execute() = 0;
+  protected:
+    /// Has the task been asked to stop?
+    Bool_t IsCancelled() const { return fToken.IsCancelled(); }
+    friend class Executor;
+  };
+
+  /// \brief Handle to a submitted task, used to wait for it or cancel it.
+  class Future
+  {
+  public:
+    /// Shared between the Future(s) and the Executor (defined in Executor.cxx)
+    struct State;
+  private:
+    boost::shared_ptr<State> fState;
+  public:
+    /// Refer to no task (Wait() returns immediately)
+    Future() { }
+    /// Refer to a submitted task
+    Future(const boost::shared_ptr<State>& state): fState(state) { }
+    /// Has the task finished (or is there no task)?
+    Bool_t IsDone() const;
+    /// Wait for the task to finish.
+    //! \details If the task runs on the compute workers, queued compute tasks are run in the
+    //! calling thread while waiting.
+    void Wait() const;
+    /// Ask the task to stop (doesn't wait)
+    void Cancel() const;
+  };
+
+  /// \brief Runs tasks on the service threads and compute workers.
+  class Executor
+  {
+  public:
+    /// Run \c task on a thread of its own (for loops that run until cancelled)
+    //! \param token Cancellation flag for the task, e.g. one shared with other tasks
+    static Future Service(Task* task, const CancelToken& token = CancelToken());
+    /// Queue \c task for the compute workers (for short pieces of parallel work)
+    static Future Submit(Task* task, const CancelToken& token = CancelToken());
+    /// Run one queued compute task in the calling thread
+    //! \returns true if a task was run, false if none were queued
+    static Bool_t RunOne();
+    /// Number of compute workers
+    static Int_t GetNworkers();
+    /// Set the number of compute workers; only has an effect before the first Submit()
+    static void SetNworkers(Int_t n);
+    /// Is the calling thread a compute worker?
+    static Bool_t InWorker();
+  private:
+    Executor();
+  };
+}
+
+#endif // #ifndef __MAKECINT__
+#endif // #ifndef EXECUTOR_HXX
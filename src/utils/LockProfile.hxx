@@ -0,0 +1,72 @@
+//! \file LockProfile.hxx
+//! \brief Defines the lock contention profiler used by rb::Mutex.
+//! \details Only does anything when compiled with -DRB_LOCK_PROFILE. Profiling can then be turned
+//! on and off at runtime with rb::stats::StartLockProfile() and rb::stats::StopLockProfile().
+#ifndef LOCK_PROFILE_HXX
+#define LOCK_PROFILE_HXX
+#include <iostream>
+#include <Rtypes.h>
+
+#if defined(RB_LOCK_PROFILE) && !defined(__MAKECINT__)
+/// Keeps functions that lock a mutex out of line, so that their return address is the call site
+#define RB_LOCK_NOINLINE __attribute__((noinline))
+/// Record the caller of the current function as the site of the next lock by this thread
+#define RB_LOCK_SITE() rb::gLockSite = __builtin_return_address(0)
+/// Forget the site recorded by RB_LOCK_SITE() (in case the lock wasn't an rb::Mutex)
+#define RB_LOCK_SITE_CLEAR() rb::gLockSite = 0
+#else
+#define RB_LOCK_NOINLINE
+#define RB_LOCK_SITE()
+#define RB_LOCK_SITE_CLEAR()
+#endif
+
+
+namespace rb
+{
+#if defined(RB_LOCK_PROFILE) && !defined(__MAKECINT__)
+/// Acquisition site set by ScopedLock and LockingPointer for the next Mutex::Lock() (0 if none)
+extern __thread const void* gLockSite;
+#endif
+
+/// Counters for one rb::Mutex instance, defined in LockProfile.cxx
+class LockProfile;
+
+/// \brief Global switch and reporting for lock profiling.
+//! \details For every rb::Mutex (including the TThread global mutex) and every code location
+//! that locks it, counts acquisitions and contended acquisitions, and measures the time spent
+//! waiting and the distribution of hold times. For contended acquisitions the waiting thread and
+//! the thread holding the lock are recorded. Locations are the return addresses of the locking
+//! calls, resolved to function and file:line when printing.
+class LockProfiler
+{
+private:
+	 /// Is profiling on?
+	 static Bool_t fgEnabled;
+public:
+	 /// Was the profiler compiled in?
+	 static Bool_t IsAvailable();
+	 /// Turn profiling on
+	 static void Enable();
+	 /// Turn profiling off
+	 static void Disable() { fgEnabled = false; }
+	 /// Is profiling on?
+	 static Bool_t IsEnabled() { return fgEnabled; }
+	 /// Zero every counter
+	 static void Reset();
+	 /// Print the mutexes in order of time spent waiting for them, with up to \c nsites
+	 //! sites and contending thread pairs each
+	 static void Print(Int_t nsites = 10, std::ostream& strm = std::cout);
+	 /// Create the counters for a mutex
+	 static LockProfile* Register(const char* name);
+	 /// Count an acquisition of a mutex
+	 //! \param wait Cycles spent waiting, if \c contended
+	 //! \param waiter, holder Ids of the acquiring thread and of the thread that held the lock
+	 static void Acquired(LockProfile* profile, const void* site, Bool_t contended, ULong64_t wait,
+												Long_t waiter, Long_t holder);
+	 /// Count the release of a mutex acquired at \c site
+	 static void Released(LockProfile* profile, const void* site, ULong64_t hold);
+};
+}
+
+
+#endif
@@ -49,8 +49,9 @@ private:
 public:
   //! Constructor (by reference).
   //! Set fObject and fMutex, lock fMutex.
-  LockingPointer(volatile T& object, rb::Mutex& mutex) :
+  RB_LOCK_NOINLINE LockingPointer(volatile T& object, rb::Mutex& mutex) :
     fObject(const_cast<T*>(&object)), fMutex(&mutex) {
+    RB_LOCK_SITE();
     fMutex->Lock();
 #ifdef LOCKING_POINTER_VERBOSE
     Info("LockingPointer", "Locking: SelfId = %li", TThread::SelfId());
@@ -60,8 +61,9 @@ public:
   //! Constructor (by pointer).
   //! Set fObject and fMutex, lock fMutex. Included for convenience
   //! so we don't have to dereference things that are already pointers.
-  LockingPointer(volatile T* object, rb::Mutex& mutex) :
+  RB_LOCK_NOINLINE LockingPointer(volatile T* object, rb::Mutex& mutex) :
     fObject(const_cast<T*>(object)), fMutex(&mutex) {
+    RB_LOCK_SITE();
     fMutex->Lock();
 #ifdef LOCKING_POINTER_VERBOSE
     Info("LockingPointer", "Locking: SelfId = %li", TThread::SelfId());
@@ -72,8 +74,9 @@ public:
   //! Set fObject and fMutex, lock fMutex. Included for convenience
   //! so we don't have to call get() on smart pointers.
   template <class PTR>
-  LockingPointer(PTR& p_object, rb::Mutex& mutex) :
+  RB_LOCK_NOINLINE LockingPointer(PTR& p_object, rb::Mutex& mutex) :
     fObject(const_cast<T*>(p_object.get())), fMutex(&mutex) {
+    RB_LOCK_SITE();
     fMutex->Lock();
 #ifdef LOCKING_POINTER_VERBOSE
     Info("LockingPointer", "Locking: SelfId = %li", TThread::SelfId());
@@ -84,8 +87,9 @@ public:
   //! Set fObject and fMutex, lock fMutex. Included for convenience
   //! so we don't have to call get() on smart pointers.
   template <class PTR>
-  LockingPointer(PTR& p_object, rb::Mutex* mutex) :
+  RB_LOCK_NOINLINE LockingPointer(PTR& p_object, rb::Mutex* mutex) :
     fObject(const_cast<T*>(p_object.get())), fMutex(mutex) {
+    RB_LOCK_SITE();
     if(fMutex) fMutex->Lock();
     else rb::TThreadMutex::Instance()->Lock();
 #ifdef LOCKING_POINTER_VERBOSE
@@ -96,8 +100,9 @@ public:
   //! Constructor (by reference and mutex pointer).
   //! Set fObject and fMutex, lock fMutex. If the mutex argument is TTHREAD_GLOBAL_MUTEX,
   //! Lock the TThread global mutex
-  LockingPointer(volatile T& object, rb::Mutex* mutex) :
+  RB_LOCK_NOINLINE LockingPointer(volatile T& object, rb::Mutex* mutex) :
     fObject(const_cast<T*>(&object)), fMutex(mutex) {
+    RB_LOCK_SITE();
     if(fMutex) fMutex->Lock();
     else rb::TThreadMutex::Instance()->Lock();
 #ifdef LOCKING_POINTER_VERBOSE
@@ -108,8 +113,9 @@ public:
   //! Constructor (by pointer and mutex pointer).
   //! Set fObject and fMutex, lock fMutex. If the mutex argument is TTHREAD_GLOBAL_MUTEX,
   //! Lock the TThread global mutex
-  LockingPointer(volatile T* object, rb::Mutex* mutex) :
+  RB_LOCK_NOINLINE LockingPointer(volatile T* object, rb::Mutex* mutex) :
     fObject(const_cast<T*>(object)), fMutex(mutex) {
+    RB_LOCK_SITE();
     if(fMutex) fMutex->Lock();
     else rb::TThreadMutex::Instance()->Lock();
 #ifdef LOCKING_POINTER_VERBOSE
@@ -241,14 +247,18 @@ private:
 
 public:
   //! Allocate a new counter
-  explicit CountedLockingPointer(volatile T* object = 0, rb::Mutex* mutex = 0) :
+  RB_LOCK_NOINLINE explicit CountedLockingPointer(volatile T* object = 0, rb::Mutex* mutex = 0) :
     fCounter(0) {
+    RB_LOCK_SITE();
     if (object) fCounter = new Counter(object, mutex);
+    RB_LOCK_SITE_CLEAR();
   }
   //! Allocate a new counter
-  explicit CountedLockingPointer(volatile T& object, rb::Mutex* mutex) :
+  RB_LOCK_NOINLINE explicit CountedLockingPointer(volatile T& object, rb::Mutex* mutex) :
     fCounter(0) {
+    RB_LOCK_SITE();
     fCounter = new Counter(&object, mutex);
+    RB_LOCK_SITE_CLEAR();
   }
   //! Call Release()
   ~CountedLockingPointer() { Release(); }
@@ -1,75 +1,182 @@
 //! \file Logger.hxx
-//! \brief Defines a very simple class for error message logging.
+//! \brief Defines a low-overhead asynchronous logger.
+//! \details Messages are written with the RB_LOG (debug level) or RB_LOG_AT(level) macros, e.g.
+//! \code
+//! RB_LOG << "Locked: " << name << ", Thread ID: " << id << std::endl;
+//! RB_LOG_AT(Logger::kWarning) << "Dropped " << n << " buffers";
+//! \endcode
+//! Each thread copies its messages, unformatted, into its own ring buffer; a background thread
+//! collects them, formats them and writes them to rbeer.log. Logging never blocks: when a ring is
+//! full, messages are dropped and counted. Messages above the current level (Logger::SetLevel())
+//! cost a single comparison. Compiling with -DRB_LOGGING makes kWarning the initial level,
+//! otherwise logging is off until turned on; debug messages (e.g. lock logging) always have to
+//! be turned on with Logger::SetLevel().
 #ifndef LOGGER_HXX
 #define LOGGER_HXX
 #include <iostream>
-#ifndef RB_LOGGING
+#include <string>
+#include <Rtypes.h>
+#include "Cycles.hxx"
+
+#ifdef __MAKECINT__
 #define RB_LOG if(0) std::cerr
+#define RB_LOG_AT(level) if(0) std::cerr
 #else
-#include <fstream>
-#include <string>
 
-#ifndef __MAKECINT__
+/// \brief Asynchronous logger.
+class Logger
+{
+public:
+	 /// Verbosity levels
+	 enum Level_t { kOff = 0, kError, kWarning, kInfo, kDebug };
+	 /// Number of records in each thread's ring buffer
+	 static const UInt_t kRingSize = 1024;
+	 /// Bytes of message arguments stored per record
+	 static const UInt_t kPayload = 96;
+	 /// Argument type tags
+	 enum { kTagSigned = 1, kTagUnsigned, kTagDouble, kTagChar, kTagBool, kTagString };
 
-#define LOG_OP__(CLASS, ARGTYPE) CLASS& operator<< (ARGTYPE arg) {	\
-    fStrm << arg; return *this;					\
-  }
-#define LOG_OPS__(CL)				\
-  LOG_OP__(CL, const char*)			\
-  LOG_OP__(CL, long long)			\
-  LOG_OP__(CL, long)				\
-  LOG_OP__(CL, int)				\
-  LOG_OP__(CL, short)				\
-  LOG_OP__(CL, char)				\
-  LOG_OP__(CL, unsigned long long)		\
-  LOG_OP__(CL, unsigned long)			\
-  LOG_OP__(CL, unsigned int)			\
-  LOG_OP__(CL, unsigned short)			\
-  LOG_OP__(CL, unsigned char)			\
-  LOG_OP__(CL, bool)				\
-  LOG_OP__(CL, double)				\
-  LOG_OP__(CL, float)				\
-  LOG_OP__(CL, const std::string&)
+	 /// One message, with its arguments stored as (tag, value) pairs
+	 struct Record {
+			/// Cycle counter at the start of the message
+			ULong64_t fTime;
+			/// Source location (string literals)
+			const char* fFile;
+			const char* fFunc;
+			Int_t fLine;
+			/// Message level
+			UShort_t fLevel;
+			/// Payload bytes used, with the top bit set if arguments were cut off
+			UShort_t fSize;
+			/// Tagged arguments
+			char fPayload[kPayload];
+	 };
 
+	 /// Single-producer single-consumer ring of records owned by one thread
+	 struct Ring;
+
+	 /// \brief Builds one record in the calling thread's ring.
+	 //! \details The record is published when the Line is destroyed, i.e. at the end of the
+	 //! statement; std::endl and other manipulators are ignored.
+	 class Line
+	 {
+	 private:
+			/// Ring being written, 0 if the message is being dropped
+			Ring* fRing;
+			/// Record being written
+			Record* fRecord;
+	 public:
+			/// Reserve a record
+			Line(Int_t level, const char* file, Int_t line, const char* func);
+			/// Publish the record
+			~Line();
+			Line& operator<< (const char* arg);
+			Line& operator<< (const std::string& arg) { return *this << arg.c_str(); }
+			Line& operator<< (char arg)               { return Put(kTagChar, &arg, 1); }
+			Line& operator<< (bool arg)               { char c = arg; return Put(kTagBool, &c, 1); }
+			Line& operator<< (short arg)              { return Signed(arg); }
+			Line& operator<< (int arg)                { return Signed(arg); }
+			Line& operator<< (long arg)               { return Signed(arg); }
+			Line& operator<< (long long arg)          { return Signed(arg); }
+			Line& operator<< (unsigned char arg)      { return Unsigned(arg); }
+			Line& operator<< (unsigned short arg)     { return Unsigned(arg); }
+			Line& operator<< (unsigned int arg)       { return Unsigned(arg); }
+			Line& operator<< (unsigned long arg)      { return Unsigned(arg); }
+			Line& operator<< (unsigned long long arg) { return Unsigned(arg); }
+			Line& operator<< (float arg)              { return *this << Double_t(arg); }
+			Line& operator<< (double arg)             { return Put(kTagDouble, &arg, sizeof(arg)); }
+			Line& operator<< (const void* arg)        { return Unsigned(ULong64_t(arg)); }
+			/// Ignore manipulators (std::endl, std::flush)
+			Line& operator<< (std::ostream& (*)(std::ostream&)) { return *this; }
+	 private:
+			Line& Signed(Long64_t arg)    { return Put(kTagSigned, &arg, sizeof(arg)); }
+			Line& Unsigned(ULong64_t arg) { return Put(kTagUnsigned, &arg, sizeof(arg)); }
+			/// Append a tagged argument
+			Line& Put(char tag, const void* data, UInt_t size);
+			Line(const Line&);
+			Line& operator= (const Line&);
+	 };
 
-class Logger
-{
 private:
-  typedef std::basic_ostream<char, std::char_traits<char> > CoutType;
-  typedef CoutType& (*StandardEndLine)(CoutType&);
-  const char* const kFileName;
-  std::ofstream fStrm;
+	 /// Current level
+	 static volatile Int_t fgLevel;
 public:
-  static Logger& Instance();
-  LOG_OPS__(Logger)
-  Logger& operator<<(StandardEndLine manip);
-  ~Logger();
- 
-private:
-  Logger(const char* fname);
-};  
+	 /// Set the verbosity level; messages above it are not recorded
+	 static void SetLevel(Int_t level) { fgLevel = level; }
+	 /// Return the verbosity level
+	 static Int_t GetLevel() { return fgLevel; }
+	 /// Will messages at \c level be recorded?
+	 static Bool_t IsEnabled(Int_t level) { return level <= fgLevel; }
+	 /// Write out every record published so far (waits for the background thread)
+	 static void Flush();
+	 /// Return the calling thread's ring, creating it if needed (0 if out of memory)
+	 static Ring* GetRing();
+	 /// Reserve the next record in \c ring, or return 0 if it is full (or already being written)
+	 static Record* Reserve(Ring* ring);
+	 /// Publish the record returned by the last Reserve()
+	 static void Publish(Ring* ring);
+};
 
-inline Logger::Logger(const char* fname): kFileName(fname),
-					  fStrm(kFileName) { }
+/// Log a message at level \c level
+#define RB_LOG_AT(level) \
+	if(!Logger::IsEnabled(level)) ; else Logger::Line(level, __FILE__, __LINE__, __func__)
 
-inline Logger::~Logger() {
-  fStrm.close();
-}
+/// Log a debug message
+#define RB_LOG RB_LOG_AT(Logger::kDebug)
 
-inline Logger& Logger::Instance() {
-  static Logger logger("rbeer.log");
-  return logger;
+
+// ========= Inlined Functions ========= //
+inline Logger::Line::Line(Int_t level, const char* file, Int_t line, const char* func):
+	fRing(GetRing()), fRecord(fRing ? Reserve(fRing) : 0) {
+	if(!fRecord) return;
+	fRecord->fTime = rb::Cycles::Now();
+	fRecord->fFile = file;
+	fRecord->fFunc = func;
+	fRecord->fLine = line;
+	fRecord->fLevel = level;
+	fRecord->fSize = 0;
 }
 
-inline Logger& Logger::operator<<(StandardEndLine manip) {
-  manip(fStrm);
-  fStrm.flush();
-  return *this;
+inline Logger::Line::~Line() {
+	if(fRecord) Publish(fRing);
 }
 
-#define RB_LOG  Logger::Instance() << "Logging in <" << __func__ << "> (" << __FILE__ << ", line " << __LINE__ << "): "
+inline Logger::Line& Logger::Line::Put(char tag, const void* data, UInt_t size) {
+	if(!fRecord) return *this;
+	const UInt_t used = fRecord->fSize & 0x7fff;
+	if(used + 1 + size > kPayload) {
+		fRecord->fSize |= 0x8000; // truncated
+		return *this;
+	}
+	fRecord->fPayload[used] = tag;
+	const char* bytes = static_cast<const char*>(data);
+	for(UInt_t i=0; i< size; ++i) fRecord->fPayload[used + 1 + i] = bytes[i];
+	fRecord->fSize += 1 + size;
+	return *this;
+}
 
-#endif // #ifdef RB_LOGGING
+inline Logger::Line& Logger::Line::operator<< (const char* arg) {
+	if(!fRecord) return *this;
+	if(!arg) arg = "(null)";
+	// Strings are copied as a length byte followed by the characters, shortened to fit
+	const UInt_t used = fRecord->fSize & 0x7fff;
+	if(used + 2 >= kPayload) {
+		fRecord->fSize |= 0x8000;
+		return *this;
+	}
+	UInt_t len = 0;
+	while(arg[len] && len < 255) ++len;
+	const UInt_t room = kPayload - used - 2;
+	if(len > room) {
+		len = room;
+		fRecord->fSize |= 0x8000;
+	}
+	fRecord->fPayload[used] = kTagString;
+	fRecord->fPayload[used + 1] = char(len);
+	for(UInt_t i=0; i< len; ++i) fRecord->fPayload[used + 2 + i] = arg[i];
+	fRecord->fSize += 2 + len;
+	return *this;
+}
 
-#endif // #ifndef __MAKECINT__
-#endif // #ifndeg LOGGER_HXX
+#endif // #ifdef __MAKECINT__
+#endif // #ifndef LOGGER_HXX
@@ -1,12 +1,16 @@
 //! \file Mutex.hxx
 //! \brief Defines a mutex class that can optionally check for deadlick conditiona.
-//! \details Compile with -DDEBUG to turn on deadlock checking
+//! \details Compile with -DDEBUG to turn on deadlock checking, with -DRB_LOG_LOCKS to log every
+//! lock and unlock (at the debug level, see Logger.hxx), or with -DRB_LOCK_PROFILE to allow lock
+//! contention profiling (see LockProfile.hxx).
 #ifndef MUTEX_HXX
 #define MUTEX_HXX
 #include <string>
 #include <TMutex.h>
 #include "Error.hxx"
 #include "Logger.hxx"
+#include "Cycles.hxx"
+#include "LockProfile.hxx"
 
 namespace rb
 {
@@ -21,6 +25,16 @@ namespace rb
     const std::string kName;
     //! Id of the thread holding the lock on this mutex
     Long_t fId;
+#if defined(RB_LOCK_PROFILE) && !defined(__MAKECINT__)
+    //! Profiling counters, created on the first profiled lock
+    LockProfile* fProfile;
+    //! Site of the outermost profiled lock currently held
+    const void* fSite;
+    //! Time of the outermost profiled lock currently held
+    ULong64_t fLockedAt;
+    //! Profiled lock depth (for recursive mutexes)
+    Int_t fDepth;
+#endif
   public:
     //! Sets name, recursive
     Mutex(const char* name = "", Bool_t recursive = kFALSE);
@@ -36,6 +50,21 @@ namespace rb
     virtual Bool_t IsLocked();
     //! \returns fId
     Long_t GetId();
+#if defined(RB_LOCK_PROFILE) && !defined(__MAKECINT__)
+  protected:
+    //! Lock without profiling or logging
+    virtual Int_t RawLock() { return TMutex::Lock(); }
+    //! TryLock without profiling or logging
+    virtual Int_t RawTryLock() { return TMutex::TryLock(); }
+    //! Unlock without profiling or logging
+    virtual Int_t RawUnLock() { return TMutex::UnLock(); }
+    //! Lock, timing any wait, and count it as an acquisition from \c caller
+    Int_t ProfiledLock(const void* caller);
+    //! TryLock, counting success as an acquisition from \c caller
+    Int_t ProfiledTryLock(const void* caller);
+    //! Count the release of the outermost profiled lock
+    void ProfiledUnLock();
+#endif
   private:
     //! Prevent copying
     Mutex(const Mutex& other) {}
@@ -60,6 +89,15 @@ namespace rb
     virtual Int_t TryLock();
     //! Unlock the mutex
     virtual Int_t UnLock();
+#if defined(RB_LOCK_PROFILE) && !defined(__MAKECINT__)
+  protected:
+    //! TThread::Lock()
+    virtual Int_t RawLock() { return TThread::Lock(); }
+    //! TThread::TryLock()
+    virtual Int_t RawTryLock() { return TThread::TryLock(); }
+    //! TThread::UnLock()
+    virtual Int_t RawUnLock() { return TThread::UnLock(); }
+#endif
   };   
 
   /// Class to lock a mutex upon construction and then unlock it upon destruction.
@@ -73,9 +111,9 @@ namespace rb
     M& fMutex;
   public:
     //! Initialize & lock fMutex
-    ScopedLock(M& mutex);
+    RB_LOCK_NOINLINE ScopedLock(M& mutex);
     //! Initialize & lock fMutex, from pointer
-    ScopedLock(M* mutex);
+    RB_LOCK_NOINLINE ScopedLock(M* mutex);
     //! Unlock fMutex
     ~ScopedLock();
   private:
@@ -93,24 +131,34 @@ namespace rb
 // ======== Class rb::Mutex ========= //
 
 inline rb::Mutex::Mutex(const char* name, Bool_t recursive):
-  TMutex(recursive), kName(name), fId(kIsUnlocked) { }
+  TMutex(recursive), kName(name), fId(kIsUnlocked)
+#if defined(RB_LOCK_PROFILE) && !defined(__MAKECINT__)
+  , fProfile(0), fSite(0), fLockedAt(0), fDepth(0)
+#endif
+{ }
 
 inline rb::Mutex::~Mutex() { }
 
-inline Int_t rb::Mutex::Lock() {
+inline RB_LOCK_NOINLINE Int_t rb::Mutex::Lock() {
+#if defined(RB_LOCK_PROFILE) && !defined(__MAKECINT__)
+  if(rb::LockProfiler::IsEnabled()) return ProfiledLock(__builtin_return_address(0));
+#endif
   Int_t ret = TMutex::Lock();
   fId = TThread::SelfId();
-#ifdef RB_LOGGING
+#ifdef RB_LOG_LOCKS
   RB_LOG << "  Locked:   " << kName << ", Thread ID: " << TThread::SelfId() << std::endl;
 #endif
   return ret;
 }
 
-inline Int_t rb::Mutex::TryLock() {
+inline RB_LOCK_NOINLINE Int_t rb::Mutex::TryLock() {
+#if defined(RB_LOCK_PROFILE) && !defined(__MAKECINT__)
+  if(rb::LockProfiler::IsEnabled()) return ProfiledTryLock(__builtin_return_address(0));
+#endif
   Int_t ret = TMutex::TryLock();
   if(ret == 0) {
     fId = TThread::SelfId();
-#ifdef RB_LOGGING
+#ifdef RB_LOG_LOCKS
   RB_LOG << "  Locked:   " << kName << ", Thread ID: " << TThread::SelfId() << std::endl;
 #endif
   }
@@ -118,8 +166,11 @@ inline Int_t rb::Mutex::TryLock() {
 }
 
 inline Int_t rb::Mutex::UnLock() {
+#if defined(RB_LOCK_PROFILE) && !defined(__MAKECINT__)
+  if(fDepth) ProfiledUnLock();
+#endif
   fId = kIsUnlocked;
-#ifdef RB_LOGGING
+#ifdef RB_LOG_LOCKS
     RB_LOG << "UnLocked: " << kName << ", Thread ID: " << TThread::SelfId() << std::endl;
 #endif
   Int_t ret = TMutex::UnLock();
@@ -133,6 +184,53 @@ inline Bool_t rb::Mutex::IsLocked() {
 inline Long_t rb::Mutex::GetId() {
   return fId;
 }
+
+#if defined(RB_LOCK_PROFILE) && !defined(__MAKECINT__)
+inline Int_t rb::Mutex::ProfiledLock(const void* caller) {
+  const void* site = rb::gLockSite ? rb::gLockSite : caller;
+  rb::gLockSite = 0;
+  Bool_t contended = false;
+  ULong64_t wait = 0;
+  Long_t holder = 0;
+  Int_t ret = RawTryLock();
+  if(ret != 0) { // somebody else has it
+    contended = true;
+    holder = fId;
+    const ULong64_t start = rb::Cycles::Now();
+    ret = RawLock();
+    wait = rb::Cycles::Now() - start;
+  }
+  fId = TThread::SelfId();
+  if(!fProfile) fProfile = rb::LockProfiler::Register(kName.c_str());
+  rb::LockProfiler::Acquired(fProfile, site, contended, wait, fId, holder);
+  if(fDepth++ == 0) {
+    fSite = site;
+    fLockedAt = rb::Cycles::Now();
+  }
+  return ret;
+}
+
+inline Int_t rb::Mutex::ProfiledTryLock(const void* caller) {
+  const void* site = rb::gLockSite ? rb::gLockSite : caller;
+  rb::gLockSite = 0;
+  Int_t ret = RawTryLock();
+  if(ret == 0) {
+    fId = TThread::SelfId();
+    if(!fProfile) fProfile = rb::LockProfiler::Register(kName.c_str());
+    rb::LockProfiler::Acquired(fProfile, site, false, 0, fId, 0);
+    if(fDepth++ == 0) {
+      fSite = site;
+      fLockedAt = rb::Cycles::Now();
+    }
+  }
+  return ret;
+}
+
+inline void rb::Mutex::ProfiledUnLock() {
+  // Called with the lock still held
+  if(--fDepth == 0) rb::LockProfiler::Released(fProfile, fSite, rb::Cycles::Now() - fLockedAt);
+}
+#endif
   
 // ======== Class rb::TThreadMutex ========= //
 
@@ -141,20 +239,26 @@ inline rb::TThreadMutex::TThreadMutex():
 
 inline rb::TThreadMutex::~TThreadMutex() {}
 
-inline Int_t rb::TThreadMutex::Lock() {
+inline RB_LOCK_NOINLINE Int_t rb::TThreadMutex::Lock() {
+#if defined(RB_LOCK_PROFILE) && !defined(__MAKECINT__)
+  if(rb::LockProfiler::IsEnabled()) return ProfiledLock(__builtin_return_address(0));
+#endif
   Int_t ret = TThread::Lock();
   fId = TThread::SelfId();
-#ifdef RB_LOGGING
+#ifdef RB_LOG_LOCKS
   RB_LOG << "  Locked:   " << kName << ", Thread ID: " << TThread::SelfId() << std::endl;
 #endif
   return ret;
 }
 
-inline Int_t rb::TThreadMutex::TryLock() {
+inline RB_LOCK_NOINLINE Int_t rb::TThreadMutex::TryLock() {
+#if defined(RB_LOCK_PROFILE) && !defined(__MAKECINT__)
+  if(rb::LockProfiler::IsEnabled()) return ProfiledTryLock(__builtin_return_address(0));
+#endif
   Int_t ret = TThread::TryLock();
   if(ret == 0) {
     fId = TThread::SelfId();
-#ifdef RB_LOGGING
+#ifdef RB_LOG_LOCKS
     RB_LOG << "  Locked:   " << kName << ", Thread ID: " << TThread::SelfId() << std::endl;
 #endif
   }
@@ -162,8 +266,11 @@ inline Int_t rb::TThreadMutex::TryLock() {
 }
 
 inline Int_t rb::TThreadMutex::UnLock() {
+#if defined(RB_LOCK_PROFILE) && !defined(__MAKECINT__)
+  if(fDepth) ProfiledUnLock();
+#endif
   fId = kIsUnlocked;
-#ifdef RB_LOGGING
+#ifdef RB_LOG_LOCKS
   RB_LOG << "UnLocked: " << kName << ", Thread ID: " << TThread::SelfId() << std::endl;
 #endif
   Int_t ret = TThread::UnLock();
@@ -180,12 +287,16 @@ inline rb::TThreadMutex* rb::TThreadMutex::Instance() {
 
 template <class M>
 rb::ScopedLock<M>::ScopedLock(M& mutex): fMutex(mutex) {
+  RB_LOCK_SITE();
   fMutex.Lock();
+  RB_LOCK_SITE_CLEAR();
 }
 
 template <class M>
 rb::ScopedLock<M>::ScopedLock(M* mutex): fMutex(*mutex) {
+  RB_LOCK_SITE();
   fMutex.Lock();
+  RB_LOCK_SITE_CLEAR();
 }
 
 template <class M>
@@ -8,8 +8,9 @@
 #include <map>
 #include <TCint.h>
 #include <TThread.h>
-#include <TCondition.h>
 #include "Mutex.hxx"
+#include "Executor.hxx"
+#include "Affinity.hxx"
 #include "nocopy.h"
 
 namespace rb
@@ -42,6 +43,9 @@ namespace rb
     //! \note Must be unique; duplicate names result in an assert.
     const char* fName;
 
+    //! Role of the thread (rb::Affinity::Role_t), which decides the CPUs it runs on
+    Int_t fRole;
+
   private:
     //! Keeps track of all presently <it>running</it> threads.
     static Thread::Set_t& fgSet() {
@@ -49,35 +53,53 @@ namespace rb
       return *out;
     }
 
-    //! ROOT TThread, handles the running of the threaded function.
-    TThread* fThread;
+    //! Guards fgSet()
+    static rb::Mutex& fgSetMutex() {
+      static rb::Mutex* out = new rb::Mutex("rb::Thread::fgSet");
+      return *out;
+    }
+
+#ifndef __MAKECINT__
+    //! Set by Stop() to end DoInThread()
+    CancelToken fToken;
+
+    //! Completion of the task running DoInThread()
+    Future fFuture;
+
+    //! Runs DoInThread() on an executor service thread
+    class Runner: public Task {
+      Thread* fThread;
+    public:
+      Runner(Thread* thread): fThread(thread) { }
+      void Execute() { Thread::FRun(fThread); }
+    };
+    friend class Runner;
+#endif
+
+    //! TThread::SelfId() of the thread running DoInThread(), 0 if not running
+    volatile Long_t fRunningId;
+
+    //! Set when DoInThread() stopped its own thread, so FRun() has to delete it
+    volatile Bool_t fSelfStopped;
 
     //! Checks to make sure there's no duplicate thread names in the program,
     //! throws an assert if there is.
     //! \todo Maybe it would be better to use an exception?
     const char* NameCheck(const char* name) {
-      bool ThreadNameIsUnique = TThread::GetThread(name) == 0;
+      bool ThreadNameIsUnique = !IsRunning(name);
       assert(ThreadNameIsUnique);
       return name;
     }
 
-    Bool_t kInLoop;
-    TCondition fInLoop;
-
   public:
-    //! \details Sets fName, initializes fThread to 0, checks for duplicate names.
-    Thread(const char* name) : fName(name), fThread(0), kInLoop(false) {
+    //! \details Sets fName and fRole, checks for duplicate names.
+    Thread(const char* name, Int_t role = -1) :
+      fName(name), fRole(role), fRunningId(0), fSelfStopped(false) {
       NameCheck(name);
     }
 
-    //! \details Calls Stop(), TThread::Join() on fThread, deallocated fThread.
-    virtual ~Thread() {
-      Stop(fName);
-      if(fThread) {
-	//	fThread->Join();
-	delete fThread;
-      }
-    }
+    //! \details Nothing to do; running threads are deleted by Stop() or when DoInThread() returns.
+    virtual ~Thread() { }
 
     //! Returns the thread name
     std::string GetName() { return std::string(fName); }
@@ -85,63 +107,98 @@ namespace rb
     //! \brief Function that we want to run in a threaded environment.
     //! \details As this is pure virtual, it must be implemented in derived
     //! classes. This is where we tell what we want to actually happen in the
-    //! threaded environment.
+    //! threaded environment. Loops should end once IsCancelled() returns true.
     virtual void DoInThread() = 0;
 
-    //! \brief Start running the thread.
+    //! \brief Start running the thread (on an rb::Executor service thread).
     Int_t Run() {
-      fThread = new TThread(fName, Thread::FRun);
+      // Hold the lock until fFuture is set: FRun() can't delete us before then
+      rb::ScopedLock<rb::Mutex> lock(fgSetMutex());
       fgSet().insert(std::make_pair<std::string, rb::Thread*> (fName, this));
-      return fThread->Run(reinterpret_cast<void*>(this));
+#ifndef __MAKECINT__
+      fFuture = Executor::Service(new Runner(this), fToken);
+#endif
+      return 0;
     }
 
+#ifndef __MAKECINT__
+    //! Use the cancellation flag of another thread, e.g. when running DoInThread() inside it.
+    void ShareCancelToken(const Thread& other) { fToken = other.fToken; }
+#endif
+
     //! \brief Checks if a specific thread is running (see Stop() for more details).
     static Bool_t IsRunning(const char* name) {
+      rb::ScopedLock<rb::Mutex> lock(fgSetMutex());
       return fgSet().count(name);
     }
 
     static rb::Thread* GetThread(const char* name) {
-      return IsRunning(name) ? fgSet().find(name)->second : 0;
+      rb::ScopedLock<rb::Mutex> lock(fgSetMutex());
+      Set_t::iterator it = fgSet().find(name);
+      return it != fgSet().end() ? it->second : 0;
     }
 
     //! Stop running a specific thread.
-    //! \details This function, along with IsRunning() are meant to allow
-    //! threads to be terminated by an external signal.  To do this, place
-    //! a condition on IsRunning within the implementation of DoInThread(),
-    //! then an external call to TThread::Stop() can stop the thread execution.
-    //! For example:
+    //! \details Asks the thread to stop, waits for DoInThread() to return, and deletes the thread.
+    //! Implementations of DoInThread() should therefore check IsCancelled() regularly:
     //! \code
     //! // In MyThread::DoInThread()
-    //! while TThread::IsRuning("MyThreadName") // do something
+    //! while (!IsCancelled()) // do something
     //! // .... //
     //! // Now in some external function
-    //! if (whatever) TThread::Stop("MyThreadName") // breaks out of the DoInThread() loop.
+    //! if (whatever) rb::Thread::Stop("MyThreadName") // breaks out of the DoInThread() loop.
     //! \endcode
     static void Stop(const char* name) {
-      if(IsRunning(name)) {
-	rb::Thread* this_ = rb::Thread::GetThread(name);
-	fgSet().erase(name);
-	TThread* th = TThread::GetThread(name);
-       	if(th) {
-      	  Int_t unlock = gCINTMutex->UnLock();
-	  th->Join();
-	  if(!unlock) gCINTMutex->Lock();
-	  delete this_;
-	}
+      rb::Thread* this_ = 0;
+      {
+        rb::ScopedLock<rb::Mutex> lock(fgSetMutex());
+        Set_t::iterator it = fgSet().find(name);
+        if(it == fgSet().end()) return;
+        this_ = it->second;
+        fgSet().erase(it);
       }
+#ifndef __MAKECINT__
+      this_->fToken.Cancel();
+      if(this_->fRunningId == TThread::SelfId()) { // stopping ourselves; FRun() cleans up
+        this_->fSelfStopped = true;
+        return;
+      }
+      Int_t unlock = gCINTMutex->UnLock();
+      this_->fFuture.Wait();
+      if(!unlock) gCINTMutex->Lock();
+#endif
+      delete this_;
     }
 
+  protected:
+#ifndef __MAKECINT__
+    //! Has Stop() been called?
+    Bool_t IsCancelled() const { return fToken.IsCancelled(); }
+#endif
+
   private:
-    //! \brief Function for passing to the TThread constructor.
-    //! \details TThread requires a function <tt>void * func(void *)</tt>
-    //! Here we define one that takes (void*)this as the argument, allowing
-    //! us to run a normal member function [DoInThread()] in the threaded
-    //! environment.  DoInThread() returns, call the destructor on this,
-    //! allowing for self-management of allocated memory.
+    //! \brief Runs DoInThread(), then deletes \c this unless Stop() is waiting to do it.
     static void * FRun(void * args) {
       Thread * this_ =  reinterpret_cast<Thread*> (args);
+      this_->fRunningId = TThread::SelfId();
+#ifndef __MAKECINT__
+      rb::Affinity::Apply(this_->fRole);
+#endif
       this_->DoInThread();
-      Stop(this_->fName);
+      this_->fRunningId = 0;
+#ifndef __MAKECINT__
+      rb::Affinity::Apply(rb::Affinity::kNone); // the service thread is reused by other roles
+#endif
+      Bool_t registered = false;
+      {
+        rb::ScopedLock<rb::Mutex> lock(fgSetMutex());
+        Set_t::iterator it = fgSet().find(this_->fName);
+        if(it != fgSet().end() && it->second == this_) {
+          fgSet().erase(it);
+          registered = true;
+        }
+      }
+      if(registered || this_->fSelfStopped) delete this_;
       return 0;
     }
   };
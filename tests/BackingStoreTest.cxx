@@ -0,0 +1,81 @@
+//! \file BackingStoreTest.cxx
+//! \brief Closes and reopens an rb::hist::BackingStore, checking that histograms resume from the counts
+//! it holds only when their event, path and binning match.
+#include <TSystem.h>
+#include "hist/BackingStore.hxx"
+#include "hist/Hist.hxx"
+#include "Rootbeer.hxx"
+#define TESTS_NEED_APP
+#include "Check.hxx"
+
+namespace
+{
+/// File of the test store
+const char* kFilename = "BackingStoreTest.store";
+}
+
+Int_t main() {
+	rb::Rint* app = create_app();
+	const Int_t code = first_event_code();
+	gSystem->Unlink(kFilename);
+
+	rb::hist::Base* same = rb::hist::New("same", "resumes", 10, 0, 10, "0", "", code);
+	rb::hist::Base* rebinned = rb::hist::New("rebinned", "starts over", 10, 0, 10, "0", "", code);
+	CHECK(same != 0 && rebinned != 0);
+	if(!same || !rebinned) return report("BackingStoreTest");
+
+	// Counts filled before opening move into the store, and keep accumulating there
+	same->AddBinContent(2, 3);
+	CHECK(rb::hist::BackingStore::Open(kFilename, 1));
+	CHECK(rb::hist::BackingStore::IsOpen());
+	CHECK(rb::hist::BackingStore::IsAttached(same) && rb::hist::BackingStore::IsAttached(rebinned));
+	CHECK(!rb::hist::BackingStore::Open(kFilename, 1));
+	same->AddBinContent(2, 1);
+	rebinned->AddBinContent(5, 4);
+	CHECK(same->GetBinContent(2) == 4);
+	rb::hist::BackingStore::Sync();
+
+	// Closing keeps the records and moves the bins back to the heap
+	rb::hist::BackingStore::Close();
+	CHECK(!rb::hist::BackingStore::IsOpen());
+	CHECK(!rb::hist::BackingStore::IsAttached(same));
+	CHECK(same->GetBinContent(2) == 4);
+
+	// As after a restart: new histograms with the same paths
+	delete same;
+	delete rebinned;
+	same = rb::hist::New("same", "resumes", 10, 0, 10, "0", "", code);
+	rebinned = rb::hist::New("rebinned", "starts over", 20, 0, 10, "0", "", code);
+	CHECK(same != 0 && rebinned != 0);
+	if(!same || !rebinned) return report("BackingStoreTest");
+	CHECK(same->GetBinContent(2) == 0);
+
+	CHECK(rb::hist::BackingStore::Open(kFilename, 1));
+	CHECK(same->GetBinContent(2) == 4);
+	CHECK(same->GetEntries() > 0);
+	CHECK(rebinned->GetBinContent(5) == 0);
+	same->AddBinContent(2, 1);
+	rb::hist::BackingStore::Close();
+	CHECK(same->GetBinContent(2) == 5);
+
+	// Created while the store is open, and resuming as it is attached
+	delete same;
+	CHECK(rb::hist::BackingStore::Open(kFilename, 1));
+	same = rb::hist::New("same", "resumes", 10, 0, 10, "0", "", code);
+	CHECK(same != 0 && rb::hist::BackingStore::IsAttached(same));
+	if(same) CHECK(same->GetBinContent(2) == 5);
+	// Deleting it while open discards its record
+	delete same;
+	rb::hist::BackingStore::Close();
+	CHECK(rb::hist::BackingStore::Open(kFilename, 1));
+	same = rb::hist::New("same", "resumes", 10, 0, 10, "0", "", code);
+	if(same) CHECK(same->GetBinContent(2) == 0);
+	rb::hist::BackingStore::Close();
+
+	delete same;
+	delete rebinned;
+	gSystem->Unlink(kFilename);
+	const Int_t status = report("BackingStoreTest");
+	app->Terminate(status);
+	return status;
+}
@@ -0,0 +1,52 @@
+//! \file Check.hxx
+//! \brief Defines the checks and helpers shared by the test programs.
+#ifndef TESTS_CHECK_HXX
+#define TESTS_CHECK_HXX
+#include <iostream>
+#include <Rtypes.h>
+
+namespace
+{
+/// Number of failed CHECK()s
+Int_t nfailed = 0;
+
+/// Print the outcome of the test program \c name
+//! \returns its exit code
+Int_t report(const char* name) {
+	if(nfailed) std::cerr << name << ": " << nfailed << " checks failed\n";
+	else std::cout << name << ": all checks passed\n";
+	return nfailed ? 1 : 0;
+}
+}
+
+/// Count and print a failed condition, without stopping
+#define CHECK(condition)																								\
+	do {																																	\
+		if(!(condition)) {																									\
+			++nfailed;																												\
+			std::cerr << __FILE__ << ":" << __LINE__ << ": failed: " #condition "\n"; \
+		}																																		\
+	} while(0)
+
+#ifdef TESTS_NEED_APP
+#include "Rint.hxx"
+
+namespace
+{
+/// Batch application without a GUI, with the events of the user code registered
+rb::Rint* create_app() {
+	static char name[] = "rbtest", batch[] = "-b", nogui[] = "-ng";
+	static char* argv[] = { name, batch, nogui, 0 };
+	static int argc = 3;
+	return new rb::Rint("Rootbeer", &argc, argv, 0, 0, kTRUE);
+}
+
+/// Code of the first registered event, for the histograms of the tests
+Int_t first_event_code() {
+	rb::EventVector_t events = rb::gApp()->GetEventVector();
+	return events.empty() ? -1 : events.front().first;
+}
+}
+#endif
+
+#endif
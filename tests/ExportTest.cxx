@@ -0,0 +1,112 @@
+//! \file ExportTest.cxx
+//! \brief Reads histograms published by rb::hist::Export through rb::hist::ExportReader, checks that the
+//! sequence lock catches publications during a read, and that only closed segments are replaced.
+#include <string>
+#include <vector>
+#include <cstring>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <TSystem.h>
+#include "hist/Export.hxx"
+#include "hist/Hist.hxx"
+#include "Rootbeer.hxx"
+#define TESTS_NEED_APP
+#include "Check.hxx"
+
+namespace
+{
+/// Name of the test segment
+const char* kSegment = "/rbtest_export";
+
+/// Time between publications (seconds)
+const Double_t kPeriod = 0.02;
+
+/// Published copy of \c path, or null
+const rb::hist::Snapshot* find(const std::vector<rb::hist::Snapshot>& snapshots, const std::string& path) {
+	for(std::vector<rb::hist::Snapshot>::const_iterator it = snapshots.begin(); it != snapshots.end(); ++it)
+		 if(it->fPath == path) return &*it;
+	return 0;
+}
+
+/// Wait (up to a second) for a publication where bin \c bin of \c path holds \c content
+Bool_t wait_for(rb::hist::ExportReader& reader, const std::string& path, UInt_t bin, Double_t content) {
+	for(Int_t i=0; i< 100; ++i) {
+		std::vector<rb::hist::Snapshot> snapshots;
+		const rb::hist::Snapshot* snapshot = reader.Read(snapshots) ? find(snapshots, path) : 0;
+		if(snapshot && bin < snapshot->fBins.size() && snapshot->fBins[bin] == content) return true;
+		gSystem->Sleep(10);
+	}
+	return false;
+}
+
+/// Leave behind a segment that looks like an exporter's, closed or not
+void fake_segment(Bool_t closed) {
+	shm_unlink(kSegment);
+	const int fd = shm_open(kSegment, O_RDWR | O_CREAT | O_EXCL, 0644);
+	CHECK(fd >= 0);
+	if(fd < 0) return;
+	CHECK(ftruncate(fd, sizeof(rb::hist::shm::Header)) == 0);
+	rb::hist::shm::Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.fMagic, rb::hist::shm::kMagic, sizeof(header.fMagic));
+	header.fFormat = rb::hist::shm::kFormat;
+	header.fSequence = 2;
+	header.fSize = sizeof(header);
+	header.fClosed = closed;
+	CHECK(pwrite(fd, &header, sizeof(header), 0) == ssize_t(sizeof(header)));
+	close(fd);
+}
+}
+
+Int_t main() {
+	rb::Rint* app = create_app();
+	rb::hist::Base* hist = rb::hist::New("exp", "export test", 10, 0, 10, "0", "", first_event_code());
+	CHECK(hist != 0);
+	if(!hist) return report("ExportTest");
+	hist->AddBinContent(4, 6);
+
+	shm_unlink(kSegment);
+	CHECK(rb::hist::Export::Start(kSegment, kPeriod));
+	rb::hist::ExportReader reader;
+	CHECK(reader.Open(kSegment));
+	CHECK(wait_for(reader, "/exp", 4, 6));
+
+	// A consistent read: the sequence is even and unchanged as long as nothing is published
+	const ULong64_t sequence = reader.BeginRead();
+	CHECK(sequence != 0 && sequence % 2 == 0);
+	CHECK(reader.GetHeader()->fNhists >= 1);
+	// Publications meanwhile invalidate it
+	gSystem->Sleep(Int_t(10 * kPeriod * 1e3));
+	CHECK(!reader.EndRead(sequence));
+	CHECK(reader.EndRead(reader.BeginRead()) || reader.EndRead(reader.BeginRead()));
+
+	hist->AddBinContent(4, 1);
+	CHECK(wait_for(reader, "/exp", 4, 7));
+
+	// Stopped: closed, but the last publication stays readable
+	rb::hist::Export::Stop();
+	CHECK(reader.BeginRead() != 0);
+	CHECK(reader.GetHeader()->fClosed != 0);
+	std::vector<rb::hist::Snapshot> last;
+	CHECK(reader.Read(last));
+	CHECK(find(last, "/exp") != 0);
+	reader.Close();
+
+	// Someone else's live segment is left alone; a closed one is replaced
+	fake_segment(false);
+	CHECK(!rb::hist::Export::Start(kSegment, kPeriod));
+	CHECK(!rb::hist::Export::IsRunning());
+	fake_segment(true);
+	CHECK(rb::hist::Export::Start(kSegment, kPeriod));
+	CHECK(reader.Open(kSegment));
+	CHECK(wait_for(reader, "/exp", 4, 7));
+	reader.Close();
+	rb::hist::Export::Stop();
+	shm_unlink(kSegment);
+
+	delete hist;
+	const Int_t status = report("ExportTest");
+	app->Terminate(status);
+	return status;
+}
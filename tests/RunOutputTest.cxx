@@ -0,0 +1,103 @@
+//! \file RunOutputTest.cxx
+//! \brief Drives rb::hist::RunOutput through run transitions, checking that a stopped run is swapped out
+//! only once its buffered events are unpacked, and saved with all of them.
+#include <TH1.h>
+#include <TFile.h>
+#include <TString.h>
+#include <TSystem.h>
+#include "hist/RunOutput.hxx"
+#include "hist/Hist.hxx"
+#include "Rootbeer.hxx"
+#ifdef MIDAS_BUFFERS
+#include "User.hxx"
+#endif
+#define TESTS_NEED_APP
+#include "Check.hxx"
+
+namespace
+{
+/// File name pattern of the test runs
+const char* kPattern = "RunOutputTest_%d.root";
+
+#ifdef MIDAS_BUFFERS
+/// Calls the transition handlers rb::Midas registers online
+struct Transitions: public rb::Midas
+{
+	 static void Start(Int_t run) { rb::Midas::RunStart(0, run, 0); }
+	 static void Stop(Int_t run) { rb::Midas::RunStop(0, run, 0); }
+};
+#else
+/// Calls what the transition handlers of a data source call
+struct Transitions
+{
+	 static void Start(Int_t run) { rb::hist::RunOutput::RunStart(run); }
+	 static void Stop(Int_t run) { rb::hist::RunOutput::RunStopping(run); }
+};
+#endif
+
+/// Content of bin \c bin of \c name in the file of run \c run, -1 if missing
+Double_t saved_content(Int_t run, const char* name, Int_t bin) {
+	TFile file(Form(kPattern, run), "READ");
+	if(file.IsZombie()) return -1;
+	TH1* hist = dynamic_cast<TH1*>(file.Get(name));
+	const Double_t out = hist ? hist->GetBinContent(bin) : -1;
+	delete hist;
+	return out;
+}
+}
+
+Int_t main() {
+	rb::Rint* app = create_app();
+	TH1::AddDirectory(false);
+	rb::hist::Base* hist = rb::hist::New("rot", "run output test", 10, 0, 10, "0", "", first_event_code());
+	CHECK(hist != 0);
+	if(!hist) return report("RunOutputTest");
+	for(Int_t run = 1; run<= 4; ++run)
+		 gSystem->Unlink(Form(kPattern, run));
+	CHECK(rb::hist::RunOutput::Enable(kPattern));
+
+	// Stop transition, then the rest of the run's events: swapped once they are unpacked
+	Transitions::Start(1);
+	hist->AddBinContent(2, 3);
+	Transitions::Stop(1);
+	hist->AddBinContent(2, 1);
+	CHECK(hist->GetBinContent(2) == 4);
+	rb::hist::RunOutput::Drained();
+	CHECK(hist->GetBinContent(2) == 0);
+	// Unpacking the end-of-run event afterwards changes nothing
+	hist->AddBinContent(2, 5);
+	rb::hist::RunOutput::RunStop(1);
+	rb::hist::RunOutput::Drained();
+	CHECK(hist->GetBinContent(2) == 5);
+
+	// The end-of-run event before the buffer runs dry
+	Transitions::Start(2);
+	Transitions::Stop(2);
+	hist->AddBinContent(3, 2);
+	rb::hist::RunOutput::RunStop(2);
+	CHECK(hist->GetBinContent(3) == 0);
+	hist->AddBinContent(3, 1);
+	rb::hist::RunOutput::Drained();
+	CHECK(hist->GetBinContent(3) == 1);
+
+	// Never drained: the next run starts with its own histograms
+	Transitions::Start(3);
+	hist->AddBinContent(4, 7);
+	Transitions::Stop(3);
+	Transitions::Start(4);
+	CHECK(hist->GetBinContent(4) == 0);
+	rb::hist::RunOutput::RunStop(4);
+
+	rb::hist::RunOutput::Disable(); // returns once the queued runs are written
+	CHECK(saved_content(1, "rot", 2) == 4);
+	CHECK(saved_content(2, "rot", 2) == 5);
+	CHECK(saved_content(2, "rot", 3) == 2);
+	CHECK(saved_content(3, "rot", 4) == 7);
+	for(Int_t run = 1; run<= 4; ++run)
+		 gSystem->Unlink(Form(kPattern, run));
+
+	delete hist;
+	const Int_t status = report("RunOutputTest");
+	app->Terminate(status);
+	return status;
+}
@@ -0,0 +1,98 @@
+//! \file ServerTest.cxx
+//! \brief Lists, gets and updates histograms through rb::hist::Server and rb::hist::Client over loopback,
+//! including a histogram redefined between requests.
+#include <string>
+#include <vector>
+#include "hist/Server.hxx"
+#include "hist/Hist.hxx"
+#include "Rootbeer.hxx"
+#define TESTS_NEED_APP
+#include "Check.hxx"
+
+namespace
+{
+/// Port of the test server
+const Int_t kPort = 9473;
+
+/// Listed definition of \c path, or null
+const rb::hist::Snapshot* find(const std::vector<rb::hist::Snapshot>& snapshots, const std::string& path) {
+	for(std::vector<rb::hist::Snapshot>::const_iterator it = snapshots.begin(); it != snapshots.end(); ++it)
+		 if(it->fPath == path) return &*it;
+	return 0;
+}
+}
+
+Int_t main() {
+	rb::Rint* app = create_app();
+	const Int_t code = first_event_code();
+	CHECK(code >= 0);
+	rb::hist::Base* hist = rb::hist::New("srv", "server test", 10, 0, 10, "0", "", code);
+	CHECK(hist != 0);
+	if(!hist) return report("ServerTest");
+	hist->AddBinContent(3, 5);
+
+	CHECK(rb::hist::Server::Start(kPort, 0, false));
+	rb::hist::Client client;
+	CHECK(client.Connect("localhost", kPort));
+
+	// list: definitions only
+	std::vector<rb::hist::Snapshot> listed;
+	CHECK(client.List(listed));
+	const rb::hist::Snapshot* definition = find(listed, "/srv");
+	CHECK(definition != 0);
+	if(definition) {
+		CHECK(definition->fTitle == "server test");
+		CHECK(definition->fNdimensions == 1 && definition->fNbins[0] == 10);
+		CHECK(definition->fLow[0] == 0 && definition->fHigh[0] == 10);
+	}
+
+	// get: everything the first time
+	Int_t nchanged = 0;
+	const rb::hist::Snapshot* copy = client.Update("/srv", &nchanged);
+	CHECK(copy != 0);
+	if(copy) {
+		CHECK(copy->fBins.size() == 12);
+		CHECK(nchanged == 12);
+		CHECK(copy->fBins.size() == 12 && copy->fBins[3] == 5);
+	}
+
+	// delta: only the changed cell
+	hist->AddBinContent(7, 2);
+	copy = client.Update("/srv", &nchanged);
+	CHECK(copy != 0);
+	if(copy) {
+		CHECK(nchanged == 1);
+		CHECK(copy->fBins.size() == 12 && copy->fBins[3] == 5 && copy->fBins[7] == 2);
+	}
+	copy = client.Update("/srv", &nchanged);
+	CHECK(copy != 0 && nchanged == 0);
+
+	// Redefined: the stale copy is refused, and listing again picks up the new binning
+	delete hist;
+	hist = rb::hist::New("srv", "server test", 20, 0, 10, "0", "", code);
+	CHECK(hist != 0);
+	if(hist) hist->AddBinContent(11, 3);
+	CHECK(client.Update("/srv") == 0);
+	CHECK(client.IsConnected());
+	CHECK(client.List(listed));
+	definition = find(listed, "/srv");
+	CHECK(definition != 0 && definition->fNbins[0] == 20);
+	copy = client.Update("/srv", &nchanged);
+	CHECK(copy != 0);
+	if(copy) {
+		CHECK(copy->fBins.size() == 22 && nchanged == 22);
+		CHECK(copy->fBins.size() == 22 && copy->fBins[11] == 3 && copy->fBins[3] == 0);
+	}
+
+	// Deleted
+	delete hist;
+	CHECK(client.List(listed));
+	CHECK(find(listed, "/srv") == 0);
+
+	client.Disconnect();
+	rb::hist::Server::Stop();
+	CHECK(!rb::hist::Server::IsRunning());
+	const Int_t status = report("ServerTest");
+	app->Terminate(status);
+	return status;
+}
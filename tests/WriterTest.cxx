@@ -0,0 +1,90 @@
+//! \file WriterTest.cxx
+//! \brief Round trips histograms through rb::hist::WriteSnapshots(), compressed, uncompressed and across
+//! the switch to 64 bit file offsets.
+#include <string>
+#include <vector>
+#include <TH1.h>
+#include <TKey.h>
+#include <TFile.h>
+#include <TString.h>
+#include <TSystem.h>
+#include <TParameter.h>
+#include "hist/Writer.hxx"
+#include "hist/Snapshot.hxx"
+#include "Check.hxx"
+
+namespace
+{
+/// 1d snapshot with \c nbins bins, mostly empty (so that it compresses) with a peak
+rb::hist::Snapshot make_snapshot(const std::string& name, Int_t nbins) {
+	rb::hist::Snapshot snapshot;
+	snapshot.fPath = "/" + name;
+	snapshot.fTitle = name + " title";
+	snapshot.fNdimensions = 1;
+	snapshot.fNbins[0] = nbins;
+	snapshot.fLow[0] = 0;
+	snapshot.fHigh[0] = nbins;
+	snapshot.fBins.assign(nbins + 2, 0.);
+	for(Int_t i = nbins / 2; i< nbins / 2 + 10; ++i)
+		 snapshot.fBins[i] = i;
+	snapshot.fEntries = 10;
+	snapshot.fAxisTitles[0] = "x";
+	snapshot.fLine.SetLineColor(kRed);
+	return snapshot;
+}
+
+/// Write \c snapshots to \c filename at compression level \c level, starting \c offset bytes in, and read them back
+void round_trip(const char* filename, Int_t level, Long64_t offset, Int_t nbins) {
+	std::vector<rb::hist::Snapshot> snapshots;
+	for(Int_t i=0; i< 5; ++i)
+		 snapshots.push_back(make_snapshot(Form("hist%d", i), nbins));
+	snapshots[1].fScaleFactor = 4;
+	{
+		TFile file(filename, "RECREATE", "", level);
+		CHECK(!file.IsZombie());
+		if(offset) file.SetEND(offset);
+		CHECK(rb::hist::WriteSnapshots(snapshots, &file) == Int_t(snapshots.size()));
+		file.Close();
+	}
+
+	TFile file(filename, "READ");
+	CHECK(!file.IsZombie());
+	Bool_t big = false;
+	for(UInt_t i=0; i< snapshots.size(); ++i) {
+		const std::string name = snapshots[i].GetName();
+		TKey* key = file.GetKey(name.c_str());
+		CHECK(key != 0);
+		if(!key) continue;
+		big = big || key->GetSeekKey() > TFile::kStartBigFile;
+		if(level > 0) CHECK(key->GetNbytes() - key->GetKeylen() < key->GetObjlen());
+		if(level == 0) CHECK(key->GetNbytes() - key->GetKeylen() == key->GetObjlen());
+		TH1* hist = dynamic_cast<TH1*>(key->ReadObj());
+		CHECK(hist != 0);
+		if(!hist) continue;
+		CHECK(snapshots[i].fTitle == hist->GetTitle());
+		CHECK(hist->GetNbinsX() == nbins);
+		for(Int_t bin = 0; bin< nbins + 2; ++bin)
+			 CHECK(hist->GetBinContent(bin) == snapshots[i].fBins[bin]);
+		CHECK(std::string("x") == hist->GetXaxis()->GetTitle());
+		CHECK(hist->GetLineColor() == kRed);
+		delete hist;
+		TParameter<Double_t>* scale =
+			 dynamic_cast<TParameter<Double_t>*>(file.Get(rb::hist::Snapshot::ScaleName(name).c_str()));
+		CHECK((scale != 0) == (snapshots[i].fScaleFactor != 1));
+		if(scale) CHECK(scale->GetVal() == snapshots[i].fScaleFactor);
+		delete scale;
+	}
+	// Starting just short of it, the first key is still 32 bit and the rest need re-packing
+	CHECK(big == (offset != 0));
+	file.Close();
+	gSystem->Unlink(filename);
+}
+}
+
+Int_t main() {
+	TH1::AddDirectory(false);
+	round_trip("WriterTest_compressed.root", 1, 0, 1000);
+	round_trip("WriterTest_uncompressed.root", 0, 0, 1000);
+	round_trip("WriterTest_big.root", 1, TFile::kStartBigFile - 100, 1000);
+	return report("WriterTest");
+}